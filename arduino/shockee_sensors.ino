@@ -7,6 +7,11 @@ const int ENCODER_PIN_B = 3;
 const int HX711_DOUT_PIN = 4;
 const int HX711_SCK_PIN = 5;
 
+// Interlock output: HIGH lets the rig's drive run (e.g. through a relay on
+// its contactor), LOW stops it. The host sends STOP when a limit trips and
+// RESUME when the alarm is reset.
+const int INTERLOCK_PIN = 6;
+
 // HX711 load cell amplifier
 HX711 scale;
 
@@ -14,7 +19,12 @@ HX711 scale;
 volatile long encoderPosition = 0;
 volatile bool encoderA_prev = false;
 
-// Calibration values
+// Raw output streams ADC steps and HX711 counts and leaves calibration to
+// the host (Tools > Calibration), which keeps the raw values in the session.
+// Set to false for the older calibrated mm/kg output.
+const bool RAW_OUTPUT = true;
+
+// Calibration values, used only without RAW_OUTPUT
 float loadCellCalibration = 1.0; // Adjust based on your load cell
 float potentiometerScale = 75.0 / 1023.0; // 75mm / 1023 ADC steps
 
@@ -41,8 +51,15 @@ void setup() {
   // Initialize potentiometer pin
   pinMode(POTENTIOMETER_PIN, INPUT);
   
+  pinMode(INTERLOCK_PIN, OUTPUT);
+  digitalWrite(INTERLOCK_PIN, HIGH);
+  
   Serial.println("# Shockee Sensor Data");
-  Serial.println("# Format: timestamp,position_mm,force_kg,encoder_pulses");
+  if (RAW_OUTPUT) {
+    Serial.println("# Channels: timestamp[ms]:int,position_raw[adc]:int,force_raw[counts]:int,encoder[pulses]:int");
+  } else {
+    Serial.println("# Format: timestamp,position_mm,force_kg,encoder_pulses");
+  }
   
   delay(1000); // Allow sensors to stabilize
 }
@@ -53,12 +70,12 @@ void loop() {
   if (currentTime - lastSampleTime >= SAMPLE_INTERVAL) {
     // Read potentiometer (position)
     int potValue = analogRead(POTENTIOMETER_PIN);
-    float position = potValue * potentiometerScale;
     
-    // Read load cell (force)
-    float force = 0.0;
+    // Read load cell (force); the last reading is repeated while the HX711
+    // converts
+    static long loadCounts = 0;
     if (scale.is_ready()) {
-      force = scale.get_units(1); // Average of 1 reading for speed
+      loadCounts = scale.read();
     }
     
     // Read encoder position
@@ -67,21 +84,33 @@ void loop() {
     // Send data in CSV format
     Serial.print(currentTime);
     Serial.print(",");
-    Serial.print(position, 2);
-    Serial.print(",");
-    Serial.print(force, 2);
+    if (RAW_OUTPUT) {
+      Serial.print(potValue);
+      Serial.print(",");
+      Serial.print(loadCounts);
+    } else {
+      Serial.print(potValue * potentiometerScale, 2);
+      Serial.print(",");
+      Serial.print((loadCounts - scale.get_offset()) / scale.get_scale(), 2);
+    }
     Serial.print(",");
     Serial.println(currentEncoderPos);
     
     lastSampleTime = currentTime;
   }
   
-  // Check for calibration commands
+  // Check for interlock and calibration commands
   if (Serial.available() > 0) {
     String command = Serial.readStringUntil('\n');
     command.trim();
     
-    if (command == "TARE") {
+    if (command == "STOP") {
+      digitalWrite(INTERLOCK_PIN, LOW);
+      Serial.println("# Stopped");
+    } else if (command == "RESUME") {
+      digitalWrite(INTERLOCK_PIN, HIGH);
+      Serial.println("# Resumed");
+    } else if (command == "TARE") {
       scale.tare();
       Serial.println("# Load cell tared");
     } else if (command == "RESET_ENCODER") {
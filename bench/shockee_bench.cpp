@@ -0,0 +1,522 @@
+// Performance benchmarks for ingest, storage, analysis and rendering.
+//
+// All inputs are synthetic: a 2 Hz, 30 mm stroke sampled at 1 kHz with a
+// little deterministic noise, so runs are repeatable between releases.
+// Kernels that stream (parsing, streaming velocity) go up to 100M samples;
+// kernels that hold a whole session stop at 10M, JSON at 1M, to keep the
+// working set within a desktop's memory.
+//
+// Run through the "bench" target to get JSON results in the build tree, or
+// pass --benchmark_out=<file> --benchmark_out_format=json directly.
+
+#include <benchmark/benchmark.h>
+
+#include <QApplication>
+#include <QBuffer>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QtMath>
+#include <map>
+
+#include "sensorstreamparser.h"
+#include "velocityestimator.h"
+#include "datalogger.h"
+#include "sessionjson.h"
+#include "csvimporter.h"
+#include "dampinganalyzer.h"
+#include "resampler.h"
+#include "sessionaligner.h"
+#include "plotwidget.h"
+#include "pointindex.h"
+
+namespace {
+
+const int SAMPLE_RATE = 1000;           // Hz
+const int LINE_BLOCK = 10000;           // distinct protocol lines per replayed block
+const int RENDER_WIDTH = 1280;
+const int RENDER_HEIGHT = 720;
+
+SensorData syntheticSample(qint64 index)
+{
+    // Cheap LCG noise keeps the series reproducible without <random> state
+    quint32 noise = quint32(index) * 1664525u + 1013904223u;
+    double jitter = (noise >> 8) / double(1 << 24) - 0.5;
+
+    double t = double(index) / SAMPLE_RATE;
+    double phase = 2.0 * M_PI * 2.0 * t;
+
+    SensorData data;
+    data.timestamp = index + 1;
+    data.timestampUs = data.timestamp * 1000;
+    data.position = 37.5 + 30.0 * qSin(phase) + 0.05 * jitter;
+    data.velocity = 30.0 * 2.0 * M_PI * 2.0 * qCos(phase);
+    data.force = 0.12 * data.velocity + 0.8 * (data.position - 37.5) + 0.2 * jitter;
+    data.encoderPulses = long(data.position * 40.0);
+    return data;
+}
+
+// Sessions are built once per size and shared by every benchmark using it
+const QVector<SensorData>& syntheticSession(qint64 count)
+{
+    static std::map<qint64, QVector<SensorData>> cache;
+    auto it = cache.find(count);
+    if (it == cache.end()) {
+        QVector<SensorData> data(count);
+        for (qint64 i = 0; i < count; ++i) {
+            data[i] = syntheticSample(i);
+        }
+        it = cache.emplace(count, std::move(data)).first;
+    }
+    return it->second;
+}
+
+// Force against position is unsorted in x, so cursors index it in a k-d tree
+QVector<QPointF> forcePositionPoints(qint64 count)
+{
+    QVector<QPointF> points;
+    points.reserve(count);
+    for (const SensorData& data : syntheticSession(count)) {
+        points.append(QPointF(data.position, data.force));
+    }
+    return points;
+}
+
+Session syntheticSessionObject(qint64 count)
+{
+    Session session;
+    session.name = "bench";
+    session.strut_info = "synthetic";
+    session.data = syntheticSession(count);
+    return session;
+}
+
+QString protocolLine(const SensorData& data)
+{
+    return QString("%1,%2,%3,%4").arg(data.timestamp).arg(data.position, 0, 'f', 2)
+                                 .arg(data.force, 0, 'f', 2).arg(data.encoderPulses);
+}
+
+const QStringList& protocolLines()
+{
+    static QStringList lines;
+    if (lines.isEmpty()) {
+        for (int i = 0; i < LINE_BLOCK; ++i) {
+            lines << protocolLine(syntheticSample(i));
+        }
+    }
+    return lines;
+}
+
+const QByteArray& protocolBlock()
+{
+    static QByteArray block;
+    if (block.isEmpty()) {
+        block = protocolLines().join("\r\n").toUtf8() + "\r\n";
+    }
+    return block;
+}
+
+void sampleCounts(benchmark::internal::Benchmark* bench, qint64 maxCount)
+{
+    for (qint64 count = 10000; count <= maxCount; count *= 10) {
+        bench->Arg(count);
+    }
+}
+
+void streamingSizes(benchmark::internal::Benchmark* bench) { sampleCounts(bench, 100000000); }
+void sessionSizes(benchmark::internal::Benchmark* bench) { sampleCounts(bench, 10000000); }
+void jsonSizes(benchmark::internal::Benchmark* bench) { sampleCounts(bench, 1000000); }
+
+void velocityMethods(benchmark::internal::Benchmark* bench, qint64 maxCount)
+{
+    bench->ArgNames({ "method", "samples" });
+    for (int method : { VelocityEstimator::MovingAverage, VelocityEstimator::SavitzkyGolay,
+                        VelocityEstimator::AlphaBeta, VelocityEstimator::CentralDifference }) {
+        for (qint64 count = 10000; count <= maxCount; count *= 10) {
+            bench->Args({ method, count });
+        }
+    }
+}
+
+void streamingVelocityArgs(benchmark::internal::Benchmark* bench) { velocityMethods(bench, 100000000); }
+void offlineVelocityArgs(benchmark::internal::Benchmark* bench) { velocityMethods(bench, 10000000); }
+
+void resampleArgs(benchmark::internal::Benchmark* bench)
+{
+    bench->ArgNames({ "mode", "samples" });
+    for (int mode : { Resampler::Linear, Resampler::WindowedSinc }) {
+        for (qint64 count = 10000; count <= 10000000; count *= 10) {
+            bench->Args({ mode, count });
+        }
+    }
+}
+
+void setItems(benchmark::State& state, qint64 count)
+{
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["samples"] = double(count);
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Ingest
+
+static void BM_ParseDataLine(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    const QStringList& lines = protocolLines();
+
+    for (auto _ : state) {
+        for (qint64 i = 0; i < count; ++i) {
+            SensorData data = SensorStreamParser::parseDataLine(lines[i % LINE_BLOCK]);
+            benchmark::DoNotOptimize(data);
+        }
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_ParseDataLine)->Apply(streamingSizes)->Unit(benchmark::kMillisecond);
+
+// Framing + parsing + streaming velocity, fed in serial-port sized chunks.
+// The block of lines is replayed, so timestamps repeat every LINE_BLOCK.
+static void BM_StreamParserFeed(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    const QByteArray& block = protocolBlock();
+    const int chunkSize = 4096;
+
+    for (auto _ : state) {
+        SensorStreamParser parser;
+        qint64 parsed = 0;
+        while (parsed < count) {
+            for (int offset = 0; offset < block.size() && parsed < count; offset += chunkSize) {
+                parsed += parser.feed(block.mid(offset, chunkSize)).size();
+            }
+        }
+        benchmark::DoNotOptimize(parsed);
+    }
+    setItems(state, count);
+    state.SetBytesProcessed(state.iterations() * count * (block.size() / LINE_BLOCK));
+}
+BENCHMARK(BM_StreamParserFeed)->Apply(streamingSizes)->Unit(benchmark::kMillisecond);
+
+// The live calculateVelocity() path: one estimator update per sample
+static void BM_VelocityUpdate(benchmark::State& state)
+{
+    const auto method = static_cast<VelocityEstimator::Method>(state.range(0));
+    const qint64 count = state.range(1);
+    const QVector<SensorData>& block = syntheticSession(LINE_BLOCK);
+
+    for (auto _ : state) {
+        std::unique_ptr<VelocityEstimator> estimator = VelocityEstimator::create(method);
+        double sum = 0;
+        for (qint64 i = 0; i < count; ++i) {
+            const SensorData& data = block[i % LINE_BLOCK];
+            sum += estimator->update((i + 1) * 1000, data.position);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    setItems(state, count);
+    state.SetLabel(VelocityEstimator::methodName(method).toStdString());
+}
+BENCHMARK(BM_VelocityUpdate)->Apply(streamingVelocityArgs)->Unit(benchmark::kMillisecond);
+
+static void BM_VelocityRecompute(benchmark::State& state)
+{
+    const auto method = static_cast<VelocityEstimator::Method>(state.range(0));
+    const qint64 count = state.range(1);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        QVector<SensorData> data = syntheticSession(count);
+        data.detach();
+        state.ResumeTiming();
+
+        VelocityEstimator::recompute(data, method);
+        benchmark::DoNotOptimize(data.constData());
+    }
+    setItems(state, count);
+    state.SetLabel(VelocityEstimator::methodName(method).toStdString());
+}
+BENCHMARK(BM_VelocityRecompute)->Apply(offlineVelocityArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// ---------------------------------------------------------------------------
+// Storage
+
+static void BM_SessionToJson(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    const Session session = syntheticSessionObject(count);
+    DataLogger logger;
+
+    for (auto _ : state) {
+        QByteArray bytes = QJsonDocument(logger.sessionToJson(session)).toJson();
+        benchmark::DoNotOptimize(bytes.constData());
+        state.counters["bytes_per_sample"] = double(bytes.size()) / count;
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_SessionToJson)->Apply(jsonSizes)->Unit(benchmark::kMillisecond);
+
+static void BM_SessionFromJson(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    DataLogger logger;
+    const QByteArray bytes = QJsonDocument(logger.sessionToJson(syntheticSessionObject(count))).toJson();
+
+    for (auto _ : state) {
+        Session session = logger.sessionFromJson(QJsonDocument::fromJson(bytes).object());
+        benchmark::DoNotOptimize(session.data.constData());
+    }
+    setItems(state, count);
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_SessionFromJson)->Apply(jsonSizes)->Unit(benchmark::kMillisecond);
+
+// Same document through the streaming reader and writer behind save/loadSession
+static void BM_SessionJsonWrite(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    const Session session = syntheticSessionObject(count);
+
+    for (auto _ : state) {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        SessionJson writer;
+        bool ok = writer.write(session, &buffer);
+        benchmark::DoNotOptimize(ok);
+        state.counters["bytes_per_sample"] = double(buffer.size()) / count;
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_SessionJsonWrite)->Apply(jsonSizes)->Unit(benchmark::kMillisecond);
+
+static void BM_SessionJsonRead(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    SessionJson writer;
+    writer.write(syntheticSessionObject(count), &buffer);
+    const QByteArray bytes = buffer.data();
+
+    for (auto _ : state) {
+        Session session;
+        SessionJson reader;
+        bool ok = reader.read(bytes.constData(), bytes.size(), &session);
+        benchmark::DoNotOptimize(ok);
+        benchmark::DoNotOptimize(session.data.constData());
+    }
+    setItems(state, count);
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_SessionJsonRead)->Apply(jsonSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ExportCsv(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    const Session session = syntheticSessionObject(count);
+    DataLogger logger;
+    QTemporaryDir dir;
+    const QString filename = dir.filePath("bench.csv");
+
+    for (auto _ : state) {
+        bool ok = logger.exportToCsv(session, filename);
+        benchmark::DoNotOptimize(ok);
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_ExportCsv)->Apply(sessionSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Reads back what BM_ExportCsv writes, so includes the velocity column
+static void BM_ImportCsv(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    DataLogger logger;
+    QTemporaryDir dir;
+    const QString filename = dir.filePath("bench.csv");
+    if (!logger.exportToCsv(syntheticSessionObject(count), filename)) {
+        state.SkipWithError("CSV export failed");
+        return;
+    }
+
+    for (auto _ : state) {
+        CsvImporter importer;
+        Session session;
+        bool ok = importer.importSession(filename, &session);
+        benchmark::DoNotOptimize(ok);
+    }
+    setItems(state, count);
+    state.SetBytesProcessed(state.iterations() * QFileInfo(filename).size());
+}
+BENCHMARK(BM_ImportCsv)->Apply(sessionSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// ---------------------------------------------------------------------------
+// Analysis
+
+static void BM_DampingCurve(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    const QVector<SensorData>& data = syntheticSession(count);
+
+    for (auto _ : state) {
+        DampingAnalyzer analyzer;
+        analyzer.addSamples(data);
+        benchmark::DoNotOptimize(analyzer.sampleCount());
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_DampingCurve)->Apply(sessionSizes)->Unit(benchmark::kMillisecond);
+
+// Down to half the input rate, so the sinc kernel also filters
+static void BM_Resample(benchmark::State& state)
+{
+    const auto mode = static_cast<Resampler::Mode>(state.range(0));
+    const qint64 count = state.range(1);
+    const QVector<SensorData>& data = syntheticSession(count);
+
+    for (auto _ : state) {
+        UniformSeries series = Resampler::resample(data, SAMPLE_RATE / 2.0, mode);
+        benchmark::DoNotOptimize(series.position.constData());
+    }
+    setItems(state, count);
+    state.SetLabel(Resampler::modeName(mode).toStdString());
+}
+BENCHMARK(BM_Resample)->Apply(resampleArgs)->Unit(benchmark::kMillisecond);
+
+// Against a copy 250 ms late; long runs take the decimated search first
+static void BM_AlignSessions(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    const QVector<SensorData>& reference = syntheticSession(count);
+    const QVector<SensorData> other = SessionAligner::shifted(reference, 250);
+
+    for (auto _ : state) {
+        AlignmentResult result = SessionAligner::align(reference, other);
+        benchmark::DoNotOptimize(result.offset);
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_AlignSessions)->Apply(sessionSizes)->Unit(benchmark::kMillisecond);
+
+// ---------------------------------------------------------------------------
+// Rendering
+
+// setAutoScale(true) reruns calculateBounds() and updateScales() on the series
+static void BM_CalculateBounds(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    PlotWidget plot(PlotWidget::ForceVsPosition);
+    plot.addDataSeries(syntheticSession(count));
+
+    for (auto _ : state) {
+        plot.setAutoScale(true);
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_CalculateBounds)->Apply(sessionSizes)->Unit(benchmark::kMillisecond);
+
+// Live plotting: one point appended per sample; bounds wait for the next repaint
+static void BM_PlotAddDataPoint(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    const QVector<SensorData>& data = syntheticSession(count);
+
+    for (auto _ : state) {
+        PlotWidget plot(PlotWidget::Position);
+        for (const SensorData& point : data) {
+            plot.addDataPoint(point);
+        }
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_PlotAddDataPoint)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Whole paint pass into an offscreen image; dominated by drawDataSeries()
+static void BM_RenderCartesian(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    PlotWidget plot(PlotWidget::ForceVsPosition);
+    plot.resize(RENDER_WIDTH, RENDER_HEIGHT);
+    plot.addDataSeries(syntheticSession(count));
+    QImage image(RENDER_WIDTH, RENDER_HEIGHT, QImage::Format_ARGB32_Premultiplied);
+
+    for (auto _ : state) {
+        plot.render(&image);
+        benchmark::DoNotOptimize(image.constBits());
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_RenderCartesian)->Apply(sessionSizes)->Unit(benchmark::kMillisecond);
+
+// Polar comparison view; dominated by drawPolarDataSeries()
+static void BM_RenderPolar(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    PlotWidget plot(PlotWidget::Comparison);
+    plot.resize(RENDER_WIDTH, RENDER_HEIGHT);
+    plot.addDataSeries(syntheticSession(count));
+    QImage image(RENDER_WIDTH, RENDER_HEIGHT, QImage::Format_ARGB32_Premultiplied);
+
+    for (auto _ : state) {
+        plot.render(&image);
+        benchmark::DoNotOptimize(image.constBits());
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_RenderPolar)->Apply(sessionSizes)->Unit(benchmark::kMillisecond);
+
+// ---------------------------------------------------------------------------
+// Plot cursors
+
+// Rebuilt on the first hover after the data changes
+static void BM_CursorIndexBuild(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    const QVector<QPointF> points = forcePositionPoints(count);
+
+    for (auto _ : state) {
+        PointIndex index;
+        index.build(points);
+        benchmark::DoNotOptimize(index.size());
+    }
+    setItems(state, count);
+}
+BENCHMARK(BM_CursorIndexBuild)->Apply(sessionSizes)->Unit(benchmark::kMillisecond);
+
+// One hover lookup; should grow with log(samples), not with samples
+static void BM_CursorLookup(benchmark::State& state)
+{
+    const qint64 count = state.range(0);
+    PointIndex index;
+    index.build(forcePositionPoints(count));
+
+    qint64 query = 0;
+    for (auto _ : state) {
+        const SensorData target = syntheticSample(query++ * 7919);
+        benchmark::DoNotOptimize(index.nearest(QPointF(target.position, target.force), 15.0, 2.0));
+    }
+    state.counters["samples"] = double(count);
+}
+BENCHMARK(BM_CursorLookup)->Apply(sessionSizes);
+
+int main(int argc, char** argv)
+{
+    // Rendering benchmarks need a QApplication but never a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    app.setApplicationName("Shockee");
+    app.setOrganizationName("Shockee Dyno");
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "acquisitionmanager.h"
+
+AcquisitionManager::AcquisitionManager(QObject *parent)
+    : QObject(parent)
+    , m_releaseTimer(new QTimer(this))
+    , m_limits(LimitMonitor::Options::fromSettings())
+{
+    createDevice();
+
+    m_releaseTimer->setInterval(RELEASE_INTERVAL);
+    connect(m_releaseTimer, &QTimer::timeout, this, &AcquisitionManager::releaseMerged);
+    m_releaseTimer->start();
+}
+
+AcquisitionManager::~AcquisitionManager()
+{
+    // Receivers may already be half destroyed; nothing more goes out
+    blockSignals(true);
+
+    while (m_devices.size() > 1) {
+        removeDevice(m_devices.size() - 1);
+    }
+
+    Device& primary = m_devices.first();
+    primary.communicator->disconnect();
+    primary.thread->quit();
+    primary.thread->wait();
+    delete primary.communicator;
+}
+
+SerialCommunicator* AcquisitionManager::device(int index) const
+{
+    return index >= 0 && index < m_devices.size() ? m_devices[index].communicator : nullptr;
+}
+
+bool AcquisitionManager::connectDevice(int index, const QString& portName, int baudRate)
+{
+    if (index < 0 || index >= m_devices.size()) {
+        return false;
+    }
+    m_devices[index].portName = portName;
+    return m_devices[index].communicator->connectToPort(portName, baudRate);
+}
+
+int AcquisitionManager::addDevice(const QString& portName, int baudRate)
+{
+    int index = createDevice();
+    if (!connectDevice(index, portName, baudRate)) {
+        removeDevice(index);
+        return -1;
+    }
+    return index;
+}
+
+void AcquisitionManager::removeDevice(int index)
+{
+    if (index <= 0 || index >= m_devices.size()) {
+        return;
+    }
+
+    // Hand out what is queued before the sources are renumbered
+    emitReleased(m_merger.flush());
+
+    Device device = m_devices.takeAt(index);
+    device.communicator->disconnect();
+    device.thread->quit();
+    device.thread->wait();
+    delete device.communicator;
+    delete device.thread;
+
+    m_merger.setSourceCount(m_devices.size());
+    m_merger.reset();
+}
+
+QStringList AcquisitionManager::portNames() const
+{
+    QStringList names;
+    for (const Device& device : m_devices) {
+        names << device.portName;
+    }
+    return names;
+}
+
+AcquisitionManager::DeviceStats AcquisitionManager::stats(int index) const
+{
+    DeviceStats stats;
+    if (index < 0 || index >= m_devices.size()) {
+        return stats;
+    }
+
+    const Device& device = m_devices[index];
+    stats.portName = device.portName;
+    stats.connected = device.communicator->isConnected();
+    stats.link = device.communicator->linkHealth();
+    stats.merge = m_merger.stats(index);
+    stats.latency = device.latency;
+    stats.limitLatency = device.communicator->limitLatency();
+    return stats;
+}
+
+void AcquisitionManager::resetMerge()
+{
+    emitReleased(m_merger.flush());
+    m_merger.reset();
+    for (Device& device : m_devices) {
+        device.latency.reset();
+    }
+}
+
+void AcquisitionManager::setLimits(const LimitMonitor::Options& options)
+{
+    m_limits = options;
+    for (const Device& device : m_devices) {
+        device.communicator->setLimits(options);
+    }
+}
+
+void AcquisitionManager::resetLimits()
+{
+    for (const Device& device : m_devices) {
+        device.communicator->resetLimits();
+        if (m_limits.stopOnTrip && !m_limits.resumeCommand.isEmpty()) {
+            device.communicator->sendCommand(m_limits.resumeCommand);
+        }
+    }
+}
+
+QStringList AcquisitionManager::unresolvedLimits() const
+{
+    QStringList channels;
+    for (int i = 0; i < m_devices.size(); ++i) {
+        for (const QString& channel : m_devices[i].communicator->unresolvedLimits()) {
+            channels << (i == 0 ? channel : QString("%1 (device %2)").arg(channel).arg(i));
+        }
+    }
+    channels.removeDuplicates();
+    return channels;
+}
+
+void AcquisitionManager::releaseMerged()
+{
+    emitReleased(m_merger.take(LatencyMonitor::now() / 1000));
+}
+
+int AcquisitionManager::createDevice()
+{
+    Device device;
+    device.communicator = new SerialCommunicator();
+    device.thread = new QThread(this);
+    device.thread->setObjectName(QString("Serial I/O %1").arg(m_devices.size()));
+    device.communicator->moveToThread(device.thread);
+
+    // Queued: the communicator emits on its own thread
+    SerialCommunicator* communicator = device.communicator;
+    connect(communicator, &SerialCommunicator::dataReceived, this,
+            [this, communicator](const SensorData& data) { onDeviceData(communicator, data); });
+    connect(communicator, &SerialCommunicator::limitTripped, this,
+            [this, communicator](const LimitTrip& trip) { onLimitTripped(communicator, trip); });
+    communicator->setLimits(m_limits);
+
+    device.thread->start();
+    m_devices.append(device);
+    m_merger.setSourceCount(m_devices.size());
+    return m_devices.size() - 1;
+}
+
+void AcquisitionManager::onDeviceData(SerialCommunicator* communicator, const SensorData& data)
+{
+    for (int i = 0; i < m_devices.size(); ++i) {
+        if (m_devices[i].communicator == communicator) {
+            m_merger.push(i, data);
+            emitReleased(m_merger.take(LatencyMonitor::now() / 1000));
+            return;
+        }
+    }
+}
+
+void AcquisitionManager::onLimitTripped(SerialCommunicator* communicator, LimitTrip trip)
+{
+    for (int i = 0; i < m_devices.size(); ++i) {
+        if (m_devices[i].communicator == communicator) {
+            trip.source = i;
+        } else if (m_limits.stopOnTrip && !m_limits.stopCommand.isEmpty()) {
+            // The drive may be on any board
+            m_devices[i].communicator->sendCommand(m_limits.stopCommand);
+        }
+    }
+    emit limitTripped(trip);
+}
+
+void AcquisitionManager::emitReleased(const QVector<SensorData>& samples)
+{
+    const qint64 now = LatencyMonitor::now();
+    for (const SensorData& data : samples) {
+        if (data.receivedAt > 0 && data.source < m_devices.size()) {
+            m_devices[data.source].latency.record(now - data.receivedAt);
+        }
+        emit sampleReady(data);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef ACQUISITIONMANAGER_H
+#define ACQUISITIONMANAGER_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QStringList>
+
+#include "serialcommunicator.h"
+#include "streammerger.h"
+#include "latencymonitor.h"
+
+// Runs any number of serial devices, each SerialCommunicator on its own I/O
+// thread, and merges their samples by reconstructed timestamp into one
+// time-ordered stream. Device 0 is the primary board; it always exists so
+// the rest of the app can hold on to it.
+class AcquisitionManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct DeviceStats {
+        QString portName;
+        bool connected;
+        LinkHealth link;
+        StreamMerger::SourceStats merge;
+        LatencyHistogram latency;   // ns, port read to merged release
+        LatencyHistogram limitLatency;  // ns, port read to limit check
+
+        DeviceStats() : connected(false) {}
+    };
+
+    explicit AcquisitionManager(QObject *parent = nullptr);
+    ~AcquisitionManager();
+
+    SerialCommunicator* primary() const { return device(0); }
+    SerialCommunicator* device(int index) const;
+    int deviceCount() const { return m_devices.size(); }
+
+    bool connectDevice(int index, const QString& portName, int baudRate = 9600);
+
+    // Adds and connects another device; returns its index, -1 on failure
+    int addDevice(const QString& portName, int baudRate = 9600);
+    // The primary device cannot be removed, only disconnected. Later
+    // devices move down one index.
+    void removeDevice(int index);
+
+    QStringList portNames() const;
+    DeviceStats stats(int index) const;
+
+    // Restarts the merge, e.g. when a recording starts
+    void resetMerge();
+
+    // Checked by every device on its own thread. A trip on one device has
+    // already stopped that one; the stop command then goes to the others.
+    void setLimits(const LimitMonitor::Options& options);
+    const LimitMonitor::Options& limits() const { return m_limits; }
+    // Re-enables checking on every device and sends them the resume command
+    void resetLimits();
+    // Rule channels some device cannot check, "force (device 1)" for
+    // devices after the primary
+    QStringList unresolvedLimits() const;
+
+signals:
+    // Released in timestamp order across all devices; data.source is the device index
+    void sampleReady(const SensorData& data);
+    // trip.source is the device index
+    void limitTripped(const LimitTrip& trip);
+
+private slots:
+    void releaseMerged();
+
+private:
+    struct Device {
+        SerialCommunicator* communicator;
+        QThread* thread;
+        QString portName;
+        LatencyHistogram latency;
+    };
+
+    int createDevice();
+    void onDeviceData(SerialCommunicator* communicator, const SensorData& data);
+    void onLimitTripped(SerialCommunicator* communicator, LimitTrip trip);
+    void emitReleased(const QVector<SensorData>& samples);
+
+    QVector<Device> m_devices;
+    StreamMerger m_merger;
+    QTimer* m_releaseTimer;
+    LimitMonitor::Options m_limits;
+
+    static const int RELEASE_INTERVAL = 20; // ms, lets silent devices time out
+};
+
+#endif // ACQUISITIONMANAGER_H
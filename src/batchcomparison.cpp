@@ -0,0 +1,169 @@
+#include "batchcomparison.h"
+#include <QtConcurrent>
+#include <QFileInfo>
+#include <algorithm>
+
+namespace {
+
+struct SideFit {
+    double peakForce;
+    double maxVelocity;
+    double damping;
+
+    SideFit() : peakForce(0), maxVelocity(0), damping(0) {}
+};
+
+// Count-weighted least squares of force = c * velocity over one direction
+SideFit fitSide(const QVector<DampingBin>& bins)
+{
+    SideFit fit;
+    double sumVF = 0, sumVV = 0;
+    for (const DampingBin& bin : bins) {
+        if (bin.count < BatchComparison::MIN_BIN_SAMPLES) {
+            continue;
+        }
+        sumVF += bin.count * bin.velocity * bin.meanForce;
+        sumVV += bin.count * bin.velocity * bin.velocity;
+        fit.peakForce = qMax(fit.peakForce, qAbs(bin.meanForce));
+        fit.maxVelocity = qMax(fit.maxVelocity, qAbs(bin.velocity));
+    }
+    fit.damping = sumVV > 0 ? sumVF / sumVV : 0.0;
+    return fit;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// SessionSummarizer
+
+SessionSummarizer::SessionSummarizer(const Session& session, double binWidth)
+    : m_damping(binWidth)
+    , m_headIntervals(0)
+    , m_firstTimestamp(0)
+    , m_lastTimestamp(0)
+{
+    m_summary.name = session.name;
+    m_summary.strutInfo = session.strut_info;
+    m_summary.dampingSetting = session.damping_setting;
+}
+
+void SessionSummarizer::addSamples(const QVector<SensorData>& data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+    if (m_summary.sampleCount == 0) {
+        m_firstTimestamp = data.first().timestamp;
+    }
+    m_lastTimestamp = data.last().timestamp;
+    m_summary.sampleCount += data.size();
+
+    m_damping.addSamples(data);
+    for (const SensorData& point : data) {
+        m_hysteresis.addSample(point);
+    }
+
+    for (int i = 0; i < data.size() && m_headIntervals < RATE_INTERVALS; ++i) {
+        if (!m_head.isEmpty() && data[i].timestampUs > m_head.last().timestampUs) {
+            ++m_headIntervals;
+        }
+        m_head.append(data[i]);
+    }
+}
+
+SessionSummary SessionSummarizer::summary() const
+{
+    SessionSummary summary = m_summary;
+    if (summary.sampleCount < 2) {
+        return summary;
+    }
+
+    summary.duration = (m_lastTimestamp - m_firstTimestamp) / 1000.0;
+    summary.sampleRate = Resampler::estimateSampleRate(m_head);
+
+    const QVector<DampingBin> compression = m_damping.compressionCurve();
+    const QVector<DampingBin> rebound = m_damping.reboundCurve();
+
+    // Rebound bins run from slow to fast; walk them backwards for a monotonic x
+    summary.curve.reserve(compression.size() + rebound.size());
+    for (int i = rebound.size() - 1; i >= 0; --i) {
+        if (rebound[i].count >= BatchComparison::MIN_BIN_SAMPLES) {
+            summary.curve.append(QPointF(rebound[i].velocity, rebound[i].meanForce));
+        }
+    }
+    for (const DampingBin& bin : compression) {
+        if (bin.count >= BatchComparison::MIN_BIN_SAMPLES) {
+            summary.curve.append(QPointF(bin.velocity, bin.meanForce));
+        }
+    }
+
+    SideFit compressionFit = fitSide(compression);
+    SideFit reboundFit = fitSide(rebound);
+    summary.peakCompressionForce = compressionFit.peakForce;
+    summary.peakReboundForce = reboundFit.peakForce;
+    summary.maxVelocity = qMax(compressionFit.maxVelocity, reboundFit.maxVelocity);
+    summary.compressionDamping = compressionFit.damping;
+    summary.reboundDamping = reboundFit.damping;
+
+    const QVector<HysteresisCycle>& cycles = m_hysteresis.cycles();
+    summary.cycleCount = cycles.size();
+    summary.energy = cycles.isEmpty() ? 0.0 : cycles.last().cumulativeEnergy;
+
+    summary.valid = !summary.curve.isEmpty();
+    return summary;
+}
+
+// ---------------------------------------------------------------------------
+// BatchComparison
+
+SessionSummary BatchComparison::summarize(const Session& session, double binWidth)
+{
+    SessionSummarizer summarizer(session, binWidth);
+    summarizer.addSamples(session.data);
+    return summarizer.summary();
+}
+
+QVector<SessionSummary> BatchComparison::summarize(const QVector<Session>& sessions, double binWidth)
+{
+    return QtConcurrent::blockingMapped<QVector<SessionSummary>>(sessions,
+        [binWidth](const Session& session) {
+            return summarize(session, binWidth);
+        });
+}
+
+QFuture<SessionSummary> BatchComparison::run(DataLogger* logger, const QStringList& filenames, double binWidth)
+{
+    return QtConcurrent::mapped(filenames, [logger, binWidth](const QString& filename) {
+        SessionSummary summary = summarize(logger->loadSession(filename), binWidth);
+        summary.filePath = filename;
+        if (summary.name.isEmpty()) {
+            summary.name = QFileInfo(filename).completeBaseName();
+        }
+        return summary;
+    });
+}
+
+QVector<QPointF> BatchComparison::normalized(const QVector<QPointF>& curve)
+{
+    double peak = 0;
+    for (const QPointF& point : curve) {
+        peak = qMax(peak, qAbs(point.y()));
+    }
+    if (peak <= 0) {
+        return curve;
+    }
+
+    QVector<QPointF> scaled = curve;
+    for (QPointF& point : scaled) {
+        point.setY(point.y() / peak);
+    }
+    return scaled;
+}
+
+void BatchComparison::sortByDampingSetting(QVector<SessionSummary>& summaries)
+{
+    std::stable_sort(summaries.begin(), summaries.end(),
+                     [](const SessionSummary& a, const SessionSummary& b) {
+                         return a.dampingSetting < b.dampingSetting;
+                     });
+}
@@ -0,0 +1,92 @@
+#ifndef BATCHCOMPARISON_H
+#define BATCHCOMPARISON_H
+
+#include <QVector>
+#include <QPointF>
+#include <QString>
+#include <QStringList>
+#include <QFuture>
+
+#include "datalogger.h"
+
+struct SessionSummary {
+    QString filePath;
+    QString name;
+    QString strutInfo;
+    double dampingSetting;
+    bool valid;
+
+    int sampleCount;
+    double duration;              // s
+    double sampleRate;            // Hz
+    double peakCompressionForce;  // kg, largest binned mean force in compression
+    double peakReboundForce;      // kg, largest binned mean |force| in rebound
+    double maxVelocity;           // mm/s, fastest bin with enough samples
+    double compressionDamping;    // kg*s/mm, least-squares slope through the origin
+    double reboundDamping;        // kg*s/mm
+    int cycleCount;
+    double energy;                // J dissipated over the session
+
+    // Mean force vs velocity, rebound (negative) through compression
+    QVector<QPointF> curve;
+
+    SessionSummary()
+        : dampingSetting(0), valid(false), sampleCount(0), duration(0), sampleRate(0)
+        , peakCompressionForce(0), peakReboundForce(0), maxVelocity(0)
+        , compressionDamping(0), reboundDamping(0), cycleCount(0), energy(0) {}
+
+    double meanCycleEnergy() const { return cycleCount > 0 ? energy / cycleCount : 0.0; }
+};
+
+// summarize() over samples that arrive in chunks, for sessions that are
+// streamed rather than loaded; the result matches summarize() on the whole
+class SessionSummarizer
+{
+public:
+    explicit SessionSummarizer(const Session& session,
+                               double binWidth = DampingAnalyzer::DEFAULT_BIN_WIDTH);
+
+    void addSamples(const QVector<SensorData>& data);
+    SessionSummary summary() const;
+
+private:
+    // Samples kept for Resampler::estimateSampleRate(), which only looks
+    // at the first RATE_INTERVALS of them
+    static const int RATE_INTERVALS = 10000;
+
+    SessionSummary m_summary;
+    DampingAnalyzer m_damping;
+    HysteresisAnalyzer m_hysteresis;
+    QVector<SensorData> m_head;
+    int m_headIntervals;
+    qint64 m_firstTimestamp;
+    qint64 m_lastTimestamp;
+};
+
+// Reduces whole sessions to a damping curve and a handful of figures so that
+// many runs (e.g. every clicker setting of one strut) can be compared at once.
+// Each session is loaded and summarised in its own task on the global thread
+// pool; nothing but the summary is kept once a task finishes.
+class BatchComparison
+{
+public:
+    static SessionSummary summarize(const Session& session,
+                                    double binWidth = DampingAnalyzer::DEFAULT_BIN_WIDTH);
+    static QVector<SessionSummary> summarize(const QVector<Session>& sessions,
+                                             double binWidth = DampingAnalyzer::DEFAULT_BIN_WIDTH);
+
+    // Asynchronous load + summarise; results keep the order of filenames.
+    // The logger is only used for loadSession(), which holds no shared state.
+    static QFuture<SessionSummary> run(DataLogger* logger, const QStringList& filenames,
+                                       double binWidth = DampingAnalyzer::DEFAULT_BIN_WIDTH);
+
+    // Curve scaled so its largest |force| is 1
+    static QVector<QPointF> normalized(const QVector<QPointF>& curve);
+
+    static void sortByDampingSetting(QVector<SessionSummary>& summaries);
+
+    // Bins with fewer samples are left out of the curve and the fits
+    static const int MIN_BIN_SAMPLES = 3;
+};
+
+#endif // BATCHCOMPARISON_H
@@ -0,0 +1,588 @@
+#include "batchprocessor.h"
+#include "spectralanalyzer.h"
+#include "sensorstreamparser.h"
+#include "tracing.h"
+#include "csvexporter.h"
+#include "xlsxexporter.h"
+#include "csvimporter.h"
+#include "sessionjson.h"
+#include <QtConcurrent>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <algorithm>
+
+namespace {
+
+// Samples per chunk when recalibrating; bounds what one task holds
+const int RECALIBRATE_CHUNK_SIZE = 65536;
+
+QJsonArray binsToJson(const QVector<DampingBin>& bins)
+{
+    QJsonArray array;
+    for (const DampingBin& bin : bins) {
+        QJsonObject json;
+        json["velocity"] = bin.velocity;
+        json["mean_force"] = bin.meanForce;
+        json["std_dev_force"] = bin.stdDevForce;
+        json["count"] = bin.count;
+        array.append(json);
+    }
+    return array;
+}
+
+QJsonArray cyclesToJson(const QVector<HysteresisCycle>& cycles)
+{
+    QJsonArray array;
+    for (const HysteresisCycle& cycle : cycles) {
+        QJsonObject json;
+        json["index"] = cycle.index;
+        json["start_time"] = cycle.startTime;
+        json["end_time"] = cycle.endTime;
+        json["area"] = cycle.area;
+        json["energy"] = cycle.energy;
+        json["peak_force"] = cycle.peakForce;
+        json["stroke"] = cycle.stroke;
+        array.append(json);
+    }
+    return array;
+}
+
+QJsonObject spectrumToJson(const PowerSpectrum& spectrum, SpectralAnalyzer::Channel channel)
+{
+    QJsonObject json;
+    json["channel"] = SpectralAnalyzer::channelName(channel).toLower();
+    json["sample_rate"] = spectrum.sampleRate;
+    json["segment_count"] = spectrum.segmentCount;
+
+    // Strongest component above DC
+    int peak = 1;
+    for (int k = 2; k < spectrum.power.size(); ++k) {
+        if (spectrum.power[k] > spectrum.power[peak]) {
+            peak = k;
+        }
+    }
+    if (peak < spectrum.power.size()) {
+        json["dominant_frequency"] = spectrum.frequency[peak];
+    }
+    return json;
+}
+
+QString comparableName(QString name)
+{
+    return name.remove(' ').remove('-').toLower();
+}
+
+} // namespace
+
+BatchProcessor::BatchProcessor(const Options& options)
+    : m_options(options)
+{
+}
+
+QJsonObject BatchProcessor::run(const QStringList& inputs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QVector<QJsonObject> results = QtConcurrent::blockingMapped<QVector<QJsonObject>>(inputs,
+        [this](const QString& input) {
+            return processFile(input);
+        });
+
+    QJsonArray array;
+    int failed = 0;
+    for (const QJsonObject& result : results) {
+        if (!result["ok"].toBool()) {
+            ++failed;
+        }
+        array.append(result);
+    }
+
+    QJsonObject report;
+    report["command"] = commandName(m_options.command);
+    report["files"] = int(inputs.size());
+    report["failed"] = failed;
+    report["threads"] = QThreadPool::globalInstance()->maxThreadCount();
+    report["elapsed_ms"] = timer.elapsed();
+    report["results"] = array;
+    return report;
+}
+
+QJsonObject BatchProcessor::processFile(const QString& input)
+{
+    SHOCKEE_TRACE_SCOPE("batch", "BatchProcessor::processFile");
+
+    switch (m_options.command) {
+        case Convert: return convert(input);
+        case Summarize: return summarize(input);
+        case Export: return exportSession(input);
+        case Analyze: return analyze(input);
+        case Recalibrate: return recalibrate(input);
+    }
+    return QJsonObject();
+}
+
+QStringList BatchProcessor::collectInputs(const QStringList& paths, Command command, bool recursive)
+{
+    // Convert reads raw logs and CSV exports, everything else reads sessions
+    const QStringList filters = command == Convert
+        ? QStringList() << "*.txt" << "*.log" << "*.csv" << "*.tsv"
+        : QStringList() << "*.json";
+
+    QStringList files;
+    for (const QString& path : paths) {
+        QFileInfo info(path);
+        if (!info.isDir()) {
+            files << path;
+            continue;
+        }
+
+        QDirIterator it(path, filters, QDir::Files,
+                        recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        QStringList found;
+        while (it.hasNext()) {
+            QString file = it.next();
+            // Skip the results of earlier analyze runs
+            if (command != Convert && file.endsWith(".analysis.json")) {
+                continue;
+            }
+            found << file;
+        }
+        found.sort();
+        files << found;
+    }
+    return files;
+}
+
+Session BatchProcessor::readRawLog(const QString& filename, QString* error)
+{
+    Session session;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return session;
+    }
+
+    // Replayed through the live serial parser: comments, blanks and lines
+    // that do not parse (headers, garbage) are dropped and counted, and
+    // timestamps are unwrapped across rollovers and board resets. The fifth
+    // column of a CSV export is velocity, not a sequence number.
+    // Logs of raw-streaming boards are calibrated with the saved settings.
+    SensorStreamParser parser;
+    parser.setSequenceField(!filename.endsWith(".csv", Qt::CaseInsensitive));
+    parser.setCalibration(CalibrationSet::fromSettings());
+    while (!file.atEnd()) {
+        session.data += parser.feed(file.read(RAW_LOG_CHUNK));
+    }
+    session.data += parser.feed("\n");
+    session.link_health = parser.health();
+    session.schema = parser.schema();
+    if (parser.calibration().appliesTo(session.schema)) {
+        session.calibration = parser.calibration();
+    }
+
+    QFileInfo info(filename);
+    session.name = info.completeBaseName();
+    session.timestamp = info.lastModified();
+    if (session.data.isEmpty() && error) {
+        *error = "No sensor data lines found";
+    }
+    return session;
+}
+
+QJsonObject BatchProcessor::summaryToJson(const SessionSummary& summary)
+{
+    QJsonObject json;
+    json["name"] = summary.name;
+    json["strut_info"] = summary.strutInfo;
+    json["damping_setting"] = summary.dampingSetting;
+    json["samples"] = summary.sampleCount;
+    json["duration"] = summary.duration;
+    json["sample_rate"] = summary.sampleRate;
+    json["peak_compression_force"] = summary.peakCompressionForce;
+    json["peak_rebound_force"] = summary.peakReboundForce;
+    json["max_velocity"] = summary.maxVelocity;
+    json["compression_damping"] = summary.compressionDamping;
+    json["rebound_damping"] = summary.reboundDamping;
+    json["cycles"] = summary.cycleCount;
+    json["energy"] = summary.energy;
+    return json;
+}
+
+bool BatchProcessor::parseCommand(const QString& name, Command* command)
+{
+    for (Command candidate : { Convert, Summarize, Export, Analyze, Recalibrate }) {
+        if (name.compare(commandName(candidate), Qt::CaseInsensitive) == 0) {
+            *command = candidate;
+            return true;
+        }
+    }
+
+    // British spellings of the analysis commands
+    if (name.compare("summarise", Qt::CaseInsensitive) == 0) {
+        *command = Summarize;
+        return true;
+    }
+    if (name.compare("analyse", Qt::CaseInsensitive) == 0) {
+        *command = Analyze;
+        return true;
+    }
+    return false;
+}
+
+bool BatchProcessor::parseVelocityMethod(const QString& name, VelocityEstimator::Method* method)
+{
+    // Accepts any prefix of the display name, e.g. "savitzky-golay" or "alpha-beta"
+    const QString wanted = comparableName(name);
+    if (wanted.isEmpty()) {
+        return false;
+    }
+
+    const QStringList names = VelocityEstimator::methodNames();
+    for (int i = 0; i < names.size(); ++i) {
+        if (comparableName(names[i]).startsWith(wanted)) {
+            *method = static_cast<VelocityEstimator::Method>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+QString BatchProcessor::commandName(Command command)
+{
+    switch (command) {
+        case Convert: return "convert";
+        case Summarize: return "summarize";
+        case Export: return "export";
+        case Analyze: return "analyze";
+        case Recalibrate: return "recalibrate";
+    }
+    return QString();
+}
+
+QStringList BatchProcessor::commandNames()
+{
+    return QStringList() << commandName(Convert) << commandName(Summarize)
+                         << commandName(Export) << commandName(Analyze)
+                         << commandName(Recalibrate);
+}
+
+QJsonObject BatchProcessor::convert(const QString& input)
+{
+    QJsonObject result;
+    result["input"] = input;
+
+    // Delimited text from exports and other software goes through the
+    // column-mapping importer, serial logs through the line parser
+    QString error;
+    Session session;
+    const QString suffix = QFileInfo(input).suffix().toLower();
+    if (suffix == "csv" || suffix == "tsv") {
+        CsvImporter::Options options;
+        options.mapping = m_options.columnMapping;
+        options.velocityMethod = m_options.velocityMethod;
+        CsvImporter importer(options);
+        if (importer.importSession(input, &session)) {
+            result["skipped_rows"] = importer.rowsSkipped();
+        } else {
+            error = importer.errorString();
+        }
+    } else {
+        session = readRawLog(input, &error);
+        // Raw logs carry no velocity; the task already owns one core, so stay serial
+        VelocityEstimator::recompute(session.data, m_options.velocityMethod, false);
+    }
+    if (session.data.isEmpty()) {
+        result["ok"] = false;
+        result["error"] = error;
+        return result;
+    }
+
+    QString output = outputPath(input, ".json");
+    bool ok = m_logger.saveSession(session, output);
+    result["ok"] = ok;
+    if (ok) {
+        result["output"] = output;
+        result["samples"] = int(session.data.size());
+    } else {
+        result["error"] = "Failed to write " + output;
+    }
+    return result;
+}
+
+QJsonObject BatchProcessor::summarize(const QString& input)
+{
+    QJsonObject result;
+    result["input"] = input;
+
+    Session session;
+    if (!loadInput(input, &session, &result)) {
+        return result;
+    }
+
+    SessionSummary summary = BatchComparison::summarize(session, m_options.binWidth);
+    if (summary.name.isEmpty()) {
+        summary.name = QFileInfo(input).completeBaseName();
+    }
+
+    result["ok"] = summary.valid;
+    result["summary"] = summaryToJson(summary);
+    if (!summary.valid) {
+        result["error"] = "No damping curve could be computed";
+    }
+    return result;
+}
+
+QJsonObject BatchProcessor::exportSession(const QString& input)
+{
+    QJsonObject result;
+    result["input"] = input;
+
+    Session session;
+    if (!loadInput(input, &session, &result)) {
+        return result;
+    }
+
+    QString output;
+    QString error;
+    bool ok;
+    if (m_options.format == Excel) {
+        XlsxExporter::Options options;
+        options.columns = m_options.columns;
+        options.startTime = m_options.startTime;
+        options.endTime = m_options.endTime;
+        options.binWidth = m_options.binWidth;
+
+        XlsxExporter exporter(options);
+        output = outputPath(input, ".xlsx");
+        ok = exporter.exportSession(session, output);
+        error = exporter.errorString();
+        result["samples"] = exporter.rowsWritten();
+        result["sheets"] = exporter.dataSheetCount();
+    } else {
+        CsvExporter::Options options;
+        options.columns = m_options.columns;
+        options.startTime = m_options.startTime;
+        options.endTime = m_options.endTime;
+
+        CsvExporter exporter(options);
+        output = outputPath(input, ".csv");
+        ok = exporter.exportSession(session, output);
+        error = exporter.errorString();
+        result["samples"] = exporter.rowsWritten();
+        result["bytes"] = exporter.bytesWritten();
+    }
+
+    result["ok"] = ok;
+    if (ok) {
+        result["output"] = output;
+    } else {
+        result.remove("samples");
+        result["error"] = "Failed to write " + output + ": " + error;
+    }
+    return result;
+}
+
+QJsonObject BatchProcessor::analyze(const QString& input)
+{
+    QJsonObject result;
+    result["input"] = input;
+
+    Session session;
+    if (!loadInput(input, &session, &result)) {
+        return result;
+    }
+
+    DampingAnalyzer damping(m_options.binWidth);
+    damping.addSamples(session.data);
+    const QVector<HysteresisCycle> cycles = HysteresisAnalyzer::analyze(session.data);
+
+    SessionSummary summary = BatchComparison::summarize(session, m_options.binWidth);
+    if (summary.name.isEmpty()) {
+        summary.name = QFileInfo(input).completeBaseName();
+    }
+
+    QJsonObject dampingJson;
+    dampingJson["bin_width"] = damping.binWidth();
+    dampingJson["compression"] = binsToJson(damping.compressionCurve());
+    dampingJson["rebound"] = binsToJson(damping.reboundCurve());
+
+    QJsonObject analysis;
+    analysis["session"] = summary.name;
+    analysis["summary"] = summaryToJson(summary);
+    analysis["damping_curve"] = dampingJson;
+    analysis["cycles"] = cyclesToJson(cycles);
+    analysis["spectrum"] = spectrumToJson(SpectralAnalyzer::welch(session.data, SpectralAnalyzer::Position),
+                                          SpectralAnalyzer::Position);
+
+    QString output = outputPath(input, ".analysis.json");
+    QFile file(output);
+    if (!file.open(QIODevice::WriteOnly)) {
+        result["ok"] = false;
+        result["error"] = "Failed to write " + output;
+        return result;
+    }
+    file.write(QJsonDocument(analysis).toJson());
+    file.close();
+
+    result["ok"] = true;
+    result["output"] = output;
+    result["summary"] = analysis["summary"];
+    return result;
+}
+
+QJsonObject BatchProcessor::recalibrate(const QString& input)
+{
+    QJsonObject result;
+    result["input"] = input;
+    result["ok"] = false;
+
+    // The header alone decides whether there is anything to do, before an
+    // output file is opened
+    SessionJson reader;
+    Session session;
+    if (!reader.readHeader(input, &session)) {
+        result["error"] = "No session data could be loaded";
+        return result;
+    }
+    if (!m_options.calibration.appliesTo(session.schema)) {
+        result["error"] = "Session has no raw channels to recalibrate";
+        return result;
+    }
+
+    // In place unless an output directory is given; QSaveFile replaces the
+    // file atomically, so an interrupted run leaves the old version
+    const QString output = m_options.outputDir.isEmpty() ? input : outputPath(input, ".json");
+    QSaveFile file(output);
+    SessionJson writer;
+    session.calibration = m_options.calibration;
+    if (!file.open(QIODevice::WriteOnly) || !writer.begin(session, &file)) {
+        result["error"] = "Failed to write " + output;
+        return result;
+    }
+
+    // Samples stream through in chunks. Velocity is re-derived as they go,
+    // so each is held back until the estimator has seen what it reads
+    // after it: lookAhead() samples for local estimators (with as many
+    // already written kept in front), none for causal ones fed through
+    // update(), and the whole series for those that need all of it.
+    // Auxiliary samples wait with them so the file stays in time order.
+    std::unique_ptr<VelocityEstimator> estimator = VelocityEstimator::create(m_options.velocityMethod);
+    const int lookAhead = estimator->lookAhead();
+    SessionSummarizer before(session, m_options.binWidth);
+    SessionSummarizer after(session, m_options.binWidth);
+    QVector<SensorData> pending;
+    QVector<SensorData> pendingAuxiliary;
+    int context = 0;        // pending samples already written
+    qint64 samples = 0;
+
+    // Writes pending[context, end) and the auxiliary samples before the
+    // first primary still held, or all of them once nothing is
+    auto release = [&](int end) {
+        const QVector<SensorData> ready = pending.mid(context, end - context);
+        int auxiliary = pendingAuxiliary.size();
+        if (end < pending.size()) {
+            const qint64 until = pending[end].timestampUs;
+            auxiliary = std::lower_bound(pendingAuxiliary.cbegin(), pendingAuxiliary.cend(), until,
+                [](const SensorData& data, qint64 timestampUs) { return data.timestampUs < timestampUs; })
+                - pendingAuxiliary.cbegin();
+        }
+        after.addSamples(ready);
+        samples += ready.size();
+        const bool written = writer.writeSamples(ready, pendingAuxiliary.mid(0, auxiliary));
+        pendingAuxiliary.remove(0, auxiliary);
+        return written;
+    };
+
+    const bool read = reader.readChunks(input, &session, RECALIBRATE_CHUNK_SIZE,
+        [&](QVector<SensorData>& data, QVector<SensorData>& auxiliary) {
+            before.addSamples(data);
+            m_options.calibration.apply(data, session.schema);
+            pendingAuxiliary += auxiliary;
+
+            if (lookAhead == 0) {
+                for (SensorData& sample : data) {
+                    sample.velocity = estimator->update(sample.timestampUs, sample.position);
+                }
+                pending = data;
+                context = 0;
+                return release(pending.size());
+            }
+
+            pending.append(data);
+            const int end = pending.size() - lookAhead;
+            if (lookAhead < 0 || end <= context) {
+                return true;
+            }
+            estimator->processRange(pending, context, end);
+            if (!release(end)) {
+                return false;
+            }
+            const int keep = end - lookAhead;
+            if (keep > 0) {
+                pending.remove(0, keep);
+            }
+            context = end - qMax(keep, 0);
+            return true;
+        });
+
+    // The tail, or for whole-series estimators everything, with whatever
+    // auxiliary samples are still held
+    bool ok = read;
+    if (ok && lookAhead != 0) {
+        if (pending.size() > context) {
+            estimator->processRange(pending, context, pending.size());
+        }
+        ok = release(pending.size());
+    }
+    if (ok && samples == 0) {
+        file.cancelWriting();
+        result["error"] = "No session data could be loaded";
+        return result;
+    }
+    ok = ok && writer.finish() && file.commit();
+    if (!ok) {
+        file.cancelWriting();
+        result["error"] = read ? "Failed to write " + output : "Failed to read " + input + ": " + reader.errorString();
+        return result;
+    }
+
+    result["ok"] = true;
+    result["output"] = output;
+    result["samples"] = samples;
+    result["before"] = summaryToJson(before.summary());
+    result["after"] = summaryToJson(after.summary());
+    return result;
+}
+
+bool BatchProcessor::loadInput(const QString& input, Session* session, QJsonObject* result)
+{
+    *session = m_logger.loadSession(input);
+    if (session->data.isEmpty()) {
+        (*result)["ok"] = false;
+        (*result)["error"] = "No session data could be loaded";
+        return false;
+    }
+
+    if (m_options.recomputeVelocity) {
+        VelocityEstimator::recompute(session->data, m_options.velocityMethod, false);
+    }
+    return true;
+}
+
+QString BatchProcessor::outputPath(const QString& input, const QString& suffix) const
+{
+    QFileInfo info(input);
+    QString dir = m_options.outputDir.isEmpty() ? info.absolutePath() : m_options.outputDir;
+    return QDir(dir).filePath(info.completeBaseName() + suffix);
+}
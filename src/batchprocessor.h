@@ -0,0 +1,88 @@
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QMap>
+
+#include "datalogger.h"
+#include "batchcomparison.h"
+
+// GUI-free session processing behind shockee-cli.
+//
+// Every input file is handled in its own task on the global thread pool and
+// produces one JSON result object; run() collects them, in input order, into
+// a report that also counts failures. Files are only ever read or written by
+// the task that owns them, so DataLogger is used purely for its (stateless)
+// load/save/export routines.
+class BatchProcessor
+{
+public:
+    enum Command {
+        Convert,    // raw serial log or CSV export -> session JSON
+        Summarize,  // per-session figures on stdout
+        Export,     // session JSON -> CSV or an Excel workbook
+        Analyze,    // session JSON -> damping curve, cycles and spectrum JSON
+        Recalibrate // session JSON -> same session with a new calibration, replaced atomically
+    };
+
+    enum ExportFormat {
+        Csv,
+        Excel
+    };
+
+    struct Options {
+        Command command;
+        QString outputDir;      // empty writes next to each input
+        ExportFormat format;
+        double binWidth;        // mm/s
+        bool recomputeVelocity;
+        VelocityEstimator::Method velocityMethod;
+        CalibrationSet calibration; // for Recalibrate
+        QStringList columns;    // Export column selection; empty exports all
+        double startTime;       // Export range, s from the first sample
+        double endTime;         // < 0 runs to the end
+        QMap<QString, QString> columnMapping;   // Convert: CSV heading -> channel, see CsvImporter
+
+        Options()
+            : command(Summarize), format(Csv), binWidth(DampingAnalyzer::DEFAULT_BIN_WIDTH)
+            , recomputeVelocity(false), velocityMethod(VelocityEstimator::SavitzkyGolay)
+            , startTime(0), endTime(-1) {}
+    };
+
+    explicit BatchProcessor(const Options& options);
+
+    QJsonObject run(const QStringList& inputs);
+    QJsonObject processFile(const QString& input);
+
+    // Expands directories to the files the command reads
+    static QStringList collectInputs(const QStringList& paths, Command command, bool recursive);
+
+    // Sensor lines in the Arduino's "timestamp,position,force,encoder" format
+    static Session readRawLog(const QString& filename, QString* error = nullptr);
+
+    static QJsonObject summaryToJson(const SessionSummary& summary);
+
+    static bool parseCommand(const QString& name, Command* command);
+    static bool parseVelocityMethod(const QString& name, VelocityEstimator::Method* method);
+    static QString commandName(Command command);
+    static QStringList commandNames();
+
+private:
+    QJsonObject convert(const QString& input);
+    QJsonObject summarize(const QString& input);
+    QJsonObject exportSession(const QString& input);
+    QJsonObject analyze(const QString& input);
+    QJsonObject recalibrate(const QString& input);
+
+    bool loadInput(const QString& input, Session* session, QJsonObject* result);
+    QString outputPath(const QString& input, const QString& suffix) const;
+
+    Options m_options;
+    DataLogger m_logger;
+
+    static const qint64 RAW_LOG_CHUNK = 1 << 16; // bytes per parser feed
+};
+
+#endif // BATCHPROCESSOR_H
@@ -0,0 +1,340 @@
+#include "calibration.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSettings>
+#include <QDebug>
+#include <algorithm>
+#include <type_traits>
+
+namespace {
+
+// Units of the built-in quantities as the default schema declares them
+QString calibratedUnit(SensorChannel::Role role)
+{
+    switch (role) {
+        case SensorChannel::Position: return "mm";
+        case SensorChannel::Force: return "kg";
+        case SensorChannel::Encoder: return "pulses";
+        case SensorChannel::Velocity: return "mm/s";
+        default: return QString();
+    }
+}
+
+// Copies one raw column of a batch out of SensorData::extra
+void gatherExtra(const SensorData* samples, int count, int extraIndex, double* raw)
+{
+    for (int i = 0; i < count; ++i) {
+        raw[i] = extraIndex < samples[i].extra.size() ? samples[i].extra[extraIndex] : qQNaN();
+    }
+}
+
+template <typename T, T SensorData::*Member>
+void scatterMember(SensorData* samples, int count, const double* values)
+{
+    for (int i = 0; i < count; ++i) {
+        samples[i].*Member = std::is_floating_point<T>::value ? T(values[i]) : T(qRound64(values[i]));
+    }
+}
+
+void scatterExtra(SensorData* samples, int count, int extraIndex, const double* values, SensorExtraStore* extras)
+{
+    for (int i = 0; i < count; ++i) {
+        if (extraIndex < samples[i].extra.size()) {
+            extras->detach(&samples[i].extra)[extraIndex] = values[i];
+        }
+    }
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// ChannelCalibration
+
+ChannelCalibration::ChannelCalibration()
+    : m_kind(Polynomial)
+    , m_coefficients({ 0.0, 1.0 })
+{
+}
+
+ChannelCalibration ChannelCalibration::polynomial(const QVector<double>& coefficients)
+{
+    ChannelCalibration calibration;
+    calibration.m_coefficients = coefficients.isEmpty() ? QVector<double>{ 0.0 } : coefficients;
+    return calibration;
+}
+
+ChannelCalibration ChannelCalibration::linear(double offset, double gain)
+{
+    return polynomial({ offset, gain });
+}
+
+ChannelCalibration ChannelCalibration::table(QVector<QPointF> points)
+{
+    std::sort(points.begin(), points.end(), [](const QPointF& a, const QPointF& b) {
+        return a.x() < b.x();
+    });
+
+    ChannelCalibration calibration;
+    calibration.m_kind = Table;
+    calibration.m_coefficients.clear();
+    for (const QPointF& point : points) {
+        // Repeated raw values would make a zero-width segment
+        if (!calibration.m_raw.isEmpty() && point.x() == calibration.m_raw.last()) {
+            continue;
+        }
+        calibration.m_raw << point.x();
+        calibration.m_values << point.y();
+    }
+
+    if (calibration.m_raw.size() < 2) {
+        qWarning() << "Calibration table needs at least two distinct raw values";
+        return ChannelCalibration();
+    }
+    return calibration;
+}
+
+QVector<QPointF> ChannelCalibration::points() const
+{
+    QVector<QPointF> points;
+    for (int i = 0; i < m_raw.size(); ++i) {
+        points << QPointF(m_raw[i], m_values[i]);
+    }
+    return points;
+}
+
+double ChannelCalibration::apply(double raw) const
+{
+    double value;
+    apply(&raw, &value, 1);
+    return value;
+}
+
+void ChannelCalibration::apply(const double* raw, double* values, int count) const
+{
+    if (m_kind == Polynomial) {
+        // Horner's rule with the batch as the inner loop
+        const int degree = m_coefficients.size() - 1;
+        const double leading = m_coefficients[degree];
+        for (int i = 0; i < count; ++i) {
+            values[i] = leading;
+        }
+        for (int k = degree - 1; k >= 0; --k) {
+            const double c = m_coefficients[k];
+            for (int i = 0; i < count; ++i) {
+                values[i] = values[i] * raw[i] + c;
+            }
+        }
+        return;
+    }
+
+    // Raw readings move slowly between samples, so start each search from
+    // the previous sample's segment
+    const int last = m_raw.size() - 2;
+    int segment = 0;
+    for (int i = 0; i < count; ++i) {
+        const double x = raw[i];
+        if (x < m_raw[segment] || x > m_raw[segment + 1]) {
+            segment = int(std::upper_bound(m_raw.constBegin(), m_raw.constEnd(), x) - m_raw.constBegin()) - 1;
+            segment = qBound(0, segment, last);
+        }
+        const double t = (x - m_raw[segment]) / (m_raw[segment + 1] - m_raw[segment]);
+        values[i] = m_values[segment] + t * (m_values[segment + 1] - m_values[segment]);
+    }
+}
+
+double ChannelCalibration::inverse(double value) const
+{
+    if (m_kind == Polynomial && m_coefficients.size() == 2 && m_coefficients[1] != 0.0) {
+        return (value - m_coefficients[0]) / m_coefficients[1];
+    }
+    return qQNaN();
+}
+
+QJsonObject ChannelCalibration::toJson() const
+{
+    QJsonObject json;
+    if (m_kind == Polynomial) {
+        QJsonArray coefficients;
+        for (double c : m_coefficients) {
+            coefficients.append(c);
+        }
+        json["type"] = "polynomial";
+        json["coefficients"] = coefficients;
+    } else {
+        QJsonArray points;
+        for (int i = 0; i < m_raw.size(); ++i) {
+            points.append(QJsonArray{ m_raw[i], m_values[i] });
+        }
+        json["type"] = "table";
+        json["points"] = points;
+    }
+    return json;
+}
+
+ChannelCalibration ChannelCalibration::fromJson(const QJsonObject& json)
+{
+    if (json["type"].toString() == "table") {
+        QVector<QPointF> points;
+        for (const QJsonValue& value : json["points"].toArray()) {
+            const QJsonArray point = value.toArray();
+            points << QPointF(point.at(0).toDouble(), point.at(1).toDouble());
+        }
+        return table(points);
+    }
+
+    QVector<double> coefficients;
+    for (const QJsonValue& value : json["coefficients"].toArray()) {
+        coefficients << value.toDouble();
+    }
+    return coefficients.isEmpty() ? ChannelCalibration() : polynomial(coefficients);
+}
+
+// ---------------------------------------------------------------------------
+// CalibrationSet
+
+void CalibrationSet::set(const QString& channel, const ChannelCalibration& calibration)
+{
+    m_channels.insert(channel.toLower(), calibration);
+}
+
+bool CalibrationSet::appliesTo(const ChannelSchema& schema) const
+{
+    for (auto it = m_channels.constBegin(); it != m_channels.constEnd(); ++it) {
+        if (schema.indexOf(rawChannelName(it.key())) >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QVector<SensorChannel> CalibrationSet::plotChannels(const ChannelSchema& schema) const
+{
+    const QVector<SensorChannel> schemaChannels = schema.plotChannels();
+    auto listed = [&schemaChannels](const QString& name) {
+        for (const SensorChannel& channel : schemaChannels) {
+            if (channel.name == name) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    QVector<SensorChannel> channels;
+    for (const SensorChannel& channel : schemaChannels) {
+        for (auto it = m_channels.constBegin(); it != m_channels.constEnd(); ++it) {
+            if (channel.role != SensorChannel::Extra || channel.name != rawChannelName(it.key())
+                || listed(it.key())) {
+                continue;
+            }
+            // Extra outputs are schema channels already, so these are
+            // always built-in quantities
+            const SensorChannel::Role role = SensorChannel::roleForName(it.key());
+            if (role != SensorChannel::Timestamp && role != SensorChannel::Sequence) {
+                channels << SensorChannel(it.key(), calibratedUnit(role));
+            }
+        }
+        channels << channel;
+    }
+    return channels;
+}
+
+void CalibrationSet::apply(SensorData* samples, int count, const ChannelSchema& schema,
+                           SensorExtraStore* extras) const
+{
+    double raw[BATCH_SIZE];
+    double values[BATCH_SIZE];
+
+    for (auto it = m_channels.constBegin(); it != m_channels.constEnd(); ++it) {
+        const int rawIndex = schema.indexOf(rawChannelName(it.key()));
+        if (rawIndex < 0 || schema.channel(rawIndex).role != SensorChannel::Extra) {
+            continue;
+        }
+        const int source = schema.channel(rawIndex).extraIndex;
+
+        // Calibrated channels either fill a built-in member or an extra
+        // channel of their own name
+        const SensorChannel::Role role = SensorChannel::roleForName(it.key());
+        int target = -1;
+        if (role == SensorChannel::Extra) {
+            const int index = schema.indexOf(it.key());
+            if (index < 0) {
+                continue;
+            }
+            target = schema.channel(index).extraIndex;
+        } else if (role == SensorChannel::Timestamp || role == SensorChannel::Sequence) {
+            continue;
+        }
+
+        for (int start = 0; start < count; start += BATCH_SIZE) {
+            const int n = qMin(BATCH_SIZE, count - start);
+            SensorData* batch = samples + start;
+            gatherExtra(batch, n, source, raw);
+            it.value().apply(raw, values, n);
+
+            switch (role) {
+                case SensorChannel::Position: scatterMember<double, &SensorData::position>(batch, n, values); break;
+                case SensorChannel::Force: scatterMember<double, &SensorData::force>(batch, n, values); break;
+                case SensorChannel::Encoder: scatterMember<long, &SensorData::encoderPulses>(batch, n, values); break;
+                case SensorChannel::Velocity: scatterMember<double, &SensorData::velocity>(batch, n, values); break;
+                case SensorChannel::Extra: scatterExtra(batch, n, target, values, extras); break;
+                case SensorChannel::Timestamp:
+                case SensorChannel::Sequence:
+                    break;
+            }
+        }
+    }
+}
+
+QJsonObject CalibrationSet::toJson() const
+{
+    QJsonObject json;
+    for (auto it = m_channels.constBegin(); it != m_channels.constEnd(); ++it) {
+        json[it.key()] = it.value().toJson();
+    }
+    return json;
+}
+
+CalibrationSet CalibrationSet::fromJson(const QJsonObject& json)
+{
+    CalibrationSet set;
+    for (auto it = json.constBegin(); it != json.constEnd(); ++it) {
+        set.set(it.key(), ChannelCalibration::fromJson(it.value().toObject()));
+    }
+    return set;
+}
+
+CalibrationSet CalibrationSet::fromSettings()
+{
+    QSettings settings;
+    settings.beginGroup("Calibration");
+
+    CalibrationSet set;
+    const QByteArray channels = settings.value("channels").toByteArray();
+    if (!channels.isEmpty()) {
+        set = fromJson(QJsonDocument::fromJson(channels).object());
+    } else {
+        // Linear calibrations from the dialog's individual values
+        const int potMin = settings.value("potMin", 0).toInt();
+        const int potMax = settings.value("potMax", 1023).toInt();
+        const double stroke = settings.value("strokeLength", 75.0).toDouble();
+        if (potMax != potMin) {
+            const double gain = stroke / (potMax - potMin);
+            set.set("position", ChannelCalibration::linear(-potMin * gain, gain));
+        }
+
+        const double zero = settings.value("loadCellZero", 0.0).toDouble();
+        const double gain = settings.value("loadCellGain", 1.0).toDouble();
+        set.set("force", ChannelCalibration::linear(-zero * gain, gain));
+    }
+
+    settings.endGroup();
+    return set;
+}
+
+void CalibrationSet::saveToSettings() const
+{
+    QSettings settings;
+    settings.beginGroup("Calibration");
+    settings.setValue("channels", QJsonDocument(toJson()).toJson(QJsonDocument::Compact));
+    settings.endGroup();
+}
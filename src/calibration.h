@@ -0,0 +1,103 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QPointF>
+#include <QJsonObject>
+
+#include "sensordata.h"
+#include "channelschema.h"
+
+// Raw sensor reading to engineering units for one channel: a polynomial
+// c0 + c1 x + c2 x^2 + ... or a piecewise-linear table of (raw, value)
+// points, extended linearly beyond its end points.
+class ChannelCalibration
+{
+public:
+    enum Kind {
+        Polynomial,
+        Table
+    };
+
+    // Identity
+    ChannelCalibration();
+
+    static ChannelCalibration polynomial(const QVector<double>& coefficients);
+    static ChannelCalibration linear(double offset, double gain);
+    // Points are sorted by raw value; needs at least two distinct raw values
+    static ChannelCalibration table(QVector<QPointF> points);
+
+    Kind kind() const { return m_kind; }
+    const QVector<double>& coefficients() const { return m_coefficients; }
+    QVector<QPointF> points() const;
+
+    double apply(double raw) const;
+    // values[i] = apply(raw[i]); the polynomial is evaluated coefficient by
+    // coefficient across the batch so the inner loop vectorises
+    void apply(const double* raw, double* values, int count) const;
+
+    // Raw value for an engineering value, for linear calibrations only
+    double inverse(double value) const;
+
+    QJsonObject toJson() const;
+    static ChannelCalibration fromJson(const QJsonObject& json);
+
+private:
+    Kind m_kind;
+    QVector<double> m_coefficients;
+    QVector<double> m_raw;      // table breakpoints, ascending
+    QVector<double> m_values;
+};
+
+// Host-side calibration of a raw-streaming device. Each entry calibrates
+// the channel it is named after from the schema channel "<name>_raw", so
+// "force" is computed from "force_raw" and lands in SensorData::force.
+// The raw channels stay in SensorData::extra, so a recorded session can be
+// calibrated again offline.
+class CalibrationSet
+{
+public:
+    bool isEmpty() const { return m_channels.isEmpty(); }
+    QStringList channels() const { return m_channels.keys(); }
+    bool contains(const QString& channel) const { return m_channels.contains(channel); }
+    ChannelCalibration calibration(const QString& channel) const { return m_channels.value(channel); }
+    void set(const QString& channel, const ChannelCalibration& calibration);
+    void remove(const QString& channel) { m_channels.remove(channel); }
+
+    static QString rawChannelName(const QString& channel) { return channel + "_raw"; }
+
+    // Whether the schema carries the raw input of at least one entry
+    bool appliesTo(const ChannelSchema& schema) const;
+
+    // The schema's plot channels plus the built-in quantities this set
+    // computes for it, each listed before the raw channel it comes from.
+    // What limit rules, triggers and the channel plot are offered.
+    QVector<SensorChannel> plotChannels(const ChannelSchema& schema) const;
+
+    // Recomputes every calibrated channel of the samples from its raw
+    // channel, BATCH_SIZE samples at a time. Calibrated extra channels go
+    // to new rows from extras, leaving any copies of the samples as they were.
+    void apply(SensorData* samples, int count, const ChannelSchema& schema, SensorExtraStore* extras) const;
+    void apply(QVector<SensorData>& samples, const ChannelSchema& schema) const
+    {
+        SensorExtraStore extras;
+        apply(samples.data(), samples.size(), schema, &extras);
+    }
+
+    QJsonObject toJson() const;
+    static CalibrationSet fromJson(const QJsonObject& json);
+
+    // The "Calibration" settings group written by CalibrationDialog
+    static CalibrationSet fromSettings();
+    void saveToSettings() const;
+
+    static const int BATCH_SIZE = 512;
+
+private:
+    QMap<QString, ChannelCalibration> m_channels;
+};
+
+#endif // CALIBRATION_H
@@ -5,6 +5,9 @@
 #include <QMessageBox>
 #include <QSettings>
 #include <QPushButton>
+#include <QFileDialog>
+#include <QFile>
+#include <QTextStream>
 
 CalibrationDialog::CalibrationDialog(SerialCommunicator* serialComm, QWidget *parent)
     : QDialog(parent)
@@ -12,8 +15,11 @@ CalibrationDialog::CalibrationDialog(SerialCommunicator* serialComm, QWidget *pa
     , m_updateTimer(new QTimer(this))
     , m_isCalibrating(false)
     , m_calibrationStep(0)
+    , m_potRawIndex(-1)
+    , m_forceRawIndex(-1)
     , m_loadCellZero(0)
     , m_loadCellScale(1.0)
+    , m_loadCellGain(1.0)
     , m_potMin(0)
     , m_potMax(1023)
     , m_strokeLengthMm(75.0)
@@ -25,10 +31,13 @@ CalibrationDialog::CalibrationDialog(SerialCommunicator* serialComm, QWidget *pa
     
     setupUI();
     loadCalibrationSettings();
+    onChannelSchemaChanged(m_serialComm->channelSchema());
     
     // Connect to sensor data
     connect(m_serialComm, &SerialCommunicator::dataReceived,
             this, &CalibrationDialog::onSensorDataReceived);
+    connect(m_serialComm, &SerialCommunicator::channelSchemaChanged,
+            this, &CalibrationDialog::onChannelSchemaChanged);
     
     // Setup update timer
     m_updateTimer->setInterval(100); // 10 Hz update
@@ -83,6 +92,16 @@ void CalibrationDialog::setupUI()
     m_calibrationFactor->setStyleSheet("font-weight: bold;");
     loadCellGridLayout->addWidget(m_calibrationFactor, 5, 1);
     
+    // Optional linearisation table for host calibration, raw counts -> kg
+    loadCellGridLayout->addWidget(new QLabel("Calibration Curve:"), 6, 0);
+    m_forceCurveLabel = new QLabel("Linear");
+    loadCellGridLayout->addWidget(m_forceCurveLabel, 6, 1);
+    m_loadTableButton = new QPushButton("Load Table...");
+    m_loadTableButton->setToolTip("CSV of raw count, kg pairs; interpolated piecewise-linearly");
+    loadCellGridLayout->addWidget(m_loadTableButton, 7, 0);
+    m_clearTableButton = new QPushButton("Use Linear");
+    loadCellGridLayout->addWidget(m_clearTableButton, 7, 1);
+    
     loadCellLayout->addWidget(m_loadCellGroup);
     loadCellLayout->addStretch();
     
@@ -177,6 +196,8 @@ void CalibrationDialog::setupUI()
     connect(m_potMinButton, &QPushButton::clicked, this, &CalibrationDialog::calibratePotentiometerMin);
     connect(m_potMaxButton, &QPushButton::clicked, this, &CalibrationDialog::calibratePotentiometerMax);
     connect(m_encoderResetButton, &QPushButton::clicked, this, &CalibrationDialog::resetEncoder);
+    connect(m_loadTableButton, &QPushButton::clicked, this, &CalibrationDialog::loadForceTable);
+    connect(m_clearTableButton, &QPushButton::clicked, this, &CalibrationDialog::clearForceTable);
     
     connect(okButton, &QPushButton::clicked, this, &CalibrationDialog::finishCalibration);
     connect(cancelButton, &QPushButton::clicked, this, &QDialog::reject);
@@ -192,16 +213,43 @@ void CalibrationDialog::updateLiveReadings()
     updateDisplays(m_lastData);
 }
 
+void CalibrationDialog::onChannelSchemaChanged(const ChannelSchema& schema)
+{
+    auto extraIndex = [&schema](const QString& channel) {
+        int index = schema.indexOf(CalibrationSet::rawChannelName(channel));
+        return index >= 0 ? schema.channel(index).extraIndex : -1;
+    };
+    m_potRawIndex = extraIndex("position");
+    m_forceRawIndex = extraIndex("force");
+    
+    m_loadTableButton->setEnabled(hostCalibration());
+    m_clearTableButton->setEnabled(hostCalibration());
+    updateFactorLabels();
+}
+
+double CalibrationDialog::rawForce(const SensorData& data) const
+{
+    // NaN for boards without raw output, which only report kg
+    return SensorExtraReader{ m_forceRawIndex }(data);
+}
+
+double CalibrationDialog::rawPosition(const SensorData& data) const
+{
+    if (m_potRawIndex < 0) {
+        // Back-computed from mm for boards without raw output
+        return data.position * 1023.0 / m_strokeLength->value();
+    }
+    return SensorExtraReader{ m_potRawIndex }(data);
+}
+
 void CalibrationDialog::updateDisplays(const SensorData& data)
 {
     // Update load cell displays
-    m_loadCellRaw->setText(QString::number(data.force, 'f', 0));
+    m_loadCellRaw->setText(QString::number(m_forceRawIndex >= 0 ? rawForce(data) : data.force, 'f', 0));
     m_loadCellCalibrated->setText(QString("%1 kg").arg(data.force, 0, 'f', 2));
     
-    // Update potentiometer displays  
-    // Note: We'd need raw ADC value from Arduino for proper calibration
-    // For now, show calculated position
-    m_potRaw->setText(QString::number((int)(data.position * 1023.0 / 75.0)));
+    // Update potentiometer displays
+    m_potRaw->setText(QString::number(qRound(rawPosition(data))));
     m_potCalibrated->setText(QString("%1 mm").arg(data.position, 0, 'f', 2));
     
     // Update encoder display
@@ -215,7 +263,13 @@ void CalibrationDialog::calibrateLoadCellZero()
         return;
     }
     
-    m_serialComm->tareLoadCell();
+    if (m_forceRawIndex >= 0) {
+        // Zero is an offset in the host calibration
+        m_loadCellZero = rawForce(m_lastData);
+        applyHostCalibration();
+    } else {
+        m_serialComm->tareLoadCell();
+    }
     QMessageBox::information(this, "Success", "Load cell zeroed");
 }
 
@@ -232,6 +286,19 @@ void CalibrationDialog::calibrateLoadCellScale()
         return;
     }
     
+    if (m_forceRawIndex >= 0) {
+        double counts = rawForce(m_lastData) - m_loadCellZero;
+        if (counts == 0 || qIsNaN(counts)) {
+            QMessageBox::warning(this, "Error", "No load detected. Please apply known weight first.");
+            return;
+        }
+        m_loadCellGain = knownWeight / counts;
+        applyHostCalibration();
+        QMessageBox::information(this, "Success",
+            QString("Load cell calibrated: %1 kg per count").arg(m_loadCellGain, 0, 'g', 6));
+        return;
+    }
+    
     // Calculate calibration factor based on current reading and known weight
     double currentReading = m_lastData.force;
     if (currentReading > 0) {
@@ -251,11 +318,10 @@ void CalibrationDialog::calibrateLoadCellScale()
 
 void CalibrationDialog::calibratePotentiometerMin()
 {
-    // In a real implementation, we'd get the raw ADC value from Arduino
-    // For now, we'll calculate based on current position
-    int rawValue = (int)(m_lastData.position * 1023.0 / m_strokeLength->value());
+    int rawValue = qRound(rawPosition(m_lastData));
     m_potMin = rawValue;
     m_potMinValue->setValue(rawValue);
+    applyHostCalibration();
     
     QMessageBox::information(this, "Success", 
         QString("Minimum position set: %1").arg(rawValue));
@@ -263,11 +329,10 @@ void CalibrationDialog::calibratePotentiometerMin()
 
 void CalibrationDialog::calibratePotentiometerMax()
 {
-    // In a real implementation, we'd get the raw ADC value from Arduino
-    // For now, we'll calculate based on current position
-    int rawValue = (int)(m_lastData.position * 1023.0 / m_strokeLength->value());
+    int rawValue = qRound(rawPosition(m_lastData));
     m_potMax = rawValue;
     m_potMaxValue->setValue(rawValue);
+    applyHostCalibration();
     
     QMessageBox::information(this, "Success", 
         QString("Maximum position set: %1").arg(rawValue));
@@ -293,9 +358,93 @@ void CalibrationDialog::startCalibration()
 void CalibrationDialog::finishCalibration()
 {
     saveCalibrationSettings();
+    m_serialComm->setCalibration(calibrationSet());
     accept();
 }
 
+void CalibrationDialog::loadForceTable()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Load Calibration Table", "",
+                                                    "CSV Files (*.csv *.txt)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+    
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, "Error", "Cannot open " + fileName);
+        return;
+    }
+    
+    // "raw,kg" per line; a header or comment lines are skipped
+    QVector<QPointF> points;
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QStringList parts = stream.readLine().split(',');
+        bool rawOk = false, valueOk = false;
+        if (parts.size() >= 2) {
+            double raw = parts[0].trimmed().toDouble(&rawOk);
+            double value = parts[1].trimmed().toDouble(&valueOk);
+            if (rawOk && valueOk) {
+                points << QPointF(raw, value);
+            }
+        }
+    }
+    
+    if (points.size() < 2) {
+        QMessageBox::warning(this, "Error", "The table needs at least two raw,kg rows");
+        return;
+    }
+    m_forceTable = points;
+    applyHostCalibration();
+}
+
+void CalibrationDialog::clearForceTable()
+{
+    m_forceTable.clear();
+    applyHostCalibration();
+}
+
+CalibrationSet CalibrationDialog::calibrationSet() const
+{
+    CalibrationSet set;
+    
+    const int potMin = m_potMinValue->value();
+    const int potMax = m_potMaxValue->value();
+    if (potMax != potMin) {
+        const double gain = m_strokeLength->value() / (potMax - potMin);
+        set.set("position", ChannelCalibration::linear(-potMin * gain, gain));
+    }
+    
+    if (m_forceTable.size() >= 2) {
+        set.set("force", ChannelCalibration::table(m_forceTable));
+    } else {
+        set.set("force", ChannelCalibration::linear(-m_loadCellZero * m_loadCellGain, m_loadCellGain));
+    }
+    return set;
+}
+
+void CalibrationDialog::applyHostCalibration()
+{
+    updateFactorLabels();
+    if (hostCalibration()) {
+        // Live readings follow straight away; saved settings wait for OK
+        m_serialComm->setCalibration(calibrationSet());
+    }
+}
+
+void CalibrationDialog::updateFactorLabels()
+{
+    if (hostCalibration()) {
+        m_calibrationFactor->setText(QString("%1 kg/count, zero %2")
+                                     .arg(m_loadCellGain, 0, 'g', 6).arg(m_loadCellZero, 0, 'f', 0));
+    } else {
+        m_calibrationFactor->setText(QString::number(m_loadCellScale, 'f', 4));
+    }
+    m_forceCurveLabel->setText(m_forceTable.isEmpty() ? QString("Linear")
+                               : QString("Table, %1 points").arg(m_forceTable.size()));
+}
+
 void CalibrationDialog::saveCalibrationSettings()
 {
     QSettings settings;
@@ -306,8 +455,13 @@ void CalibrationDialog::saveCalibrationSettings()
     settings.setValue("potMax", m_potMax);
     settings.setValue("strokeLength", m_strokeLength->value());
     settings.setValue("encoderPPR", m_encoderPPR->value());
+    settings.setValue("loadCellZero", m_loadCellZero);
+    settings.setValue("loadCellGain", m_loadCellGain);
     
     settings.endGroup();
+    
+    // The full host calibration, including any table
+    calibrationSet().saveToSettings();
 }
 
 void CalibrationDialog::loadCalibrationSettings()
@@ -320,9 +474,16 @@ void CalibrationDialog::loadCalibrationSettings()
     m_potMax = settings.value("potMax", 1023).toInt();
     m_strokeLengthMm = settings.value("strokeLength", 75.0).toDouble();
     m_encoderPulsesPerRev = settings.value("encoderPPR", 1000).toInt();
+    m_loadCellZero = settings.value("loadCellZero", 0.0).toDouble();
+    m_loadCellGain = settings.value("loadCellGain", 1.0).toDouble();
+    
+    const ChannelCalibration force = CalibrationSet::fromSettings().calibration("force");
+    if (force.kind() == ChannelCalibration::Table) {
+        m_forceTable = force.points();
+    }
     
     // Update UI
-    m_calibrationFactor->setText(QString::number(m_loadCellScale, 'f', 4));
+    updateFactorLabels();
     m_potMinValue->setValue(m_potMin);
     m_potMaxValue->setValue(m_potMax);
     m_strokeLength->setValue(m_strokeLengthMm);
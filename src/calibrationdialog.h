@@ -16,6 +16,7 @@
 #include <QTabWidget>
 
 #include "serialcommunicator.h"
+#include "calibration.h"
 
 class CalibrationDialog : public QDialog
 {
@@ -34,6 +35,9 @@ private slots:
     void startCalibration();
     void finishCalibration();
     void updateLiveReadings();
+    void onChannelSchemaChanged(const ChannelSchema& schema);
+    void loadForceTable();
+    void clearForceTable();
 
 private:
     void setupUI();
@@ -41,6 +45,15 @@ private:
     void saveCalibrationSettings();
     void loadCalibrationSettings();
     
+    // Raw readings when the board streams position_raw/force_raw; the
+    // calibration is then applied on the host rather than on the board
+    bool hostCalibration() const { return m_forceRawIndex >= 0 || m_potRawIndex >= 0; }
+    double rawForce(const SensorData& data) const;
+    double rawPosition(const SensorData& data) const;
+    CalibrationSet calibrationSet() const;
+    void applyHostCalibration();
+    void updateFactorLabels();
+    
     SerialCommunicator* m_serialComm;
     
     // UI Components
@@ -54,6 +67,9 @@ private:
     QPushButton* m_calibrateButton;
     QDoubleSpinBox* m_knownWeight;
     QLabel* m_calibrationFactor;
+    QLabel* m_forceCurveLabel;
+    QPushButton* m_loadTableButton;
+    QPushButton* m_clearTableButton;
     
     // Potentiometer Calibration
     QGroupBox* m_potGroup;
@@ -79,9 +95,15 @@ private:
     bool m_isCalibrating;
     int m_calibrationStep;
     
+    // Raw channel positions in SensorData::extra, -1 if not streamed
+    int m_potRawIndex;
+    int m_forceRawIndex;
+    
     // Calibration values
-    double m_loadCellZero;
-    double m_loadCellScale;
+    double m_loadCellZero;      // raw counts at no load
+    double m_loadCellScale;     // on-board HX711 factor for calibrated-output boards
+    double m_loadCellGain;      // kg per raw count, host calibration
+    QVector<QPointF> m_forceTable; // raw counts -> kg, replaces the gain when set
     int m_potMin;
     int m_potMax;
     double m_strokeLengthMm;
@@ -0,0 +1,181 @@
+#include "channelcondition.h"
+#include <QtMath>
+
+namespace {
+
+// Stored names of ChannelCondition::Type, in enum order
+const char* const TYPE_KEYS[] = { "above", "below", "magnitude", "rate", "crossing" };
+
+// Names limit rules and trigger conditions used before sharing the type
+struct LegacyKey {
+    const char* key;
+    ChannelCondition::Type type;
+};
+
+const LegacyKey LEGACY_KEYS[] = {
+    { "maximum", ChannelCondition::Above }, { "minimum", ChannelCondition::Below },
+    { "threshold", ChannelCondition::Magnitude }, { "slope", ChannelCondition::Rate },
+    { "rising", ChannelCondition::Above }, { "falling", ChannelCondition::Below }
+};
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// ChannelCondition
+
+QString ChannelCondition::typeName(Type type)
+{
+    switch (type) {
+        case Above: return "Above";
+        case Below: return "Below";
+        case Magnitude: return "Magnitude Above";
+        case Rate: return "Rate of Change Above";
+        case Crossing: return "Crossing";
+    }
+    return QString();
+}
+
+QString ChannelCondition::description() const
+{
+    const QString value = QString::number(level);
+    switch (type) {
+        case Above: return QString("%1 > %2").arg(channel, value);
+        case Below: return QString("%1 < %2").arg(channel, value);
+        case Magnitude: return QString("|%1| > %2").arg(channel, value);
+        case Rate: return QString("|d%1/dt| > %2/s").arg(channel, value);
+        case Crossing: return QString("%1 crosses %2").arg(channel, value);
+    }
+    return QString();
+}
+
+QJsonObject ChannelCondition::toJson() const
+{
+    QJsonObject json;
+    json["channel"] = channel;
+    json["type"] = QLatin1String(TYPE_KEYS[type]);
+    json["level"] = level;
+    return json;
+}
+
+ChannelCondition ChannelCondition::fromJson(const QJsonObject& json)
+{
+    ChannelCondition condition;
+    condition.channel = json["channel"].toString(condition.channel);
+    const QString type = json["type"].toString();
+    for (int t = Above; t <= Crossing; ++t) {
+        if (type == TYPE_KEYS[t]) {
+            condition.type = Type(t);
+        }
+    }
+    for (const LegacyKey& legacy : LEGACY_KEYS) {
+        if (type == legacy.key) {
+            condition.type = legacy.type;
+        }
+    }
+    condition.level = json["level"].toDouble();
+    return condition;
+}
+
+// ---------------------------------------------------------------------------
+// ChannelConditionSet
+
+ChannelConditionSet::ChannelConditionSet()
+    : m_channels(ChannelSchema::defaultSchema().plotChannels())
+{
+}
+
+void ChannelConditionSet::setConditions(const QVector<ChannelCondition>& conditions)
+{
+    m_conditions = conditions;
+    resolve();
+}
+
+void ChannelConditionSet::setChannels(const QVector<SensorChannel>& channels)
+{
+    m_channels = channels;
+    resolve();
+}
+
+void ChannelConditionSet::resolve()
+{
+    m_states.clear();
+    for (const ChannelCondition& condition : m_conditions) {
+        State state;
+        state.resolved = false;
+        state.lastValue = qQNaN();
+        state.lastTimeUs = 0;
+        for (const SensorChannel& channel : m_channels) {
+            if (channel.name == condition.channel.toLower()) {
+                state.channel = channel;
+                state.resolved = true;
+                break;
+            }
+        }
+        m_states << state;
+    }
+}
+
+QStringList ChannelConditionSet::unresolvedChannels() const
+{
+    QStringList names;
+    for (int i = 0; i < m_states.size(); ++i) {
+        if (!m_states[i].resolved) {
+            names << m_conditions[i].channel;
+        }
+    }
+    return names;
+}
+
+bool ChannelConditionSet::test(int index, const SensorData& data, double* measured)
+{
+    const ChannelCondition& condition = m_conditions[index];
+    State& state = m_states[index];
+    double value = qQNaN();
+    if (state.resolved) {
+        visitChannel(state.channel, [&value, &data](auto reader) { value = reader(data); });
+    }
+
+    const double last = state.lastValue;
+    const qint64 lastTimeUs = state.lastTimeUs;
+    state.lastValue = value;
+    state.lastTimeUs = data.timestampUs;
+    if (!qIsFinite(value)) {
+        return false;
+    }
+
+    double tested = value;
+    bool met = false;
+    switch (condition.type) {
+        case ChannelCondition::Above:
+            met = value > condition.level;
+            break;
+        case ChannelCondition::Below:
+            met = value < condition.level;
+            break;
+        case ChannelCondition::Magnitude:
+            met = qAbs(value) > condition.level;
+            break;
+        case ChannelCondition::Rate:
+            if (!qIsFinite(last) || data.timestampUs <= lastTimeUs) {
+                return false;
+            }
+            tested = (value - last) * 1e6 / (data.timestampUs - lastTimeUs);
+            met = qAbs(tested) > condition.level;
+            break;
+        case ChannelCondition::Crossing:
+            met = qIsFinite(last) && (last < condition.level) != (value < condition.level);
+            break;
+    }
+    if (measured) {
+        *measured = tested;
+    }
+    return met;
+}
+
+void ChannelConditionSet::restart()
+{
+    for (State& state : m_states) {
+        state.lastValue = qQNaN();
+        state.lastTimeUs = 0;
+    }
+}
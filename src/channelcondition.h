@@ -0,0 +1,81 @@
+#ifndef CHANNELCONDITION_H
+#define CHANNELCONDITION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QJsonObject>
+
+#include "sensordata.h"
+#include "channelschema.h"
+
+// A test of one channel against a level, made on every sample: the rules
+// of LimitMonitor and the trigger conditions of TriggerCapture
+struct ChannelCondition {
+    enum Type {
+        Above,          // value > level
+        Below,          // value < level
+        Magnitude,      // |value| > level
+        Rate,           // |d value / dt| > level, per second, between consecutive samples
+        Crossing        // the sample on which value passes level either way
+    };
+
+    QString channel;    // schema channel name, e.g. "force" or "velocity"
+    Type type;
+    double level;       // in the channel's unit (per second for Rate)
+
+    ChannelCondition() : channel("force"), type(Magnitude), level(0) {}
+    ChannelCondition(const QString& channel, Type type, double level)
+        : channel(channel), type(type), level(level) {}
+
+    QString description() const;
+
+    // Also reads the type names limit rules and trigger conditions were
+    // stored under before they shared this type
+    QJsonObject toJson() const;
+    static ChannelCondition fromJson(const QJsonObject& json);
+
+    static QString typeName(Type type);
+};
+
+// Conditions evaluated sample by sample. Channel names are resolved once
+// against the channels on offer; a condition on a channel that is not
+// among them is never met (see unresolvedChannels()). Each condition keeps
+// the previous sample's value for Rate and Crossing.
+class ChannelConditionSet
+{
+public:
+    ChannelConditionSet();
+
+    void setConditions(const QVector<ChannelCondition>& conditions);
+    // Plot channels, velocity and calibrated ones included; see
+    // CalibrationSet::plotChannels()
+    void setChannels(const QVector<SensorChannel>& channels);
+    QStringList unresolvedChannels() const;
+
+    int size() const { return m_states.size(); }
+    bool isResolved(int index) const { return m_states[index].resolved; }
+
+    // Whether condition index is met on data. measured is the value tested:
+    // the channel value, or the signed rate for Rate. Every condition has
+    // to see every sample for rates and crossings to span consecutive ones.
+    bool test(int index, const SensorData& data, double* measured = nullptr);
+    // Forgets the previous values; rates and crossings restart
+    void restart();
+
+private:
+    struct State {
+        SensorChannel channel;
+        bool resolved;
+        double lastValue;
+        qint64 lastTimeUs;
+    };
+
+    void resolve();
+
+    QVector<ChannelCondition> m_conditions;
+    QVector<SensorChannel> m_channels;
+    QVector<State> m_states;
+};
+
+#endif // CHANNELCONDITION_H
@@ -0,0 +1,377 @@
+#include "channelschema.h"
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QDebug>
+#include <QVarLengthArray>
+
+namespace {
+
+const char* const FORMAT_PREFIX = "# Format:";
+const char* const CHANNELS_PREFIX = "# Channels:";
+
+// "position_mm" -> position, mm; "velocity_mm_s" -> velocity, mm/s
+SensorChannel channelFromFormatToken(const QString& token)
+{
+    const int split = token.indexOf('_');
+    if (split < 0) {
+        // The sketch's bare "timestamp" is millis()
+        const bool time = SensorChannel::roleForName(token) == SensorChannel::Timestamp;
+        return SensorChannel(token, time ? "ms" : QString());
+    }
+    QString unit = token.mid(split + 1);
+    unit.replace('_', '/');
+    return SensorChannel(token.left(split), unit);
+}
+
+// "force[kg]:real*0.001"
+bool channelFromToken(const QString& token, SensorChannel* channel)
+{
+    static const QRegularExpression pattern(
+        "^([A-Za-z][A-Za-z0-9_]*)(?:\\[([^\\]]*)\\])?(?::(int|real))?(?:\\*([-+0-9.eE]+))?$");
+
+    const QRegularExpressionMatch match = pattern.match(token);
+    if (!match.hasMatch()) {
+        return false;
+    }
+
+    double scale = 1.0;
+    if (match.capturedLength(4) > 0) {
+        bool ok;
+        scale = match.captured(4).toDouble(&ok);
+        if (!ok || scale == 0.0) {
+            return false;
+        }
+    }
+
+    *channel = SensorChannel(match.captured(1), match.captured(2),
+                             match.captured(3) == "int" ? SensorChannel::Integer : SensorChannel::Real,
+                             scale);
+    return true;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// SensorChannel
+
+SensorChannel::SensorChannel(const QString& name, const QString& unit, Type type, double scale)
+    : name(name.toLower())
+    , unit(unit)
+    , type(type)
+    , scale(scale)
+    , role(roleForName(name))
+    , extraIndex(-1)
+{
+}
+
+QString SensorChannel::title() const
+{
+    QString text = name;
+    text.replace('_', ' ');
+    if (!text.isEmpty()) {
+        text[0] = text[0].toUpper();
+    }
+    return text;
+}
+
+QString SensorChannel::label() const
+{
+    return unit.isEmpty() ? title() : QString("%1 (%2)").arg(title(), unit);
+}
+
+SensorChannel::Role SensorChannel::roleForName(const QString& name)
+{
+    const QString key = name.toLower();
+    if (key == "timestamp" || key == "time") return Timestamp;
+    if (key == "position") return Position;
+    if (key == "force") return Force;
+    if (key == "encoder") return Encoder;
+    if (key == "velocity") return Velocity;
+    if (key == "sequence" || key == "seq") return Sequence;
+    return Extra;
+}
+
+QString SensorChannel::typeName(Type type)
+{
+    switch (type) {
+        case Integer: return "int";
+        case Real: return "real";
+    }
+    return QString();
+}
+
+// ---------------------------------------------------------------------------
+// ChannelSchema
+
+ChannelSchema::ChannelSchema()
+    : m_extraCount(0)
+{
+    m_channels << SensorChannel("timestamp", "ms", SensorChannel::Integer)
+               << SensorChannel("position", "mm")
+               << SensorChannel("force", "kg")
+               << SensorChannel("encoder", "pulses", SensorChannel::Integer);
+    compile();
+}
+
+ChannelSchema::ChannelSchema(const QVector<SensorChannel>& channels)
+    : m_channels(channels)
+    , m_extraCount(0)
+{
+    compile();
+}
+
+bool ChannelSchema::isHeader(const QString& line)
+{
+    return line.startsWith(FORMAT_PREFIX, Qt::CaseInsensitive)
+        || line.startsWith(CHANNELS_PREFIX, Qt::CaseInsensitive);
+}
+
+ChannelSchema ChannelSchema::fromHeader(const QString& line, bool* ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+
+    const bool legacy = line.startsWith(FORMAT_PREFIX, Qt::CaseInsensitive);
+    if (!legacy && !line.startsWith(CHANNELS_PREFIX, Qt::CaseInsensitive)) {
+        return ChannelSchema();
+    }
+
+    const QString body = line.mid(line.indexOf(':') + 1);
+    QVector<SensorChannel> channels;
+    for (const QString& part : body.split(',')) {
+        const QString token = part.trimmed();
+        SensorChannel channel;
+        if (legacy) {
+            channel = channelFromFormatToken(token);
+        } else if (!channelFromToken(token, &channel)) {
+            qWarning() << "Unrecognised channel in schema header:" << token;
+            return ChannelSchema();
+        }
+        if (channel.name.isEmpty()) {
+            return ChannelSchema();
+        }
+        // The sketch's millis() and pulse counts are integers whatever the header says
+        if (legacy && (channel.role == SensorChannel::Timestamp || channel.role == SensorChannel::Encoder)) {
+            channel.type = SensorChannel::Integer;
+        }
+        channels << channel;
+    }
+
+    // Every sample needs a time, and it has to lead the line for the fast
+    // paths and link accounting
+    if (channels.isEmpty() || channels.first().role != SensorChannel::Timestamp) {
+        qWarning() << "Schema header does not start with a timestamp:" << line;
+        return ChannelSchema();
+    }
+
+    if (ok) {
+        *ok = true;
+    }
+    return ChannelSchema(channels);
+}
+
+ChannelSchema ChannelSchema::fromChannels(const QVector<SensorChannel>& channels, bool* ok)
+{
+    const bool valid = !channels.isEmpty() && channels.first().role == SensorChannel::Timestamp;
+    if (ok) {
+        *ok = valid;
+    }
+    return valid ? ChannelSchema(channels) : ChannelSchema();
+}
+
+QString ChannelSchema::toHeader() const
+{
+    QStringList tokens;
+    for (const SensorChannel& channel : m_channels) {
+        QString token = channel.name;
+        if (!channel.unit.isEmpty()) {
+            token += "[" + channel.unit + "]";
+        }
+        token += ":" + SensorChannel::typeName(channel.type);
+        if (channel.scale != 1.0) {
+            token += "*" + QString::number(channel.scale, 'g', 10);
+        }
+        tokens << token;
+    }
+    return QString(CHANNELS_PREFIX) + " " + tokens.join(',');
+}
+
+QJsonArray ChannelSchema::toJson() const
+{
+    QJsonArray array;
+    for (const SensorChannel& channel : m_channels) {
+        QJsonObject json;
+        json["name"] = channel.name;
+        json["unit"] = channel.unit;
+        json["type"] = SensorChannel::typeName(channel.type);
+        json["scale"] = channel.scale;
+        array.append(json);
+    }
+    return array;
+}
+
+ChannelSchema ChannelSchema::fromJson(const QJsonArray& json)
+{
+    QVector<SensorChannel> channels;
+    for (const QJsonValue& value : json) {
+        const QJsonObject object = value.toObject();
+        channels << SensorChannel(object["name"].toString(), object["unit"].toString(),
+                                  object["type"].toString() == "int" ? SensorChannel::Integer
+                                                                    : SensorChannel::Real,
+                                  object["scale"].toDouble(1.0));
+    }
+    if (channels.isEmpty() || channels.first().role != SensorChannel::Timestamp) {
+        return ChannelSchema();
+    }
+    return ChannelSchema(channels);
+}
+
+int ChannelSchema::indexOf(const QString& name) const
+{
+    const QString key = name.toLower();
+    for (int i = 0; i < m_channels.size(); ++i) {
+        if (m_channels[i].name == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QVector<SensorChannel> ChannelSchema::extraChannels() const
+{
+    QVector<SensorChannel> extras;
+    for (const SensorChannel& channel : m_channels) {
+        if (channel.role == SensorChannel::Extra) {
+            extras << channel;
+        }
+    }
+    return extras;
+}
+
+QVector<SensorChannel> ChannelSchema::plotChannels() const
+{
+    QVector<SensorChannel> channels;
+    bool velocity = false;
+    for (const SensorChannel& channel : m_channels) {
+        if (channel.role == SensorChannel::Timestamp || channel.role == SensorChannel::Sequence) {
+            continue;
+        }
+        velocity = velocity || channel.role == SensorChannel::Velocity;
+        channels << channel;
+    }
+    if (!velocity) {
+        channels << SensorChannel("velocity", "mm/s");
+    }
+    return channels;
+}
+
+bool ChannelSchema::isDefault() const
+{
+    return *this == ChannelSchema();
+}
+
+bool ChannelSchema::operator==(const ChannelSchema& other) const
+{
+    if (m_channels.size() != other.m_channels.size()) {
+        return false;
+    }
+    for (int i = 0; i < m_channels.size(); ++i) {
+        const SensorChannel& a = m_channels[i];
+        const SensorChannel& b = other.m_channels[i];
+        if (a.name != b.name || a.unit != b.unit || a.type != b.type || a.scale != b.scale) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ChannelSchema::compile()
+{
+    // Resolved once here, so parseLine() reads every field in one loop and
+    // stores each quantity from its known column, with no call or switch
+    // per field
+    m_columnTypes.clear();
+    m_columnScales.clear();
+    m_plan = ParsePlan();
+    m_extraCount = 0;
+    for (int column = 0; column < m_channels.size(); ++column) {
+        SensorChannel& channel = m_channels[column];
+        const bool sequence = channel.role == SensorChannel::Sequence;
+        m_columnTypes << (sequence || channel.type == SensorChannel::Integer);
+        m_columnScales << (sequence ? 1.0 : channel.scale);
+        channel.extraIndex = -1;
+
+        switch (channel.role) {
+            case SensorChannel::Timestamp: m_plan.timestamp = column; break;
+            case SensorChannel::Position: m_plan.position = column; break;
+            case SensorChannel::Force: m_plan.force = column; break;
+            case SensorChannel::Encoder: m_plan.encoder = column; break;
+            case SensorChannel::Velocity: m_plan.velocity = column; break;
+            case SensorChannel::Sequence: m_plan.sequence = column; break;
+            case SensorChannel::Extra:
+                channel.extraIndex = m_extraCount++;
+                m_plan.extras << column;
+                break;
+        }
+    }
+}
+
+bool ChannelSchema::parseLine(const QString& line, SensorData* data, SensorExtraStore* extras,
+                              qint64* sequence) const
+{
+    if (sequence) {
+        *sequence = -1;
+    }
+
+    const QStringList parts = line.split(',');
+    const int columns = m_channels.size();
+    if (parts.size() < columns) {
+        return false;
+    }
+
+    // Integer fields go through toLongLong() so "1.5" is rejected as before
+    QVarLengthArray<double, 16> values(columns);
+    for (int i = 0; i < columns; ++i) {
+        bool ok;
+        const double raw = m_columnTypes[i] ? double(parts[i].toLongLong(&ok)) : parts[i].toDouble(&ok);
+        if (!ok) {
+            return false;
+        }
+        values[i] = raw * m_columnScales[i];
+    }
+
+    if (m_plan.timestamp >= 0) {
+        data->timestamp = qRound64(values[m_plan.timestamp]);
+    }
+    if (m_plan.position >= 0) {
+        data->position = values[m_plan.position];
+    }
+    if (m_plan.force >= 0) {
+        data->force = values[m_plan.force];
+    }
+    if (m_plan.encoder >= 0) {
+        data->encoderPulses = long(qRound64(values[m_plan.encoder]));
+    }
+    if (m_plan.velocity >= 0) {
+        data->velocity = values[m_plan.velocity];
+    }
+    double* extra = extras->allocate(&data->extra, m_extraCount);
+    for (int i = 0; i < m_extraCount; ++i) {
+        extra[i] = values[m_plan.extras[i]];
+    }
+
+    if (sequence) {
+        if (m_plan.sequence >= 0) {
+            *sequence = qint64(values[m_plan.sequence]);
+        } else if (parts.size() > columns) {
+            // Trailing sequence number, as in the original protocol
+            bool ok;
+            const qint64 value = parts[columns].toLongLong(&ok);
+            if (ok) {
+                *sequence = value;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,169 @@
+#ifndef CHANNELSCHEMA_H
+#define CHANNELSCHEMA_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QJsonArray>
+#include <QtNumeric>
+
+#include "sensordata.h"
+
+// One column of the device's data lines
+struct SensorChannel {
+    enum Type {
+        Integer,
+        Real
+    };
+
+    // Where a parsed value is stored. The built-in quantities keep their
+    // typed SensorData members; anything else goes to SensorData::extra.
+    enum Role {
+        Timestamp,
+        Position,
+        Force,
+        Encoder,
+        Velocity,
+        Sequence,
+        Extra
+    };
+
+    QString name;
+    QString unit;
+    Type type;
+    double scale;       // applied to the raw field value
+    Role role;
+    int extraIndex;     // index into SensorData::extra for Extra channels, else -1
+
+    SensorChannel() : type(Real), scale(1.0), role(Extra), extraIndex(-1) {}
+    SensorChannel(const QString& name, const QString& unit, Type type = Real, double scale = 1.0);
+
+    // "Force", and with the unit "Force (kg)"
+    QString title() const;
+    QString label() const;
+
+    static Role roleForName(const QString& name);
+    static QString typeName(Type type);
+};
+
+// Reads one channel of a sample as a double. Each is a distinct type, so
+// loops instantiated over a reader (see visitChannel) compile to a direct
+// member load with no per-sample dispatch.
+template <typename T, T SensorData::*Member>
+struct SensorMemberReader {
+    double operator()(const SensorData& data) const { return double(data.*Member); }
+};
+
+struct SensorTimeReader {
+    double operator()(const SensorData& data) const { return data.timestamp / 1000.0; } // s
+};
+
+struct SensorExtraReader {
+    int index;
+    double operator()(const SensorData& data) const
+    {
+        return index >= 0 && index < data.extra.size() ? data.extra[index] : qQNaN();
+    }
+};
+
+// Resolves the channel's reader once and calls visitor(reader), so the
+// visitor's per-sample loop is generated for each storage type.
+template <typename Visitor>
+void visitChannel(const SensorChannel& channel, Visitor&& visitor)
+{
+    switch (channel.role) {
+        case SensorChannel::Timestamp: visitor(SensorTimeReader()); break;
+        case SensorChannel::Position: visitor(SensorMemberReader<double, &SensorData::position>()); break;
+        case SensorChannel::Force: visitor(SensorMemberReader<double, &SensorData::force>()); break;
+        case SensorChannel::Encoder: visitor(SensorMemberReader<long, &SensorData::encoderPulses>()); break;
+        case SensorChannel::Velocity: visitor(SensorMemberReader<double, &SensorData::velocity>()); break;
+        case SensorChannel::Sequence: break;
+        case SensorChannel::Extra: visitor(SensorExtraReader{ channel.extraIndex }); break;
+    }
+}
+
+// The columns of the device's data lines, negotiated from the header the
+// sketch prints on reset. Two header forms are understood:
+//
+//   # Format: timestamp,position_mm,force_kg,encoder_pulses
+//   # Channels: timestamp[ms]:int,position[mm],force[kg]:real*0.001,temperature[degC]
+//
+// The first is what every existing sketch prints: name_unit tokens. The
+// second gives each channel a unit in brackets, an optional int/real type
+// and an optional scale applied to the raw value. Channels named like a
+// built-in quantity fill that SensorData member, others are stored in
+// SensorData::extra in schema order.
+class ChannelSchema
+{
+public:
+    // timestamp, position, force, encoder: the original line protocol
+    ChannelSchema();
+
+    static ChannelSchema defaultSchema() { return ChannelSchema(); }
+
+    // Whether the comment line is a schema header
+    static bool isHeader(const QString& line);
+    // Schema from a header line; ok is false (and the default returned) if
+    // there is no timestamp channel or a token does not parse
+    static ChannelSchema fromHeader(const QString& line, bool* ok = nullptr);
+    QString toHeader() const;
+
+    // Schema of the given columns; ok is false (and the default returned)
+    // unless the first is a timestamp
+    static ChannelSchema fromChannels(const QVector<SensorChannel>& channels, bool* ok = nullptr);
+
+    QJsonArray toJson() const;
+    static ChannelSchema fromJson(const QJsonArray& json);
+
+    int size() const { return m_channels.size(); }
+    const SensorChannel& channel(int index) const { return m_channels[index]; }
+    const QVector<SensorChannel>& channels() const { return m_channels; }
+    int indexOf(const QString& name) const;
+
+    // Channels stored in SensorData::extra, in extra order
+    int extraCount() const { return m_extraCount; }
+    QVector<SensorChannel> extraChannels() const;
+
+    // Time-series channels worth plotting: everything but the timestamp and
+    // sequence, plus the host-computed velocity
+    QVector<SensorChannel> plotChannels() const;
+
+    // Exactly the original four columns, unscaled
+    bool isDefault() const;
+
+    bool operator==(const ChannelSchema& other) const;
+    bool operator!=(const ChannelSchema& other) const { return !(*this == other); }
+
+    // Parses one data line into data, its extra channels into a row from
+    // extras. A field after the last channel is read as a sequence number
+    // when sequence is given, as before. Returns false if the line is
+    // malformed.
+    bool parseLine(const QString& line, SensorData* data, SensorExtraStore* extras,
+                   qint64* sequence = nullptr) const;
+
+private:
+    explicit ChannelSchema(const QVector<SensorChannel>& channels);
+    void compile();
+
+    // Column of each stored quantity, -1 if the schema has none; see compile()
+    struct ParsePlan {
+        ParsePlan()
+            : timestamp(-1), position(-1), force(-1), encoder(-1), velocity(-1), sequence(-1), extras() {}
+
+        int timestamp;
+        int position;
+        int force;
+        int encoder;
+        int velocity;
+        int sequence;
+        QVector<int> extras;
+    };
+
+    QVector<SensorChannel> m_channels;
+    QVector<bool> m_columnTypes;        // true where the field is read as an integer
+    QVector<double> m_columnScales;
+    ParsePlan m_plan;
+    int m_extraCount;
+};
+
+#endif // CHANNELSCHEMA_H
@@ -0,0 +1,201 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonDocument>
+#include <QThreadPool>
+#include <QTextStream>
+#include <cstdio>
+
+#include "batchprocessor.h"
+#include "sessionjson.h"
+#include "tracing.h"
+
+// Exit codes: 0 all files processed, 1 some files failed, 2 usage error
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Same names as the GUI so the default session library is shared
+    app.setApplicationName("Shockee");
+    app.setApplicationVersion("1.0.0");
+    app.setOrganizationName("Shockee Dyno");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Headless Shockee session processing. Prints a JSON report to stdout.\n\n"
+        "Commands:\n"
+        "  convert    raw serial logs, or CSV/TSV from Shockee or other software -> session JSON\n"
+        "  summarize  peak forces, damping coefficients, cycles and energy\n"
+        "  export     session JSON -> CSV or an Excel workbook\n"
+        "  analyze    session JSON -> damping curve, cycles and spectrum JSON\n"
+        "  recalibrate  session JSON -> the same sessions recalibrated from their raw channels,\n"
+        "               with velocity re-derived; files are replaced atomically unless -o is given");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("command", "One of: " + BatchProcessor::commandNames().join(", "));
+    parser.addPositionalArgument("inputs", "Files or directories; defaults to the session library",
+                                 "[inputs...]");
+
+    QCommandLineOption outputOption({"o", "output"}, "Write output files to <dir> instead of next to the inputs.", "dir");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Number of worker threads (default: all cores).", "n");
+    QCommandLineOption formatOption("format", "Export format: csv or excel (default: csv).", "format", "csv");
+    QCommandLineOption binWidthOption("bin-width", "Damping curve velocity bin width in mm/s.", "mm/s",
+                                      QString::number(DampingAnalyzer::DEFAULT_BIN_WIDTH));
+    QCommandLineOption velocityOption("velocity", "Velocity estimator for convert, or to recompute "
+                                      "velocity before other commands (e.g. savitzky-golay, alpha-beta).", "method");
+    QCommandLineOption calibrationOption("calibration", "Calibration for recalibrate, as the \"calibration\" "
+                                         "object of a session file (default: the GUI's saved calibration).", "file");
+    QCommandLineOption columnsOption("columns", "Export only these comma-separated channels, in this order "
+                                     "(e.g. timestamp,position,force).", "names");
+    QCommandLineOption fromOption("from", "Export samples from <s> seconds after the session start.", "s");
+    QCommandLineOption toOption("to", "Export samples up to <s> seconds after the session start.", "s");
+    QCommandLineOption mapOption("map", "Map a CSV column heading to a channel for convert, e.g. "
+                                 "\"Disp (in)=position\" or \"Temp=temperature[degC]\"; an empty channel "
+                                 "skips the column. May be repeated.", "heading=channel");
+    QCommandLineOption recursiveOption({"r", "recursive"}, "Descend into subdirectories.");
+    QCommandLineOption compactOption("compact", "Print the report on a single line.");
+    QCommandLineOption traceOption("trace", "Record a Chrome trace of the run to <file> (open in ui.perfetto.dev).", "file");
+    parser.addOptions({ outputOption, jobsOption, formatOption, binWidthOption, velocityOption,
+                        calibrationOption, columnsOption, fromOption, toOption, mapOption,
+                        recursiveOption, compactOption, traceOption });
+
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QStringList args = parser.positionalArguments();
+    if (args.isEmpty()) {
+        err << "No command given\n\n" << parser.helpText();
+        return 2;
+    }
+
+    BatchProcessor::Options options;
+    if (!BatchProcessor::parseCommand(args.first(), &options.command)) {
+        err << "Unknown command: " << args.first() << "\n";
+        return 2;
+    }
+
+    options.outputDir = parser.value(outputOption);
+    if (!options.outputDir.isEmpty() && !QDir().mkpath(options.outputDir)) {
+        err << "Cannot create output directory: " << options.outputDir << "\n";
+        return 2;
+    }
+
+    QString format = parser.value(formatOption).toLower();
+    if (format == "excel" || format == "xlsx") {
+        options.format = BatchProcessor::Excel;
+    } else if (format != "csv") {
+        err << "Unknown export format: " << format << "\n";
+        return 2;
+    }
+
+    bool ok = false;
+    options.binWidth = parser.value(binWidthOption).toDouble(&ok);
+    if (!ok || options.binWidth <= 0) {
+        err << "Invalid bin width: " << parser.value(binWidthOption) << "\n";
+        return 2;
+    }
+
+    if (parser.isSet(velocityOption)) {
+        if (!BatchProcessor::parseVelocityMethod(parser.value(velocityOption), &options.velocityMethod)) {
+            err << "Unknown velocity method: " << parser.value(velocityOption) << "\n";
+            return 2;
+        }
+        options.recomputeVelocity = true;
+    }
+
+    for (const QString& entry : parser.values(mapOption)) {
+        const int split = entry.lastIndexOf('=');
+        if (split <= 0) {
+            err << "Invalid column mapping: " << entry << "\n";
+            return 2;
+        }
+        options.columnMapping.insert(entry.left(split), entry.mid(split + 1));
+    }
+
+    if (parser.isSet(columnsOption)) {
+        options.columns = parser.value(columnsOption).split(',', Qt::SkipEmptyParts);
+    }
+    if (parser.isSet(fromOption)) {
+        options.startTime = parser.value(fromOption).toDouble(&ok);
+        if (!ok || options.startTime < 0) {
+            err << "Invalid start time: " << parser.value(fromOption) << "\n";
+            return 2;
+        }
+    }
+    if (parser.isSet(toOption)) {
+        options.endTime = parser.value(toOption).toDouble(&ok);
+        if (!ok || options.endTime < options.startTime) {
+            err << "Invalid end time: " << parser.value(toOption) << "\n";
+            return 2;
+        }
+    }
+
+    if (options.command == BatchProcessor::Recalibrate) {
+        if (parser.isSet(calibrationOption)) {
+            // A whole session file works too; only its header is read
+            Session session;
+            SessionJson reader;
+            if (reader.readHeader(parser.value(calibrationOption), &session) && !session.calibration.isEmpty()) {
+                options.calibration = session.calibration;
+            } else {
+                QFile file(parser.value(calibrationOption));
+                const QJsonDocument document = file.open(QIODevice::ReadOnly)
+                    ? QJsonDocument::fromJson(file.readAll()) : QJsonDocument();
+                options.calibration = CalibrationSet::fromJson(document.object());
+            }
+        } else {
+            options.calibration = CalibrationSet::fromSettings();
+        }
+        if (options.calibration.isEmpty()) {
+            err << "No calibration to apply\n";
+            return 2;
+        }
+    }
+
+    if (parser.isSet(jobsOption)) {
+        int jobs = parser.value(jobsOption).toInt(&ok);
+        if (!ok || jobs < 1) {
+            err << "Invalid job count: " << parser.value(jobsOption) << "\n";
+            return 2;
+        }
+        QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+    }
+
+    const QString traceFile = parser.value(traceOption);
+    if (!traceFile.isEmpty()) {
+#ifdef SHOCKEE_TRACING
+        Tracer::setEnabled(true);
+#else
+        err << "Tracing was not compiled in (configure with -DSHOCKEE_TRACING=ON)\n";
+        return 2;
+#endif
+    }
+
+    BatchProcessor processor(options);
+
+    QStringList paths = args.mid(1);
+    if (paths.isEmpty()) {
+        if (options.command == BatchProcessor::Convert) {
+            err << "convert needs input files\n";
+            return 2;
+        }
+        paths << DataLogger().getSessionsDirectory();
+    }
+
+    const QStringList inputs = BatchProcessor::collectInputs(paths, options.command, parser.isSet(recursiveOption));
+    QJsonObject report = processor.run(inputs);
+
+    if (!traceFile.isEmpty()) {
+        Tracer::setEnabled(false);
+        if (!Tracer::writeChromeTrace(traceFile)) {
+            err << "Cannot write trace file: " << traceFile << "\n";
+        }
+    }
+
+    QJsonDocument document(report);
+    QTextStream out(stdout);
+    out << document.toJson(parser.isSet(compactOption) ? QJsonDocument::Compact : QJsonDocument::Indented);
+    out.flush();
+
+    return report["failed"].toInt() > 0 ? 1 : 0;
+}
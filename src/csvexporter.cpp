@@ -0,0 +1,257 @@
+#include "csvexporter.h"
+#include "tracing.h"
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace {
+
+char* writeDouble(char* out, char* end, double value, int precision)
+{
+    // Missing values are empty fields rather than "nan"
+    if (!qIsFinite(value)) {
+        return out;
+    }
+    const std::to_chars_result result = precision > 0
+        ? std::to_chars(out, end, value, std::chars_format::general, precision)
+        : std::to_chars(out, end, value);
+    return result.ptr;
+}
+
+} // namespace
+
+CsvExporter::CsvExporter(const Options& options)
+    : m_options(options)
+    , m_rows(0)
+    , m_bytes(0)
+{
+}
+
+QVector<SensorChannel> CsvExporter::availableColumns(const Session& session)
+{
+    QVector<SensorChannel> columns;
+    const ChannelSchema defaults;
+    for (const SensorChannel& channel : defaults.channels()) {
+        // The session's own unit where its schema has the channel
+        const int index = session.schema.indexOf(channel.name);
+        columns << (index >= 0 ? session.schema.channel(index) : channel);
+    }
+    columns << SensorChannel("velocity", "mm/s");
+    columns << session.schema.extraChannels();
+    return columns;
+}
+
+bool CsvExporter::selectColumns(const Session& session, const QStringList& names,
+                                QVector<SensorChannel>* columns, QString* error)
+{
+    const QVector<SensorChannel> available = availableColumns(session);
+    if (names.isEmpty()) {
+        *columns = available;
+        return true;
+    }
+
+    columns->clear();
+    for (const QString& name : names) {
+        const QString key = name.trimmed().toLower();
+        auto it = std::find_if(available.begin(), available.end(), [&key](const SensorChannel& channel) {
+            return channel.name == key;
+        });
+        if (it == available.end()) {
+            if (error) {
+                *error = "Unknown column: " + name;
+            }
+            return false;
+        }
+        *columns << *it;
+    }
+    return true;
+}
+
+CsvExporter::FieldWriter CsvExporter::fieldWriter(const SensorChannel& channel)
+{
+    switch (channel.role) {
+        case SensorChannel::Timestamp: return &writeInteger<qint64, &SensorData::timestamp>;
+        case SensorChannel::Position: return &writeReal<&SensorData::position>;
+        case SensorChannel::Force: return &writeReal<&SensorData::force>;
+        case SensorChannel::Encoder: return &writeInteger<long, &SensorData::encoderPulses>;
+        case SensorChannel::Velocity: return &writeReal<&SensorData::velocity>;
+        case SensorChannel::Extra: return &writeExtra;
+        case SensorChannel::Sequence: break;
+    }
+    return nullptr;
+}
+
+void CsvExporter::selectRange(const QVector<SensorData>& data, double startTime, double endTime,
+                              const SensorData** begin, const SensorData** end)
+{
+    // A slice of the time-ordered samples
+    *begin = data.constData();
+    *end = *begin + data.size();
+    if (data.isEmpty()) {
+        return;
+    }
+
+    const qint64 origin = data.first().timestamp;
+    if (startTime > 0) {
+        const qint64 first = origin + qint64(std::ceil(startTime * 1000.0));
+        *begin = std::lower_bound(*begin, *end, first, [](const SensorData& sample, qint64 time) {
+            return sample.timestamp < time;
+        });
+    }
+    if (endTime >= 0) {
+        const qint64 last = origin + qint64(std::floor(endTime * 1000.0));
+        *end = std::upper_bound(*begin, *end, last, [](qint64 time, const SensorData& sample) {
+            return time < sample.timestamp;
+        });
+    }
+}
+
+QByteArray CsvExporter::headerLine() const
+{
+    QStringList names;
+    for (const Column& column : m_columns) {
+        const SensorChannel& channel = column.channel;
+        // position_mm as in the sketch's header, with the bare timestamp of
+        // earlier exports
+        if (channel.role == SensorChannel::Timestamp || channel.unit.isEmpty()) {
+            names << channel.name;
+        } else {
+            names << channel.name + "_" + QString(channel.unit).replace('/', '_');
+        }
+    }
+    return names.join(QChar(m_options.separator)).toUtf8() + '\n';
+}
+
+template <typename T, T SensorData::*Member>
+char* CsvExporter::writeInteger(char* out, const SensorData& data, int, int)
+{
+    return std::to_chars(out, out + MAX_FIELD_LENGTH, data.*Member).ptr;
+}
+
+template <double SensorData::*Member>
+char* CsvExporter::writeReal(char* out, const SensorData& data, int, int precision)
+{
+    return writeDouble(out, out + MAX_FIELD_LENGTH, data.*Member, precision);
+}
+
+char* CsvExporter::writeExtra(char* out, const SensorData& data, int extraIndex, int precision)
+{
+    return writeDouble(out, out + MAX_FIELD_LENGTH, SensorExtraReader{ extraIndex }(data), precision);
+}
+
+QByteArray CsvExporter::encodeRows(const SensorData* rows, int count) const
+{
+    SHOCKEE_TRACE_SCOPE("storage", "CsvExporter::encodeRows");
+
+    // Sized for the longest possible row, then trimmed once
+    QByteArray chunk(qsizetype(count) * (m_columns.size() * MAX_FIELD_LENGTH + 1), Qt::Uninitialized);
+    char* out = chunk.data();
+    const char separator = m_options.separator;
+    const int precision = m_options.precision;
+    const Column* columns = m_columns.constData();
+    const int columnCount = m_columns.size();
+
+    for (int i = 0; i < count; ++i) {
+        const SensorData& data = rows[i];
+        for (int c = 0; c < columnCount; ++c) {
+            if (c > 0) {
+                *out++ = separator;
+            }
+            out = columns[c].writer(out, data, columns[c].channel.extraIndex, precision);
+        }
+        *out++ = '\n';
+    }
+
+    chunk.truncate(out - chunk.constData());
+    return chunk;
+}
+
+bool CsvExporter::exportSession(const Session& session, const QString& filename)
+{
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_error = file.errorString();
+        qWarning() << "Failed to open CSV file for writing:" << filename;
+        return false;
+    }
+    if (!exportSession(session, &file)) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        m_error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool CsvExporter::exportSession(const Session& session, QIODevice* device)
+{
+    SHOCKEE_TRACE_SCOPE("storage", "CsvExporter::exportSession");
+
+    m_error.clear();
+    m_rows = 0;
+    m_bytes = 0;
+    QVector<SensorChannel> channels;
+    if (!selectColumns(session, m_options.columns, &channels, &m_error)) {
+        return false;
+    }
+    m_columns.clear();
+    for (const SensorChannel& channel : channels) {
+        if (FieldWriter writer = fieldWriter(channel)) {
+            m_columns << Column{ channel, writer };
+        }
+    }
+
+    auto write = [this, device](const QByteArray& bytes) {
+        if (device->write(bytes) != bytes.size()) {
+            m_error = device->errorString();
+            return false;
+        }
+        m_bytes += bytes.size();
+        return true;
+    };
+    if (!write(headerLine())) {
+        return false;
+    }
+
+    const SensorData* begin;
+    const SensorData* end;
+    selectRange(session.data, m_options.startTime, m_options.endTime, &begin, &end);
+    const int total = int(end - begin);
+
+    QVector<int> chunkStarts;
+    for (int start = 0; start < total; start += ROWS_PER_CHUNK) {
+        chunkStarts << start;
+    }
+
+    // The next window of chunks is encoded while the previous one is written
+    const int window = qMax(1, QThreadPool::globalInstance()->maxThreadCount()) * CHUNKS_PER_THREAD;
+    auto encodeWindow = [this, begin, total, &chunkStarts, window](int first) {
+        return QtConcurrent::mapped(chunkStarts.mid(first, window), [this, begin, total](int start) {
+            return encodeRows(begin + start, qMin(ROWS_PER_CHUNK, total - start));
+        });
+    };
+
+    QFuture<QByteArray> pending = encodeWindow(0);
+    for (int first = 0; first < chunkStarts.size(); first += window) {
+        const QList<QByteArray> chunks = pending.results();
+        if (first + window < chunkStarts.size()) {
+            pending = encodeWindow(first + window);
+        }
+        for (const QByteArray& chunk : chunks) {
+            if (!write(chunk)) {
+                pending.cancel();
+                pending.waitForFinished();
+                return false;
+            }
+        }
+    }
+
+    m_rows = total;
+    return true;
+}
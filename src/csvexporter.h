@@ -0,0 +1,84 @@
+#ifndef CSVEXPORTER_H
+#define CSVEXPORTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <QIODevice>
+
+#include "datalogger.h"
+
+// Streaming delimited-text export of a session.
+//
+// Rows are encoded ROWS_PER_CHUNK at a time on the global thread pool,
+// numbers formatted with std::to_chars straight into the chunk buffer, and
+// the chunks written to the device in row order as single large writes.
+// At most a few chunks per worker are held at once, so memory stays flat
+// however long the session is.
+class CsvExporter
+{
+public:
+    struct Options {
+        char separator;
+        QStringList columns;    // channel names in output order; empty exports all
+        double startTime;       // s from the first sample
+        double endTime;         // s from the first sample, inclusive; < 0 runs to the end
+        int precision;          // significant digits for real values; 0 is shortest round-trip
+
+        Options()
+            : separator(','), startTime(0), endTime(-1), precision(0) {}
+    };
+
+    explicit CsvExporter(const Options& options = Options());
+
+    // Every column the session can export: timestamp, position, force,
+    // encoder, velocity and the schema's extra channels
+    static QVector<SensorChannel> availableColumns(const Session& session);
+
+    // Formats one field of a sample at out, which must have MAX_FIELD_LENGTH
+    // bytes free, and returns the end; writes nothing for a missing value
+    typedef char* (*FieldWriter)(char* out, const SensorData& data, int extraIndex, int precision);
+
+    // The named columns in order, or every available column for no names
+    static bool selectColumns(const Session& session, const QStringList& names,
+                              QVector<SensorChannel>* columns, QString* error);
+    static FieldWriter fieldWriter(const SensorChannel& channel);
+    // Samples between the times (s from the first sample; end < 0 for all)
+    static void selectRange(const QVector<SensorData>& data, double startTime, double endTime,
+                            const SensorData** begin, const SensorData** end);
+
+    bool exportSession(const Session& session, const QString& filename);
+    bool exportSession(const Session& session, QIODevice* device);
+
+    QString errorString() const { return m_error; }
+    qint64 rowsWritten() const { return m_rows; }
+    qint64 bytesWritten() const { return m_bytes; }
+
+    static const int ROWS_PER_CHUNK = 8192;
+    static const int CHUNKS_PER_THREAD = 2;   // encoded ahead of the writer
+    static const int MAX_FIELD_LENGTH = 32;   // longest to_chars double
+
+private:
+    struct Column {
+        SensorChannel channel;
+        FieldWriter writer;
+    };
+
+    QByteArray headerLine() const;
+    QByteArray encodeRows(const SensorData* rows, int count) const;
+
+    template <typename T, T SensorData::*Member>
+    static char* writeInteger(char* out, const SensorData& data, int extraIndex, int precision);
+    template <double SensorData::*Member>
+    static char* writeReal(char* out, const SensorData& data, int extraIndex, int precision);
+    static char* writeExtra(char* out, const SensorData& data, int extraIndex, int precision);
+
+    Options m_options;
+    QVector<Column> m_columns;
+    QString m_error;
+    qint64 m_rows;
+    qint64 m_bytes;
+};
+
+#endif // CSVEXPORTER_H
@@ -0,0 +1,530 @@
+#include "csvimporter.h"
+#include "tracing.h"
+#include "mappedfile.h"
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+struct UnitScale {
+    const char* unit;
+    double scale;
+};
+
+// Units other software writes, as multiples of Shockee's unit for the
+// channel; the first entry is that unit
+const UnitScale TIME_UNITS[] = { { "ms", 1.0 }, { "s", 1000.0 }, { "sec", 1000.0 }, { "us", 0.001 },
+                                 { "min", 60000.0 } };
+const UnitScale POSITION_UNITS[] = { { "mm", 1.0 }, { "cm", 10.0 }, { "m", 1000.0 }, { "in", 25.4 } };
+const UnitScale FORCE_UNITS[] = { { "kg", 1.0 }, { "kgf", 1.0 }, { "n", 1.0 / 9.80665 },
+                                  { "kn", 1000.0 / 9.80665 }, { "lb", 0.45359237 }, { "lbf", 0.45359237 },
+                                  { "lbs", 0.45359237 } };
+const UnitScale VELOCITY_UNITS[] = { { "mm/s", 1.0 }, { "cm/s", 10.0 }, { "m/s", 1000.0 }, { "in/s", 25.4 } };
+const UnitScale ENCODER_UNITS[] = { { "pulses", 1.0 }, { "counts", 1.0 } };
+
+template <size_t N>
+bool lookupUnit(const UnitScale (&units)[N], const QString& unit, double* scale)
+{
+    for (const UnitScale& entry : units) {
+        if (unit == entry.unit) {
+            *scale = entry.scale;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Scale from the unit to the role's canonical unit; false if unknown
+bool unitScale(SensorChannel::Role role, const QString& unit, double* scale)
+{
+    *scale = 1.0;
+    if (unit.isEmpty()) {
+        return true;
+    }
+    switch (role) {
+        case SensorChannel::Timestamp: return lookupUnit(TIME_UNITS, unit, scale);
+        case SensorChannel::Position: return lookupUnit(POSITION_UNITS, unit, scale);
+        case SensorChannel::Force: return lookupUnit(FORCE_UNITS, unit, scale);
+        case SensorChannel::Velocity: return lookupUnit(VELOCITY_UNITS, unit, scale);
+        case SensorChannel::Encoder: return lookupUnit(ENCODER_UNITS, unit, scale);
+        case SensorChannel::Sequence:
+        case SensorChannel::Extra:
+            break;
+    }
+    return true;
+}
+
+QString canonicalUnit(SensorChannel::Role role)
+{
+    switch (role) {
+        case SensorChannel::Timestamp: return TIME_UNITS[0].unit;
+        case SensorChannel::Position: return POSITION_UNITS[0].unit;
+        case SensorChannel::Force: return FORCE_UNITS[0].unit;
+        case SensorChannel::Velocity: return VELOCITY_UNITS[0].unit;
+        case SensorChannel::Encoder: return ENCODER_UNITS[0].unit;
+        case SensorChannel::Sequence:
+        case SensorChannel::Extra:
+            break;
+    }
+    return QString();
+}
+
+bool isKnownUnit(const QString& unit)
+{
+    double scale;
+    for (SensorChannel::Role role : { SensorChannel::Timestamp, SensorChannel::Position, SensorChannel::Force,
+                                      SensorChannel::Velocity, SensorChannel::Encoder }) {
+        if (unitScale(role, unit, &scale)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Built-in channel names under the headings other tools use
+QString aliasFor(const QString& name)
+{
+    static const QMap<QString, QString> aliases = {
+        { "time", "timestamp" }, { "t", "timestamp" },
+        { "pos", "position" }, { "displacement", "position" }, { "disp", "position" },
+        { "travel", "position" }, { "stroke", "position" },
+        { "load", "force" },
+        { "pulses", "encoder" },
+        { "vel", "velocity" }, { "speed", "velocity" },
+        { "seq", "sequence" }
+    };
+    return aliases.value(name, name);
+}
+
+// "Front Left" -> "front_left"
+QString channelName(const QString& text)
+{
+    QString name = text.trimmed().toLower();
+    name.replace(QRegularExpression("[^a-z0-9]+"), "_");
+    name.remove(QRegularExpression("^_+|_+$"));
+    if (name.isEmpty() || !name[0].isLetter()) {
+        name.prepend("column_");
+    }
+    return name;
+}
+
+// "Position (mm)", "Travel [in]", "position_mm", "velocity_mm_s". An
+// underscore only introduces a unit that is recognised, so "force_raw_counts"
+// is force_raw in counts and "front_left" has no unit.
+void splitNameUnit(const QString& heading, QString* name, QString* unit)
+{
+    static const QRegularExpression bracketed("^(.*?)\\s*[\\(\\[]([^\\)\\]]*)[\\)\\]]\\s*$");
+
+    *name = heading.trimmed();
+    unit->clear();
+    const QRegularExpressionMatch match = bracketed.match(*name);
+    if (match.hasMatch()) {
+        *name = match.captured(1);
+        *unit = match.captured(2).trimmed();
+        return;
+    }
+
+    const QStringList parts = name->split('_');
+    for (int i = 1; i < parts.size(); ++i) {
+        const QString candidate = parts.mid(i).join('/').toLower();
+        if (isKnownUnit(candidate)) {
+            *name = parts.mid(0, i).join('_');
+            *unit = candidate;
+            return;
+        }
+    }
+}
+
+const char* skipSpace(const char* begin, const char* end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        ++begin;
+    }
+    return begin;
+}
+
+// Parses a whole field, allowing surrounding blanks, quotes and a leading +
+bool parseNumber(const char* begin, const char* end, double* value)
+{
+    begin = skipSpace(begin, end);
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) {
+        --end;
+    }
+    if (end - begin >= 2 && *begin == '"' && end[-1] == '"') {
+        ++begin;
+        --end;
+    }
+    if (begin < end && *begin == '+') {
+        ++begin;
+    }
+    if (begin == end) {
+        return false;
+    }
+    const std::from_chars_result result = std::from_chars(begin, end, *value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// End of the field at begin: the next separator outside quotes. A quoted
+// field runs to its closing quote ("" being an escaped quote), so "Load, N"
+// or "1,5" stays one field; an unterminated quote runs to the end
+const char* findFieldEnd(const char* begin, const char* end, char separator)
+{
+    const char* p = begin;
+    while (p < end && (*p == ' ' || *p == '\t') && *p != separator) {
+        ++p;
+    }
+    if (p < end && *p == '"') {
+        for (++p; p < end; ++p) {
+            if (*p == '"') {
+                if (p + 1 < end && p[1] == '"') {
+                    ++p;
+                    continue;
+                }
+                ++p;
+                break;
+            }
+        }
+    }
+    const char* next = static_cast<const char*>(memchr(p, separator, end - p));
+    return next ? next : end;
+}
+
+QStringList splitHeading(const QByteArray& line, char separator)
+{
+    QStringList headings;
+    const char* field = line.constData();
+    const char* const end = field + line.size();
+    for (;;) {
+        const char* fieldEnd = findFieldEnd(field, end, separator);
+        QString heading = QString::fromUtf8(field, int(fieldEnd - field)).trimmed();
+        if (heading.size() >= 2 && heading.startsWith('"') && heading.endsWith('"')) {
+            heading = heading.mid(1, heading.size() - 2).replace("\"\"", "\"");
+        }
+        headings << heading;
+        if (fieldEnd == end) {
+            break;
+        }
+        field = fieldEnd + 1;
+    }
+    return headings;
+}
+
+// Headings of Shockee's own exports, for files that have none
+QStringList defaultHeadings(int count)
+{
+    QStringList headings = { "timestamp", "position_mm", "force_kg", "encoder_pulses", "velocity_mm_s" };
+    while (headings.size() < count) {
+        headings << QString("column_%1").arg(headings.size() + 1);
+    }
+    return headings.mid(0, count);
+}
+
+} // namespace
+
+CsvImporter::CsvImporter(const Options& options)
+    : m_options(options)
+    , m_separator(',')
+    , m_extraCount(0)
+    , m_rows(0)
+    , m_skipped(0)
+{
+}
+
+SensorChannel CsvImporter::channelForHeading(const QString& heading, double* scale)
+{
+    QString name;
+    QString unit;
+    splitNameUnit(heading, &name, &unit);
+
+    const QString key = aliasFor(channelName(name));
+    const SensorChannel::Role role = SensorChannel::roleForName(key);
+    *scale = 1.0;
+    if (role == SensorChannel::Extra || role == SensorChannel::Sequence) {
+        return SensorChannel(key, unit);
+    }
+
+    const QString normalized = unit.toLower().remove(' ').replace("µ", "u");
+    if (!unitScale(role, normalized, scale)) {
+        qWarning() << "Unknown unit" << unit << "for" << heading << "- importing unscaled";
+    }
+    return SensorChannel(key, canonicalUnit(role),
+                         role == SensorChannel::Timestamp || role == SensorChannel::Encoder
+                             ? SensorChannel::Integer : SensorChannel::Real);
+}
+
+bool CsvImporter::resolveColumns(const QStringList& headings, ChannelSchema* schema, bool* hasVelocity)
+{
+    // Lower-cased mapping keys
+    QMap<QString, QString> mapping;
+    for (auto it = m_options.mapping.constBegin(); it != m_options.mapping.constEnd(); ++it) {
+        mapping.insert(it.key().trimmed().toLower(), it.value().trimmed());
+    }
+
+    // Built-in channels keep the original schema layout, so a re-imported
+    // export has the default schema; other columns follow as extras
+    QVector<SensorChannel> channels = ChannelSchema::defaultSchema().channels();
+    QVector<bool> builtinTaken(SensorChannel::Extra, false);
+    QVector<SensorChannel> fileChannels;
+    *hasVelocity = false;
+
+    for (const QString& heading : headings) {
+        double scale = 1.0;
+        SensorChannel channel;
+        const QString key = heading.toLower();
+        if (mapping.contains(key)) {
+            const QString target = mapping.value(key);
+            if (target.isEmpty()) {
+                fileChannels << SensorChannel("sequence", QString());   // skipped
+                m_columns << Column{ SensorChannel::Sequence, -1, 1.0 };
+                continue;
+            }
+            // The mapping names the channel; the heading's unit applies unless
+            // the mapping gives one
+            QString name;
+            QString unit;
+            splitNameUnit(target, &name, &unit);
+            if (unit.isEmpty()) {
+                QString headingName;
+                splitNameUnit(heading, &headingName, &unit);
+            }
+            channel = channelForHeading(unit.isEmpty() ? name : QString("%1 [%2]").arg(name, unit), &scale);
+        } else {
+            channel = channelForHeading(heading, &scale);
+        }
+
+        // A second column for a built-in quantity is kept as an extra
+        if (channel.role != SensorChannel::Extra && channel.role != SensorChannel::Sequence
+            && builtinTaken[channel.role]) {
+            channel = SensorChannel(channel.name + "_2", channel.unit);
+        }
+        if (channel.role == SensorChannel::Extra) {
+            QString name = channel.name;
+            for (int n = 2; std::any_of(fileChannels.begin(), fileChannels.end(),
+                                        [&name](const SensorChannel& c) { return c.name == name; }); ++n) {
+                name = channel.name + "_" + QString::number(n);
+            }
+            channel = SensorChannel(name, channel.unit);
+            channels << channel;
+        } else if (channel.role != SensorChannel::Sequence) {
+            builtinTaken[channel.role] = true;
+            *hasVelocity = *hasVelocity || channel.role == SensorChannel::Velocity;
+        }
+        fileChannels << channel;
+        m_columns << Column{ channel.role, -1, scale };
+    }
+
+    if (!builtinTaken[SensorChannel::Timestamp]) {
+        m_error = "No time column among: " + headings.join(", ");
+        return false;
+    }
+
+    *schema = ChannelSchema::fromChannels(channels);
+    m_extraCount = schema->extraCount();
+    for (int i = 0; i < m_columns.size(); ++i) {
+        if (m_columns[i].role == SensorChannel::Extra) {
+            m_columns[i].extraIndex = schema->channel(schema->indexOf(fileChannels[i].name)).extraIndex;
+        }
+    }
+    return true;
+}
+
+bool CsvImporter::parseRow(const char* begin, const char* end, SensorData* data, SensorExtraStore* extras) const
+{
+    double* extra = extras->allocate(&data->extra, m_extraCount);
+    std::fill(extra, extra + m_extraCount, qQNaN());
+
+    bool hasTime = false;
+    const char* field = begin;
+    for (int i = 0; i < m_columns.size(); ++i) {
+        // Columns missing from a short row read as empty fields
+        const char* fieldEnd = end;
+        if (field < end) {
+            fieldEnd = findFieldEnd(field, end, m_separator);
+        } else {
+            field = end;
+        }
+        const Column& column = m_columns[i];
+
+        if (column.role != SensorChannel::Sequence) {
+            double value;
+            const bool ok = parseNumber(field, fieldEnd, &value);
+            // Gaps are allowed in extra channels only
+            if (!ok && column.role != SensorChannel::Extra) {
+                return false;
+            }
+            value *= column.scale;
+            switch (column.role) {
+                case SensorChannel::Timestamp:
+                    data->timestampUs = qRound64(value * 1000.0);
+                    data->timestamp = data->timestampUs / 1000;
+                    hasTime = true;
+                    break;
+                case SensorChannel::Position: data->position = value; break;
+                case SensorChannel::Force: data->force = value; break;
+                case SensorChannel::Encoder: data->encoderPulses = long(qRound64(value)); break;
+                case SensorChannel::Velocity: data->velocity = value; break;
+                case SensorChannel::Extra:
+                    if (ok) {
+                        extra[column.extraIndex] = value;
+                    }
+                    break;
+                case SensorChannel::Sequence:
+                    break;
+            }
+        }
+        field = fieldEnd + 1;
+    }
+    return hasTime;
+}
+
+CsvImporter::ChunkResult CsvImporter::parseChunk(const char* begin, const char* end) const
+{
+    SHOCKEE_TRACE_SCOPE("storage", "CsvImporter::parseChunk");
+
+    ChunkResult result;
+    result.skipped = 0;
+    // Rows are at least a few bytes each; a rough reserve saves regrowth
+    result.data.reserve(int((end - begin) / (8 * qMax(1, int(m_columns.size())))));
+
+    // Chunks are parsed in parallel, so each fills extra rows of its own
+    SensorExtraStore extras;
+    while (begin < end) {
+        const char* lineEnd = static_cast<const char*>(memchr(begin, '\n', end - begin));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        const char* next = lineEnd + 1;
+        if (lineEnd > begin && lineEnd[-1] == '\r') {
+            --lineEnd;
+        }
+
+        const char* content = skipSpace(begin, lineEnd);
+        if (content < lineEnd && *content != '#') {
+            SensorData data;
+            if (parseRow(begin, lineEnd, &data, &extras)) {
+                result.data.append(data);
+            } else {
+                ++result.skipped;
+            }
+        }
+        begin = next;
+    }
+    return result;
+}
+
+bool CsvImporter::importSession(const QString& filename, Session* session)
+{
+    SHOCKEE_TRACE_SCOPE("storage", "CsvImporter::importSession");
+
+    m_error.clear();
+    m_rows = 0;
+    m_skipped = 0;
+    m_columns.clear();
+    m_extraCount = 0;
+
+    MappedFile file;
+    if (!file.open(filename)) {
+        m_error = file.errorString();
+        return false;
+    }
+    const char* const end = file.end();
+
+    // First line that is not blank or a comment: headings, or already data
+    const char* line = file.text();
+    const char* lineEnd = line;
+    while (line < end) {
+        lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        const char* content = skipSpace(line, lineEnd);
+        if (content < lineEnd && *content != '#' && *content != '\r') {
+            break;
+        }
+        line = lineEnd + 1;
+    }
+    if (line >= end) {
+        m_error = "No data lines found";
+        return false;
+    }
+    QByteArray first(line, int(lineEnd - line));
+    if (first.endsWith('\r')) {
+        first.chop(1);
+    }
+
+    m_separator = m_options.separator;
+    if (m_separator == 0) {
+        m_separator = first.contains('\t') ? '\t' : first.count(';') > first.count(',') ? ';' : ',';
+    }
+
+    QStringList headings = splitHeading(first, m_separator);
+    double number;
+    const char* firstEnd = findFieldEnd(first.constData(), first.constData() + first.size(), m_separator);
+    const bool hasHeadings = !parseNumber(first.constData(), firstEnd, &number);
+    const char* body = hasHeadings ? qMin(lineEnd + 1, end) : line;
+    if (!hasHeadings) {
+        headings = defaultHeadings(headings.size());
+    }
+
+    ChannelSchema schema;
+    bool hasVelocity;
+    if (!resolveColumns(headings, &schema, &hasVelocity)) {
+        return false;
+    }
+
+    // Newline-aligned chunks, parsed in parallel and joined in file order
+    QVector<QPair<const char*, const char*>> chunks;
+    for (const char* start = body; start < end;) {
+        const char* stop = end - start > CHUNK_SIZE ? start + CHUNK_SIZE : end;
+        if (stop < end) {
+            const char* newline = static_cast<const char*>(memchr(stop, '\n', end - stop));
+            stop = newline ? newline + 1 : end;
+        }
+        chunks.append(qMakePair(start, stop));
+        start = stop;
+    }
+
+    const QVector<ChunkResult> results = QtConcurrent::blockingMapped<QVector<ChunkResult>>(chunks,
+        [this](const QPair<const char*, const char*>& chunk) {
+            return parseChunk(chunk.first, chunk.second);
+        });
+
+    qint64 total = 0;
+    for (const ChunkResult& result : results) {
+        total += result.data.size();
+        m_skipped += result.skipped;
+    }
+
+    Session imported;
+    imported.data.reserve(total);
+    for (const ChunkResult& result : results) {
+        imported.data += result.data;
+    }
+    m_rows = imported.data.size();
+    if (imported.data.isEmpty()) {
+        m_error = "No rows could be parsed";
+        return false;
+    }
+
+    // Other software does not always write in time order
+    auto earlier = [](const SensorData& a, const SensorData& b) { return a.timestampUs < b.timestampUs; };
+    if (!std::is_sorted(imported.data.begin(), imported.data.end(), earlier)) {
+        std::stable_sort(imported.data.begin(), imported.data.end(), earlier);
+    }
+    if (!hasVelocity) {
+        VelocityEstimator::recompute(imported.data, m_options.velocityMethod);
+    }
+
+    const QFileInfo info(filename);
+    imported.name = info.completeBaseName();
+    imported.timestamp = info.lastModified();
+    imported.description = "Imported from " + info.fileName();
+    imported.schema = schema;
+    *session = imported;
+    return true;
+}
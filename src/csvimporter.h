@@ -0,0 +1,77 @@
+#ifndef CSVIMPORTER_H
+#define CSVIMPORTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+
+#include "datalogger.h"
+
+// Delimited-text import of sessions recorded by other dyno software or
+// exported by Shockee.
+//
+// The file is memory-mapped and cut into CHUNK_SIZE pieces, each extended
+// to the next newline, which are parsed in parallel with std::from_chars
+// and concatenated in file order. Column headings are mapped to channels:
+// built-in quantities (by name or a common alias, with the unit converted
+// to Shockee's) fill the SensorData members, any other column becomes an
+// extra channel of the session's schema. Options::mapping overrides the
+// guess for individual headings. Quoted fields may contain the separator
+// but not a line break; a quoted number such as "1,5" in a comma-separated
+// file is read as one unparseable field rather than split.
+class CsvImporter
+{
+public:
+    struct Options {
+        char separator;         // 0 detects tab, semicolon or comma from the first line
+        // Heading (case-insensitive) -> channel name, e.g. "Disp" -> "position"
+        // or "Temp" -> "temperature[degC]"; an empty channel skips the column
+        QMap<QString, QString> mapping;
+        VelocityEstimator::Method velocityMethod;    // when the file has no velocity column
+
+        Options() : separator(0), velocityMethod(VelocityEstimator::SavitzkyGolay) {}
+    };
+
+    explicit CsvImporter(const Options& options = Options());
+
+    bool importSession(const QString& filename, Session* session);
+
+    QString errorString() const { return m_error; }
+    qint64 rowsRead() const { return m_rows; }
+    qint64 rowsSkipped() const { return m_skipped; }
+
+    // Channel a heading maps to without an explicit mapping: "Position (mm)",
+    // "position_mm", "Travel [in]" and "Load (N)" are all recognised. The
+    // returned scale converts the column's unit to the channel's.
+    static SensorChannel channelForHeading(const QString& heading, double* scale);
+
+    static const qint64 CHUNK_SIZE = 4 << 20;   // bytes per parse task
+
+private:
+    struct Column {
+        SensorChannel::Role role;   // Sequence for skipped columns
+        int extraIndex;
+        double scale;
+    };
+
+    struct ChunkResult {
+        QVector<SensorData> data;
+        qint64 skipped;
+    };
+
+    bool resolveColumns(const QStringList& headings, ChannelSchema* schema, bool* hasVelocity);
+    ChunkResult parseChunk(const char* begin, const char* end) const;
+    // Extra channels go to a row from extras
+    bool parseRow(const char* begin, const char* end, SensorData* data, SensorExtraStore* extras) const;
+
+    Options m_options;
+    char m_separator;
+    QVector<Column> m_columns;
+    int m_extraCount;
+    QString m_error;
+    qint64 m_rows;
+    qint64 m_skipped;
+};
+
+#endif // CSVIMPORTER_H
@@ -0,0 +1,133 @@
+#include "dampinganalyzer.h"
+#include <QtMath>
+
+DampingAnalyzer::DampingAnalyzer(double binWidth)
+    : m_binWidth(binWidth > 0 ? binWidth : DEFAULT_BIN_WIDTH)
+    , m_sampleCount(0)
+    , m_outlierCount(0)
+{
+}
+
+void DampingAnalyzer::setBinWidth(double binWidth)
+{
+    if (binWidth <= 0 || binWidth == m_binWidth) {
+        return;
+    }
+
+    // Existing bins cannot be re-split, so a new width starts from scratch
+    m_binWidth = binWidth;
+    clear();
+}
+
+void DampingAnalyzer::clear()
+{
+    m_compression.clear();
+    m_rebound.clear();
+    m_sampleCount = 0;
+    m_outlierCount = 0;
+}
+
+void DampingAnalyzer::addSample(const SensorData& data)
+{
+    if (data.velocity >= 0) {
+        accumulate(m_compression, data.velocity, data.force);
+    } else {
+        accumulate(m_rebound, -data.velocity, data.force);
+    }
+}
+
+void DampingAnalyzer::addSamples(const QVector<SensorData>& data)
+{
+    for (const SensorData& point : data) {
+        addSample(point);
+    }
+}
+
+void DampingAnalyzer::accumulate(QVector<Accumulator>& bins, double speed, double force)
+{
+    double scaled = speed / m_binWidth;
+    if (!(scaled < MAX_BINS)) {
+        ++m_outlierCount;
+        return;
+    }
+
+    int index = static_cast<int>(scaled);
+    if (index >= bins.size()) {
+        bins.resize(index + 1);
+    }
+
+    // Welford's running mean/variance
+    Accumulator& bin = bins[index];
+    ++bin.count;
+    double delta = force - bin.mean;
+    bin.mean += delta / bin.count;
+    bin.m2 += delta * (force - bin.mean);
+
+    ++m_sampleCount;
+}
+
+QVector<DampingBin> DampingAnalyzer::compressionCurve() const
+{
+    return toCurve(m_compression, 1.0);
+}
+
+QVector<DampingBin> DampingAnalyzer::reboundCurve() const
+{
+    return toCurve(m_rebound, -1.0);
+}
+
+QVector<DampingBin> DampingAnalyzer::toCurve(const QVector<Accumulator>& bins, double sign) const
+{
+    QVector<DampingBin> curve;
+    curve.reserve(bins.size());
+
+    for (int i = 0; i < bins.size(); ++i) {
+        const Accumulator& acc = bins[i];
+        if (acc.count == 0) continue;
+
+        DampingBin bin;
+        bin.velocity = sign * (i + 0.5) * m_binWidth;
+        bin.meanForce = acc.mean;
+        bin.stdDevForce = acc.count > 1 ? qSqrt(acc.m2 / (acc.count - 1)) : 0.0;
+        bin.count = acc.count;
+        curve.append(bin);
+    }
+
+    return curve;
+}
+
+QRectF DampingAnalyzer::bounds() const
+{
+    double minV = 0, maxV = 0, minF = 0, maxF = 0;
+    bool first = true;
+
+    // Straight from the accumulators, as toCurve() would lay them out,
+    // without building the curves
+    auto extend = [&](const QVector<Accumulator>& bins, double sign) {
+        for (int i = 0; i < bins.size(); ++i) {
+            const Accumulator& acc = bins[i];
+            if (acc.count == 0) continue;
+
+            double velocity = sign * (i + 0.5) * m_binWidth;
+            double stdDev = acc.count > 1 ? qSqrt(acc.m2 / (acc.count - 1)) : 0.0;
+            double low = acc.mean - stdDev;
+            double high = acc.mean + stdDev;
+            if (first) {
+                minV = maxV = velocity;
+                minF = low;
+                maxF = high;
+                first = false;
+            } else {
+                minV = qMin(minV, velocity);
+                maxV = qMax(maxV, velocity);
+                minF = qMin(minF, low);
+                maxF = qMax(maxF, high);
+            }
+        }
+    };
+
+    extend(m_compression, 1.0);
+    extend(m_rebound, -1.0);
+
+    return QRectF(QPointF(minV, minF), QPointF(maxV, maxF));
+}
@@ -0,0 +1,68 @@
+#ifndef DAMPINGANALYZER_H
+#define DAMPINGANALYZER_H
+
+#include <QVector>
+#include <QRectF>
+
+#include "sensordata.h"
+
+struct DampingBin {
+    double velocity;    // bin centre, mm/s (negative for rebound)
+    double meanForce;   // kg
+    double stdDevForce; // kg
+    qint64 count;
+
+    DampingBin() : velocity(0), meanForce(0), stdDevForce(0), count(0) {}
+};
+
+// Bins force by shaft velocity to produce the classic damping curve.
+// Compression (velocity >= 0) and rebound (velocity < 0) are kept apart and
+// each bin keeps a running mean/variance, so samples can be streamed in one
+// at a time during recording without keeping the raw data around.
+class DampingAnalyzer
+{
+public:
+    explicit DampingAnalyzer(double binWidth = DEFAULT_BIN_WIDTH);
+
+    void setBinWidth(double binWidth);
+    double binWidth() const { return m_binWidth; }
+    void clear();
+
+    void addSample(const SensorData& data);
+    void addSamples(const QVector<SensorData>& data);
+
+    QVector<DampingBin> compressionCurve() const;
+    QVector<DampingBin> reboundCurve() const;
+
+    qint64 sampleCount() const { return m_sampleCount; }
+    qint64 outlierCount() const { return m_outlierCount; }
+    bool isEmpty() const { return m_sampleCount == 0; }
+
+    // Velocity/force extent of the binned curve (mean +/- one stddev)
+    QRectF bounds() const;
+
+    static constexpr double DEFAULT_BIN_WIDTH = 10.0; // mm/s
+
+private:
+    struct Accumulator {
+        qint64 count;
+        double mean;
+        double m2;
+
+        Accumulator() : count(0), mean(0), m2(0) {}
+    };
+
+    void accumulate(QVector<Accumulator>& bins, double speed, double force);
+    QVector<DampingBin> toCurve(const QVector<Accumulator>& bins, double sign) const;
+
+    double m_binWidth;
+    QVector<Accumulator> m_compression;
+    QVector<Accumulator> m_rebound;
+    qint64 m_sampleCount;
+    qint64 m_outlierCount;
+
+    // Upper bound on bins per direction; protects against velocity spikes
+    static const int MAX_BINS = 65536;
+};
+
+#endif // DAMPINGANALYZER_H
@@ -1,10 +1,15 @@
 #include "datalogger.h"
+#include "tracing.h"
+#include "streammerger.h"
+#include "csvexporter.h"
+#include "xlsxexporter.h"
+#include "sessionjson.h"
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QTextStream>
 #include <QDebug>
 #include <QDateTime>
 
@@ -51,46 +56,47 @@ void DataLogger::clearCurrentSession()
 
 bool DataLogger::saveSession(const Session& session, const QString& filename)
 {
+    SHOCKEE_TRACE_SCOPE("storage", "DataLogger::saveSession");
+    
     QString filepath = filename;
     if (filepath.isEmpty()) {
         filepath = m_sessionsDir + "/" + generateSessionFilename(session.name) + ".json";
     }
     
-    QFile file(filepath);
+    // Written to a temporary file and renamed over the target, so a crash or
+    // full disk never leaves a truncated session behind
+    QSaveFile file(filepath);
     if (!file.open(QIODevice::WriteOnly)) {
         qWarning() << "Failed to open file for writing:" << filepath;
         return false;
     }
     
-    QJsonObject json = sessionToJson(session);
-    QJsonDocument doc(json);
-    
-    file.write(doc.toJson());
-    file.close();
+    SessionJson writer;
+    if (!writer.write(session, &file)) {
+        qWarning() << "Failed to write session:" << filepath << writer.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        qWarning() << "Failed to write session:" << filepath << file.errorString();
+        return false;
+    }
     
     return true;
 }
 
 Session DataLogger::loadSession(const QString& filename)
 {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Failed to open file for reading:" << filename;
-        return Session();
-    }
+    SHOCKEE_TRACE_SCOPE("storage", "DataLogger::loadSession");
     
-    QByteArray data = file.readAll();
-    file.close();
-    
-    QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
-    
-    if (error.error != QJsonParseError::NoError) {
-        qWarning() << "JSON parse error:" << error.errorString();
+    Session session;
+    SessionJson reader;
+    if (!reader.read(filename, &session)) {
+        qWarning() << "Failed to read session:" << filename << reader.errorString();
         return Session();
     }
     
-    return sessionFromJson(doc.object());
+    return session;
 }
 
 QStringList DataLogger::getAvailableSessions()
@@ -116,55 +122,22 @@ QString DataLogger::getSessionsDirectory()
 
 bool DataLogger::exportToCsv(const Session& session, const QString& filename)
 {
-    QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qWarning() << "Failed to open CSV file for writing:" << filename;
+    // Schema channels beyond the built-in ones follow velocity
+    CsvExporter exporter;
+    if (!exporter.exportSession(session, filename)) {
+        qWarning() << "CSV export failed:" << filename << exporter.errorString();
         return false;
     }
-    
-    QTextStream stream(&file);
-    
-    // Write header
-    stream << "timestamp,position_mm,force_kg,encoder_pulses,velocity_mm_s\n";
-    
-    // Write data
-    for (const SensorData& data : session.data) {
-        stream << data.timestamp << ","
-               << data.position << ","
-               << data.force << ","
-               << data.encoderPulses << ","
-               << data.velocity << "\n";
-    }
-    
-    file.close();
     return true;
 }
 
 bool DataLogger::exportToExcel(const Session& session, const QString& filename)
 {
-    // For now, export as CSV with .xlsx extension
-    // A full Excel implementation would require additional libraries
-    QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qWarning() << "Failed to open Excel file for writing:" << filename;
+    XlsxExporter exporter;
+    if (!exporter.exportSession(session, filename)) {
+        qWarning() << "Excel export failed:" << filename << exporter.errorString();
         return false;
     }
-    
-    QTextStream stream(&file);
-    
-    // Write header with tab separation for Excel compatibility
-    stream << "Timestamp\tPosition (mm)\tForce (kg)\tEncoder (pulses)\tVelocity (mm/s)\n";
-    
-    // Write data
-    for (const SensorData& data : session.data) {
-        stream << data.timestamp << "\t"
-               << data.position << "\t"
-               << data.force << "\t"
-               << data.encoderPulses << "\t"
-               << data.velocity << "\n";
-    }
-    
-    file.close();
     return true;
 }
 
@@ -219,6 +192,43 @@ QVector<QPointF> DataLogger::getVelocityVsTimeCurve(const Session& session)
     return curve;
 }
 
+QVector<HysteresisCycle> DataLogger::analyzeHysteresis(const Session& session)
+{
+    return HysteresisAnalyzer::analyze(session.data);
+}
+
+void DataLogger::recomputeVelocity(Session& session, VelocityEstimator::Method method)
+{
+    VelocityEstimator::recompute(session.data, method);
+}
+
+bool DataLogger::recalibrateSession(Session& session, const CalibrationSet& calibration,
+                                    VelocityEstimator::Method method)
+{
+    if (!calibration.appliesTo(session.schema)) {
+        qWarning() << "Session" << session.name << "has no raw channels to recalibrate";
+        return false;
+    }
+    
+    calibration.apply(session.data, session.schema);
+    session.calibration = calibration;
+    VelocityEstimator::recompute(session.data, method);
+    return true;
+}
+
+void DataLogger::resampleSession(Session& session, double sampleRate, Resampler::Mode mode)
+{
+    UniformSeries series = Resampler::resample(session.data, sampleRate, mode);
+    if (series.isEmpty()) {
+        qWarning() << "Cannot resample session" << session.name << "to" << sampleRate << "Hz";
+        return;
+    }
+    
+    // Grid times keep microsecond resolution in timestampUs; the millisecond
+    // timestamp is truncated from it as for live data
+    session.data = series.toSensorData();
+}
+
 void DataLogger::setSessionMetadata(const QString& strutInfo, double springRate, 
                                    double dampingSetting, const QString& testConditions)
 {
@@ -245,10 +255,36 @@ QJsonObject DataLogger::sessionToJson(const Session& session)
     json["spring_rate"] = session.spring_rate;
     json["damping_setting"] = session.damping_setting;
     json["test_conditions"] = session.test_conditions;
+    if (session.link_health.linesReceived > 0) {
+        json["link_health"] = session.link_health.toJson();
+    }
+    if (!session.limit_trips.isEmpty()) {
+        QJsonArray trips;
+        for (const LimitTrip& trip : session.limit_trips) {
+            trips.append(trip.toJson());
+        }
+        json["limit_trips"] = trips;
+    }
+    
+    if (!session.devices.isEmpty()) {
+        json["devices"] = QJsonArray::fromStringList(session.devices);
+    }
     
+    if (!session.schema.isDefault()) {
+        json["channels"] = session.schema.toJson();
+    }
+    if (!session.calibration.isEmpty()) {
+        json["calibration"] = session.calibration.toJson();
+    }
+    
+    const QVector<SensorData> samples = session.auxiliary.isEmpty()
+        ? session.data
+        : StreamMerger::merge({ session.data, session.auxiliary });
+    
+    const QVector<SensorChannel> extras = session.schema.extraChannels();
     QJsonArray dataArray;
-    for (const SensorData& data : session.data) {
-        dataArray.append(sensorDataToJson(data));
+    for (const SensorData& data : samples) {
+        dataArray.append(sensorDataToJson(data, extras));
     }
     json["data"] = dataArray;
     
@@ -265,33 +301,81 @@ Session DataLogger::sessionFromJson(const QJsonObject& json)
     session.spring_rate = json["spring_rate"].toDouble();
     session.damping_setting = json["damping_setting"].toDouble();
     session.test_conditions = json["test_conditions"].toString();
+    if (json.contains("link_health")) {
+        session.link_health = LinkHealth::fromJson(json["link_health"].toObject());
+    }
+    for (const QJsonValue& trip : json["limit_trips"].toArray()) {
+        session.limit_trips << LimitTrip::fromJson(trip.toObject());
+    }
+    
+    for (const QJsonValue& device : json["devices"].toArray()) {
+        session.devices << device.toString();
+    }
     
+    if (json.contains("channels")) {
+        session.schema = ChannelSchema::fromJson(json["channels"].toArray());
+    }
+    if (json.contains("calibration")) {
+        session.calibration = CalibrationSet::fromJson(json["calibration"].toObject());
+    }
+    
+    const QVector<SensorChannel> extras = session.schema.extraChannels();
+    SensorExtraStore store;
     QJsonArray dataArray = json["data"].toArray();
     for (const QJsonValue& value : dataArray) {
-        session.data.append(sensorDataFromJson(value.toObject()));
+        SensorData data = sensorDataFromJson(value.toObject(), extras, &store);
+        if (data.source == 0) {
+            session.data.append(data);
+        } else {
+            session.auxiliary.append(data);
+        }
     }
     
     return session;
 }
 
-QJsonObject DataLogger::sensorDataToJson(const SensorData& data)
+QJsonObject DataLogger::sensorDataToJson(const SensorData& data, const QVector<SensorChannel>& extras)
 {
     QJsonObject json;
     json["timestamp"] = static_cast<qint64>(data.timestamp);
+    if (data.timestampUs != 0) {
+        json["timestamp_us"] = data.timestampUs;
+    }
     json["position"] = data.position;
     json["force"] = data.force;
     json["encoder_pulses"] = static_cast<qint64>(data.encoderPulses);
     json["velocity"] = data.velocity;
+    if (data.source != 0) {
+        json["source"] = data.source;
+    }
+    if (!extras.isEmpty() && !data.extra.isEmpty()) {
+        QJsonObject channels;
+        for (const SensorChannel& channel : extras) {
+            channels[channel.name] = SensorExtraReader{ channel.extraIndex }(data);
+        }
+        json["extra"] = channels;
+    }
     return json;
 }
 
-SensorData DataLogger::sensorDataFromJson(const QJsonObject& json)
+SensorData DataLogger::sensorDataFromJson(const QJsonObject& json, const QVector<SensorChannel>& extras,
+                                          SensorExtraStore* store)
 {
     SensorData data;
     data.timestamp = json["timestamp"].toVariant().toLongLong();
+    data.timestampUs = json.contains("timestamp_us") ? json["timestamp_us"].toInteger()
+                                                      : data.timestamp * 1000;
     data.position = json["position"].toDouble();
     data.force = json["force"].toDouble();
     data.encoderPulses = json["encoder_pulses"].toVariant().toLongLong();
     data.velocity = json["velocity"].toDouble();
+    data.source = json["source"].toInt();
+    if (!extras.isEmpty()) {
+        const QJsonObject channels = json["extra"].toObject();
+        double* values = store->allocate(&data.extra, extras.size());
+        for (const SensorChannel& channel : extras) {
+            values[channel.extraIndex] = channels[channel.name].toDouble(qQNaN());
+        }
+    }
     return data;
 }
\ No newline at end of file
@@ -11,14 +11,35 @@
 #include <QDir>
 #include <QStandardPaths>
 #include <QPointF>
+#include <QStringList>
 
-#include "serialcommunicator.h"
+#include "sensordata.h"
+#include "dampinganalyzer.h"
+#include "velocityestimator.h"
+#include "hysteresisanalyzer.h"
+#include "resampler.h"
+#include "linkhealthmonitor.h"
+#include "channelschema.h"
+#include "calibration.h"
+#include "limitmonitor.h"
 
 struct Session {
     QString name;
     QString description;
     QDateTime timestamp;
-    QVector<SensorData> data;
+    QVector<SensorData> data;        // primary device
+    
+    // Samples from additional acquisition devices (source > 0), time-ordered.
+    // Saved interleaved with data as one time-ordered stream.
+    QVector<SensorData> auxiliary;
+    QStringList devices;             // port of each source, when there are several
+    
+    // Columns the primary device streamed; non-default schemas add
+    // SensorData::extra values to every sample
+    ChannelSchema schema;
+    // Host calibration that produced the calibrated channels from the raw
+    // ones in the schema; empty for devices that calibrate on board
+    CalibrationSet calibration;
     
     // Metadata
     QString strut_info;
@@ -26,6 +47,11 @@ struct Session {
     double damping_setting;
     QString test_conditions;
     
+    // Serial link accounting for live recordings; empty for imports
+    LinkHealth link_health;
+    // Limits broken while recording, in the order they tripped
+    QVector<LimitTrip> limit_trips;
+    
     Session() : spring_rate(0), damping_setting(0) {}
 };
 
@@ -48,6 +74,11 @@ public:
     QStringList getAvailableSessions();
     QString getSessionsDirectory();
     
+    // Whole-document JSON form; save/loadSession stream the same document
+    // through SessionJson instead
+    QJsonObject sessionToJson(const Session& session);
+    Session sessionFromJson(const QJsonObject& json);
+    
     // Export functions
     bool exportToCsv(const Session& session, const QString& filename);
     bool exportToExcel(const Session& session, const QString& filename);
@@ -59,6 +90,20 @@ public:
     QVector<QPointF> getForceVsPositionCurve(const Session& session);
     QVector<QPointF> getVelocityVsTimeCurve(const Session& session);
     
+    QVector<HysteresisCycle> analyzeHysteresis(const Session& session);
+    
+    // Offline velocity recomputation
+    void recomputeVelocity(Session& session, VelocityEstimator::Method method);
+    
+    // Recomputes calibrated channels from the session's raw channels, then
+    // velocity; returns false if the session has no raw channels to use
+    bool recalibrateSession(Session& session, const CalibrationSet& calibration,
+                            VelocityEstimator::Method method = VelocityEstimator::SavitzkyGolay);
+    
+    // Puts a session on a fixed sample rate
+    void resampleSession(Session& session, double sampleRate,
+                         Resampler::Mode mode = Resampler::WindowedSinc);
+    
     // Current session access
     const Session& getCurrentSession() const { return m_currentSession; }
     bool isRecording() const { return m_isRecording; }
@@ -74,10 +119,9 @@ signals:
 
 private:
     QString generateSessionFilename(const QString& baseName = "");
-    QJsonObject sessionToJson(const Session& session);
-    Session sessionFromJson(const QJsonObject& json);
-    QJsonObject sensorDataToJson(const SensorData& data);
-    SensorData sensorDataFromJson(const QJsonObject& json);
+    QJsonObject sensorDataToJson(const SensorData& data, const QVector<SensorChannel>& extras);
+    SensorData sensorDataFromJson(const QJsonObject& json, const QVector<SensorChannel>& extras,
+                                  SensorExtraStore* store);
     
     Session m_currentSession;
     bool m_isRecording;
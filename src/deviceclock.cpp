@@ -0,0 +1,111 @@
+#include "deviceclock.h"
+#include <QtMath>
+
+DeviceClock::DeviceClock()
+{
+    reset();
+}
+
+void DeviceClock::reset()
+{
+    m_started = false;
+    m_lastRaw = 0;
+    m_unwrapped = 0;
+    m_lastStep = 1;
+    m_lastHostTime = 0;
+    m_lastOutput = 0;
+    m_segmentBase = 0;
+
+    m_weight = 0;
+    m_meanX = 0;
+    m_meanY = 0;
+    m_covXX = 0;
+    m_covXY = 0;
+    m_slope = 1000.0;
+
+    m_rollovers = 0;
+    m_resets = 0;
+}
+
+qint64 DeviceClock::map(qint64 deviceMillis, qint64 hostTime)
+{
+    // millis() is an unsigned 32-bit counter whatever the line says
+    const quint32 raw = quint32(deviceMillis);
+
+    if (!m_started) {
+        m_started = true;
+        m_segmentBase = double(raw) * 1000.0;
+        startSegment(raw);
+    } else {
+        // Modular difference: a rollover is a small step forward,
+        // anything in the upper half of the range is a step back
+        const quint32 step = raw - m_lastRaw;
+        bool discontinuity = step >= 0x80000000u;
+
+        if (!discontinuity && hostTime > 0 && m_lastHostTime > 0) {
+            const qint64 hostStep = (hostTime - m_lastHostTime) / 1000000;
+            discontinuity = qint64(step) > hostStep + JUMP_TOLERANCE;
+        }
+
+        if (discontinuity) {
+            ++m_resets;
+            m_segmentBase = double(m_lastOutput) + m_lastStep * 1000.0;
+            startSegment(raw);
+        } else {
+            if (raw < m_lastRaw) {
+                ++m_rollovers;
+            }
+            m_unwrapped += step;
+            if (step > 0) {
+                m_lastStep = step;
+            }
+        }
+    }
+
+    m_lastRaw = raw;
+    const double x = double(m_unwrapped);
+
+    if (hostTime > 0) {
+        m_lastHostTime = hostTime;
+        addFitPoint(x, hostTime / 1000.0);
+    }
+
+    double predicted;
+    if (m_weight > 0) {
+        predicted = m_meanY + m_slope * (x - m_meanX);
+    } else {
+        predicted = m_segmentBase + x * 1000.0;
+    }
+
+    m_lastOutput = qMax(m_lastOutput, qRound64(predicted));
+    return m_lastOutput;
+}
+
+void DeviceClock::startSegment(quint32 raw)
+{
+    m_lastRaw = raw;
+    m_unwrapped = 0;
+
+    // The device restarted its clock; keep the slope, forget the points
+    m_weight = 0;
+    m_meanX = 0;
+    m_meanY = 0;
+    m_covXX = 0;
+    m_covXY = 0;
+}
+
+void DeviceClock::addFitPoint(double x, double y)
+{
+    // Exponentially weighted running means and co-moments (West's update)
+    const double decay = 1.0 - 1.0 / FIT_MEMORY;
+    m_weight = decay * m_weight + 1.0;
+    const double dx = x - m_meanX;
+    m_meanX += dx / m_weight;
+    m_meanY += (y - m_meanY) / m_weight;
+    m_covXX = decay * m_covXX + dx * (x - m_meanX);
+    m_covXY = decay * m_covXY + dx * (y - m_meanY);
+
+    if (x >= MIN_FIT_SPAN && m_covXX > 0) {
+        m_slope = qBound(1000.0 * (1.0 - MAX_DRIFT), m_covXY / m_covXX, 1000.0 * (1.0 + MAX_DRIFT));
+    }
+}
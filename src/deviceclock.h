@@ -0,0 +1,70 @@
+#ifndef DEVICECLOCK_H
+#define DEVICECLOCK_H
+
+#include <QtGlobal>
+
+// Rebuilds a monotonic 64-bit microsecond timeline from the device's 32-bit
+// millis() timestamps.
+//
+// Rollovers (every ~49.7 days) are unwrapped. A timestamp that goes
+// backwards, or jumps further ahead than the host clock allows, is taken as
+// a device reset and starts a new segment that carries on from the previous
+// output. Within a segment, when host receive times are available, a least
+// squares fit with exponential forgetting maps device time onto the host
+// monotonic clock, so the output runs at host rate (drift corrected) and
+// streams from several devices share one timeline. Without host times
+// (offline logs) the output is the unwrapped device time.
+//
+// The output never decreases.
+class DeviceClock
+{
+public:
+    DeviceClock();
+
+    void reset();
+
+    // deviceMillis as sent by the device; hostTime in ns on the
+    // LatencyMonitor::now() clock, 0 if unknown. Returns microseconds.
+    qint64 map(qint64 deviceMillis, qint64 hostTime = 0);
+
+    int rollovers() const { return m_rollovers; }
+    int resets() const { return m_resets; }
+
+    // Device clock error relative to the host in parts per million;
+    // positive when the device runs slow
+    double drift() const { return (m_slope / 1000.0 - 1.0) * 1e6; }
+
+    // Forward jump beyond the host elapsed time that counts as a reset (ms)
+    static const qint64 JUMP_TOLERANCE = 5000;
+    // Device time a segment must span before its slope is trusted (ms)
+    static const qint64 MIN_FIT_SPAN = 2000;
+    // Effective number of samples remembered by the fit
+    static const int FIT_MEMORY = 30000;
+    // Largest drift the fit may report; ceramic resonators stay well inside
+    static constexpr double MAX_DRIFT = 0.01;
+
+private:
+    void startSegment(quint32 raw);
+    void addFitPoint(double x, double y);
+
+    bool m_started;
+    quint32 m_lastRaw;
+    qint64 m_unwrapped;       // ms, device time since the segment's first sample
+    qint64 m_lastStep;        // ms, last forward device step
+    qint64 m_lastHostTime;    // ns
+    qint64 m_lastOutput;      // us
+    double m_segmentBase;     // us, output at the segment start when there is no fit
+
+    // Decayed least squares of host time (us) on segment device time (ms)
+    double m_weight;
+    double m_meanX;
+    double m_meanY;
+    double m_covXX;
+    double m_covXY;
+    double m_slope;           // host us per device ms, kept across segments
+
+    int m_rollovers;
+    int m_resets;
+};
+
+#endif // DEVICECLOCK_H
@@ -0,0 +1,138 @@
+#include "devicesdialog.h"
+#include "diagnosticsdialog.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QInputDialog>
+#include <QMessageBox>
+
+DevicesDialog::DevicesDialog(AcquisitionManager* acquisition, QWidget *parent)
+    : QDialog(parent)
+    , m_acquisition(acquisition)
+    , m_refreshTimer(new QTimer(this))
+{
+    setWindowTitle("Acquisition Devices");
+    setModal(false);
+    resize(980, 260);
+
+    setupUI();
+
+    m_refreshTimer->setInterval(REFRESH_INTERVAL);
+    connect(m_refreshTimer, &QTimer::timeout, this, &DevicesDialog::refresh);
+}
+
+void DevicesDialog::setupUI()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    const QStringList columns = { "Port", "Status", "Samples", "Lost", "Late", "Queued",
+                                  "Rate (Hz)", "Link Load", "Latency p50", "Latency p99", "Limit Check Max" };
+    m_table = new QTableWidget(0, columns.size());
+    m_table->setHorizontalHeaderLabels(columns);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    m_table->setToolTip("Lost: gaps in the device stream. Late: samples that arrived after newer "
+                        "ones from other devices were merged. Latency: port read to merged output. "
+                        "Limit Check Max: worst port read to limit check, on the device's own thread.");
+    mainLayout->addWidget(m_table);
+
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    m_addButton = new QPushButton("Add Device...");
+    m_removeButton = new QPushButton("Remove");
+    QPushButton* closeButton = new QPushButton("Close");
+
+    buttonLayout->addWidget(m_addButton);
+    buttonLayout->addWidget(m_removeButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(m_addButton, &QPushButton::clicked, this, &DevicesDialog::addDevice);
+    connect(m_removeButton, &QPushButton::clicked, this, &DevicesDialog::removeDevice);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::close);
+}
+
+void DevicesDialog::showEvent(QShowEvent* event)
+{
+    QDialog::showEvent(event);
+    refresh();
+    m_refreshTimer->start();
+}
+
+void DevicesDialog::hideEvent(QHideEvent* event)
+{
+    m_refreshTimer->stop();
+    QDialog::hideEvent(event);
+}
+
+void DevicesDialog::refresh()
+{
+    const int count = m_acquisition->deviceCount();
+    m_table->setRowCount(count);
+
+    for (int row = 0; row < count; ++row) {
+        const AcquisitionManager::DeviceStats stats = m_acquisition->stats(row);
+        const bool hasLatency = stats.latency.count() > 0;
+
+        QString port = stats.portName.isEmpty() ? "-" : stats.portName;
+        if (row == 0) {
+            port += " (primary)";
+        }
+
+        const QStringList cells = {
+            port,
+            stats.connected ? "Connected" : "Disconnected",
+            QString::number(stats.link.samplesReceived),
+            QString::number(stats.link.missingSamples),
+            QString::number(stats.merge.dropped),
+            QString::number(stats.merge.queued),
+            QString::number(stats.link.samplesPerSecond, 'f', 1),
+            stats.link.baudRate > 0 ? QString("%1%").arg(stats.link.utilization() * 100.0, 0, 'f', 0) : "-",
+            hasLatency ? DiagnosticsDialog::formatLatency(stats.latency.percentile(50)) : "-",
+            hasLatency ? DiagnosticsDialog::formatLatency(stats.latency.percentile(99)) : "-",
+            stats.limitLatency.count() > 0 ? DiagnosticsDialog::formatLatency(stats.limitLatency.max()) : "-"
+        };
+
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem* item = m_table->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem();
+                m_table->setItem(row, column, item);
+            }
+            item->setText(cells[column]);
+        }
+    }
+
+    m_removeButton->setEnabled(count > 1);
+}
+
+void DevicesDialog::addDevice()
+{
+    bool ok = false;
+    QString portName = QInputDialog::getItem(this, "Add Device", "Serial port:",
+                                             m_acquisition->primary()->getAvailablePorts(),
+                                             0, true, &ok);
+    if (!ok || portName.isEmpty()) {
+        return;
+    }
+
+    if (m_acquisition->addDevice(portName) < 0) {
+        QMessageBox::warning(this, "Error", "Failed to connect to " + portName);
+    }
+    refresh();
+}
+
+void DevicesDialog::removeDevice()
+{
+    int row = m_table->currentRow();
+    if (row <= 0) {
+        QMessageBox::information(this, "Remove Device",
+                                 "Select an additional device; the primary board is disconnected from the main window.");
+        return;
+    }
+
+    m_acquisition->removeDevice(row);
+    refresh();
+}
@@ -0,0 +1,41 @@
+#ifndef DEVICESDIALOG_H
+#define DEVICESDIALOG_H
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QPushButton>
+#include <QTimer>
+
+#include "acquisitionmanager.h"
+
+// Lists the acquisition devices with per-device link, merge and latency
+// figures, and adds or removes the additional boards
+class DevicesDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DevicesDialog(AcquisitionManager* acquisition, QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private slots:
+    void refresh();
+    void addDevice();
+    void removeDevice();
+
+private:
+    void setupUI();
+
+    AcquisitionManager* m_acquisition;
+    QTableWidget* m_table;
+    QPushButton* m_addButton;
+    QPushButton* m_removeButton;
+    QTimer* m_refreshTimer;
+
+    static const int REFRESH_INTERVAL = 1000; // ms
+};
+
+#endif // DEVICESDIALOG_H
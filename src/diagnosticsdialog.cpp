@@ -0,0 +1,143 @@
+#include "diagnosticsdialog.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QDateTime>
+
+DiagnosticsDialog::DiagnosticsDialog(QWidget *parent)
+    : QDialog(parent)
+    , m_refreshTimer(new QTimer(this))
+{
+    setWindowTitle("Latency Diagnostics");
+    setModal(false);
+    resize(700, 260);
+
+    setupUI();
+
+    m_refreshTimer->setInterval(REFRESH_INTERVAL);
+    connect(m_refreshTimer, &QTimer::timeout, this, &DiagnosticsDialog::refresh);
+
+    refresh();
+}
+
+void DiagnosticsDialog::setupUI()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    const QStringList columns = { "Count", "p50", "p90", "p99", "p99.9", "Max", "Mean" };
+    m_table = new QTableWidget(LatencyMonitor::StageCount, columns.size());
+    m_table->setHorizontalHeaderLabels(columns);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionMode(QAbstractItemView::NoSelection);
+    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+    QStringList stages;
+    for (int stage = 0; stage < LatencyMonitor::StageCount; ++stage) {
+        stages << LatencyMonitor::stageName(static_cast<LatencyMonitor::Stage>(stage));
+    }
+    m_table->setVerticalHeaderLabels(stages);
+    m_table->setToolTip("Read is the duration of each port read; every other stage is the "
+                        "time since the sample's bytes were read");
+    mainLayout->addWidget(m_table);
+
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    m_enabledCheckbox = new QCheckBox("Record latencies");
+    m_enabledCheckbox->setChecked(LatencyMonitor::instance().isEnabled());
+    m_resetButton = new QPushButton("Reset");
+    m_saveButton = new QPushButton("Save...");
+    QPushButton* closeButton = new QPushButton("Close");
+
+    buttonLayout->addWidget(m_enabledCheckbox);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(m_resetButton);
+    buttonLayout->addWidget(m_saveButton);
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(m_enabledCheckbox, &QCheckBox::toggled, this, &DiagnosticsDialog::setMonitoringEnabled);
+    connect(m_resetButton, &QPushButton::clicked, this, &DiagnosticsDialog::resetHistograms);
+    connect(m_saveButton, &QPushButton::clicked, this, &DiagnosticsDialog::saveHistograms);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::close);
+}
+
+void DiagnosticsDialog::showEvent(QShowEvent* event)
+{
+    QDialog::showEvent(event);
+    refresh();
+    m_refreshTimer->start();
+}
+
+void DiagnosticsDialog::hideEvent(QHideEvent* event)
+{
+    m_refreshTimer->stop();
+    QDialog::hideEvent(event);
+}
+
+void DiagnosticsDialog::refresh()
+{
+    const LatencyMonitor& monitor = LatencyMonitor::instance();
+
+    for (int stage = 0; stage < LatencyMonitor::StageCount; ++stage) {
+        const LatencyHistogram histogram = monitor.histogram(static_cast<LatencyMonitor::Stage>(stage));
+        const bool empty = histogram.count() == 0;
+
+        const QStringList cells = {
+            QString::number(histogram.count()),
+            empty ? "-" : formatLatency(histogram.percentile(50)),
+            empty ? "-" : formatLatency(histogram.percentile(90)),
+            empty ? "-" : formatLatency(histogram.percentile(99)),
+            empty ? "-" : formatLatency(histogram.percentile(99.9)),
+            empty ? "-" : formatLatency(histogram.max()),
+            empty ? "-" : formatLatency(histogram.mean())
+        };
+
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem* item = m_table->item(stage, column);
+            if (!item) {
+                item = new QTableWidgetItem();
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                m_table->setItem(stage, column, item);
+            }
+            item->setText(cells[column]);
+        }
+    }
+}
+
+void DiagnosticsDialog::resetHistograms()
+{
+    LatencyMonitor::instance().reset();
+    refresh();
+}
+
+void DiagnosticsDialog::saveHistograms()
+{
+    QString defaultName = QString("latency_%1.json")
+                          .arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+    QString fileName = QFileDialog::getSaveFileName(this, "Save Latency Histograms",
+                                                    defaultName, "JSON Files (*.json)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    if (!LatencyMonitor::instance().dump(fileName)) {
+        QMessageBox::warning(this, "Error", "Failed to save latency histograms");
+    }
+}
+
+void DiagnosticsDialog::setMonitoringEnabled(bool enabled)
+{
+    LatencyMonitor::instance().setEnabled(enabled);
+}
+
+QString DiagnosticsDialog::formatLatency(double nanoseconds)
+{
+    if (nanoseconds < 1e3) {
+        return QString("%1 ns").arg(nanoseconds, 0, 'f', 0);
+    }
+    if (nanoseconds < 1e6) {
+        return QString("%1 µs").arg(nanoseconds / 1e3, 0, 'f', 1);
+    }
+    return QString("%1 ms").arg(nanoseconds / 1e6, 0, 'f', 2);
+}
@@ -0,0 +1,45 @@
+#ifndef DIAGNOSTICSDIALOG_H
+#define DIAGNOSTICSDIALOG_H
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QPushButton>
+#include <QCheckBox>
+#include <QTimer>
+
+#include "latencymonitor.h"
+
+// Live view of the LatencyMonitor histograms, one row per pipeline stage.
+// Non-modal so it can stay open next to the real-time plots.
+class DiagnosticsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DiagnosticsDialog(QWidget *parent = nullptr);
+
+    static QString formatLatency(double nanoseconds);
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private slots:
+    void refresh();
+    void resetHistograms();
+    void saveHistograms();
+    void setMonitoringEnabled(bool enabled);
+
+private:
+    void setupUI();
+
+    QTableWidget* m_table;
+    QCheckBox* m_enabledCheckbox;
+    QPushButton* m_resetButton;
+    QPushButton* m_saveButton;
+    QTimer* m_refreshTimer;
+
+    static const int REFRESH_INTERVAL = 500; // ms
+};
+
+#endif // DIAGNOSTICSDIALOG_H
@@ -0,0 +1,216 @@
+#include "fft.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef SHOCKEE_HAVE_FFTW
+#include <fftw3.h>
+#include <mutex>
+#endif
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+#ifdef SHOCKEE_HAVE_FFTW
+// Only fftw_execute is thread-safe; planning and destroying plans touch
+// FFTW's shared planner state, and batch analysis builds transforms on
+// several pool threads at once
+std::mutex& plannerMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+#endif
+
+} // namespace
+
+int Fft::nextPowerOfTwo(int n)
+{
+    int p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+Fft::Fft(int size)
+    : m_size(size > 0 ? size : 1)
+    , m_convolutionSize(0)
+    , m_convolution(nullptr)
+    , m_fftwForward(nullptr)
+    , m_fftwInverse(nullptr)
+{
+#ifdef SHOCKEE_HAVE_FFTW
+    // Unaligned in-place plans so any caller buffer can be used
+    std::vector<Complex> scratch(m_size);
+    fftw_complex* buffer = reinterpret_cast<fftw_complex*>(scratch.data());
+    std::lock_guard<std::mutex> lock(plannerMutex());
+    m_fftwForward = fftw_plan_dft_1d(m_size, buffer, buffer, FFTW_FORWARD, FFTW_ESTIMATE | FFTW_UNALIGNED);
+    m_fftwInverse = fftw_plan_dft_1d(m_size, buffer, buffer, FFTW_BACKWARD, FFTW_ESTIMATE | FFTW_UNALIGNED);
+#else
+    if (isPowerOfTwo(m_size)) {
+        // Entries [half, 2 * half) hold the twiddles of the stage with that
+        // butterfly span, so every stage reads its table contiguously. Only
+        // the last stage needs trig; the others are subsamples of it.
+        m_twiddles.resize(std::max(m_size, 2));
+        const int top = std::max(m_size / 2, 1);
+        for (int j = 0; j < top; ++j) {
+            double angle = -PI * j / top;
+            m_twiddles[top + j] = Complex(std::cos(angle), std::sin(angle));
+        }
+        for (int half = top / 2; half >= 1; half >>= 1) {
+            for (int j = 0; j < half; ++j) {
+                m_twiddles[half + j] = m_twiddles[2 * half + 2 * j];
+            }
+        }
+
+        int bits = 0;
+        while ((1 << bits) < m_size) {
+            ++bits;
+        }
+        m_bitReverse.resize(m_size);
+        m_bitReverse[0] = 0;
+        for (int i = 1; i < m_size; ++i) {
+            m_bitReverse[i] = (m_bitReverse[i >> 1] >> 1) | ((i & 1) << (bits - 1));
+        }
+        return;
+    }
+
+    // Bluestein: express the DFT as a convolution with a chirp and evaluate
+    // it with a power-of-two transform
+    m_convolutionSize = nextPowerOfTwo(2 * m_size - 1);
+    m_convolution = new Fft(m_convolutionSize);
+
+    m_chirp.resize(m_size);
+    const long long period = 2LL * m_size;
+    for (int k = 0; k < m_size; ++k) {
+        // k^2 mod 2n keeps the angle small and exact for large k
+        long long kk = (static_cast<long long>(k) * k) % period;
+        double angle = -PI * kk / m_size;
+        m_chirp[k] = Complex(std::cos(angle), std::sin(angle));
+    }
+
+    m_chirpSpectrum.assign(m_convolutionSize, Complex(0, 0));
+    m_chirpSpectrum[0] = std::conj(m_chirp[0]);
+    for (int k = 1; k < m_size; ++k) {
+        m_chirpSpectrum[k] = std::conj(m_chirp[k]);
+        m_chirpSpectrum[m_convolutionSize - k] = std::conj(m_chirp[k]);
+    }
+    m_convolution->forward(m_chirpSpectrum.data());
+#endif
+}
+
+Fft::~Fft()
+{
+#ifdef SHOCKEE_HAVE_FFTW
+    std::lock_guard<std::mutex> lock(plannerMutex());
+    if (m_fftwForward) fftw_destroy_plan(static_cast<fftw_plan>(m_fftwForward));
+    if (m_fftwInverse) fftw_destroy_plan(static_cast<fftw_plan>(m_fftwInverse));
+#endif
+    delete m_convolution;
+}
+
+void Fft::forward(Complex* data) const
+{
+    transform(data, false);
+}
+
+void Fft::inverse(Complex* data) const
+{
+    transform(data, true);
+}
+
+void Fft::transform(Complex* data, bool inverse) const
+{
+#ifdef SHOCKEE_HAVE_FFTW
+    fftw_complex* buffer = reinterpret_cast<fftw_complex*>(data);
+    fftw_execute_dft(static_cast<fftw_plan>(inverse ? m_fftwInverse : m_fftwForward), buffer, buffer);
+#else
+    if (m_convolution) {
+        bluestein(data, inverse);
+    } else {
+        radix2(data, inverse);
+    }
+#endif
+}
+
+void Fft::radix2(Complex* data, bool inverse) const
+{
+    const int n = m_size;
+
+    for (int i = 0; i < n; ++i) {
+        int j = m_bitReverse[i];
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    // Complex products are written out; std::complex multiplication goes
+    // through a NaN-checking library call without -ffast-math
+    const double sign = inverse ? -1.0 : 1.0;
+    for (int half = 1; half < n; half <<= 1) {
+        const Complex* twiddles = m_twiddles.data() + half;
+        for (int start = 0; start < n; start += 2 * half) {
+            Complex* even = data + start;
+            Complex* odd = even + half;
+            for (int j = 0; j < half; ++j) {
+                double wr = twiddles[j].real();
+                double wi = sign * twiddles[j].imag();
+                double xr = odd[j].real();
+                double xi = odd[j].imag();
+                Complex product(xr * wr - xi * wi, xr * wi + xi * wr);
+                odd[j] = even[j] - product;
+                even[j] += product;
+            }
+        }
+    }
+}
+
+void Fft::bluestein(Complex* data, bool inverse) const
+{
+    // inverse(x) = conj(forward(conj(x)))
+    if (inverse) {
+        for (int k = 0; k < m_size; ++k) data[k] = std::conj(data[k]);
+    }
+
+    std::vector<Complex> work(m_convolutionSize, Complex(0, 0));
+    for (int k = 0; k < m_size; ++k) {
+        work[k] = data[k] * m_chirp[k];
+    }
+
+    m_convolution->forward(work.data());
+    for (int k = 0; k < m_convolutionSize; ++k) {
+        work[k] *= m_chirpSpectrum[k];
+    }
+    m_convolution->inverse(work.data());
+
+    const double scale = 1.0 / m_convolutionSize;
+    for (int k = 0; k < m_size; ++k) {
+        data[k] = work[k] * m_chirp[k] * scale;
+    }
+
+    if (inverse) {
+        for (int k = 0; k < m_size; ++k) data[k] = std::conj(data[k]);
+    }
+}
+
+void Fft::forwardRealPair(const double* a, const double* b, Complex* spectrumA, Complex* spectrumB) const
+{
+    const int n = m_size;
+
+    std::vector<Complex> packed(n);
+    for (int k = 0; k < n; ++k) {
+        packed[k] = Complex(a[k], b ? b[k] : 0.0);
+    }
+    transform(packed.data(), false);
+
+    // Separate the two spectra using conjugate symmetry of real signals
+    for (int k = 0; k <= n / 2; ++k) {
+        Complex z = packed[k];
+        Complex mirrored = std::conj(packed[(n - k) % n]);
+        spectrumA[k] = 0.5 * (z + mirrored);
+        if (spectrumB) {
+            spectrumB[k] = Complex(0, -0.5) * (z - mirrored);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <vector>
+
+// Complex FFT of a fixed size. Powers of two use an iterative radix-2
+// kernel with precomputed twiddles; any other size goes through Bluestein's
+// chirp-z algorithm on top of it. When built with SHOCKEE_HAVE_FFTW the
+// transforms are delegated to FFTW instead.
+//
+// A plan is immutable after construction and may be shared between threads.
+class Fft
+{
+public:
+    typedef std::complex<double> Complex;
+
+    explicit Fft(int size);
+    ~Fft();
+
+    Fft(const Fft&) = delete;
+    Fft& operator=(const Fft&) = delete;
+
+    int size() const { return m_size; }
+
+    // In-place transforms; inverse() is unnormalised (scale by 1/size)
+    void forward(Complex* data) const;
+    void inverse(Complex* data) const;
+
+    // Spectrum of two real sequences of length size() for the price of one
+    // complex transform. Writes bins 0..size()/2 of each.
+    void forwardRealPair(const double* a, const double* b, Complex* spectrumA, Complex* spectrumB) const;
+
+    static bool isPowerOfTwo(int n) { return n > 0 && (n & (n - 1)) == 0; }
+    static int nextPowerOfTwo(int n);
+
+private:
+    void transform(Complex* data, bool inverse) const;
+    void radix2(Complex* data, bool inverse) const;
+    void bluestein(Complex* data, bool inverse) const;
+
+    int m_size;
+
+    // Radix-2 tables (size m_size, or m_convolutionSize for Bluestein)
+    std::vector<Complex> m_twiddles;
+    std::vector<int> m_bitReverse;
+
+    // Bluestein state
+    int m_convolutionSize;
+    std::vector<Complex> m_chirp;
+    std::vector<Complex> m_chirpSpectrum;
+    Fft* m_convolution;
+
+    void* m_fftwForward;
+    void* m_fftwInverse;
+};
+
+#endif // FFT_H
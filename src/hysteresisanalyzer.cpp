@@ -0,0 +1,130 @@
+#include "hysteresisanalyzer.h"
+#include <QtMath>
+
+HysteresisAnalyzer::HysteresisAnalyzer(double velocityThreshold)
+    : m_velocityThreshold(velocityThreshold)
+{
+    clear();
+}
+
+void HysteresisAnalyzer::clear()
+{
+    m_direction = Unknown;
+    m_inCycle = false;
+    m_originX = m_originY = 0;
+    m_lastX = m_lastY = 0;
+    m_twiceArea = 0;
+    m_startTime = 0;
+    m_peakForce = 0;
+    m_minPosition = m_maxPosition = 0;
+    m_sampleCount = 0;
+    m_cycles.clear();
+    m_cumulativeEnergy = 0;
+}
+
+bool HysteresisAnalyzer::addSample(const SensorData& data)
+{
+    Direction direction = m_direction;
+    if (data.velocity > m_velocityThreshold) {
+        direction = Compression;
+    } else if (data.velocity < -m_velocityThreshold) {
+        direction = Rebound;
+    }
+
+    bool closed = false;
+    if (direction == Compression && m_direction == Rebound) {
+        // Rebound-to-compression reversal ends one loop and starts the next
+        if (m_inCycle) {
+            accumulate(data);
+            closed = closeCycle(data);
+        }
+        beginCycle(data);
+    } else if (m_inCycle) {
+        accumulate(data);
+    }
+
+    m_direction = direction;
+    return closed;
+}
+
+void HysteresisAnalyzer::beginCycle(const SensorData& data)
+{
+    m_inCycle = true;
+    m_originX = data.position;
+    m_originY = data.force;
+    m_lastX = m_lastY = 0;
+    m_twiceArea = 0;
+    m_startTime = data.timestamp / 1000.0;
+    m_peakForce = qAbs(data.force);
+    m_minPosition = m_maxPosition = data.position;
+    m_sampleCount = 1;
+}
+
+void HysteresisAnalyzer::accumulate(const SensorData& data)
+{
+    double x = data.position - m_originX;
+    double y = data.force - m_originY;
+
+    // Shoelace term; the closing edge back to the origin is (0, 0) and
+    // contributes nothing
+    m_twiceArea += m_lastX * y - x * m_lastY;
+    m_lastX = x;
+    m_lastY = y;
+
+    m_peakForce = qMax(m_peakForce, qAbs(data.force));
+    m_minPosition = qMin(m_minPosition, data.position);
+    m_maxPosition = qMax(m_maxPosition, data.position);
+    ++m_sampleCount;
+}
+
+bool HysteresisAnalyzer::closeCycle(const SensorData& data)
+{
+    if (m_sampleCount < MIN_CYCLE_SAMPLES) {
+        return false;
+    }
+
+    HysteresisCycle cycle;
+    cycle.index = m_cycles.size();
+    cycle.startTime = m_startTime;
+    cycle.endTime = data.timestamp / 1000.0;
+    cycle.area = qAbs(m_twiceArea) * 0.5;
+    cycle.energy = cycle.area * JOULES_PER_KG_MM;
+    m_cumulativeEnergy += cycle.energy;
+    cycle.cumulativeEnergy = m_cumulativeEnergy;
+    cycle.peakForce = m_peakForce;
+    cycle.stroke = m_maxPosition - m_minPosition;
+    cycle.sampleCount = m_sampleCount;
+
+    m_cycles.append(cycle);
+    return true;
+}
+
+QVector<HysteresisCycle> HysteresisAnalyzer::analyze(const QVector<SensorData>& data,
+                                                     double velocityThreshold)
+{
+    HysteresisAnalyzer analyzer(velocityThreshold);
+    for (const SensorData& point : data) {
+        analyzer.addSample(point);
+    }
+    return analyzer.cycles();
+}
+
+QVector<QPointF> HysteresisAnalyzer::energyVsTime(const QVector<HysteresisCycle>& cycles)
+{
+    QVector<QPointF> curve;
+    curve.reserve(cycles.size());
+    for (const HysteresisCycle& cycle : cycles) {
+        curve.append(QPointF(cycle.endTime, cycle.energy));
+    }
+    return curve;
+}
+
+QVector<QPointF> HysteresisAnalyzer::cumulativeEnergyVsTime(const QVector<HysteresisCycle>& cycles)
+{
+    QVector<QPointF> curve;
+    curve.reserve(cycles.size());
+    for (const HysteresisCycle& cycle : cycles) {
+        curve.append(QPointF(cycle.endTime, cycle.cumulativeEnergy));
+    }
+    return curve;
+}
@@ -0,0 +1,79 @@
+#ifndef HYSTERESISANALYZER_H
+#define HYSTERESISANALYZER_H
+
+#include <QVector>
+#include <QPointF>
+
+#include "sensordata.h"
+
+struct HysteresisCycle {
+    int index;
+    double startTime;        // s
+    double endTime;          // s
+    double area;             // kg*mm enclosed by the force-vs-position loop
+    double energy;           // J dissipated in this cycle
+    double cumulativeEnergy; // J dissipated since the start of the session
+    double peakForce;        // kg
+    double stroke;           // mm
+    int sampleCount;
+
+    HysteresisCycle()
+        : index(0), startTime(0), endTime(0), area(0), energy(0)
+        , cumulativeEnergy(0), peakForce(0), stroke(0), sampleCount(0) {}
+};
+
+// Splits a recording into stroke cycles and integrates the area of each
+// force-vs-position loop with the shoelace formula. A cycle runs from one
+// rebound-to-compression reversal to the next; reversals use a velocity
+// dead band so sensor noise around standstill does not split cycles.
+class HysteresisAnalyzer
+{
+public:
+    explicit HysteresisAnalyzer(double velocityThreshold = DEFAULT_VELOCITY_THRESHOLD);
+
+    void clear();
+    void setVelocityThreshold(double threshold) { m_velocityThreshold = threshold; }
+
+    // Returns true when the sample closes a cycle (see lastCycle())
+    bool addSample(const SensorData& data);
+
+    const QVector<HysteresisCycle>& cycles() const { return m_cycles; }
+    const HysteresisCycle& lastCycle() const { return m_cycles.last(); }
+    double cumulativeEnergy() const { return m_cumulativeEnergy; }
+
+    static QVector<HysteresisCycle> analyze(const QVector<SensorData>& data,
+                                            double velocityThreshold = DEFAULT_VELOCITY_THRESHOLD);
+    static QVector<QPointF> energyVsTime(const QVector<HysteresisCycle>& cycles);
+    static QVector<QPointF> cumulativeEnergyVsTime(const QVector<HysteresisCycle>& cycles);
+
+    static constexpr double DEFAULT_VELOCITY_THRESHOLD = 5.0; // mm/s
+    static constexpr double JOULES_PER_KG_MM = 9.80665e-3;
+
+private:
+    enum Direction { Unknown, Compression, Rebound };
+
+    void beginCycle(const SensorData& data);
+    void accumulate(const SensorData& data);
+    bool closeCycle(const SensorData& data);
+
+    double m_velocityThreshold;
+    Direction m_direction;
+    bool m_inCycle;
+
+    // Running state of the open cycle; coordinates are relative to its
+    // first sample to keep the shoelace sum well conditioned
+    double m_originX, m_originY;
+    double m_lastX, m_lastY;
+    double m_twiceArea;
+    double m_startTime;
+    double m_peakForce;
+    double m_minPosition, m_maxPosition;
+    int m_sampleCount;
+
+    QVector<HysteresisCycle> m_cycles;
+    double m_cumulativeEnergy;
+
+    static const int MIN_CYCLE_SAMPLES = 4;
+};
+
+#endif // HYSTERESISANALYZER_H
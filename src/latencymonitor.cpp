@@ -0,0 +1,234 @@
+#include "latencymonitor.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QDebug>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+int highestBit(quint64 value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// LatencyHistogram
+
+LatencyHistogram::LatencyHistogram()
+    : m_counts(BUCKET_COUNT, 0)
+{
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(qint64 value)
+{
+    if (value < SUB_BUCKET_COUNT) {
+        return qMax(qint64(0), value);
+    }
+
+    // Keep the top SUB_BUCKET_BITS bits; the shift picks the power of two
+    const int shift = highestBit(quint64(value)) - (SUB_BUCKET_BITS - 1);
+    const int sub = int(value >> shift) - SUB_BUCKET_COUNT / 2;
+    return SUB_BUCKET_COUNT + (shift - 1) * (SUB_BUCKET_COUNT / 2) + sub;
+}
+
+qint64 LatencyHistogram::bucketLowerBound(int index)
+{
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+
+    const int shift = (index - SUB_BUCKET_COUNT) / (SUB_BUCKET_COUNT / 2) + 1;
+    const int sub = (index - SUB_BUCKET_COUNT) % (SUB_BUCKET_COUNT / 2);
+    return qint64(SUB_BUCKET_COUNT / 2 + sub) << shift;
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    return index + 1 < BUCKET_COUNT ? bucketLowerBound(index + 1) - 1
+                                    : std::numeric_limits<qint64>::max();
+}
+
+void LatencyHistogram::record(qint64 value)
+{
+    value = qMax(qint64(0), value);
+    ++m_counts[bucketIndex(value)];
+    m_min = m_count > 0 ? qMin(m_min, value) : value;
+    m_max = qMax(m_max, value);
+    m_sum += value;
+    ++m_count;
+}
+
+void LatencyHistogram::reset()
+{
+    m_counts.fill(0, BUCKET_COUNT);
+    m_count = 0;
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0;
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other)
+{
+    if (other.m_count == 0) {
+        return;
+    }
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        m_counts[i] += other.m_counts[i];
+    }
+    m_min = m_count > 0 ? qMin(m_min, other.m_min) : other.m_min;
+    m_max = qMax(m_max, other.m_max);
+    m_sum += other.m_sum;
+    m_count += other.m_count;
+}
+
+qint64 LatencyHistogram::percentile(double percent) const
+{
+    if (m_count == 0) {
+        return 0;
+    }
+
+    const qint64 rank = qMax(qint64(1), qint64(std::ceil(qBound(0.0, percent, 100.0) / 100.0 * m_count)));
+    qint64 seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_counts[i];
+        if (seen >= rank) {
+            return qMin(bucketUpperBound(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+QJsonObject LatencyHistogram::toJson() const
+{
+    QJsonObject json;
+    json["count"] = m_count;
+    json["min"] = min();
+    json["mean"] = mean();
+    json["p50"] = percentile(50);
+    json["p90"] = percentile(90);
+    json["p99"] = percentile(99);
+    json["p99_9"] = percentile(99.9);
+    json["max"] = m_max;
+
+    // Sparse [lower bound, count] pairs so the histogram can be re-plotted
+    QJsonArray buckets;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        if (m_counts[i] > 0) {
+            buckets.append(QJsonArray{ bucketLowerBound(i), m_counts[i] });
+        }
+    }
+    json["buckets"] = buckets;
+    return json;
+}
+
+// ---------------------------------------------------------------------------
+// LatencyMonitor
+
+LatencyMonitor::LatencyMonitor()
+    : m_enabled(true)
+{
+}
+
+LatencyMonitor& LatencyMonitor::instance()
+{
+    static LatencyMonitor monitor;
+    return monitor;
+}
+
+qint64 LatencyMonitor::now()
+{
+    static const QElapsedTimer clock = [] {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    // Offset by one so a valid time is never mistaken for "not stamped"
+    return clock.nsecsElapsed() + 1;
+}
+
+void LatencyMonitor::record(Stage stage, qint64 receivedAt)
+{
+    if (isEnabled() && receivedAt > 0) {
+        const qint64 latency = now() - receivedAt;
+        QMutexLocker locker(&m_mutex);
+        m_histograms[stage].record(latency);
+    }
+}
+
+void LatencyMonitor::recordDuration(Stage stage, qint64 nanoseconds)
+{
+    if (isEnabled()) {
+        QMutexLocker locker(&m_mutex);
+        m_histograms[stage].record(nanoseconds);
+    }
+}
+
+LatencyHistogram LatencyMonitor::histogram(Stage stage) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_histograms[stage];
+}
+
+void LatencyMonitor::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    for (LatencyHistogram& histogram : m_histograms) {
+        histogram.reset();
+    }
+}
+
+QJsonObject LatencyMonitor::toJson() const
+{
+    QJsonObject stages;
+    for (int stage = 0; stage < StageCount; ++stage) {
+        stages[stageName(static_cast<Stage>(stage))] = histogram(static_cast<Stage>(stage)).toJson();
+    }
+
+    QJsonObject json;
+    json["unit"] = "ns";
+    json["created"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    json["stages"] = stages;
+    return json;
+}
+
+bool LatencyMonitor::dump(const QString& filename) const
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open latency dump for writing:" << filename;
+        return false;
+    }
+
+    file.write(QJsonDocument(toJson()).toJson());
+    file.close();
+    return true;
+}
+
+QString LatencyMonitor::stageName(Stage stage)
+{
+    switch (stage) {
+        case Read: return "read";
+        case Parsed: return "parsed";
+        case Dispatched: return "dispatched";
+        case Logged: return "logged";
+        case Painted: return "painted";
+        case StageCount: break;
+    }
+    return QString();
+}
@@ -0,0 +1,99 @@
+#ifndef LATENCYMONITOR_H
+#define LATENCYMONITOR_H
+
+#include <QVector>
+#include <QString>
+#include <QJsonObject>
+#include <QMutex>
+#include <atomic>
+
+// Log-linear latency histogram in the style of HdrHistogram: values below
+// 2^SUB_BUCKET_BITS get their own bucket, above that each power of two is
+// split into 2^(SUB_BUCKET_BITS-1) equal buckets, so any recorded value is
+// known to within ~3% from nanoseconds up to hours with a fixed table.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(qint64 value);
+    void reset();
+    void add(const LatencyHistogram& other);
+
+    qint64 count() const { return m_count; }
+    qint64 min() const { return m_count > 0 ? m_min : 0; }
+    qint64 max() const { return m_max; }
+    double mean() const { return m_count > 0 ? m_sum / m_count : 0.0; }
+
+    // Upper edge of the bucket holding the given percentile (0..100), capped at max()
+    qint64 percentile(double percent) const;
+
+    QJsonObject toJson() const;
+
+    static int bucketIndex(qint64 value);
+    static qint64 bucketLowerBound(int index);
+    static qint64 bucketUpperBound(int index);
+
+    static const int SUB_BUCKET_BITS = 6;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_COUNT = SUB_BUCKET_COUNT + (63 - SUB_BUCKET_BITS) * (SUB_BUCKET_COUNT / 2);
+
+private:
+    QVector<qint64> m_counts;
+    qint64 m_count;
+    qint64 m_min;
+    qint64 m_max;
+    double m_sum;
+};
+
+// End-to-end acquisition latency, wire to screen.
+//
+// Each SensorData carries receivedAt, the monotonic time its bytes were
+// read from the port. As the sample passes a pipeline stage the stage
+// records now() - receivedAt, so every histogram is cumulative latency
+// since the read. The Read stage is the exception: it holds how long each
+// read of the port itself took.
+//
+// Read and Parsed are recorded on the serial I/O threads, the rest on the
+// GUI thread, so the histograms are guarded by a mutex.
+class LatencyMonitor
+{
+public:
+    enum Stage {
+        Read,        // duration of the port read in readData()
+        Parsed,      // line split, parsed and given a velocity
+        Dispatched,  // delivered to the main window
+        Logged,      // appended to the session being recorded
+        Painted,     // newest sample on screen after a plot repaint
+        StageCount
+    };
+
+    static LatencyMonitor& instance();
+
+    // Nanoseconds on a process-wide monotonic clock, never 0
+    static qint64 now();
+
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // Records now() - receivedAt; samples without a receive time are ignored
+    void record(Stage stage, qint64 receivedAt);
+    void recordDuration(Stage stage, qint64 nanoseconds);
+
+    LatencyHistogram histogram(Stage stage) const;
+    void reset();
+
+    QJsonObject toJson() const;
+    bool dump(const QString& filename) const;
+
+    static QString stageName(Stage stage);
+
+private:
+    LatencyMonitor();
+
+    std::atomic<bool> m_enabled;
+    mutable QMutex m_mutex;
+    LatencyHistogram m_histograms[StageCount];
+};
+
+#endif // LATENCYMONITOR_H
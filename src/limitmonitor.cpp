@@ -0,0 +1,156 @@
+#include "limitmonitor.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSettings>
+
+QString LimitTrip::description() const
+{
+    QString text = QString("%1 (%2)").arg(rule.description()).arg(value, 0, 'f', 2);
+    if (source > 0) {
+        text += QString(" on device %1").arg(source);
+    }
+    return text;
+}
+
+QJsonObject LimitTrip::toJson() const
+{
+    QJsonObject json;
+    json["rule"] = rule.toJson();
+    json["value"] = value;
+    json["timestamp_us"] = timestampUs;
+    json["source"] = source;
+    json["detection_latency_ns"] = detectionLatency;
+    if (stopLatency > 0) {
+        json["stop_latency_ns"] = stopLatency;
+    }
+    return json;
+}
+
+LimitTrip LimitTrip::fromJson(const QJsonObject& json)
+{
+    LimitTrip trip;
+    trip.rule = LimitRule::fromJson(json["rule"].toObject());
+    trip.value = json["value"].toDouble();
+    trip.timestampUs = json["timestamp_us"].toInteger();
+    trip.source = json["source"].toInt();
+    trip.detectionLatency = json["detection_latency_ns"].toInteger();
+    trip.stopLatency = json["stop_latency_ns"].toInteger();
+    return trip;
+}
+
+QJsonObject LimitMonitor::Options::toJson() const
+{
+    QJsonArray list;
+    for (const LimitRule& rule : rules) {
+        list.append(rule.toJson());
+    }
+    QJsonObject json;
+    json["rules"] = list;
+    json["enabled"] = enabled;
+    json["stop_on_trip"] = stopOnTrip;
+    json["stop_command"] = stopCommand;
+    json["resume_command"] = resumeCommand;
+    return json;
+}
+
+LimitMonitor::Options LimitMonitor::Options::fromJson(const QJsonObject& json)
+{
+    Options options;
+    for (const QJsonValue& rule : json["rules"].toArray()) {
+        options.rules << LimitRule::fromJson(rule.toObject());
+    }
+    options.enabled = json["enabled"].toBool(options.enabled);
+    options.stopOnTrip = json["stop_on_trip"].toBool(options.stopOnTrip);
+    options.stopCommand = json["stop_command"].toString(options.stopCommand);
+    options.resumeCommand = json["resume_command"].toString(options.resumeCommand);
+    return options;
+}
+
+LimitMonitor::Options LimitMonitor::Options::fromSettings()
+{
+    QSettings settings;
+    const QByteArray options = settings.value("Limits/options").toByteArray();
+    if (options.isEmpty()) {
+        // The standard rig's 400 kg load cell rating
+        Options defaults;
+        defaults.rules << LimitRule("force", LimitRule::Magnitude, 400.0);
+        return defaults;
+    }
+    return fromJson(QJsonDocument::fromJson(options).object());
+}
+
+void LimitMonitor::Options::saveToSettings() const
+{
+    QSettings settings;
+    settings.setValue("Limits/options", QJsonDocument(toJson()).toJson(QJsonDocument::Compact));
+}
+
+LimitMonitor::LimitMonitor(const Options& options)
+    : m_options(options)
+    , m_tripped(false)
+{
+    m_rules.setConditions(m_options.rules);
+}
+
+void LimitMonitor::setOptions(const Options& options)
+{
+    m_options = options;
+    m_rules.setConditions(m_options.rules);
+}
+
+void LimitMonitor::setSchema(const ChannelSchema& schema, const CalibrationSet& calibration)
+{
+    m_rules.setChannels(calibration.plotChannels(schema));
+}
+
+QStringList LimitMonitor::unresolvedChannels() const
+{
+    return m_rules.unresolvedChannels();
+}
+
+QVector<ChannelCondition::Type> LimitMonitor::ruleTypes()
+{
+    return { ChannelCondition::Above, ChannelCondition::Below, ChannelCondition::Magnitude,
+             ChannelCondition::Rate };
+}
+
+bool LimitMonitor::check(const SensorData& data)
+{
+    if (!m_options.enabled || m_tripped) {
+        return false;
+    }
+
+    int broken = -1;
+    double measured = 0;
+    for (int i = 0; i < m_rules.size(); ++i) {
+        // Every rule is tested so rate limits see consecutive samples
+        if (m_rules.test(i, data, &measured) && broken < 0) {
+            broken = i;
+            m_trip.value = measured;
+        }
+    }
+
+    const qint64 checkedAt = LatencyMonitor::now();
+    if (data.receivedAt > 0) {
+        m_latency.record(checkedAt - data.receivedAt);
+    }
+    if (broken < 0) {
+        return false;
+    }
+
+    m_tripped = true;
+    m_trip.rule = m_options.rules[broken];
+    m_trip.timestampUs = data.timestampUs;
+    m_trip.source = data.source;
+    m_trip.receivedAt = data.receivedAt;
+    m_trip.detectionLatency = data.receivedAt > 0 ? checkedAt - data.receivedAt : 0;
+    m_trip.stopLatency = 0;
+    return true;
+}
+
+void LimitMonitor::reset()
+{
+    m_tripped = false;
+    m_trip = LimitTrip();
+    m_rules.restart();
+}
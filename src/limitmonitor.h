@@ -0,0 +1,98 @@
+#ifndef LIMITMONITOR_H
+#define LIMITMONITOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QJsonObject>
+
+#include "sensordata.h"
+#include "channelschema.h"
+#include "channelcondition.h"
+#include "calibration.h"
+#include "latencymonitor.h"
+
+// A safe operating limit on one channel
+typedef ChannelCondition LimitRule;
+
+// The sample that broke a limit, with how long the host took to act on it
+struct LimitTrip {
+    LimitRule rule;
+    double value;               // channel value, or rate for Rate rules
+    qint64 timestampUs;         // of the sample
+    int source;                 // device index
+    qint64 receivedAt;          // LatencyMonitor::now() when its bytes were read
+    qint64 detectionLatency;    // ns, port read to rule evaluated
+    qint64 stopLatency;         // ns, port read to stop command written, 0 if none was sent
+
+    LimitTrip() : value(0), timestampUs(0), source(0), receivedAt(0), detectionLatency(0), stopLatency(0) {}
+
+    QString description() const;
+
+    QJsonObject toJson() const;
+    static LimitTrip fromJson(const QJsonObject& json);
+};
+
+// Per-sample limit checking for one device, run on its serial I/O thread
+// between parsing and handing the samples on, so a trip does not wait for
+// the merge, the queued hop to the GUI thread or a repaint.
+//
+// The first sample to break any rule trips the monitor, which then latches:
+// no further samples are checked until reset(), so the stop command goes
+// out once per event. The time from each sample's port read to its check
+// is kept in a histogram whose maximum is the worst-case detection latency
+// actually seen; time spent in the OS and USB buffers before the read is
+// not included.
+class LimitMonitor
+{
+public:
+    struct Options {
+        QVector<LimitRule> rules;
+        bool enabled;
+        bool stopOnTrip;        // send stopCommand to the devices on a trip
+        QString stopCommand;
+        QString resumeCommand;  // sent when the alarm is reset
+
+        Options() : enabled(true), stopOnTrip(true), stopCommand("STOP"), resumeCommand("RESUME") {}
+
+        QJsonObject toJson() const;
+        static Options fromJson(const QJsonObject& json);
+        static Options fromSettings();
+        void saveToSettings() const;
+    };
+
+    explicit LimitMonitor(const Options& options = Options());
+
+    void setOptions(const Options& options);
+    const Options& options() const { return m_options; }
+
+    // Resolves the rules' channel names against the schema's channels and
+    // the quantities the calibration computes from them; rules on channels
+    // neither provides are not checked (see unresolvedChannels())
+    void setSchema(const ChannelSchema& schema, const CalibrationSet& calibration = CalibrationSet());
+    QStringList unresolvedChannels() const;
+
+    // Returns true on the sample that trips; trip() then describes it
+    bool check(const SensorData& data);
+    bool isTripped() const { return m_tripped; }
+    const LimitTrip& trip() const { return m_trip; }
+    // Clears the trip and starts checking again; rate limits restart from
+    // the next sample
+    void reset();
+
+    // ns from port read to limit check, every checked sample
+    const LatencyHistogram& detectionLatency() const { return m_latency; }
+    void resetLatency() { m_latency.reset(); }
+
+    // The condition types a limit can be, in the order offered to the user
+    static QVector<ChannelCondition::Type> ruleTypes();
+
+private:
+    Options m_options;
+    ChannelConditionSet m_rules;
+    bool m_tripped;
+    LimitTrip m_trip;
+    LatencyHistogram m_latency;
+};
+
+#endif // LIMITMONITOR_H
@@ -0,0 +1,157 @@
+#include "limitsdialog.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QHeaderView>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+
+namespace {
+
+enum Column {
+    ChannelColumn,
+    TypeColumn,
+    LevelColumn,
+    ColumnCount
+};
+
+} // namespace
+
+LimitsDialog::LimitsDialog(const LimitMonitor::Options& options, const QVector<SensorChannel>& channels,
+                           QWidget *parent)
+    : QDialog(parent)
+    , m_options(options)
+    , m_channels(channels)
+{
+    setWindowTitle("Limits");
+    setModal(true);
+    resize(520, 360);
+
+    setupUI();
+
+    m_enabledCheckbox->setChecked(options.enabled);
+    for (const LimitRule& rule : options.rules) {
+        appendRule(rule);
+    }
+    m_stopCheckbox->setChecked(options.stopOnTrip);
+    m_stopCommandEdit->setText(options.stopCommand);
+    m_resumeCommandEdit->setText(options.resumeCommand);
+    m_stopCommandEdit->setEnabled(options.stopOnTrip);
+    m_resumeCommandEdit->setEnabled(options.stopOnTrip);
+}
+
+void LimitsDialog::setupUI()
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    m_enabledCheckbox = new QCheckBox("Check limits on every sample");
+    mainLayout->addWidget(m_enabledCheckbox);
+
+    m_table = new QTableWidget(0, ColumnCount);
+    m_table->setHorizontalHeaderLabels({ "Channel", "Limit", "Level" });
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    m_table->verticalHeader()->setVisible(false);
+    m_table->setToolTip("Any rule broken by a sample trips the alarm. Rate of change is per second, "
+                        "between consecutive samples.");
+    mainLayout->addWidget(m_table);
+
+    QHBoxLayout* ruleButtons = new QHBoxLayout();
+    m_addButton = new QPushButton("Add Rule");
+    m_removeButton = new QPushButton("Remove Rule");
+    ruleButtons->addWidget(m_addButton);
+    ruleButtons->addWidget(m_removeButton);
+    ruleButtons->addStretch();
+    mainLayout->addLayout(ruleButtons);
+
+    QFormLayout* tripLayout = new QFormLayout();
+    m_stopCheckbox = new QCheckBox("Send the stop command to every device");
+    tripLayout->addRow("On trip:", m_stopCheckbox);
+    m_stopCommandEdit = new QLineEdit();
+    tripLayout->addRow("Stop command:", m_stopCommandEdit);
+    m_resumeCommandEdit = new QLineEdit();
+    m_resumeCommandEdit->setToolTip("Sent when the alarm is reset");
+    tripLayout->addRow("Resume command:", m_resumeCommandEdit);
+    mainLayout->addLayout(tripLayout);
+
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    buttonLayout->addStretch();
+    QPushButton* okButton = new QPushButton("OK");
+    QPushButton* cancelButton = new QPushButton("Cancel");
+    okButton->setDefault(true);
+    buttonLayout->addWidget(okButton);
+    buttonLayout->addWidget(cancelButton);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(m_addButton, &QPushButton::clicked, this, &LimitsDialog::addRule);
+    connect(m_removeButton, &QPushButton::clicked, this, &LimitsDialog::removeRule);
+    connect(m_stopCheckbox, &QCheckBox::toggled, m_stopCommandEdit, &QWidget::setEnabled);
+    connect(m_stopCheckbox, &QCheckBox::toggled, m_resumeCommandEdit, &QWidget::setEnabled);
+    connect(okButton, &QPushButton::clicked, this, &QDialog::accept);
+    connect(cancelButton, &QPushButton::clicked, this, &QDialog::reject);
+}
+
+void LimitsDialog::appendRule(const LimitRule& rule)
+{
+    const int row = m_table->rowCount();
+    m_table->insertRow(row);
+
+    QComboBox* channelCombo = new QComboBox();
+    for (const SensorChannel& channel : m_channels) {
+        channelCombo->addItem(channel.label(), channel.name);
+    }
+    int index = channelCombo->findData(rule.channel.toLower());
+    if (index < 0) {
+        channelCombo->addItem(rule.channel + " (not provided)", rule.channel);
+        index = channelCombo->count() - 1;
+    }
+    channelCombo->setCurrentIndex(index);
+    m_table->setCellWidget(row, ChannelColumn, channelCombo);
+
+    QComboBox* typeCombo = new QComboBox();
+    for (ChannelCondition::Type type : LimitMonitor::ruleTypes()) {
+        typeCombo->addItem(ChannelCondition::typeName(type), int(type));
+    }
+    typeCombo->setCurrentIndex(qMax(0, typeCombo->findData(int(rule.type))));
+    m_table->setCellWidget(row, TypeColumn, typeCombo);
+
+    QDoubleSpinBox* levelSpin = new QDoubleSpinBox();
+    levelSpin->setRange(-1e6, 1e6);
+    levelSpin->setDecimals(2);
+    levelSpin->setValue(rule.level);
+    m_table->setCellWidget(row, LevelColumn, levelSpin);
+}
+
+void LimitsDialog::addRule()
+{
+    appendRule(LimitRule());
+    m_table->selectRow(m_table->rowCount() - 1);
+}
+
+void LimitsDialog::removeRule()
+{
+    const int row = m_table->currentRow();
+    if (row >= 0) {
+        m_table->removeRow(row);
+    }
+}
+
+LimitMonitor::Options LimitsDialog::options() const
+{
+    LimitMonitor::Options options = m_options;
+    options.enabled = m_enabledCheckbox->isChecked();
+    options.rules.clear();
+    for (int row = 0; row < m_table->rowCount(); ++row) {
+        const QComboBox* channelCombo = qobject_cast<QComboBox*>(m_table->cellWidget(row, ChannelColumn));
+        const QComboBox* typeCombo = qobject_cast<QComboBox*>(m_table->cellWidget(row, TypeColumn));
+        const QDoubleSpinBox* levelSpin = qobject_cast<QDoubleSpinBox*>(m_table->cellWidget(row, LevelColumn));
+        options.rules << LimitRule(channelCombo->currentData().toString(),
+                                   LimitRule::Type(typeCombo->currentData().toInt()),
+                                   levelSpin->value());
+    }
+    options.stopOnTrip = m_stopCheckbox->isChecked();
+    options.stopCommand = m_stopCommandEdit->text().trimmed();
+    options.resumeCommand = m_resumeCommandEdit->text().trimmed();
+    return options;
+}
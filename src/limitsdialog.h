@@ -0,0 +1,45 @@
+#ifndef LIMITSDIALOG_H
+#define LIMITSDIALOG_H
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QCheckBox>
+#include <QLineEdit>
+#include <QPushButton>
+
+#include "limitmonitor.h"
+
+// Edits the limit rules and what happens on a trip. Channels are offered
+// from the live device's plot channels, calibrated ones included; rules on
+// channels it does not provide are kept but shown as such.
+class LimitsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    LimitsDialog(const LimitMonitor::Options& options, const QVector<SensorChannel>& channels,
+                 QWidget *parent = nullptr);
+
+    LimitMonitor::Options options() const;
+
+private slots:
+    void addRule();
+    void removeRule();
+
+private:
+    void setupUI();
+    void appendRule(const LimitRule& rule);
+
+    LimitMonitor::Options m_options;
+    QVector<SensorChannel> m_channels;
+
+    QCheckBox* m_enabledCheckbox;
+    QTableWidget* m_table;
+    QPushButton* m_addButton;
+    QPushButton* m_removeButton;
+    QCheckBox* m_stopCheckbox;
+    QLineEdit* m_stopCommandEdit;
+    QLineEdit* m_resumeCommandEdit;
+};
+
+#endif // LIMITSDIALOG_H
@@ -0,0 +1,290 @@
+#include "linkhealthmonitor.h"
+#include <QtMath>
+#include <algorithm>
+
+// ---------------------------------------------------------------------------
+// LinkHealth
+
+LinkHealth::LinkHealth()
+    : bytesReceived(0)
+    , linesReceived(0)
+    , parseErrors(0)
+    , samplesReceived(0)
+    , samplesExpected(0)
+    , missingSamples(0)
+    , gaps(0)
+    , duplicates(0)
+    , backwardsTimestamps(0)
+    , maxReadSize(0)
+    , maxPendingBytes(0)
+    , deviceResets(0)
+    , clockRollovers(0)
+    , clockDrift(0)
+    , nominalInterval(0)
+    , bytesPerSecond(0)
+    , samplesPerSecond(0)
+    , baudRate(0)
+    , sequenced(false)
+{
+}
+
+double LinkHealth::sampleLossRate() const
+{
+    return samplesExpected > 0 ? double(missingSamples) / samplesExpected : 0.0;
+}
+
+double LinkHealth::parseErrorRate() const
+{
+    return linesReceived > 0 ? double(parseErrors) / linesReceived : 0.0;
+}
+
+double LinkHealth::utilization() const
+{
+    return baudRate > 0 ? bytesPerSecond / capacity() : 0.0;
+}
+
+bool LinkHealth::isHealthy() const
+{
+    return sampleLossRate() <= MAX_LOSS_RATE
+        && parseErrorRate() <= MAX_PARSE_ERROR_RATE
+        && utilization() <= MAX_UTILIZATION;
+}
+
+QString LinkHealth::summary() const
+{
+    QString text = QString("%1 Hz | lost %2 (%3%) | parse errors %4")
+                   .arg(samplesPerSecond, 0, 'f', 1)
+                   .arg(missingSamples)
+                   .arg(sampleLossRate() * 100.0, 0, 'f', 2)
+                   .arg(parseErrors);
+
+    if (duplicates > 0 || backwardsTimestamps > 0) {
+        text += QString(" | dup %1, back %2").arg(duplicates).arg(backwardsTimestamps);
+    }
+    if (deviceResets > 0) {
+        text += QString(" | device resets %1").arg(deviceResets);
+    }
+    if (clockDrift != 0) {
+        text += QString(" | drift %1 ppm").arg(clockDrift, 0, 'f', 0);
+    }
+
+    text += QString(" | %1 B/s").arg(bytesPerSecond, 0, 'f', 0);
+    if (baudRate > 0) {
+        text += QString(" (%1% of %2 baud)").arg(utilization() * 100.0, 0, 'f', 0).arg(baudRate);
+    }
+    return text;
+}
+
+QJsonObject LinkHealth::toJson() const
+{
+    QJsonObject json;
+    json["bytes_received"] = bytesReceived;
+    json["lines_received"] = linesReceived;
+    json["parse_errors"] = parseErrors;
+    json["samples_received"] = samplesReceived;
+    json["samples_expected"] = samplesExpected;
+    json["missing_samples"] = missingSamples;
+    json["gaps"] = gaps;
+    json["duplicates"] = duplicates;
+    json["backwards_timestamps"] = backwardsTimestamps;
+    json["max_read_size"] = maxReadSize;
+    json["max_pending_bytes"] = maxPendingBytes;
+    json["device_resets"] = deviceResets;
+    json["clock_rollovers"] = clockRollovers;
+    json["clock_drift_ppm"] = clockDrift;
+    json["nominal_interval"] = nominalInterval;
+    json["bytes_per_second"] = bytesPerSecond;
+    json["samples_per_second"] = samplesPerSecond;
+    json["baud_rate"] = baudRate;
+    json["sequenced"] = sequenced;
+    json["sample_loss_rate"] = sampleLossRate();
+    json["parse_error_rate"] = parseErrorRate();
+    json["link_utilization"] = utilization();
+    return json;
+}
+
+LinkHealth LinkHealth::fromJson(const QJsonObject& json)
+{
+    LinkHealth health;
+    health.bytesReceived = json["bytes_received"].toInteger();
+    health.linesReceived = json["lines_received"].toInteger();
+    health.parseErrors = json["parse_errors"].toInteger();
+    health.samplesReceived = json["samples_received"].toInteger();
+    health.samplesExpected = json["samples_expected"].toInteger();
+    health.missingSamples = json["missing_samples"].toInteger();
+    health.gaps = json["gaps"].toInteger();
+    health.duplicates = json["duplicates"].toInteger();
+    health.backwardsTimestamps = json["backwards_timestamps"].toInteger();
+    health.maxReadSize = json["max_read_size"].toInteger();
+    health.maxPendingBytes = json["max_pending_bytes"].toInteger();
+    health.deviceResets = json["device_resets"].toInt();
+    health.clockRollovers = json["clock_rollovers"].toInt();
+    health.clockDrift = json["clock_drift_ppm"].toDouble();
+    health.nominalInterval = json["nominal_interval"].toDouble();
+    health.bytesPerSecond = json["bytes_per_second"].toDouble();
+    health.samplesPerSecond = json["samples_per_second"].toDouble();
+    health.baudRate = json["baud_rate"].toInt();
+    health.sequenced = json["sequenced"].toBool();
+    return health;
+}
+
+// ---------------------------------------------------------------------------
+// LinkHealthMonitor
+
+LinkHealthMonitor::LinkHealthMonitor()
+    : m_fixedInterval(0)
+{
+    reset();
+}
+
+void LinkHealthMonitor::reset()
+{
+    const int baudRate = m_health.baudRate;
+    m_health = LinkHealth();
+    m_health.baudRate = baudRate;
+    m_health.nominalInterval = m_fixedInterval;
+
+    m_lastTimestamp = -1;
+    m_lastSequence = -1;
+    m_warmup.clear();
+
+    m_windowStart = 0;
+    m_windowBytes = 0;
+    m_windowSamples = 0;
+}
+
+void LinkHealthMonitor::setBaudRate(int baudRate)
+{
+    m_health.baudRate = baudRate;
+}
+
+void LinkHealthMonitor::setNominalInterval(double interval)
+{
+    m_fixedInterval = qMax(0.0, interval);
+    m_health.nominalInterval = m_fixedInterval;
+    m_warmup.clear();
+}
+
+void LinkHealthMonitor::recordRead(qint64 bytes, qint64 hostTime)
+{
+    m_health.bytesReceived += bytes;
+    m_health.maxReadSize = qMax(m_health.maxReadSize, bytes);
+
+    if (hostTime <= 0) {
+        return;
+    }
+    if (m_windowStart == 0) {
+        m_windowStart = hostTime;
+        return;
+    }
+
+    m_windowBytes += bytes;
+    const qint64 elapsed = hostTime - m_windowStart;
+    if (elapsed >= RATE_WINDOW) {
+        m_health.bytesPerSecond = m_windowBytes * 1e9 / elapsed;
+        m_health.samplesPerSecond = m_windowSamples * 1e9 / elapsed;
+        m_windowStart = hostTime;
+        m_windowBytes = 0;
+        m_windowSamples = 0;
+    }
+}
+
+void LinkHealthMonitor::recordPendingBytes(qint64 bytes)
+{
+    m_health.maxPendingBytes = qMax(m_health.maxPendingBytes, bytes);
+}
+
+void LinkHealthMonitor::recordParseError()
+{
+    ++m_health.linesReceived;
+    ++m_health.parseErrors;
+}
+
+void LinkHealthMonitor::recordSample(qint64 timestamp, qint64 sequence)
+{
+    ++m_health.linesReceived;
+    ++m_health.samplesReceived;
+    ++m_windowSamples;
+
+    if (m_lastTimestamp >= 0) {
+        const qint64 delta = timestamp - m_lastTimestamp;
+        const bool bySequence = sequence >= 0 && m_lastSequence >= 0;
+
+        if (delta < 0) {
+            ++m_health.backwardsTimestamps;
+        }
+
+        if (bySequence) {
+            m_health.sequenced = true;
+            const qint64 step = sequence - m_lastSequence;
+            if (step == 0) {
+                ++m_health.duplicates;
+            } else if (step > 1) {
+                m_health.missingSamples += step - 1;
+                ++m_health.gaps;
+            }
+        } else if (delta == 0) {
+            ++m_health.duplicates;
+        }
+
+        // The interval estimate is kept even when sequence numbers do the counting
+        if (delta > 0) {
+            accountDelta(delta, !bySequence);
+        }
+    }
+
+    m_lastTimestamp = timestamp;
+    m_lastSequence = sequence;
+}
+
+LinkHealth LinkHealthMonitor::health(qint64 hostTime) const
+{
+    LinkHealth health = m_health;
+    health.samplesExpected = health.samplesReceived + health.missingSamples;
+
+    // Nothing has closed the rate window for a while: report what it holds so far
+    if (hostTime > 0 && m_windowStart > 0 && hostTime - m_windowStart >= 2 * RATE_WINDOW) {
+        const qint64 elapsed = hostTime - m_windowStart;
+        health.bytesPerSecond = m_windowBytes * 1e9 / elapsed;
+        health.samplesPerSecond = m_windowSamples * 1e9 / elapsed;
+    }
+    return health;
+}
+
+void LinkHealthMonitor::accountDelta(qint64 delta, bool countGaps)
+{
+    if (m_health.nominalInterval > 0) {
+        if (countGaps) {
+            countGap(delta);
+        }
+        return;
+    }
+
+    m_warmup.append(delta);
+    if (m_warmup.size() < INTERVAL_ESTIMATE_DELTAS) {
+        return;
+    }
+    // Estimate, then account for the deltas that were held back
+    m_health.nominalInterval = medianInterval(m_warmup);
+    if (countGaps) {
+        for (qint64 held : m_warmup) {
+            countGap(held);
+        }
+    }
+    m_warmup.clear();
+}
+
+void LinkHealthMonitor::countGap(qint64 delta)
+{
+    const double interval = m_health.nominalInterval;
+    if (delta > GAP_THRESHOLD * interval) {
+        m_health.missingSamples += qMax(qint64(1), qRound64(delta / interval) - 1);
+        ++m_health.gaps;
+    }
+}
+
+double LinkHealthMonitor::medianInterval(QVector<qint64> deltas)
+{
+    std::nth_element(deltas.begin(), deltas.begin() + deltas.size() / 2, deltas.end());
+    return double(deltas[deltas.size() / 2]);
+}
@@ -0,0 +1,100 @@
+#ifndef LINKHEALTHMONITOR_H
+#define LINKHEALTHMONITOR_H
+
+#include <QVector>
+#include <QString>
+#include <QJsonObject>
+
+// Snapshot of how well the serial link is keeping up
+struct LinkHealth {
+    qint64 bytesReceived;
+    qint64 linesReceived;        // data lines, parsed or not (comments excluded)
+    qint64 parseErrors;          // data lines that did not parse
+    qint64 samplesReceived;
+    qint64 samplesExpected;      // received + missing
+    qint64 missingSamples;
+    qint64 gaps;                 // runs of one or more missing samples
+    qint64 duplicates;           // repeated timestamp or sequence number
+    qint64 backwardsTimestamps;  // timestamp went down (device reset or corruption)
+    qint64 maxReadSize;          // bytes drained by the largest single read
+    qint64 maxPendingBytes;      // high-water mark of the partial-line buffer
+    int deviceResets;            // clock restarts seen by DeviceClock
+    int clockRollovers;          // 32-bit millis() wraps
+    double clockDrift;           // ppm, device against host
+    double nominalInterval;      // ms between samples, 0 until known
+    double bytesPerSecond;
+    double samplesPerSecond;
+    int baudRate;
+    bool sequenced;              // gaps counted from a sequence field, not timestamps
+
+    LinkHealth();
+
+    double sampleLossRate() const;
+    double parseErrorRate() const;
+    double capacity() const { return baudRate / 10.0; }  // bytes/s, 8N1 framing
+    double utilization() const;
+
+    // False once loss, parse errors or link load pass the warning thresholds
+    bool isHealthy() const;
+
+    QString summary() const;
+    QJsonObject toJson() const;
+    static LinkHealth fromJson(const QJsonObject& json);
+
+    static constexpr double MAX_LOSS_RATE = 0.01;
+    static constexpr double MAX_PARSE_ERROR_RATE = 0.01;
+    static constexpr double MAX_UTILIZATION = 0.9;
+};
+
+// Sample accounting for one acquisition stream.
+//
+// Samples are expected every nominal interval, which is either set or taken
+// as the median of the first deltas seen. A delta longer than GAP_THRESHOLD
+// intervals counts the samples that should have been in it as missing. When
+// the device sends a sequence number (optional fifth field) gaps and
+// duplicates are counted from it instead, which is exact.
+//
+// Host times are nanoseconds (LatencyMonitor::now()); 0 skips rate tracking.
+class LinkHealthMonitor
+{
+public:
+    LinkHealthMonitor();
+
+    // Clears the counters, keeping the baud rate and any fixed interval
+    void reset();
+
+    void setBaudRate(int baudRate);
+    // ms; 0 estimates it from the stream
+    void setNominalInterval(double interval);
+
+    void recordRead(qint64 bytes, qint64 hostTime);
+    void recordPendingBytes(qint64 bytes);
+    void recordParseError();
+    // Device timestamp in ms; sequence < 0 if the line had none
+    void recordSample(qint64 timestamp, qint64 sequence = -1);
+
+    // Rates go stale when data stops; pass the current host time to decay them
+    LinkHealth health(qint64 hostTime = 0) const;
+
+    static const int INTERVAL_ESTIMATE_DELTAS = 32;
+    static constexpr double GAP_THRESHOLD = 1.5;
+    static const qint64 RATE_WINDOW = 1000000000;  // ns
+
+private:
+    void accountDelta(qint64 delta, bool countGaps);
+    void countGap(qint64 delta);
+    static double medianInterval(QVector<qint64> deltas);
+
+    LinkHealth m_health;
+    double m_fixedInterval;
+
+    qint64 m_lastTimestamp;
+    qint64 m_lastSequence;
+    QVector<qint64> m_warmup;
+
+    qint64 m_windowStart;
+    qint64 m_windowBytes;
+    qint64 m_windowSamples;
+};
+
+#endif // LINKHEALTHMONITOR_H
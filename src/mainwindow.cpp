@@ -1,4 +1,7 @@
 #include "mainwindow.h"
+#include "tracing.h"
+#include "batchprocessor.h"
+#include "csvimporter.h"
 #include <QApplication>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -7,26 +10,44 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QSettings>
+#include <QInputDialog>
 #include <QStandardPaths>
+#include <QHeaderView>
+#include <QDebug>
+#include <QtConcurrent>
+#include <algorithm>
+#include <memory>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
-    , m_serialComm(new SerialCommunicator(this))
+    , m_acquisition(new AcquisitionManager(this))
+    , m_serialComm(m_acquisition->primary())
     , m_dataLogger(new DataLogger(this))
     , m_displayUpdateTimer(new QTimer(this))
     , m_recordingTimer(new QTimer(this))
+    , m_linkHealthTimer(new QTimer(this))
+    , m_batchWatcher(new QFutureWatcher<SessionSummary>(this))
+    , m_recalibrateWatcher(new QFutureWatcher<QJsonObject>(this))
+    , m_diagnosticsDialog(nullptr)
+    , m_devicesDialog(nullptr)
     , m_isRecording(false)
     , m_isConnected(false)
+    , m_limitTripped(false)
     , m_recordingStartTime(0)
 {
     setupUI();
     setupMenus();
     setupStatusBar();
     setupConnections();
+    setChannelSchema(ChannelSchema::defaultSchema());
+    setTriggerSchema(ChannelSchema::defaultSchema());
+    m_serialComm->setCalibration(CalibrationSet::fromSettings());
+    updateLimitStatus();
     
     // Setup timers
     m_displayUpdateTimer->setInterval(DISPLAY_UPDATE_INTERVAL);
     m_recordingTimer->setInterval(1000); // 1 second for recording time display
+    m_linkHealthTimer->setInterval(LINK_HEALTH_INTERVAL);
     
     // Load serial ports
     m_serialPortCombo->addItems(m_serialComm->getAvailablePorts());
@@ -43,6 +64,11 @@ MainWindow::~MainWindow()
     if (m_isConnected) {
         m_serialComm->disconnect();
     }
+    
+    // Batch workers use the data logger; let them drain before it goes away
+    m_batchWatcher->cancel();
+    m_batchWatcher->waitForFinished();
+    m_recalibrateWatcher->waitForFinished();
 }
 
 void MainWindow::setupUI()
@@ -65,9 +91,19 @@ void MainWindow::setupUI()
     m_comparisonTab = new QWidget();
     m_tabWidget->addTab(m_comparisonTab, "Comparison");
     
+    // Spectral tab
+    m_spectralTab = new QWidget();
+    m_tabWidget->addTab(m_spectralTab, "Spectral");
+    
+    // Batch tab
+    m_batchTab = new QWidget();
+    m_tabWidget->addTab(m_batchTab, "Batch");
+    
     setupRealTimeTab();
     setupAnalysisTab();
     setupComparisonTab();
+    setupSpectralTab();
+    setupBatchTab();
 }
 
 void MainWindow::setupRealTimeTab()
@@ -99,6 +135,15 @@ void MainWindow::setupRealTimeTab()
     m_connectionStatus->setStyleSheet("color: red; font-weight: bold;");
     connLayout->addWidget(m_connectionStatus, 2, 0, 1, 2);
     
+    // Limits are checked on the serial threads; this shows their state
+    m_limitStatus = new QLabel();
+    m_limitStatus->setWordWrap(true);
+    connLayout->addWidget(m_limitStatus, 3, 0);
+    m_resetLimitButton = new QPushButton("Reset Alarm");
+    m_resetLimitButton->setEnabled(false);
+    m_resetLimitButton->setToolTip("Re-enables limit checking and sends the devices the resume command");
+    connLayout->addWidget(m_resetLimitButton, 3, 1);
+    
     leftLayout->addWidget(m_connectionGroup);
     
     // Recording group
@@ -127,6 +172,59 @@ void MainWindow::setupRealTimeTab()
     
     leftLayout->addWidget(m_recordingGroup);
     
+    // Triggered capture group: the first condition of the stored trigger
+    // options is edited here, any further ones are kept as they are
+    const TriggerCapture::Options triggerOptions = TriggerCapture::Options::fromSettings();
+    const TriggerCondition condition = triggerOptions.conditions.value(0);
+    m_triggerGroup = new QGroupBox("Triggered Capture");
+    QGridLayout* triggerLayout = new QGridLayout(m_triggerGroup);
+    
+    triggerLayout->addWidget(new QLabel("Channel:"), 0, 0);
+    m_triggerChannelCombo = new QComboBox();
+    triggerLayout->addWidget(m_triggerChannelCombo, 0, 1);
+    
+    triggerLayout->addWidget(new QLabel("Condition:"), 1, 0);
+    m_triggerTypeCombo = new QComboBox();
+    for (ChannelCondition::Type type : TriggerCapture::conditionTypes()) {
+        m_triggerTypeCombo->addItem(ChannelCondition::typeName(type), int(type));
+    }
+    m_triggerTypeCombo->setCurrentIndex(qMax(0, m_triggerTypeCombo->findData(int(condition.type))));
+    triggerLayout->addWidget(m_triggerTypeCombo, 1, 1);
+    
+    triggerLayout->addWidget(new QLabel("Level:"), 2, 0);
+    m_triggerLevelSpin = new QDoubleSpinBox();
+    m_triggerLevelSpin->setRange(-1e6, 1e6);
+    m_triggerLevelSpin->setDecimals(2);
+    m_triggerLevelSpin->setValue(condition.level);
+    triggerLayout->addWidget(m_triggerLevelSpin, 2, 1);
+    
+    triggerLayout->addWidget(new QLabel("Pre / Post:"), 3, 0);
+    QHBoxLayout* windowLayout = new QHBoxLayout();
+    m_preTriggerSpin = new QDoubleSpinBox();
+    m_preTriggerSpin->setRange(0.0, 60.0);
+    m_preTriggerSpin->setSuffix(" s");
+    m_preTriggerSpin->setValue(triggerOptions.preTrigger);
+    m_postTriggerSpin = new QDoubleSpinBox();
+    m_postTriggerSpin->setRange(0.0, 600.0);
+    m_postTriggerSpin->setSuffix(" s");
+    m_postTriggerSpin->setValue(triggerOptions.postTrigger);
+    windowLayout->addWidget(m_preTriggerSpin);
+    windowLayout->addWidget(m_postTriggerSpin);
+    triggerLayout->addLayout(windowLayout, 3, 1);
+    
+    m_autoRearmCheckbox = new QCheckBox("Re-arm after each capture");
+    m_autoRearmCheckbox->setChecked(triggerOptions.autoRearm);
+    triggerLayout->addWidget(m_autoRearmCheckbox, 4, 0, 1, 2);
+    
+    m_armTriggerButton = new QPushButton("Arm Trigger");
+    m_armTriggerButton->setCheckable(true);
+    m_armTriggerButton->setEnabled(false);
+    triggerLayout->addWidget(m_armTriggerButton, 5, 0);
+    m_triggerStatus = new QLabel("Idle");
+    triggerLayout->addWidget(m_triggerStatus, 5, 1);
+    
+    leftLayout->addWidget(m_triggerGroup);
+    
     // Sensor displays group
     m_sensorGroup = new QGroupBox("Live Sensor Data");
     QGridLayout* sensorLayout = new QGridLayout(m_sensorGroup);
@@ -151,6 +249,11 @@ void MainWindow::setupRealTimeTab()
     m_velocityDisplay->setStyleSheet("font-size: 14px; font-weight: bold; color: purple;");
     sensorLayout->addWidget(m_velocityDisplay, 3, 1);
     
+    // Any channel in the device's schema can take the lower left plot
+    sensorLayout->addWidget(new QLabel("Plot Channel:"), 4, 0);
+    m_plotChannelCombo = new QComboBox();
+    sensorLayout->addWidget(m_plotChannelCombo, 4, 1);
+    
     leftLayout->addWidget(m_sensorGroup);
     leftLayout->addStretch();
     
@@ -167,9 +270,9 @@ void MainWindow::setupRealTimeTab()
     m_forcePlot->setMinimumHeight(200);
     plotLayout->addWidget(m_forcePlot, 0, 1);
     
-    m_encoderPlot = new PlotWidget(PlotWidget::Encoder);
-    m_encoderPlot->setMinimumHeight(200);
-    plotLayout->addWidget(m_encoderPlot, 1, 0);
+    m_channelPlot = new PlotWidget(PlotWidget::ChannelSeries);
+    m_channelPlot->setMinimumHeight(200);
+    plotLayout->addWidget(m_channelPlot, 1, 0);
     
     m_forceVsPositionPlot = new PlotWidget(PlotWidget::ForceVsPosition);
     m_forceVsPositionPlot->setMinimumHeight(200);
@@ -188,7 +291,33 @@ void MainWindow::setupRealTimeTab()
 void MainWindow::setupAnalysisTab()
 {
     QVBoxLayout* layout = new QVBoxLayout(m_analysisTab);
-    layout->addWidget(new QLabel("Analysis features will be implemented here"));
+    
+    // Analysis controls
+    QHBoxLayout* controlsLayout = new QHBoxLayout();
+    controlsLayout->addWidget(new QLabel("Velocity Bin Width:"));
+    m_velocityBinSpin = new QDoubleSpinBox();
+    m_velocityBinSpin->setRange(0.5, 500.0);
+    m_velocityBinSpin->setDecimals(1);
+    m_velocityBinSpin->setSuffix(" mm/s");
+    m_velocityBinSpin->setValue(DampingAnalyzer::DEFAULT_BIN_WIDTH);
+    controlsLayout->addWidget(m_velocityBinSpin);
+    controlsLayout->addStretch();
+    
+    layout->addLayout(controlsLayout);
+    
+    // Damping curve, per-cycle and cumulative dissipated energy
+    QSplitter* splitter = new QSplitter(Qt::Vertical);
+    
+    m_forceVsVelocityPlot = new PlotWidget(PlotWidget::ForceVsVelocity);
+    splitter->addWidget(m_forceVsVelocityPlot);
+    
+    m_energyPlot = new PlotWidget(PlotWidget::EnergyVsTime);
+    splitter->addWidget(m_energyPlot);
+    
+    m_cumulativeEnergyPlot = new PlotWidget(PlotWidget::CumulativeEnergyVsTime);
+    splitter->addWidget(m_cumulativeEnergyPlot);
+    
+    layout->addWidget(splitter);
 }
 
 void MainWindow::setupComparisonTab()
@@ -199,15 +328,111 @@ void MainWindow::setupComparisonTab()
     QHBoxLayout* controlsLayout = new QHBoxLayout();
     m_overlayCheckbox = new QCheckBox("Overlay Mode");
     m_loadComparisonButton = new QPushButton("Load Comparison Session");
+    m_alignCheckbox = new QCheckBox("Align to Reference");
+    m_alignCheckbox->setChecked(true);
+    m_alignCheckbox->setToolTip("Shift comparison sessions in time to line up with the current session");
+    m_alignmentLabel = new QLabel();
     controlsLayout->addWidget(m_overlayCheckbox);
+    controlsLayout->addWidget(m_alignCheckbox);
     controlsLayout->addWidget(m_loadComparisonButton);
+    controlsLayout->addWidget(m_alignmentLabel);
     controlsLayout->addStretch();
     
     layout->addLayout(controlsLayout);
     
-    // Comparison plot
+    // Comparison plot with the residual of the latest comparison below it
+    QSplitter* splitter = new QSplitter(Qt::Vertical);
+    
     m_comparisonPlot = new PlotWidget(PlotWidget::Comparison);
-    layout->addWidget(m_comparisonPlot);
+    splitter->addWidget(m_comparisonPlot);
+    
+    m_residualPlot = new PlotWidget(PlotWidget::Residual);
+    splitter->addWidget(m_residualPlot);
+    splitter->setStretchFactor(0, 3);
+    splitter->setStretchFactor(1, 1);
+    
+    layout->addWidget(splitter);
+}
+
+void MainWindow::setupSpectralTab()
+{
+    QVBoxLayout* layout = new QVBoxLayout(m_spectralTab);
+    
+    // Spectral controls
+    QHBoxLayout* controlsLayout = new QHBoxLayout();
+    controlsLayout->addWidget(new QLabel("Channel:"));
+    m_spectralChannelCombo = new QComboBox();
+    for (SpectralAnalyzer::Channel channel : { SpectralAnalyzer::Position, SpectralAnalyzer::Force,
+                                               SpectralAnalyzer::Velocity }) {
+        m_spectralChannelCombo->addItem(SpectralAnalyzer::channelName(channel), channel);
+    }
+    controlsLayout->addWidget(m_spectralChannelCombo);
+    
+    controlsLayout->addWidget(new QLabel("Segment Size:"));
+    m_segmentSizeCombo = new QComboBox();
+    for (int size : { 128, 256, 512, 1024, 2048, 4096 }) {
+        m_segmentSizeCombo->addItem(QString::number(size), size);
+    }
+    m_segmentSizeCombo->setCurrentText(QString::number(SpectralAnalyzer::DEFAULT_SEGMENT_SIZE));
+    controlsLayout->addWidget(m_segmentSizeCombo);
+    controlsLayout->addStretch();
+    
+    layout->addLayout(controlsLayout);
+    
+    // Averaged spectrum and its evolution over time
+    QSplitter* splitter = new QSplitter(Qt::Vertical);
+    
+    m_psdPlot = new PlotWidget(PlotWidget::PowerSpectrum);
+    splitter->addWidget(m_psdPlot);
+    
+    m_spectrogramPlot = new PlotWidget(PlotWidget::Spectrogram);
+    splitter->addWidget(m_spectrogramPlot);
+    
+    layout->addWidget(splitter);
+}
+
+void MainWindow::setupBatchTab()
+{
+    QVBoxLayout* layout = new QVBoxLayout(m_batchTab);
+    
+    // Batch controls
+    QHBoxLayout* controlsLayout = new QHBoxLayout();
+    m_batchAddButton = new QPushButton("Add Sessions...");
+    m_batchLibraryButton = new QPushButton("Add All Saved Sessions");
+    m_batchClearButton = new QPushButton("Clear");
+    m_batchNormalizeCheckbox = new QCheckBox("Normalise Force");
+    m_batchNormalizeCheckbox->setToolTip("Scale each curve by its own peak force to compare shapes");
+    m_batchProgress = new QProgressBar();
+    m_batchProgress->setVisible(false);
+    controlsLayout->addWidget(m_batchAddButton);
+    controlsLayout->addWidget(m_batchLibraryButton);
+    controlsLayout->addWidget(m_batchClearButton);
+    controlsLayout->addWidget(m_batchNormalizeCheckbox);
+    controlsLayout->addWidget(m_batchProgress);
+    controlsLayout->addStretch();
+    
+    layout->addLayout(controlsLayout);
+    
+    // Family of damping curves over the per-session summary
+    QSplitter* splitter = new QSplitter(Qt::Vertical);
+    
+    m_batchPlot = new PlotWidget(PlotWidget::DampingFamily);
+    splitter->addWidget(m_batchPlot);
+    
+    const QStringList headers = {
+        "", "Session", "Damping", "Samples", "Duration (s)", "Peak Comp. (kg)", "Peak Reb. (kg)",
+        "Max Vel. (mm/s)", "Comp. (kg·s/mm)", "Reb. (kg·s/mm)", "Cycles", "Energy (J)"
+    };
+    m_batchTable = new QTableWidget(0, headers.size());
+    m_batchTable->setHorizontalHeaderLabels(headers);
+    m_batchTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_batchTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_batchTable->verticalHeader()->setVisible(false);
+    m_batchTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_batchTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
+    splitter->addWidget(m_batchTable);
+    
+    layout->addWidget(splitter);
 }
 
 void MainWindow::setupMenus()
@@ -226,6 +451,9 @@ void MainWindow::setupMenus()
     QAction* loadAction = fileMenu->addAction("Load Session");
     connect(loadAction, &QAction::triggered, this, &MainWindow::loadSession);
     
+    QAction* importAction = fileMenu->addAction("Import CSV...");
+    connect(importAction, &QAction::triggered, this, &MainWindow::importCsv);
+    
     fileMenu->addSeparator();
     
     QAction* exportAction = fileMenu->addAction("Export Data...");
@@ -241,20 +469,85 @@ void MainWindow::setupMenus()
     
     QAction* calibrationAction = toolsMenu->addAction("Calibration...");
     connect(calibrationAction, &QAction::triggered, this, &MainWindow::showCalibration);
+    
+    QAction* limitsAction = toolsMenu->addAction("Limits...");
+    connect(limitsAction, &QAction::triggered, this, &MainWindow::showLimits);
+    
+    toolsMenu->addSeparator();
+    
+    // Velocity estimator selection, persisted between runs
+    QSettings settings;
+    int velocityMethod = settings.value("Analysis/velocityMethod",
+                                        VelocityEstimator::SavitzkyGolay).toInt();
+    
+    QMenu* velocityMenu = toolsMenu->addMenu("Velocity Estimator");
+    m_velocityMethodGroup = new QActionGroup(this);
+    m_velocityMethodGroup->setExclusive(true);
+    
+    const QStringList methodNames = VelocityEstimator::methodNames();
+    for (int method = 0; method < methodNames.size(); ++method) {
+        QAction* action = velocityMenu->addAction(methodNames[method]);
+        action->setCheckable(true);
+        action->setData(method);
+        action->setChecked(method == velocityMethod);
+        m_velocityMethodGroup->addAction(action);
+    }
+    connect(m_velocityMethodGroup, &QActionGroup::triggered, this, &MainWindow::selectVelocityMethod);
+    m_serialComm->setVelocityMethod(velocityMethod);
+    
+    QAction* recomputeAction = toolsMenu->addAction("Recompute Velocity");
+    connect(recomputeAction, &QAction::triggered, this, &MainWindow::recomputeVelocity);
+    
+    QAction* resampleAction = toolsMenu->addAction("Resample Session...");
+    connect(resampleAction, &QAction::triggered, this, &MainWindow::resampleSession);
+    
+    QAction* recalibrateAction = toolsMenu->addAction("Recalibrate Sessions...");
+    connect(recalibrateAction, &QAction::triggered, this, &MainWindow::recalibrateSessions);
+    
+    toolsMenu->addSeparator();
+    
+    QAction* devicesAction = toolsMenu->addAction("Devices...");
+    connect(devicesAction, &QAction::triggered, this, &MainWindow::showDevices);
+    
+    QAction* diagnosticsAction = toolsMenu->addAction("Latency Diagnostics...");
+    connect(diagnosticsAction, &QAction::triggered, this, &MainWindow::showDiagnostics);
+    
+    QAction* recordTraceAction = toolsMenu->addAction("Record Trace");
+    recordTraceAction->setCheckable(true);
+    recordTraceAction->setChecked(Tracer::isEnabled());
+    connect(recordTraceAction, &QAction::toggled, this, &MainWindow::setTracingEnabled);
+    
+    QAction* saveTraceAction = toolsMenu->addAction("Save Trace...");
+    connect(saveTraceAction, &QAction::triggered, this, &MainWindow::saveTrace);
+#ifndef SHOCKEE_TRACING
+    recordTraceAction->setEnabled(false);
+    saveTraceAction->setEnabled(false);
+#endif
 }
 
 void MainWindow::setupStatusBar()
 {
     statusBar()->showMessage("Ready");
+    
+    m_linkHealthLabel = new QLabel();
+    m_linkHealthLabel->setToolTip("Serial link health: sample rate, missing samples, malformed lines "
+                                  "and throughput against the baud rate capacity");
+    statusBar()->addPermanentWidget(m_linkHealthLabel);
 }
 
 void MainWindow::setupConnections()
 {
-    // Serial communication
-    connect(m_serialComm, &SerialCommunicator::dataReceived, 
-            this, &MainWindow::onNewDataReceived);
+    // Serial communication; samples from all devices arrive merged in time order
+    connect(m_acquisition, &AcquisitionManager::sampleReady,
+            this, &MainWindow::onMergedSample);
     connect(m_serialComm, &SerialCommunicator::connectionStatusChanged,
             this, &MainWindow::onConnectionStatusChanged);
+    connect(m_serialComm, &SerialCommunicator::channelSchemaChanged,
+            this, &MainWindow::onChannelSchemaChanged);
+    connect(m_acquisition, &AcquisitionManager::limitTripped,
+            this, &MainWindow::onLimitTripped);
+    connect(m_plotChannelCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onPlotChannelChanged);
     
     // UI connections
     connect(m_connectButton, &QPushButton::clicked, 
@@ -269,16 +562,49 @@ void MainWindow::setupConnections()
             this, &MainWindow::saveSession);
     connect(m_loadButton, &QPushButton::clicked,
             this, &MainWindow::loadSession);
+    connect(m_armTriggerButton, &QPushButton::toggled,
+            this, &MainWindow::armTrigger);
+    connect(m_resetLimitButton, &QPushButton::clicked,
+            this, &MainWindow::resetLimitAlarm);
     connect(m_overlayCheckbox, &QCheckBox::toggled,
             this, &MainWindow::toggleOverlay);
     connect(m_loadComparisonButton, &QPushButton::clicked,
             this, &MainWindow::loadComparisonSession);
+    connect(m_velocityBinSpin, &QDoubleSpinBox::valueChanged,
+            this, &MainWindow::onVelocityBinWidthChanged);
+    connect(m_spectralChannelCombo, &QComboBox::currentIndexChanged,
+            this, &MainWindow::onSpectralSettingsChanged);
+    connect(m_segmentSizeCombo, &QComboBox::currentIndexChanged,
+            this, &MainWindow::onSpectralSettingsChanged);
+    connect(m_batchAddButton, &QPushButton::clicked,
+            this, &MainWindow::addBatchSessions);
+    connect(m_batchLibraryButton, &QPushButton::clicked,
+            this, &MainWindow::addLibraryToBatch);
+    connect(m_batchClearButton, &QPushButton::clicked,
+            this, &MainWindow::clearBatch);
+    connect(m_batchNormalizeCheckbox, &QCheckBox::toggled,
+            this, &MainWindow::updateBatchView);
+    connect(m_batchWatcher, &QFutureWatcher<SessionSummary>::progressRangeChanged,
+            m_batchProgress, &QProgressBar::setRange);
+    connect(m_batchWatcher, &QFutureWatcher<SessionSummary>::progressValueChanged,
+            m_batchProgress, &QProgressBar::setValue);
+    connect(m_batchWatcher, &QFutureWatcher<SessionSummary>::finished,
+            this, &MainWindow::onBatchFinished);
+    connect(m_recalibrateWatcher, &QFutureWatcher<QJsonObject>::progressValueChanged,
+            this, [this](int value) {
+                statusBar()->showMessage(QString("Recalibrating sessions... %1/%2")
+                                         .arg(value).arg(m_recalibrateWatcher->progressMaximum()));
+            });
+    connect(m_recalibrateWatcher, &QFutureWatcher<QJsonObject>::finished,
+            this, &MainWindow::onRecalibrateFinished);
     
     // Timers
     connect(m_displayUpdateTimer, &QTimer::timeout,
             this, &MainWindow::updateDisplay);
     connect(m_recordingTimer, &QTimer::timeout,
             this, &MainWindow::updateDisplay);
+    connect(m_linkHealthTimer, &QTimer::timeout,
+            this, &MainWindow::updateLinkHealth);
 }
 
 void MainWindow::connectToArduino()
@@ -294,7 +620,7 @@ void MainWindow::connectToArduino()
         portName = portName.split(" ").first();
     }
     
-    if (m_serialComm->connectToPort(portName)) {
+    if (m_acquisition->connectDevice(0, portName)) {
         statusBar()->showMessage("Connected to " + portName);
     } else {
         statusBar()->showMessage("Failed to connect to " + portName);
@@ -313,14 +639,26 @@ void MainWindow::startRecording()
         QMessageBox::warning(this, "Error", "Please connect to Arduino first");
         return;
     }
+    if (m_triggerCapture.isArmed()) {
+        QMessageBox::warning(this, "Error", "Disarm the trigger before recording manually");
+        return;
+    }
+    
+    // Flush samples merged before the start so they stay out of the session
+    m_acquisition->resetMerge();
     
     m_isRecording = true;
     m_recordingStartTime = QDateTime::currentMSecsSinceEpoch();
     m_currentSession.clear();
+    m_auxiliarySession.clear();
+    m_serialComm->resetLinkHealth();
+    m_sessionLinkHealth = LinkHealth();
+    m_sessionLimitTrips.clear();
     
     m_startRecordButton->setEnabled(false);
     m_stopRecordButton->setEnabled(true);
     m_saveButton->setEnabled(false);
+    m_armTriggerButton->setEnabled(false);
     
     m_displayUpdateTimer->start();
     m_recordingTimer->start();
@@ -328,22 +666,50 @@ void MainWindow::startRecording()
     // Clear plots
     m_positionPlot->clearData();
     m_forcePlot->clearData();
-    m_encoderPlot->clearData();
+    m_channelPlot->clearData();
     m_forceVsPositionPlot->clearData();
-    
+    m_forceVsVelocityPlot->clearData();
+    m_energyPlot->clearData();
+    m_cumulativeEnergyPlot->clearData();
+    m_hysteresisAnalyzer.clear();
+    m_psdPlot->clearData();
+    m_spectrogramPlot->clearData();
+    m_spectrogramStream.configure(spectralChannel(), spectralSegmentSize(), spectralSegmentSize() / 4);
+    
+    updateLimitStatus();
+    const QStringList unresolved = m_acquisition->limits().enabled ? m_acquisition->unresolvedLimits() : QStringList();
+    if (!unresolved.isEmpty()) {
+        QApplication::beep();
+        statusBar()->showMessage("Recording started; limits NOT checked on " + unresolved.join(", "));
+        return;
+    }
     statusBar()->showMessage("Recording started");
 }
 
 void MainWindow::stopRecording()
 {
     m_isRecording = false;
+    m_sessionLinkHealth = m_serialComm->linkHealth();
+    
+    // Kept with the raw channels so the session can be recalibrated later
+    m_sessionCalibration = CalibrationSet();
+    CalibrationSet calibration = m_serialComm->calibration();
+    if (calibration.appliesTo(m_channelSchema)) {
+        m_sessionCalibration = calibration;
+    }
     
     m_startRecordButton->setEnabled(true);
     m_stopRecordButton->setEnabled(false);
     m_saveButton->setEnabled(true);
+    m_armTriggerButton->setEnabled(m_isConnected);
     
     m_recordingTimer->stop();
     
+    // The averaged spectrum needs the whole run; the live spectrogram is
+    // replaced by the full-length one at the same time
+    QVector<SensorData> dataVector(m_currentSession.begin(), m_currentSession.end());
+    updateSpectralPlots(dataVector);
+    
     statusBar()->showMessage("Recording stopped");
 }
 
@@ -358,6 +724,14 @@ void MainWindow::saveSession()
         session.name = QFileInfo(fileName).baseName();
         session.timestamp = QDateTime::currentDateTime();
         session.data = QVector<SensorData>(m_currentSession.begin(), m_currentSession.end());
+        session.link_health = m_sessionLinkHealth;
+        session.limit_trips = m_sessionLimitTrips;
+        session.auxiliary = m_auxiliarySession;
+        session.schema = m_channelSchema;
+        session.calibration = m_sessionCalibration;
+        if (!m_auxiliarySession.isEmpty()) {
+            session.devices = m_acquisition->portNames();
+        }
         
         if (m_dataLogger->saveSession(session, fileName)) {
             statusBar()->showMessage("Session saved: " + fileName);
@@ -376,25 +750,7 @@ void MainWindow::loadSession()
     if (!fileName.isEmpty()) {
         Session session = m_dataLogger->loadSession(fileName);
         if (!session.data.isEmpty()) {
-            m_currentSession = QList<SensorData>(session.data.begin(), session.data.end());
-            
-            // Update plots with loaded data
-            m_positionPlot->clearData();
-            m_forcePlot->clearData();
-            m_encoderPlot->clearData();
-            m_forceVsPositionPlot->clearData();
-            m_comparisonPlot->clearData();
-            
-            // Add data to main plots
-            QVector<SensorData> dataVector(m_currentSession.begin(), m_currentSession.end());
-            m_positionPlot->addDataSeries(dataVector, session.name);
-            m_forcePlot->addDataSeries(dataVector, session.name);
-            m_encoderPlot->addDataSeries(dataVector, session.name);
-            m_forceVsPositionPlot->addDataSeries(dataVector, session.name);
-            
-            // Add to comparison plot as main dataset
-            m_comparisonPlot->addDataSeries(dataVector, session.name);
-            
+            showSession(session);
             statusBar()->showMessage("Session loaded: " + fileName);
         } else {
             QMessageBox::warning(this, "Error", "Failed to load session");
@@ -402,6 +758,55 @@ void MainWindow::loadSession()
     }
 }
 
+void MainWindow::importCsv()
+{
+    QString fileName = QFileDialog::getOpenFileName(this,
+        "Import CSV", QString(), "Delimited Text (*.csv *.tsv *.txt);;All Files (*)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+    
+    CsvImporter::Options options;
+    QAction* checked = m_velocityMethodGroup->checkedAction();
+    options.velocityMethod = static_cast<VelocityEstimator::Method>(checked ? checked->data().toInt()
+                                                                           : VelocityEstimator::SavitzkyGolay);
+    CsvImporter importer(options);
+    Session session;
+    
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool ok = importer.importSession(fileName, &session);
+    QApplication::restoreOverrideCursor();
+    
+    if (!ok) {
+        QMessageBox::warning(this, "Error", "Failed to import " + fileName + ":\n" + importer.errorString());
+        return;
+    }
+    
+    showSession(session);
+    QString message = QString("Imported %1 samples from %2").arg(importer.rowsRead()).arg(fileName);
+    if (importer.rowsSkipped() > 0) {
+        message += QString(", %1 unreadable rows skipped").arg(importer.rowsSkipped());
+    }
+    statusBar()->showMessage(message);
+}
+
+void MainWindow::showSession(const Session& session)
+{
+    m_currentSession = QList<SensorData>(session.data.begin(), session.data.end());
+    m_sessionLinkHealth = session.link_health;
+    m_sessionLimitTrips = session.limit_trips;
+    m_auxiliarySession = session.auxiliary;
+    setChannelSchema(session.schema, session.calibration);
+    m_sessionCalibration = session.calibration;
+    
+    // Update plots with loaded data
+    refreshSessionPlots(session.data, session.name);
+    
+    // Add to comparison plot as main dataset
+    m_comparisonPlot->clearData();
+    m_comparisonPlot->addDataSeries(session.data, session.name);
+}
+
 void MainWindow::loadComparisonSession()
 {
     QString fileName = QFileDialog::getOpenFileName(this,
@@ -411,10 +816,29 @@ void MainWindow::loadComparisonSession()
     if (!fileName.isEmpty()) {
         Session session = m_dataLogger->loadSession(fileName);
         if (!session.data.isEmpty()) {
-            m_comparisonSession = QList<SensorData>(session.data.begin(), session.data.end());
+            QVector<SensorData> dataVector = session.data;
+            
+            // Line the runs up in time before overlaying them
+            if (m_alignCheckbox->isChecked() && !m_currentSession.isEmpty()) {
+                QVector<SensorData> reference(m_currentSession.begin(), m_currentSession.end());
+                AlignmentResult alignment = SessionAligner::align(reference, dataVector);
+                if (alignment.valid) {
+                    dataVector = SessionAligner::shifted(dataVector, alignment.offsetMs());
+                    m_residualPlot->setCurveData(SessionAligner::residual(reference, dataVector));
+                    m_residualPlot->setCurveLabel(session.name);
+                    m_alignmentLabel->setText(QString("%1: offset %2 s, score %3")
+                                              .arg(SessionAligner::methodName(alignment.method))
+                                              .arg(alignment.offset, 0, 'f', 3)
+                                              .arg(alignment.score, 0, 'f', 2));
+                } else {
+                    m_residualPlot->clearData();
+                    m_alignmentLabel->setText("Alignment failed, showing raw timestamps");
+                }
+            }
+            
+            m_comparisonSession = QList<SensorData>(dataVector.begin(), dataVector.end());
             
             // Add to comparison plot as overlay
-            QVector<SensorData> dataVector(m_comparisonSession.begin(), m_comparisonSession.end());
             m_comparisonPlot->addOverlayData(dataVector, session.name);
             
             // Enable overlay mode automatically
@@ -441,6 +865,7 @@ void MainWindow::exportData()
     if (!fileName.isEmpty()) {
         Session session;
         session.data = QVector<SensorData>(m_currentSession.begin(), m_currentSession.end());
+        session.schema = m_channelSchema;
         
         bool success = false;
         if (fileName.endsWith(".csv")) {
@@ -461,18 +886,271 @@ void MainWindow::showCalibration()
 {
     CalibrationDialog dialog(m_serialComm, this);
     dialog.exec();
+    
+    // Calibrated channels may have come or gone with the live calibration
+    const ChannelSchema schema = m_serialComm->channelSchema();
+    const CalibrationSet calibration = m_serialComm->calibration();
+    setChannelSchema(schema, calibration);
+    setTriggerSchema(schema, calibration);
+    updateLimitStatus();
+}
+
+void MainWindow::showDiagnostics()
+{
+    if (!m_diagnosticsDialog) {
+        m_diagnosticsDialog = new DiagnosticsDialog(this);
+    }
+    m_diagnosticsDialog->show();
+    m_diagnosticsDialog->raise();
+    m_diagnosticsDialog->activateWindow();
+}
+
+void MainWindow::showDevices()
+{
+    if (!m_devicesDialog) {
+        m_devicesDialog = new DevicesDialog(m_acquisition, this);
+    }
+    m_devicesDialog->show();
+    m_devicesDialog->raise();
+    m_devicesDialog->activateWindow();
+}
+
+void MainWindow::showLimits()
+{
+    LimitsDialog dialog(m_acquisition->limits(),
+                        m_serialComm->calibration().plotChannels(m_serialComm->channelSchema()), this);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    const LimitMonitor::Options options = dialog.options();
+    options.saveToSettings();
+    m_acquisition->setLimits(options);
+    updateLimitStatus();
+}
+
+void MainWindow::setTracingEnabled(bool enabled)
+{
+    if (enabled) {
+        Tracer::clear();
+    }
+    Tracer::setEnabled(enabled);
+    statusBar()->showMessage(enabled ? "Recording trace" : "Trace recording stopped");
+}
+
+void MainWindow::saveTrace()
+{
+    QString defaultName = QString("shockee_trace_%1.json")
+                          .arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+    QString fileName = QFileDialog::getSaveFileName(this, "Save Trace", defaultName,
+                                                    "Chrome Trace Files (*.json)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+    
+    if (Tracer::writeChromeTrace(fileName)) {
+        statusBar()->showMessage("Trace saved: " + fileName + " (open in ui.perfetto.dev)");
+    } else {
+        QMessageBox::warning(this, "Error", "Failed to save trace");
+    }
+}
+
+void MainWindow::selectVelocityMethod(QAction* action)
+{
+    int method = action->data().toInt();
+    m_serialComm->setVelocityMethod(method);
+    
+    QSettings settings;
+    settings.setValue("Analysis/velocityMethod", method);
+    
+    statusBar()->showMessage("Velocity estimator: " + action->text());
+}
+
+void MainWindow::recomputeVelocity()
+{
+    if (m_isRecording) {
+        QMessageBox::information(this, "Info", "Stop recording before recomputing velocity");
+        return;
+    }
+    
+    if (m_currentSession.isEmpty()) {
+        QMessageBox::information(this, "Info", "No data to recompute");
+        return;
+    }
+    
+    QAction* checked = m_velocityMethodGroup->checkedAction();
+    auto method = static_cast<VelocityEstimator::Method>(checked ? checked->data().toInt()
+                                                                 : VelocityEstimator::SavitzkyGolay);
+    
+    Session session;
+    session.data = QVector<SensorData>(m_currentSession.begin(), m_currentSession.end());
+    m_dataLogger->recomputeVelocity(session, method);
+    m_currentSession = QList<SensorData>(session.data.begin(), session.data.end());
+    
+    refreshSessionPlots(session.data, QString());
+    
+    statusBar()->showMessage("Velocity recomputed using " + VelocityEstimator::methodName(method));
+}
+
+void MainWindow::resampleSession()
+{
+    if (m_isRecording) {
+        QMessageBox::information(this, "Info", "Stop recording before resampling");
+        return;
+    }
+    
+    if (m_currentSession.isEmpty()) {
+        QMessageBox::information(this, "Info", "No data to resample");
+        return;
+    }
+    
+    Session session;
+    session.data = QVector<SensorData>(m_currentSession.begin(), m_currentSession.end());
+    
+    bool ok = false;
+    double currentRate = Resampler::estimateSampleRate(session.data);
+    double sampleRate = QInputDialog::getDouble(this, "Resample Session", "Sample rate (Hz):",
+                                                qRound(currentRate), 1.0, 1000.0, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    
+    QString modeText = QInputDialog::getItem(this, "Resample Session", "Interpolation:",
+                                             Resampler::modeNames(), Resampler::WindowedSinc, false, &ok);
+    if (!ok) {
+        return;
+    }
+    auto mode = static_cast<Resampler::Mode>(Resampler::modeNames().indexOf(modeText));
+    
+    m_dataLogger->resampleSession(session, sampleRate, mode);
+    m_currentSession = QList<SensorData>(session.data.begin(), session.data.end());
+    
+    refreshSessionPlots(session.data, QString());
+    
+    statusBar()->showMessage(QString("Resampled to %1 Hz (%2)").arg(sampleRate).arg(Resampler::modeName(mode)));
+}
+
+void MainWindow::refreshSessionPlots(const QVector<SensorData>& data, const QString& label)
+{
+    m_positionPlot->clearData();
+    m_forcePlot->clearData();
+    m_channelPlot->clearData();
+    m_forceVsPositionPlot->clearData();
+    m_forceVsVelocityPlot->clearData();
+    
+    m_positionPlot->addDataSeries(data, label);
+    m_forcePlot->addDataSeries(data, label);
+    m_channelPlot->addDataSeries(data, label);
+    m_forceVsPositionPlot->addDataSeries(data, label);
+    m_forceVsVelocityPlot->addDataSeries(data, label);
+    
+    // Cycle detection depends on velocity, so re-run it with the plots
+    m_hysteresisAnalyzer.clear();
+    for (const SensorData& point : data) {
+        m_hysteresisAnalyzer.addSample(point);
+    }
+    m_energyPlot->setCurveData(HysteresisAnalyzer::energyVsTime(m_hysteresisAnalyzer.cycles()));
+    m_cumulativeEnergyPlot->setCurveData(HysteresisAnalyzer::cumulativeEnergyVsTime(m_hysteresisAnalyzer.cycles()));
+    updateEnergyLabel();
+    
+    updateSpectralPlots(data);
+}
+
+void MainWindow::updateSpectralPlots(const QVector<SensorData>& data)
+{
+    SpectralAnalyzer::Channel channel = spectralChannel();
+    int segmentSize = spectralSegmentSize();
+    
+    double sampleRate = Resampler::estimateSampleRate(data);
+    QVector<double> samples = SpectralAnalyzer::resampleUniform(data, channel, sampleRate);
+    
+    PowerSpectrum spectrum = SpectralAnalyzer::welch(samples, sampleRate, segmentSize);
+    m_psdPlot->setCurveData(SpectralAnalyzer::toDecibelCurve(spectrum));
+    m_psdPlot->setCurveLabel(QString("%1, %2 segments at %3 Hz")
+                             .arg(SpectralAnalyzer::channelName(channel))
+                             .arg(spectrum.segmentCount)
+                             .arg(sampleRate, 0, 'f', 1));
+    
+    int hop = segmentSize / 4;
+    m_spectrogramPlot->setSpectrogram(SpectralAnalyzer::spectrogram(samples, sampleRate, segmentSize, hop),
+                                      sampleRate > 0 ? hop / sampleRate : 0, sampleRate / 2);
+}
+
+SpectralAnalyzer::Channel MainWindow::spectralChannel() const
+{
+    return static_cast<SpectralAnalyzer::Channel>(m_spectralChannelCombo->currentData().toInt());
+}
+
+int MainWindow::spectralSegmentSize() const
+{
+    return m_segmentSizeCombo->currentData().toInt();
+}
+
+void MainWindow::onSpectralSettingsChanged()
+{
+    if (m_isRecording) {
+        // Restart the live spectrogram with the new settings
+        m_spectrogramPlot->clearData();
+        m_spectrogramStream.configure(spectralChannel(), spectralSegmentSize(), spectralSegmentSize() / 4);
+        return;
+    }
+    
+    if (!m_currentSession.isEmpty()) {
+        QVector<SensorData> dataVector(m_currentSession.begin(), m_currentSession.end());
+        updateSpectralPlots(dataVector);
+    }
+}
+
+void MainWindow::updateEnergyLabel()
+{
+    m_energyPlot->setCurveLabel(QString("%1 cycles, %2 J total")
+                                .arg(m_hysteresisAnalyzer.cycles().size())
+                                .arg(m_hysteresisAnalyzer.cumulativeEnergy(), 0, 'f', 2));
+}
+
+void MainWindow::onMergedSample(const SensorData& data)
+{
+    // The pre-trigger ring runs on every sample while connected, armed or not
+    for (int pending = m_triggerCapture.addSample(data); pending > 0; --pending) {
+        onTriggerCaptured(m_triggerCapture.takeCapture());
+    }
+    
+    if (data.source == 0) {
+        onNewDataReceived(data);
+    } else if (m_isRecording) {
+        // Additional boards are recorded alongside; the plots follow the primary
+        m_auxiliarySession.append(data);
+    }
 }
 
 void MainWindow::onNewDataReceived(const SensorData& data)
 {
+    LatencyMonitor& latency = LatencyMonitor::instance();
+    latency.record(LatencyMonitor::Dispatched, data.receivedAt);
+    
     if (m_isRecording) {
         m_currentSession.append(data);
+        latency.record(LatencyMonitor::Logged, data.receivedAt);
         
         // Add to plots
         m_positionPlot->addDataPoint(data);
         m_forcePlot->addDataPoint(data);
-        m_encoderPlot->addDataPoint(data);
+        m_channelPlot->addDataPoint(data);
         m_forceVsPositionPlot->addDataPoint(data);
+        m_forceVsVelocityPlot->addDataPoint(data);
+        
+        if (m_hysteresisAnalyzer.addSample(data)) {
+            const HysteresisCycle& cycle = m_hysteresisAnalyzer.lastCycle();
+            m_energyPlot->addCurvePoint(QPointF(cycle.endTime, cycle.energy));
+            m_cumulativeEnergyPlot->addCurvePoint(QPointF(cycle.endTime, cycle.cumulativeEnergy));
+            updateEnergyLabel();
+        }
+        
+        for (int pending = m_spectrogramStream.addSample(data); pending > 0; --pending) {
+            m_spectrogramPlot->addSpectrogramFrame(m_spectrogramStream.takeFrame(),
+                                                   m_spectrogramStream.frameInterval(),
+                                                   m_spectrogramStream.maxFrequency());
+        }
     }
     
     // Update sensor displays
@@ -486,24 +1164,262 @@ void MainWindow::onConnectionStatusChanged(bool connected)
     m_connectButton->setEnabled(!connected);
     m_disconnectButton->setEnabled(connected);
     m_startRecordButton->setEnabled(connected && !m_isRecording);
+    m_armTriggerButton->setEnabled(connected && !m_isRecording);
     
     if (connected) {
         m_connectionStatus->setText("Connected");
         m_connectionStatus->setStyleSheet("color: green; font-weight: bold;");
         m_displayUpdateTimer->start();
+        m_linkHealthTimer->start();
+        m_limitTrips.clear();
     } else {
         m_connectionStatus->setText("Disconnected");
         m_connectionStatus->setStyleSheet("color: red; font-weight: bold;");
         m_displayUpdateTimer->stop();
+        m_linkHealthTimer->stop();
+        m_linkHealthLabel->clear();
         
         if (m_isRecording) {
             stopRecording();
         }
+        // A capture cut short by the disconnect is still kept
+        m_armTriggerButton->setChecked(false);
+        m_triggerCapture.reset();
+    }
+}
+
+void MainWindow::updateLinkHealth()
+{
+    LinkHealth health = m_serialComm->linkHealth();
+    m_linkHealthLabel->setText(health.summary());
+    m_linkHealthLabel->setStyleSheet(health.isHealthy() ? "" : "color: red; font-weight: bold;");
+}
+
+void MainWindow::onChannelSchemaChanged(const ChannelSchema& schema)
+{
+    const CalibrationSet calibration = m_serialComm->calibration();
+    setChannelSchema(schema, calibration);
+    setTriggerSchema(schema, calibration);
+    updateLimitStatus();
+    
+    QStringList labels;
+    for (const SensorChannel& channel : schema.channels()) {
+        labels << channel.label();
+    }
+    statusBar()->showMessage("Device channels: " + labels.join(", "));
+}
+
+void MainWindow::setChannelSchema(const ChannelSchema& schema, const CalibrationSet& calibration)
+{
+    // Keep the plotted channel if the new schema still has it
+    const QString current = m_plotChannelCombo->currentData().toString();
+    m_channelSchema = schema;
+    m_plotChannels = calibration.plotChannels(schema);
+    
+    QSignalBlocker blocker(m_plotChannelCombo);
+    m_plotChannelCombo->clear();
+    for (const SensorChannel& channel : m_plotChannels) {
+        m_plotChannelCombo->addItem(channel.label(), channel.name);
+    }
+    int index = m_plotChannelCombo->findData(current.isEmpty() ? QString("encoder") : current);
+    m_plotChannelCombo->setCurrentIndex(qMax(0, index));
+    onPlotChannelChanged(m_plotChannelCombo->currentIndex());
+}
+
+void MainWindow::onPlotChannelChanged(int index)
+{
+    if (index >= 0 && index < m_plotChannels.size()) {
+        m_channelPlot->setChannel(m_plotChannels[index]);
+    }
+}
+
+void MainWindow::setTriggerSchema(const ChannelSchema& schema, const CalibrationSet& calibration)
+{
+    // Triggers follow the live device's channels, not a loaded session's
+    m_triggerCapture.setSchema(schema, calibration);
+    
+    QString current = m_triggerChannelCombo->currentData().toString();
+    if (current.isEmpty()) {
+        current = TriggerCapture::Options::fromSettings().conditions.value(0).channel;
+    }
+    m_triggerChannelCombo->clear();
+    for (const SensorChannel& channel : calibration.plotChannels(schema)) {
+        m_triggerChannelCombo->addItem(channel.label(), channel.name);
+    }
+    m_triggerChannelCombo->setCurrentIndex(qMax(0, m_triggerChannelCombo->findData(current)));
+}
+
+void MainWindow::armTrigger(bool armed)
+{
+    if (!armed) {
+        m_triggerCapture.disarm();
+        for (int pending = m_triggerCapture.pendingCaptures(); pending > 0; --pending) {
+            onTriggerCaptured(m_triggerCapture.takeCapture());
+        }
+        m_armTriggerButton->setText("Arm Trigger");
+        m_startRecordButton->setEnabled(m_isConnected && !m_isRecording);
+        m_triggerStatus->setText(QString("Idle, %1 captured").arg(m_triggerCapture.captureCount()));
+        return;
+    }
+    
+    TriggerCapture::Options options = TriggerCapture::Options::fromSettings();
+    const TriggerCondition condition(m_triggerChannelCombo->currentData().toString(),
+                                     TriggerCondition::Type(m_triggerTypeCombo->currentData().toInt()),
+                                     m_triggerLevelSpin->value());
+    if (options.conditions.isEmpty()) {
+        options.conditions << condition;
+    } else {
+        options.conditions[0] = condition;
+    }
+    options.preTrigger = m_preTriggerSpin->value();
+    options.postTrigger = m_postTriggerSpin->value();
+    options.autoRearm = m_autoRearmCheckbox->isChecked();
+    options.saveToSettings();
+    
+    m_triggerCapture.setOptions(options);
+    const QStringList missing = m_triggerCapture.unresolvedChannels();
+    if (!missing.isEmpty()) {
+        statusBar()->showMessage("Trigger channels not sent by the device: " + missing.join(", "));
+    }
+    m_triggerCapture.arm();
+    
+    m_armTriggerButton->setText("Disarm Trigger");
+    m_startRecordButton->setEnabled(false);
+    m_triggerStatus->setText("Armed: " + condition.description());
+}
+
+void MainWindow::onLimitTripped(const LimitTrip& trip)
+{
+    // The devices have already been sent the stop command; this is the
+    // operator's side of it
+    m_limitTripped = true;
+    m_limitTrips << trip;
+    if (m_isRecording) {
+        m_sessionLimitTrips << trip;
+    }
+    updateLimitStatus();
+    QApplication::beep();
+    
+    QString latency = QString("Detected %1 after the port read")
+                          .arg(DiagnosticsDialog::formatLatency(trip.detectionLatency));
+    if (trip.stopLatency > 0) {
+        latency += QString(", stop command sent after %1").arg(DiagnosticsDialog::formatLatency(trip.stopLatency));
+    }
+    const LatencyHistogram worst = m_acquisition->stats(trip.source).limitLatency;
+    if (worst.count() > 0) {
+        latency += QString(".\nWorst case since connecting: %1 over %2 samples")
+                       .arg(DiagnosticsDialog::formatLatency(worst.max()))
+                       .arg(worst.count());
+    }
+    statusBar()->showMessage("Limit tripped: " + trip.description());
+    QMessageBox::critical(this, "Limit Tripped",
+                          QString("%1\n\n%2.\n\nReset the alarm to resume checking.")
+                              .arg(trip.description(), latency));
+}
+
+void MainWindow::resetLimitAlarm()
+{
+    m_acquisition->resetLimits();
+    m_limitTripped = false;
+    updateLimitStatus();
+    statusBar()->showMessage("Limit alarm reset");
+}
+
+void MainWindow::updateLimitStatus()
+{
+    const LimitMonitor::Options& options = m_acquisition->limits();
+    m_resetLimitButton->setEnabled(m_limitTripped);
+    if (m_limitTripped) {
+        m_limitStatus->setText("LIMIT TRIPPED: " + m_limitTrips.last().description());
+        m_limitStatus->setStyleSheet("color: white; background-color: red; font-weight: bold;");
+        return;
+    }
+    
+    QStringList rules;
+    for (const LimitRule& rule : options.rules) {
+        rules << rule.description();
+    }
+    const bool active = options.enabled && !rules.isEmpty();
+    m_limitStatus->setToolTip(rules.join("\n"));
+    
+    // A rule on a channel the device does not provide is silently skipped
+    // by the monitor, so it is shown as loudly as a trip
+    const QStringList unresolved = active ? m_acquisition->unresolvedLimits() : QStringList();
+    if (!unresolved.isEmpty()) {
+        m_limitStatus->setText("LIMITS NOT CHECKED: no " + unresolved.join(", "));
+        m_limitStatus->setStyleSheet("color: red; font-weight: bold;");
+        return;
+    }
+    m_limitStatus->setText(active ? QString("Limits: %1").arg(rules.size()) : QString("Limits off"));
+    m_limitStatus->setStyleSheet(active ? "color: green;" : "color: gray;");
+}
+
+void MainWindow::onTriggerCaptured(const TriggerCapture::Capture& capture)
+{
+    if (capture.data.isEmpty()) {
+        return;
+    }
+    
+    // Saved straight away, so back-to-back events need no attention
+    Session session;
+    session.name = QString("capture_%1").arg(m_triggerCapture.captureCount() - m_triggerCapture.pendingCaptures());
+    session.timestamp = QDateTime::currentDateTime();
+    for (const SensorData& data : capture.data) {
+        if (data.source == 0) {
+            session.data.append(data);
+        } else {
+            session.auxiliary.append(data);
+        }
+    }
+    if (session.data.isEmpty()) {
+        return;
+    }
+    const TriggerCondition condition = m_triggerCapture.options().conditions.value(capture.condition);
+    const double triggerTime = (capture.triggerTimeUs - capture.data.first().timestampUs) / 1e6;
+    session.description = QString("Triggered by %1 at %2 s%3")
+                              .arg(condition.description())
+                              .arg(triggerTime, 0, 'f', 3)
+                              .arg(capture.complete ? QString() : QString(", cut short"));
+    session.schema = m_channelSchema;
+    session.link_health = m_serialComm->linkHealth();
+    const CalibrationSet calibration = m_serialComm->calibration();
+    if (calibration.appliesTo(session.schema)) {
+        session.calibration = calibration;
+    }
+    if (!session.auxiliary.isEmpty()) {
+        session.devices = m_acquisition->portNames();
+    }
+    for (const LimitTrip& trip : m_limitTrips) {
+        if (trip.timestampUs >= capture.data.first().timestampUs
+            && trip.timestampUs <= capture.data.last().timestampUs) {
+            session.limit_trips << trip;
+        }
+    }
+    
+    const bool saved = m_dataLogger->saveSession(session);
+    showSession(session);
+    m_saveButton->setEnabled(true);
+    
+    QString status = QString("%1 captured").arg(m_triggerCapture.captureCount());
+    if (m_triggerCapture.state() != TriggerCapture::Idle) {
+        status = "Armed, " + status;
+    }
+    m_triggerStatus->setText(status);
+    statusBar()->showMessage(saved
+        ? QString("Captured %1 (%2 s) into the session library").arg(session.name).arg(capture.duration(), 0, 'f', 1)
+        : QString("Captured %1 but could not save it").arg(session.name));
+    if (m_triggerCapture.state() == TriggerCapture::Idle && m_armTriggerButton->isChecked()) {
+        QSignalBlocker blocker(m_armTriggerButton);
+        m_armTriggerButton->setChecked(false);
+        m_armTriggerButton->setText("Arm Trigger");
+        m_startRecordButton->setEnabled(m_isConnected && !m_isRecording);
     }
 }
 
 void MainWindow::updateDisplay()
 {
+    SHOCKEE_TRACE_SCOPE("ui", "MainWindow::updateDisplay");
+    
     if (m_isRecording) {
         qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - m_recordingStartTime;
         int seconds = elapsed / 1000;
@@ -539,8 +1455,235 @@ void MainWindow::resetDisplay()
     m_recordingProgress->setValue(0);
 }
 
+void MainWindow::onVelocityBinWidthChanged(double binWidth)
+{
+    // Re-bin whatever session is currently shown
+    m_forceVsVelocityPlot->setVelocityBinWidth(binWidth);
+    if (!m_currentSession.isEmpty()) {
+        QVector<SensorData> dataVector(m_currentSession.begin(), m_currentSession.end());
+        m_forceVsVelocityPlot->addDataSeries(dataVector);
+    }
+}
+
 void MainWindow::toggleOverlay()
 {
     bool overlayMode = m_overlayCheckbox->isChecked();
     m_comparisonPlot->setOverlayMode(overlayMode);
-}
\ No newline at end of file
+}
+
+void MainWindow::addBatchSessions()
+{
+    QStringList fileNames = QFileDialog::getOpenFileNames(this,
+        "Add Sessions to Batch", m_dataLogger->getSessionsDirectory(),
+        "Shockee Session Files (*.json)");
+    
+    if (!fileNames.isEmpty()) {
+        startBatch(fileNames);
+    }
+}
+
+void MainWindow::addLibraryToBatch()
+{
+    QStringList fileNames = m_dataLogger->getAvailableSessions();
+    if (fileNames.isEmpty()) {
+        QMessageBox::information(this, "Info", "No saved sessions found");
+        return;
+    }
+    
+    startBatch(fileNames);
+}
+
+void MainWindow::clearBatch()
+{
+    m_batchSummaries.clear();
+    updateBatchView();
+}
+
+void MainWindow::startBatch(const QStringList& fileNames)
+{
+    if (m_batchWatcher->isRunning()) {
+        return;
+    }
+    
+    // Sessions already in the batch are not summarised again
+    QStringList pending;
+    for (const QString& fileName : fileNames) {
+        bool known = std::any_of(m_batchSummaries.begin(), m_batchSummaries.end(),
+                                 [&fileName](const SessionSummary& summary) {
+                                     return summary.filePath == fileName;
+                                 });
+        if (!known && !pending.contains(fileName)) {
+            pending << fileName;
+        }
+    }
+    if (pending.isEmpty()) {
+        return;
+    }
+    
+    m_batchAddButton->setEnabled(false);
+    m_batchLibraryButton->setEnabled(false);
+    m_batchClearButton->setEnabled(false);
+    m_batchProgress->setValue(0);
+    m_batchProgress->setVisible(true);
+    
+    m_batchWatcher->setFuture(BatchComparison::run(m_dataLogger, pending, m_velocityBinSpin->value()));
+    statusBar()->showMessage(QString("Summarising %1 sessions...").arg(pending.size()));
+}
+
+void MainWindow::onBatchFinished()
+{
+    m_batchAddButton->setEnabled(true);
+    m_batchLibraryButton->setEnabled(true);
+    m_batchClearButton->setEnabled(true);
+    m_batchProgress->setVisible(false);
+    
+    if (m_batchWatcher->isCanceled()) {
+        return;
+    }
+    
+    int added = 0;
+    int skipped = 0;
+    for (const SessionSummary& summary : m_batchWatcher->future().results()) {
+        if (summary.valid) {
+            m_batchSummaries.append(summary);
+            ++added;
+        } else {
+            qWarning() << "Skipping session without usable data:" << summary.filePath;
+            ++skipped;
+        }
+    }
+    
+    BatchComparison::sortByDampingSetting(m_batchSummaries);
+    updateBatchView();
+    
+    QString message = QString("Added %1 sessions to batch").arg(added);
+    if (skipped > 0) {
+        message += QString(", %1 skipped").arg(skipped);
+    }
+    statusBar()->showMessage(message);
+}
+
+void MainWindow::recalibrateSessions()
+{
+    if (m_recalibrateWatcher->isRunning()) {
+        return;
+    }
+    
+    CalibrationSet calibration = CalibrationSet::fromSettings();
+    QStringList fileNames = QFileDialog::getOpenFileNames(this,
+        "Recalibrate Sessions", m_dataLogger->getSessionsDirectory(),
+        "Shockee Session Files (*.json)");
+    if (fileNames.isEmpty()) {
+        return;
+    }
+    
+    QMessageBox::StandardButton answer = QMessageBox::question(this, "Recalibrate Sessions",
+        QString("Apply the current calibration (%1) to %2 sessions and re-derive their velocity? "
+                "Each file is replaced with the recalibrated version; sessions recorded without "
+                "raw channels are left untouched.")
+            .arg(calibration.channels().join(", ")).arg(fileNames.size()));
+    if (answer != QMessageBox::Yes) {
+        return;
+    }
+    
+    BatchProcessor::Options options;
+    options.command = BatchProcessor::Recalibrate;
+    options.calibration = calibration;
+    options.binWidth = m_velocityBinSpin->value();
+    QAction* checked = m_velocityMethodGroup->checkedAction();
+    options.velocityMethod = static_cast<VelocityEstimator::Method>(checked ? checked->data().toInt()
+                                                                           : VelocityEstimator::SavitzkyGolay);
+    
+    // Each worker streams one session at a time; the mapped function keeps
+    // the processor alive until the last file is done
+    auto processor = std::make_shared<BatchProcessor>(options);
+    m_recalibrateWatcher->setFuture(QtConcurrent::mapped(fileNames,
+        [processor](const QString& fileName) {
+            return processor->processFile(fileName);
+        }));
+    statusBar()->showMessage(QString("Recalibrating %1 sessions...").arg(fileNames.size()));
+}
+
+void MainWindow::onRecalibrateFinished()
+{
+    int recalibrated = 0;
+    QStringList failures;
+    QStringList refreshed;
+    for (const QJsonObject& result : m_recalibrateWatcher->future().results()) {
+        const QString fileName = result["input"].toString();
+        if (!result["ok"].toBool()) {
+            failures << QFileInfo(fileName).fileName() + ": " + result["error"].toString();
+            continue;
+        }
+        ++recalibrated;
+        
+        // Batch summaries of the old versions are stale
+        auto stale = std::remove_if(m_batchSummaries.begin(), m_batchSummaries.end(),
+                                    [&fileName](const SessionSummary& summary) {
+                                        return summary.filePath == fileName;
+                                    });
+        if (stale != m_batchSummaries.end()) {
+            m_batchSummaries.erase(stale, m_batchSummaries.end());
+            refreshed << fileName;
+        }
+    }
+    
+    if (!refreshed.isEmpty()) {
+        updateBatchView();
+        startBatch(refreshed);
+    }
+    
+    QString message = QString("Recalibrated %1 sessions").arg(recalibrated);
+    statusBar()->showMessage(message);
+    if (!failures.isEmpty()) {
+        QMessageBox::warning(this, "Recalibrate Sessions",
+                             message + QString(", %1 failed:\n\n").arg(failures.size()) + failures.join("\n"));
+    }
+}
+
+void MainWindow::updateBatchView()
+{
+    const bool normalize = m_batchNormalizeCheckbox->isChecked();
+    const int count = m_batchSummaries.size();
+    
+    QVector<QVector<QPointF>> curves;
+    QStringList labels;
+    curves.reserve(count);
+    for (const SessionSummary& summary : m_batchSummaries) {
+        curves.append(normalize ? BatchComparison::normalized(summary.curve) : summary.curve);
+        labels << summary.name;
+    }
+    m_batchPlot->setCurveFamily(curves, labels, normalize);
+    
+    // Rows follow the curve order so the swatches match the plot
+    m_batchTable->setRowCount(count);
+    for (int row = 0; row < count; ++row) {
+        const SessionSummary& summary = m_batchSummaries[row];
+        
+        QTableWidgetItem* swatch = new QTableWidgetItem();
+        swatch->setBackground(PlotWidget::familyColor(row, count));
+        swatch->setToolTip(summary.filePath);
+        m_batchTable->setItem(row, 0, swatch);
+        
+        const QStringList values = {
+            summary.name,
+            QString::number(summary.dampingSetting),
+            QString::number(summary.sampleCount),
+            QString::number(summary.duration, 'f', 1),
+            QString::number(summary.peakCompressionForce, 'f', 1),
+            QString::number(summary.peakReboundForce, 'f', 1),
+            QString::number(summary.maxVelocity, 'f', 0),
+            QString::number(summary.compressionDamping, 'f', 3),
+            QString::number(summary.reboundDamping, 'f', 3),
+            QString::number(summary.cycleCount),
+            QString::number(summary.energy, 'f', 1)
+        };
+        for (int column = 0; column < values.size(); ++column) {
+            QTableWidgetItem* item = new QTableWidgetItem(values[column]);
+            if (column > 0) {
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            }
+            m_batchTable->setItem(row, column + 1, item);
+        }
+    }
+}
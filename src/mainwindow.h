@@ -18,11 +18,22 @@
 #include <QTimer>
 #include <QGroupBox>
 #include <QCheckBox>
+#include <QActionGroup>
+#include <QTableWidget>
+#include <QFutureWatcher>
 
 #include "serialcommunicator.h"
 #include "datalogger.h"
 #include "plotwidget.h"
 #include "calibrationdialog.h"
+#include "diagnosticsdialog.h"
+#include "devicesdialog.h"
+#include "limitsdialog.h"
+#include "acquisitionmanager.h"
+#include "spectralanalyzer.h"
+#include "sessionaligner.h"
+#include "batchcomparison.h"
+#include "triggercapture.h"
 
 class MainWindow : public QMainWindow
 {
@@ -42,27 +53,67 @@ private slots:
     void loadComparisonSession();
     void exportData();
     void showCalibration();
+    void showDiagnostics();
+    void showDevices();
+    void showLimits();
+    void setTracingEnabled(bool enabled);
+    void saveTrace();
+    void onMergedSample(const SensorData& data);
     void onNewDataReceived(const SensorData& data);
     void onConnectionStatusChanged(bool connected);
     void updateDisplay();
+    void updateLinkHealth();
+    void onChannelSchemaChanged(const ChannelSchema& schema);
+    void armTrigger(bool armed);
+    void onLimitTripped(const LimitTrip& trip);
+    void resetLimitAlarm();
+    void onPlotChannelChanged(int index);
     void toggleOverlay();
+    void onVelocityBinWidthChanged(double binWidth);
+    void selectVelocityMethod(QAction* action);
+    void recomputeVelocity();
+    void resampleSession();
+    void importCsv();
+    void recalibrateSessions();
+    void onRecalibrateFinished();
+    void onSpectralSettingsChanged();
+    void addBatchSessions();
+    void addLibraryToBatch();
+    void clearBatch();
+    void onBatchFinished();
+    void updateBatchView();
 
 private:
     void setupUI();
     void setupRealTimeTab();
     void setupAnalysisTab();
     void setupComparisonTab();
+    void setupSpectralTab();
+    void setupBatchTab();
     void setupMenus();
     void setupStatusBar();
     void setupConnections();
     void updateSensorDisplays(const SensorData& data);
+    void refreshSessionPlots(const QVector<SensorData>& data, const QString& label);
+    void updateEnergyLabel();
+    void updateSpectralPlots(const QVector<SensorData>& data);
+    void startBatch(const QStringList& fileNames);
+    SpectralAnalyzer::Channel spectralChannel() const;
+    int spectralSegmentSize() const;
     void resetDisplay();
+    void showSession(const Session& session);
+    void setChannelSchema(const ChannelSchema& schema, const CalibrationSet& calibration = CalibrationSet());
+    void setTriggerSchema(const ChannelSchema& schema, const CalibrationSet& calibration = CalibrationSet());
+    void onTriggerCaptured(const TriggerCapture::Capture& capture);
+    void updateLimitStatus();
 
     // UI Components
     QTabWidget* m_tabWidget;
     QWidget* m_realTimeTab;
     QWidget* m_analysisTab;
     QWidget* m_comparisonTab;
+    QWidget* m_spectralTab;
+    QWidget* m_batchTab;
     
     // Control Panel
     QGroupBox* m_connectionGroup;
@@ -70,6 +121,8 @@ private:
     QPushButton* m_connectButton;
     QPushButton* m_disconnectButton;
     QLabel* m_connectionStatus;
+    QLabel* m_limitStatus;
+    QPushButton* m_resetLimitButton;
     
     QGroupBox* m_recordingGroup;
     QPushButton* m_startRecordButton;
@@ -78,6 +131,17 @@ private:
     QPushButton* m_loadButton;
     QLabel* m_recordingTime;
     QProgressBar* m_recordingProgress;
+    QLabel* m_linkHealthLabel;
+    
+    QGroupBox* m_triggerGroup;
+    QComboBox* m_triggerChannelCombo;
+    QComboBox* m_triggerTypeCombo;
+    QDoubleSpinBox* m_triggerLevelSpin;
+    QDoubleSpinBox* m_preTriggerSpin;
+    QDoubleSpinBox* m_postTriggerSpin;
+    QCheckBox* m_autoRearmCheckbox;
+    QPushButton* m_armTriggerButton;
+    QLabel* m_triggerStatus;
     
     // Sensor Displays
     QGroupBox* m_sensorGroup;
@@ -85,38 +149,87 @@ private:
     QLabel* m_forceDisplay;
     QLabel* m_encoderDisplay;
     QLabel* m_velocityDisplay;
+    QComboBox* m_plotChannelCombo;
     
     // Plot Widgets
     PlotWidget* m_positionPlot;
     PlotWidget* m_forcePlot;
-    PlotWidget* m_encoderPlot;
+    PlotWidget* m_channelPlot;      // channel picked in m_plotChannelCombo, encoder by default
     PlotWidget* m_forceVsPositionPlot;
     
+    // Analysis Tools
+    QDoubleSpinBox* m_velocityBinSpin;
+    PlotWidget* m_forceVsVelocityPlot;
+    PlotWidget* m_energyPlot;
+    PlotWidget* m_cumulativeEnergyPlot;
+    
     // Comparison Tools
     QCheckBox* m_overlayCheckbox;
     QPushButton* m_loadComparisonButton;
+    QCheckBox* m_alignCheckbox;
+    QLabel* m_alignmentLabel;
     PlotWidget* m_comparisonPlot;
+    PlotWidget* m_residualPlot;
+    
+    // Spectral Tools
+    QComboBox* m_spectralChannelCombo;
+    QComboBox* m_segmentSizeCombo;
+    PlotWidget* m_psdPlot;
+    PlotWidget* m_spectrogramPlot;
+    
+    // Batch tab
+    QPushButton* m_batchAddButton;
+    QPushButton* m_batchLibraryButton;
+    QPushButton* m_batchClearButton;
+    QCheckBox* m_batchNormalizeCheckbox;
+    QProgressBar* m_batchProgress;
+    PlotWidget* m_batchPlot;
+    QTableWidget* m_batchTable;
+    
+    // Menus
+    QActionGroup* m_velocityMethodGroup;
     
     // Backend Components
-    SerialCommunicator* m_serialComm;
+    AcquisitionManager* m_acquisition;
+    SerialCommunicator* m_serialComm;   // primary device, owned by m_acquisition
     DataLogger* m_dataLogger;
     
     // Timers
     QTimer* m_displayUpdateTimer;
     QTimer* m_recordingTimer;
+    QTimer* m_linkHealthTimer;
+    
+    // Analysis
+    HysteresisAnalyzer m_hysteresisAnalyzer;
+    SpectrogramStream m_spectrogramStream;
+    TriggerCapture m_triggerCapture;
+    QFutureWatcher<SessionSummary>* m_batchWatcher;
+    QFutureWatcher<QJsonObject>* m_recalibrateWatcher;
+    DiagnosticsDialog* m_diagnosticsDialog;
+    DevicesDialog* m_devicesDialog;
     
     // Data
     QList<SensorData> m_currentSession;
     QList<SensorData> m_comparisonSession;
+    QVector<SensorData> m_auxiliarySession;
+    LinkHealth m_sessionLinkHealth;
+    ChannelSchema m_channelSchema;      // live device's columns, or the loaded session's
+    QVector<SensorChannel> m_plotChannels;  // its plot channels, calibrated ones included
+    CalibrationSet m_sessionCalibration;
+    QVector<LimitTrip> m_sessionLimitTrips;
+    QVector<LimitTrip> m_limitTrips;    // since connecting, for triggered captures
+    QVector<SessionSummary> m_batchSummaries;
     
     // State
     bool m_isRecording;
     bool m_isConnected;
+    bool m_limitTripped;
     qint64 m_recordingStartTime;
     
     // Constants
     static const int MAX_RECORDING_TIME = 120000; // 2 minutes in ms
     static const int DISPLAY_UPDATE_INTERVAL = 50; // 20 FPS
+    static const int LINK_HEALTH_INTERVAL = 1000; // ms
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "mappedfile.h"
+#include <cstring>
+
+MappedFile::MappedFile()
+    : m_data(nullptr)
+    , m_size(0)
+{
+}
+
+bool MappedFile::open(const QString& filename)
+{
+    m_file.close();
+    m_contents.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_error.clear();
+
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    m_data = size > 0 ? reinterpret_cast<const char*>(m_file.map(0, size)) : nullptr;
+    if (m_data) {
+        m_size = size;
+        return true;
+    }
+
+    m_contents = m_file.readAll();
+    if (m_file.error() != QFileDevice::NoError) {
+        m_error = m_file.errorString();
+        m_contents.clear();
+        return false;
+    }
+    m_data = m_contents.constData();
+    m_size = m_contents.size();
+    return true;
+}
+
+const char* MappedFile::skipByteOrderMark(const char* begin, const char* end)
+{
+    if (end - begin >= 3 && memcmp(begin, "\xEF\xBB\xBF", 3) == 0) {
+        return begin + 3;
+    }
+    return begin;
+}
@@ -0,0 +1,40 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+// Read-only view of a whole file for the session readers. The file is
+// memory-mapped where possible; pipes and special files, which cannot be,
+// are read into memory instead. The view stays valid until the object is
+// destroyed or opened again.
+class MappedFile
+{
+public:
+    MappedFile();
+
+    bool open(const QString& filename);
+
+    const char* data() const { return m_data; }
+    const char* end() const { return m_data + m_size; }
+    qint64 size() const { return m_size; }
+
+    // The contents past a leading UTF-8 byte order mark
+    const char* text() const { return skipByteOrderMark(m_data, end()); }
+
+    QString errorString() const { return m_error; }
+
+    static const char* skipByteOrderMark(const char* begin, const char* end);
+
+private:
+    Q_DISABLE_COPY(MappedFile)
+
+    QFile m_file;
+    QByteArray m_contents;
+    const char* m_data;
+    qint64 m_size;
+    QString m_error;
+};
+
+#endif // MAPPEDFILE_H
@@ -1,4 +1,6 @@
 #include "plotwidget.h"
+#include "latencymonitor.h"
+#include "tracing.h"
 #include <QPainter>
 #include <QMouseEvent>
 #include <QWheelEvent>
@@ -7,21 +9,32 @@
 #include <QApplication>
 #include <QDebug>
 #include <QtMath>
+#include <algorithm>
 
 PlotWidget::PlotWidget(PlotType type, QWidget *parent)
     : QWidget(parent)
     , m_plotType(type)
+    , m_familyNormalized(false)
+    , m_spectrogramHead(0), m_spectrogramCount(0)
+    , m_spectrogramInterval(0), m_spectrogramMaxFrequency(0)
+    , m_spectrogramEndTime(0), m_spectrogramTopDb(0)
     , m_timeWindow(DEFAULT_TIME_WINDOW)
     , m_autoScale(true)
+    , m_boundsStale(false)
     , m_gridVisible(true)
     , m_overlayMode(false)
     , m_polarMode(type == Comparison)
     , m_minX(0), m_maxX(10), m_minY(-10), m_maxY(10)
     , m_scaleX(1), m_scaleY(1)
-    , m_isDragging(false)
-    , m_zoomFactor(1.0)
     , m_polarRadius(0)
     , m_minForce(0), m_maxForce(1000)
+    , m_lastPaintedReceivedAt(0)
+    , m_isDragging(false)
+    , m_cursorClick(false)
+    , m_zoomFactor(1.0)
+    , m_cursorIndexValid(false)
+    , m_plotCacheValid(false)
+    , m_cursorRepaint(false)
 {
     setMinimumSize(200, 150);
     setAttribute(Qt::WA_OpaquePaintEvent);
@@ -32,10 +45,9 @@ PlotWidget::PlotWidget(PlotType type, QWidget *parent)
     m_gridColor = QColor(220, 220, 220);
     m_axisColor = QColor(100, 100, 100);
     m_dataColor = QColor(50, 150, 250);
-    
-    // Setup overlay colors
-    m_overlayColors << QColor(255, 100, 100) << QColor(100, 255, 100) 
-                    << QColor(255, 255, 100) << QColor(255, 100, 255);
+    m_reboundColor = QColor(230, 90, 60);
+    m_cursorColors[0] = QColor(230, 130, 20);
+    m_cursorColors[1] = QColor(150, 60, 200);
     
     // Setup pens
     m_dataPen = QPen(m_dataColor, 2);
@@ -50,50 +62,69 @@ PlotWidget::PlotWidget(PlotType type, QWidget *parent)
 
 void PlotWidget::addDataPoint(const SensorData& data)
 {
-    m_data.append(data);
-    
-    // Keep only recent data for performance
-    if (m_data.size() > 10000) {
-        m_data.removeFirst();
-    }
-    
-    if (m_autoScale) {
-        calculateBounds();
-        updateScales();
+    if (m_plotType == ForceVsVelocity) {
+        // Binned incrementally; the raw samples are not kept
+        m_dampingCurve.addSample(data);
+    } else {
+        m_data.append(data);
+        
+        // Keep only recent data for performance
+        if (m_data.size() > 10000) {
+            m_data.removeFirst();
+        }
     }
+    m_cursorIndexValid = false;
     
-    update();
+    // Live samples arrive far faster than frames; the autoscaled bounds
+    // are recomputed once per repaint rather than once per sample
+    m_boundsStale = m_autoScale;
+    replot();
 }
 
 void PlotWidget::addDataSeries(const QVector<SensorData>& data, const QString& label)
 {
-    if (m_overlayMode) {
+    if (m_plotType == ForceVsVelocity) {
+        m_dampingCurve.clear();
+        m_dampingCurve.addSamples(data);
+    } else if (m_overlayMode) {
         m_overlaySeries.append(data);
         m_overlayLabels.append(label);
     } else {
         m_data = data;
     }
+    m_cursorIndexValid = false;
     
     if (m_autoScale) {
         calculateBounds();
         updateScales();
     }
     
-    update();
+    replot();
 }
 
 void PlotWidget::clearData()
 {
     m_data.clear();
+    m_dampingCurve.clear();
+    m_curve.clear();
+    m_family.clear();
+    m_familyLabels.clear();
+    m_spectrogramFrames.clear();
+    m_spectrogramImage = QImage();
+    m_spectrogramHead = 0;
+    m_spectrogramCount = 0;
+    m_spectrogramEndTime = 0;
     m_overlaySeries.clear();
     m_overlayLabels.clear();
-    update();
+    m_cursorIndexValid = false;
+    clearCursors();
+    replot();
 }
 
 void PlotWidget::setTimeWindow(double seconds)
 {
     m_timeWindow = seconds;
-    update();
+    replot();
 }
 
 void PlotWidget::setAutoScale(bool enable)
@@ -102,53 +133,293 @@ void PlotWidget::setAutoScale(bool enable)
     if (enable) {
         calculateBounds();
         updateScales();
-        update();
+        replot();
     }
 }
 
+void PlotWidget::setVelocityBinWidth(double binWidth)
+{
+    // Changing the width discards the bins; callers re-feed their data
+    m_dampingCurve.setBinWidth(binWidth);
+    replot();
+}
+
+void PlotWidget::setCurveData(const QVector<QPointF>& curve, const QString& label)
+{
+    m_curve = curve;
+    m_curveLabel = label;
+    m_cursorIndexValid = false;
+    
+    if (m_autoScale) {
+        calculateBounds();
+        updateScales();
+    }
+    
+    replot();
+}
+
+void PlotWidget::setCurveFamily(const QVector<QVector<QPointF>>& curves, const QStringList& labels,
+                                bool normalized)
+{
+    m_family = curves;
+    m_familyLabels = labels;
+    m_familyNormalized = normalized;
+    
+    if (m_autoScale) {
+        calculateBounds();
+        updateScales();
+    }
+    
+    replot();
+}
+
+QColor PlotWidget::seriesColor(int index)
+{
+    // Golden-angle hue steps never repeat and keep neighbours far apart
+    double hue = std::fmod(0.6 + index * 0.381966, 1.0);
+    return QColor::fromHsvF(hue, 0.75, 0.85);
+}
+
+QColor PlotWidget::familyColor(int index, int count)
+{
+    // Stop short of the pale yellow end, which vanishes on the background
+    double t = count > 1 ? 0.9 * index / (count - 1) : 0.0;
+    return getViridisColor(t, 0.0, 1.0);
+}
+
+void PlotWidget::addCurvePoint(const QPointF& point)
+{
+    m_curve.append(point);
+    m_cursorIndexValid = false;
+    m_boundsStale = m_autoScale;
+    replot();
+}
+
+void PlotWidget::setCurveLabel(const QString& label)
+{
+    m_curveLabel = label;
+    replot();
+}
+
+void PlotWidget::setSpectrogram(const QVector<QVector<float>>& frames, double frameInterval, double maxFrequency)
+{
+    clearData();
+    if (frames.isEmpty()) {
+        replot();
+        return;
+    }
+    
+    // Long recordings are max-pooled down to a drawable number of columns
+    const int maxColumns = SPECTROGRAM_COLUMNS * 4;
+    const int stride = (frames.size() + maxColumns - 1) / maxColumns;
+    const int columns = (frames.size() + stride - 1) / stride;
+    const int bins = frames.first().size();
+    
+    resetSpectrogram(columns, bins);
+    m_spectrogramInterval = frameInterval * stride;
+    m_spectrogramMaxFrequency = maxFrequency;
+    
+    for (int column = 0; column < columns; ++column) {
+        QVector<float> pooled = frames[column * stride];
+        for (int j = column * stride + 1; j < qMin(int(frames.size()), (column + 1) * stride); ++j) {
+            for (int k = 0; k < bins && k < frames[j].size(); ++k) {
+                pooled[k] = qMax(pooled[k], frames[j][k]);
+            }
+        }
+        for (float value : pooled) {
+            m_spectrogramTopDb = qMax(m_spectrogramTopDb, double(value));
+        }
+        m_spectrogramFrames[column] = pooled;
+    }
+    m_spectrogramCount = columns;
+    m_spectrogramHead = 0;
+    m_spectrogramEndTime = frames.size() * frameInterval;
+    
+    repaintSpectrogramImage();
+    
+    if (m_autoScale) {
+        calculateBounds();
+        updateScales();
+    }
+    
+    replot();
+}
+
+void PlotWidget::addSpectrogramFrame(const QVector<float>& frame, double frameInterval, double maxFrequency)
+{
+    if (frame.isEmpty()) {
+        return;
+    }
+    
+    if (m_spectrogramImage.isNull() || m_spectrogramImage.height() != frame.size()
+        || m_spectrogramMaxFrequency != maxFrequency) {
+        resetSpectrogram(SPECTROGRAM_COLUMNS, frame.size());
+        m_spectrogramMaxFrequency = maxFrequency;
+        m_spectrogramEndTime = 0;
+    }
+    m_spectrogramInterval = frameInterval;
+    
+    int column = m_spectrogramHead;
+    m_spectrogramFrames[column] = frame;
+    m_spectrogramHead = (m_spectrogramHead + 1) % m_spectrogramFrames.size();
+    m_spectrogramCount = qMin(m_spectrogramCount + 1, int(m_spectrogramFrames.size()));
+    m_spectrogramEndTime += frameInterval;
+    
+    // Only the new column is coloured unless the dB range has to move
+    float frameMax = *std::max_element(frame.begin(), frame.end());
+    if (m_spectrogramCount == 1 || frameMax > m_spectrogramTopDb + 6.0) {
+        m_spectrogramTopDb = frameMax;
+        repaintSpectrogramImage();
+    } else {
+        paintSpectrogramColumn(column);
+    }
+    
+    m_boundsStale = m_autoScale;
+    replot();
+}
+
+void PlotWidget::resetSpectrogram(int columns, int bins)
+{
+    m_spectrogramFrames = QVector<QVector<float>>(columns);
+    m_spectrogramImage = QImage(columns, bins, QImage::Format_RGB32);
+    m_spectrogramImage.fill(m_backgroundColor);
+    m_spectrogramHead = 0;
+    m_spectrogramCount = 0;
+    m_spectrogramTopDb = -1e30;
+}
+
+void PlotWidget::paintSpectrogramColumn(int column)
+{
+    const QVector<float>& frame = m_spectrogramFrames[column];
+    const int bins = m_spectrogramImage.height();
+    const double bottomDb = m_spectrogramTopDb - SPECTROGRAM_RANGE_DB;
+    
+    // Low frequencies at the bottom of the image
+    for (int k = 0; k < bins; ++k) {
+        QRgb color = k < frame.size()
+            ? getViridisColor(frame[k], bottomDb, m_spectrogramTopDb).rgb()
+            : m_backgroundColor.rgb();
+        m_spectrogramImage.setPixel(column, bins - 1 - k, color);
+    }
+}
+
+void PlotWidget::repaintSpectrogramImage()
+{
+    for (int column = 0; column < m_spectrogramFrames.size(); ++column) {
+        paintSpectrogramColumn(column);
+    }
+}
+
+void PlotWidget::setChannel(const SensorChannel& channel)
+{
+    m_channel = channel;
+    m_cursorIndexValid = false;
+    clearCursors();
+    if (m_autoScale) {
+        calculateBounds();
+        updateScales();
+    }
+    replot();
+}
+
+bool PlotWidget::isCurvePlot() const
+{
+    return m_plotType == EnergyVsTime || m_plotType == CumulativeEnergyVsTime
+        || m_plotType == PowerSpectrum || m_plotType == Residual;
+}
+
+bool PlotWidget::hasCursors() const
+{
+    // Damping curves and the spectrogram are drawn from bins and images,
+    // not from points a cursor could snap to
+    return m_plotType != ForceVsVelocity && m_plotType != Spectrogram && m_plotType != DampingFamily;
+}
+
+bool PlotWidget::hasTimeAxis() const
+{
+    return m_plotType != ForceVsPosition && m_plotType != ForceVsVelocity && m_plotType != PowerSpectrum
+        && m_plotType != DampingFamily;
+}
+
 void PlotWidget::setGridVisible(bool visible)
 {
     m_gridVisible = visible;
-    update();
+    replot();
 }
 
 void PlotWidget::setOverlayMode(bool enable)
 {
     m_overlayMode = enable;
-    update();
+    replot();
 }
 
 void PlotWidget::setPolarMode(bool enable)
 {
     m_polarMode = enable;
-    update();
+    m_cursorIndexValid = false;
+    clearCursors();
+    replot();
 }
 
 void PlotWidget::addOverlayData(const QVector<SensorData>& data, const QString& label)
 {
     m_overlaySeries.append(data);
     m_overlayLabels.append(label);
+    m_cursorIndexValid = false;
     
     if (m_autoScale) {
         calculateBounds();
         updateScales();
     }
     
-    update();
+    replot();
 }
 
 void PlotWidget::clearOverlayData()
 {
     m_overlaySeries.clear();
     m_overlayLabels.clear();
-    update();
+    m_cursorIndexValid = false;
+    replot();
+}
+
+void PlotWidget::clearCursors()
+{
+    m_hoverCursor = Cursor();
+    m_cursors[0] = Cursor();
+    m_cursors[1] = Cursor();
+    updateCursors();
 }
 
 void PlotWidget::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event)
+    SHOCKEE_TRACE_SCOPE("paint", "PlotWidget::paintEvent");
+    
+    refreshBounds();
+    
+    // When only the cursors moved the last rendered plot is reused, so
+    // hovering costs a blit and a few lines however many samples are plotted
+    const qreal ratio = devicePixelRatioF();
+    const QSize cacheSize = size() * ratio;
+    if (!m_cursorRepaint || !m_plotCacheValid || m_plotCache.size() != cacheSize) {
+        if (m_plotCache.size() != cacheSize) {
+            m_plotCache = QPixmap(cacheSize);
+            m_plotCache.setDevicePixelRatio(ratio);
+        }
+        QPainter cachePainter(&m_plotCache);
+        drawPlot(cachePainter);
+        m_plotCacheValid = true;
+    }
+    m_cursorRepaint = false;
     
     QPainter painter(this);
+    painter.drawPixmap(0, 0, m_plotCache);
+    drawCursors(painter);
+}
+
+void PlotWidget::drawPlot(QPainter& painter)
+{
     painter.setRenderHint(QPainter::Antialiasing);
     
     // Fill background
@@ -185,9 +456,19 @@ void PlotWidget::paintEvent(QPaintEvent *event)
     drawTitle(painter);
     
     // Draw legend if needed
-    if ((m_overlayMode && !m_overlayLabels.isEmpty()) || (m_polarMode && m_plotType == Comparison)) {
+    if ((m_overlayMode && !m_overlayLabels.isEmpty()) || (m_polarMode && m_plotType == Comparison)
+        || (m_plotType == ForceVsVelocity && !m_dampingCurve.isEmpty())
+        || (isCurvePlot() && !m_curveLabel.isEmpty())
+        || (m_plotType == Spectrogram && m_spectrogramCount > 0)
+        || (m_plotType == DampingFamily && !m_family.isEmpty())) {
         drawLegend(painter);
     }
+    
+    // Wire-to-screen latency of the newest live sample, once per sample
+    if (!m_data.isEmpty() && m_data.last().receivedAt > m_lastPaintedReceivedAt) {
+        m_lastPaintedReceivedAt = m_data.last().receivedAt;
+        LatencyMonitor::instance().record(LatencyMonitor::Painted, m_lastPaintedReceivedAt);
+    }
 }
 
 void PlotWidget::drawAxes(QPainter& painter)
@@ -222,6 +503,26 @@ void PlotWidget::drawGrid(QPainter& painter)
 
 void PlotWidget::drawData(QPainter& painter)
 {
+    if (m_plotType == ForceVsVelocity) {
+        drawDampingCurve(painter);
+        return;
+    }
+    
+    if (isCurvePlot()) {
+        drawCurve(painter);
+        return;
+    }
+    
+    if (m_plotType == Spectrogram) {
+        drawSpectrogram(painter);
+        return;
+    }
+    
+    if (m_plotType == DampingFamily) {
+        drawCurveFamily(painter);
+        return;
+    }
+    
     if (m_data.isEmpty() && m_overlaySeries.isEmpty()) {
         return;
     }
@@ -234,13 +535,138 @@ void PlotWidget::drawData(QPainter& painter)
     
     // Draw overlay series
     for (int i = 0; i < m_overlaySeries.size(); ++i) {
-        QColor color = m_overlayColors[i % m_overlayColors.size()];
+        QColor color = seriesColor(i);
         QPen pen(color, 2);
         painter.setPen(pen);
         drawDataSeries(painter, m_overlaySeries[i], color);
     }
 }
 
+void PlotWidget::drawCurve(QPainter& painter)
+{
+    if (m_curve.isEmpty()) {
+        return;
+    }
+    
+    QPainterPath path;
+    path.moveTo(dataToScreen(m_curve.first().x(), m_curve.first().y()));
+    for (int i = 1; i < m_curve.size(); ++i) {
+        path.lineTo(dataToScreen(m_curve[i].x(), m_curve[i].y()));
+    }
+    
+    painter.setPen(m_dataPen);
+    painter.setBrush(Qt::NoBrush);
+    painter.drawPath(path);
+    
+    // Markers only while they stay distinguishable
+    if (m_curve.size() <= m_plotArea.width() / 4) {
+        painter.setBrush(QBrush(m_dataColor));
+        for (const QPointF& point : m_curve) {
+            painter.drawEllipse(dataToScreen(point.x(), point.y()), 2.5, 2.5);
+        }
+        painter.setBrush(Qt::NoBrush);
+    }
+}
+
+void PlotWidget::drawCurveFamily(QPainter& painter)
+{
+    for (int i = 0; i < m_family.size(); ++i) {
+        const QVector<QPointF>& curve = m_family[i];
+        if (curve.isEmpty()) {
+            continue;
+        }
+        
+        QPainterPath path;
+        path.moveTo(dataToScreen(curve.first().x(), curve.first().y()));
+        for (int k = 1; k < curve.size(); ++k) {
+            path.lineTo(dataToScreen(curve[k].x(), curve[k].y()));
+        }
+        
+        painter.setPen(QPen(familyColor(i, m_family.size()), 2));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawPath(path);
+    }
+}
+
+void PlotWidget::drawSpectrogram(QPainter& painter)
+{
+    if (m_spectrogramCount == 0) {
+        return;
+    }
+    
+    const int capacity = m_spectrogramFrames.size();
+    const int height = m_spectrogramImage.height();
+    const int oldest = m_spectrogramCount < capacity ? 0 : m_spectrogramHead;
+    const double startTime = m_spectrogramEndTime - m_spectrogramCount * m_spectrogramInterval;
+    
+    painter.save();
+    painter.setClipRect(m_plotArea);
+    
+    // The ring may wrap, in which case it is drawn as two strips
+    int firstColumns = qMin(m_spectrogramCount, capacity - oldest);
+    double splitTime = startTime + firstColumns * m_spectrogramInterval;
+    painter.drawImage(QRectF(dataToScreen(startTime, m_spectrogramMaxFrequency), dataToScreen(splitTime, 0)),
+                      m_spectrogramImage, QRectF(oldest, 0, firstColumns, height));
+    
+    int secondColumns = m_spectrogramCount - firstColumns;
+    if (secondColumns > 0) {
+        painter.drawImage(QRectF(dataToScreen(splitTime, m_spectrogramMaxFrequency),
+                                 dataToScreen(m_spectrogramEndTime, 0)),
+                          m_spectrogramImage, QRectF(0, 0, secondColumns, height));
+    }
+    
+    painter.restore();
+}
+
+void PlotWidget::drawDampingCurve(QPainter& painter)
+{
+    if (m_dampingCurve.isEmpty()) {
+        return;
+    }
+    
+    // Zero-velocity reference line separating rebound from compression
+    if (m_minX < 0 && m_maxX > 0) {
+        painter.setPen(QPen(m_axisColor, 1, Qt::DashLine));
+        painter.drawLine(dataToScreen(0, m_minY), dataToScreen(0, m_maxY));
+    }
+    
+    drawDampingSeries(painter, m_dampingCurve.compressionCurve(), m_dataColor);
+    drawDampingSeries(painter, m_dampingCurve.reboundCurve(), m_reboundColor);
+}
+
+void PlotWidget::drawDampingSeries(QPainter& painter, const QVector<DampingBin>& curve, const QColor& color)
+{
+    if (curve.isEmpty()) return;
+    
+    // Standard deviation whiskers
+    QColor whiskerColor = color;
+    whiskerColor.setAlphaF(0.4);
+    painter.setPen(QPen(whiskerColor, 1));
+    for (const DampingBin& bin : curve) {
+        if (bin.stdDevForce > 0) {
+            painter.drawLine(dataToScreen(bin.velocity, bin.meanForce - bin.stdDevForce),
+                             dataToScreen(bin.velocity, bin.meanForce + bin.stdDevForce));
+        }
+    }
+    
+    // Mean force curve
+    QPainterPath path;
+    path.moveTo(dataToScreen(curve.first().velocity, curve.first().meanForce));
+    for (int i = 1; i < curve.size(); ++i) {
+        path.lineTo(dataToScreen(curve[i].velocity, curve[i].meanForce));
+    }
+    
+    painter.setPen(QPen(color, 2));
+    painter.setBrush(Qt::NoBrush);
+    painter.drawPath(path);
+    
+    painter.setBrush(QBrush(color));
+    for (const DampingBin& bin : curve) {
+        painter.drawEllipse(dataToScreen(bin.velocity, bin.meanForce), 2.5, 2.5);
+    }
+    painter.setBrush(Qt::NoBrush);
+}
+
 void PlotWidget::drawPolarData(QPainter& painter)
 {
     if (m_data.isEmpty() && m_overlaySeries.isEmpty()) {
@@ -392,53 +818,78 @@ void PlotWidget::drawPolarLabels(QPainter& painter)
     }
 }
 
+template <typename Visitor>
+void PlotWidget::visitSampleAxes(Visitor&& visitor) const
+{
+    SensorTimeReader time;
+    SensorMemberReader<double, &SensorData::position> position;
+    SensorMemberReader<double, &SensorData::force> force;
+    
+    switch (m_plotType) {
+        case Position:
+        case Comparison:
+            visitor(time, position);
+            break;
+        case Force:
+            visitor(time, force);
+            break;
+        case Encoder:
+            visitor(time, SensorMemberReader<long, &SensorData::encoderPulses>());
+            break;
+        case ForceVsPosition:
+            visitor(position, force);
+            break;
+        case ForceVsVelocity:
+            visitor(SensorMemberReader<double, &SensorData::velocity>(), force);
+            break;
+        case ChannelSeries:
+            visitChannel(m_channel, [&](auto read) { visitor(time, read); });
+            break;
+        case EnergyVsTime:
+        case CumulativeEnergyVsTime:
+        case PowerSpectrum:
+        case Spectrogram:
+        case Residual:
+        case DampingFamily:
+            // Drawn from derived results, not from samples
+            break;
+    }
+}
+
 void PlotWidget::drawDataSeries(QPainter& painter, const QVector<SensorData>& data, const QColor& color)
 {
     if (data.size() < 2) return;
     
+    if (m_polarMode && m_plotType == Comparison) {
+        // For polar mode, we handle this in drawPolarDataSeries
+        return;
+    }
+    
     QPainterPath path;
-    bool firstPoint = true;
     
-    for (const SensorData& point : data) {
-        double x, y;
-        
-        switch (m_plotType) {
-            case Position:
-                x = point.timestamp / 1000.0; // Convert to seconds
-                y = point.position;
-                break;
-            case Force:
-                x = point.timestamp / 1000.0;
-                y = point.force;
-                break;
-            case Encoder:
-                x = point.timestamp / 1000.0;
-                y = point.encoderPulses;
-                break;
-            case ForceVsPosition:
-                x = point.position;
-                y = point.force;
-                break;
-            case Comparison:
-                if (m_polarMode) {
-                    // For polar mode, we handle this in drawPolarDataSeries
-                    return;
-                } else {
-                    x = point.timestamp / 1000.0;
-                    y = point.position;
-                }
-                break;
-        }
-        
-        QPointF screenPoint = dataToScreen(x, y);
-        
-        if (firstPoint) {
-            path.moveTo(screenPoint);
-            firstPoint = false;
-        } else {
-            path.lineTo(screenPoint);
+    // The readers are picked once per series, so this loop is generated for
+    // each channel's storage type instead of switching per sample
+    visitSampleAxes([&](auto readX, auto readY) {
+        bool firstPoint = true;
+        for (const SensorData& point : data) {
+            double x = readX(point);
+            double y = readY(point);
+            if (qIsNaN(x) || qIsNaN(y)) {
+                // Gap in a channel the sample did not carry
+                firstPoint = true;
+                continue;
+            }
+            
+            QPointF screenPoint = dataToScreen(x, y);
+            
+            if (firstPoint) {
+                path.moveTo(screenPoint);
+                firstPoint = false;
+            } else {
+                path.lineTo(screenPoint);
+            }
         }
-    }
+    });
     
     painter.drawPath(path);
 }
@@ -455,10 +906,10 @@ void PlotWidget::drawLabels(QPainter& painter)
         double screenX = m_plotArea.left() + (m_plotArea.width() * i) / numXLabels;
         
         QString label;
-        if (m_plotType == ForceVsPosition) {
-            label = QString::number(dataX, 'f', 1);
-        } else {
+        if (hasTimeAxis()) {
             label = QString::number(dataX, 'f', 1) + "s";
+        } else {
+            label = QString::number(dataX, 'f', 1);
         }
         
         QRectF textRect(screenX - 30, m_plotArea.bottom() + 5, 60, 20);
@@ -471,7 +922,7 @@ void PlotWidget::drawLabels(QPainter& painter)
         double dataY = m_minY + (m_maxY - m_minY) * (numYLabels - i) / numYLabels;
         double screenY = m_plotArea.top() + (m_plotArea.height() * i) / numYLabels;
         
-        QString label = QString::number(dataY, 'f', 1);
+        QString label = QString::number(dataY, 'f', (m_plotType == DampingFamily && m_familyNormalized) ? 2 : 1);
         
         QRectF textRect(5, screenY - 10, MARGIN - 10, 20);
         painter.drawText(textRect, Qt::AlignRight | Qt::AlignVCenter, label);
@@ -483,23 +934,44 @@ void PlotWidget::drawLabels(QPainter& painter)
         painter.translate(15, m_plotArea.center().y());
         painter.rotate(-90);
         
-        QString yTitle;
-        switch (m_plotType) {
-            case Position: yTitle = "Position (mm)"; break;
-            case Force: yTitle = "Force (kg)"; break;
-            case Encoder: yTitle = "Encoder (pulses)"; break;
-            case ForceVsPosition: yTitle = "Force (kg)"; break;
-            case Comparison: yTitle = "Position (mm)"; break;
-        }
-        
-        painter.drawText(-50, 0, 100, 20, Qt::AlignCenter, yTitle);
+        painter.drawText(-50, 0, 100, 20, Qt::AlignCenter, yAxisTitle());
         painter.restore();
         
         // X-axis title
-        QString xTitle = (m_plotType == ForceVsPosition) ? "Position (mm)" : "Time (s)";
         QRectF xTitleRect(m_plotArea.left(), height() - 25, m_plotArea.width(), 20);
-        painter.drawText(xTitleRect, Qt::AlignCenter, xTitle);
+        painter.drawText(xTitleRect, Qt::AlignCenter, xAxisTitle());
+    }
+}
+
+QString PlotWidget::xAxisTitle() const
+{
+    switch (m_plotType) {
+        case ForceVsPosition: return "Position (mm)";
+        case ForceVsVelocity: return "Velocity (mm/s)";
+        case DampingFamily: return "Velocity (mm/s)";
+        case PowerSpectrum: return "Frequency (Hz)";
+        default: return "Time (s)";
+    }
+}
+
+QString PlotWidget::yAxisTitle() const
+{
+    switch (m_plotType) {
+        case Position: return "Position (mm)";
+        case Force: return "Force (kg)";
+        case Encoder: return "Encoder (pulses)";
+        case ChannelSeries: return m_channel.label();
+        case ForceVsPosition: return "Force (kg)";
+        case Comparison: return "Position (mm)";
+        case ForceVsVelocity: return "Force (kg)";
+        case EnergyVsTime: return "Energy (J)";
+        case CumulativeEnergyVsTime: return "Energy (J)";
+        case PowerSpectrum: return "PSD (dB)";
+        case Spectrogram: return "Frequency (Hz)";
+        case Residual: return "Difference (mm)";
+        case DampingFamily: return m_familyNormalized ? "Force / Peak" : "Force (kg)";
     }
+    return QString();
 }
 
 void PlotWidget::drawLegend(QPainter& painter)
@@ -534,10 +1006,60 @@ void PlotWidget::drawLegend(QPainter& painter)
             painter.drawText(legendX, legendY, "Dataset 1: Viridis colors");
             painter.drawText(legendX, legendY + 15, "Dataset 2: Cividis colors");
         }
+    } else if (isCurvePlot()) {
+        painter.drawText(legendX, legendY + 9, m_curveLabel);
+    } else if (m_plotType == Spectrogram) {
+        // dB colour scale
+        double bottomDb = m_spectrogramTopDb - SPECTROGRAM_RANGE_DB;
+        QRectF colorBar(legendX, legendY, 200, 12);
+        QLinearGradient gradient(colorBar.topLeft(), colorBar.topRight());
+        for (int i = 0; i <= 10; ++i) {
+            double t = i / 10.0;
+            gradient.setColorAt(t, getViridisColor(bottomDb + t * SPECTROGRAM_RANGE_DB, bottomDb, m_spectrogramTopDb));
+        }
+        painter.fillRect(colorBar, gradient);
+        painter.drawRect(colorBar);
+        
+        QString rangeLabel = QString("%1 .. %2 dB").arg(bottomDb, 0, 'f', 0).arg(m_spectrogramTopDb, 0, 'f', 0);
+        painter.drawText(legendX + 210, legendY + 10, rangeLabel);
+    } else if (m_plotType == DampingFamily) {
+        // Colour ramp from the first to the last session
+        const int count = m_family.size();
+        QRectF colorBar(legendX, legendY, 200, 12);
+        QLinearGradient gradient(colorBar.topLeft(), colorBar.topRight());
+        for (int i = 0; i < count; ++i) {
+            gradient.setColorAt(count > 1 ? double(i) / (count - 1) : 0.0, familyColor(i, count));
+        }
+        painter.fillRect(colorBar, gradient);
+        painter.drawRect(colorBar);
+        
+        QString rangeLabel = count > 1
+            ? QString("%1 .. %2 (%3 sessions)").arg(m_familyLabels.value(0))
+                                               .arg(m_familyLabels.value(count - 1)).arg(count)
+            : m_familyLabels.value(0);
+        painter.drawText(legendX + 210, legendY + 10, rangeLabel);
+    } else if (m_plotType == ForceVsVelocity) {
+        // Compression/rebound key
+        const QString labels[] = { "Compression", "Rebound" };
+        const QColor colors[] = { m_dataColor, m_reboundColor };
+        for (int i = 0; i < 2; ++i) {
+            QRectF colorRect(legendX, legendY, 15, 10);
+            painter.fillRect(colorRect, colors[i]);
+            
+            QRectF textRect(legendX + 20, legendY - 5, 100, 20);
+            painter.drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter, labels[i]);
+            
+            legendX += 130;
+        }
+        
+        QString countLabel = QString("%1 samples, %2 mm/s bins")
+                           .arg(m_dampingCurve.sampleCount())
+                           .arg(m_dampingCurve.binWidth(), 0, 'f', 1);
+        painter.drawText(legendX, legendY + 9, countLabel);
     } else if (!m_overlayLabels.isEmpty()) {
         // Regular legend for overlay mode
         for (int i = 0; i < m_overlayLabels.size(); ++i) {
-            QColor color = m_overlayColors[i % m_overlayColors.size()];
+            QColor color = seriesColor(i);
             
             // Draw color indicator
             QRectF colorRect(legendX, legendY, 15, 10);
@@ -558,91 +1080,65 @@ void PlotWidget::drawLegend(QPainter& painter)
 
 void PlotWidget::calculateBounds()
 {
-    if (m_data.isEmpty() && m_overlaySeries.isEmpty()) {
-        return;
-    }
+    SHOCKEE_TRACE_SCOPE("paint", "PlotWidget::calculateBounds");
     
-    m_minX = m_maxX = m_minY = m_maxY = 0;
-    bool firstPoint = true;
-    
-    // Process main data
-    for (const SensorData& point : m_data) {
-        double x, y;
-        
-        switch (m_plotType) {
-            case Position:
-                x = point.timestamp / 1000.0;
-                y = point.position;
-                break;
-            case Force:
-                x = point.timestamp / 1000.0;
-                y = point.force;
-                break;
-            case Encoder:
-                x = point.timestamp / 1000.0;
-                y = point.encoderPulses;
-                break;
-            case ForceVsPosition:
-                x = point.position;
-                y = point.force;
-                break;
-            case Comparison:
-                x = point.timestamp / 1000.0;
-                y = point.position;
-                break;
-        }
-        
-        if (firstPoint) {
-            m_minX = m_maxX = x;
-            m_minY = m_maxY = y;
-            firstPoint = false;
-        } else {
-            m_minX = qMin(m_minX, x);
-            m_maxX = qMax(m_maxX, x);
-            m_minY = qMin(m_minY, y);
-            m_maxY = qMax(m_maxY, y);
+    if (m_plotType == ForceVsVelocity) {
+        if (m_dampingCurve.isEmpty()) {
+            return;
         }
-    }
-    
-    // Process overlay data
-    for (const QVector<SensorData>& series : m_overlaySeries) {
-        for (const SensorData& point : series) {
-            double x, y;
-            
-            switch (m_plotType) {
-                case Position:
-                    x = point.timestamp / 1000.0;
-                    y = point.position;
-                    break;
-                case Force:
-                    x = point.timestamp / 1000.0;
-                    y = point.force;
-                    break;
-                case Encoder:
-                    x = point.timestamp / 1000.0;
-                    y = point.encoderPulses;
-                    break;
-                case ForceVsPosition:
-                    x = point.position;
-                    y = point.force;
-                    break;
-                case Comparison:
-                    x = point.timestamp / 1000.0;
-                    y = point.position;
-                    break;
-            }
-            
-            if (firstPoint) {
-                m_minX = m_maxX = x;
-                m_minY = m_maxY = y;
-                firstPoint = false;
-            } else {
-                m_minX = qMin(m_minX, x);
-                m_maxX = qMax(m_maxX, x);
-                m_minY = qMin(m_minY, y);
-                m_maxY = qMax(m_maxY, y);
+        
+        // Bounds come from the bins, never from the raw samples
+        QRectF bounds = m_dampingCurve.bounds();
+        m_minX = bounds.left();
+        m_maxX = bounds.right();
+        m_minY = bounds.top();
+        m_maxY = bounds.bottom();
+    } else if (m_plotType == Spectrogram) {
+        if (m_spectrogramCount == 0) {
+            return;
+        }
+        
+        m_minX = m_spectrogramEndTime - m_spectrogramCount * m_spectrogramInterval;
+        m_maxX = m_spectrogramEndTime;
+        m_minY = 0;
+        m_maxY = m_spectrogramMaxFrequency;
+    } else if (m_plotType == DampingFamily) {
+        bool first = true;
+        for (const QVector<QPointF>& curve : m_family) {
+            for (const QPointF& point : curve) {
+                if (first) {
+                    m_minX = m_maxX = point.x();
+                    m_minY = m_maxY = point.y();
+                    first = false;
+                }
+                m_minX = qMin(m_minX, point.x());
+                m_maxX = qMax(m_maxX, point.x());
+                m_minY = qMin(m_minY, point.y());
+                m_maxY = qMax(m_maxY, point.y());
             }
         }
+        if (first) {
+            return;
+        }
+    } else if (isCurvePlot()) {
+        if (m_curve.isEmpty()) {
+            return;
+        }
+        
+        m_minX = m_maxX = m_curve.first().x();
+        m_minY = m_maxY = m_curve.first().y();
+        for (const QPointF& point : m_curve) {
+            m_minX = qMin(m_minX, point.x());
+            m_maxX = qMax(m_maxX, point.x());
+            m_minY = qMin(m_minY, point.y());
+            m_maxY = qMax(m_maxY, point.y());
+        }
+    } else {
+        if (m_data.isEmpty() && m_overlaySeries.isEmpty()) {
+            return;
+        }
+        
+        calculateDataBounds();
     }
     
     // Add some padding
@@ -665,6 +1161,43 @@ void PlotWidget::calculateBounds()
     }
 }
 
+void PlotWidget::calculateDataBounds()
+{
+    m_minX = m_maxX = m_minY = m_maxY = 0;
+    bool firstPoint = true;
+    
+    auto accumulate = [&](const QVector<SensorData>& series) {
+        visitSampleAxes([&](auto readX, auto readY) {
+            for (const SensorData& point : series) {
+                double x = readX(point);
+                double y = readY(point);
+                if (qIsNaN(x) || qIsNaN(y)) {
+                    continue;
+                }
+                
+                if (firstPoint) {
+                    m_minX = m_maxX = x;
+                    m_minY = m_maxY = y;
+                    firstPoint = false;
+                } else {
+                    m_minX = qMin(m_minX, x);
+                    m_maxX = qMax(m_maxX, x);
+                    m_minY = qMin(m_minY, y);
+                    m_maxY = qMax(m_maxY, y);
+                }
+            }
+        });
+    };
+    
+    // Process main data
+    accumulate(m_data);
+    
+    // Process overlay data
+    for (const QVector<SensorData>& series : m_overlaySeries) {
+        accumulate(series);
+    }
+}
+
 void PlotWidget::updateScales()
 {
     if (m_plotArea.width() > 0 && m_plotArea.height() > 0) {
@@ -687,17 +1220,160 @@ QPointF PlotWidget::screenToData(const QPointF& screen) const
     return QPointF(dataX, dataY);
 }
 
+void PlotWidget::refreshBounds()
+{
+    if (!m_boundsStale) {
+        return;
+    }
+    m_boundsStale = false;
+    if (m_autoScale) {
+        calculateBounds();
+        updateScales();
+    }
+}
+
+void PlotWidget::replot()
+{
+    m_plotCacheValid = false;
+    update();
+}
+
+void PlotWidget::updateCursors()
+{
+    m_cursorRepaint = true;
+    update();
+}
+
+QPointF PlotWidget::polarPoint(const SensorData& data)
+{
+    // As drawPolarDataSeries() places it, in units of the polar radius
+    double angle = (data.encoderPulses % 3600) * (2.0 * M_PI / 3600.0);
+    double radius = (data.position + 75.0) / 150.0;
+    return QPointF(radius * qCos(angle - M_PI_2), radius * qSin(angle - M_PI_2));
+}
+
+QVector<QPointF> PlotWidget::cursorPoints(const QVector<SensorData>& data) const
+{
+    QVector<QPointF> points;
+    points.reserve(data.size());
+    if (m_polarMode && m_plotType == Comparison) {
+        for (const SensorData& point : data) {
+            points.append(polarPoint(point));
+        }
+    } else {
+        visitSampleAxes([&](auto readX, auto readY) {
+            for (const SensorData& point : data) {
+                points.append(QPointF(readX(point), readY(point)));
+            }
+        });
+    }
+    return points;
+}
+
+void PlotWidget::buildCursorIndex()
+{
+    SHOCKEE_TRACE_SCOPE("paint", "PlotWidget::buildCursorIndex");
+    
+    m_cursorIndex.clear();
+    if (isCurvePlot()) {
+        m_cursorIndex.resize(1);
+        m_cursorIndex[0].build(m_curve);
+    } else {
+        m_cursorIndex.resize(1 + m_overlaySeries.size());
+        m_cursorIndex[0].build(cursorPoints(m_data));
+        for (int i = 0; i < m_overlaySeries.size(); ++i) {
+            m_cursorIndex[i + 1].build(cursorPoints(m_overlaySeries[i]));
+        }
+    }
+    m_cursorIndexValid = true;
+}
+
+PlotWidget::Cursor PlotWidget::nearestSample(const QPointF& screen)
+{
+    Cursor cursor;
+    const bool polar = m_polarMode && m_plotType == Comparison;
+    if (!hasCursors() || (polar && m_polarRadius <= 0)) {
+        return cursor;
+    }
+    if (!m_cursorIndexValid) {
+        buildCursorIndex();
+    }
+    refreshBounds();
+    
+    // Nearest on screen across every series, so scales are pixels per unit
+    QPointF target;
+    double scaleX, scaleY;
+    if (polar) {
+        target = (screen - m_polarCenter) / m_polarRadius;
+        scaleX = scaleY = m_polarRadius;
+    } else {
+        target = screenToData(screen);
+        scaleX = m_scaleX;
+        scaleY = m_scaleY;
+    }
+    
+    int bestIndex = -1;
+    double bestDistance = 0;
+    for (int series = 0; series < m_cursorIndex.size(); ++series) {
+        double distance;
+        int index = m_cursorIndex[series].nearest(target, scaleX, scaleY, &distance);
+        if (index >= 0 && (bestIndex < 0 || distance < bestDistance)) {
+            bestIndex = index;
+            bestDistance = distance;
+            cursor.series = series;
+        }
+    }
+    if (bestIndex < 0) {
+        return cursor;
+    }
+    
+    cursor.valid = true;
+    if (isCurvePlot()) {
+        cursor.value = m_curve[bestIndex];
+        return cursor;
+    }
+    
+    const SensorData& sample = cursor.series == 0 ? m_data[bestIndex] : m_overlaySeries[cursor.series - 1][bestIndex];
+    if (polar) {
+        cursor.value = QPointF((sample.encoderPulses % 3600) / 10.0, sample.position);
+        cursor.force = sample.force;
+    } else {
+        visitSampleAxes([&](auto readX, auto readY) {
+            cursor.value = QPointF(readX(sample), readY(sample));
+        });
+    }
+    return cursor;
+}
+
+QPointF PlotWidget::cursorToScreen(const Cursor& cursor) const
+{
+    if (m_polarMode && m_plotType == Comparison) {
+        double angle = qDegreesToRadians(cursor.value.x());
+        double radius = (cursor.value.y() + 75.0) / 150.0 * m_polarRadius;
+        return m_polarCenter + QPointF(radius * qCos(angle - M_PI_2), radius * qSin(angle - M_PI_2));
+    }
+    return dataToScreen(cursor.value.x(), cursor.value.y());
+}
+
 void PlotWidget::mousePressEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton) {
         m_isDragging = true;
         m_lastMousePos = event->position();
     }
+    m_pressPos = event->position();
+    m_cursorClick = true;
 }
 
 void PlotWidget::mouseMoveEvent(QMouseEvent *event)
 {
+    if (event->buttons() != Qt::NoButton
+        && (event->position() - m_pressPos).manhattanLength() >= CLICK_DISTANCE) {
+        m_cursorClick = false;
+    }
+    
     if (m_isDragging) {
+        refreshBounds();
         QPointF delta = event->position() - m_lastMousePos;
         
         // Pan the view
@@ -710,9 +1386,14 @@ void PlotWidget::mouseMoveEvent(QMouseEvent *event)
         m_maxY += deltaY;
         
         updateScales();
-        update();
+        replot();
         
         m_lastMousePos = event->position();
+    } else if (hasCursors()) {
+        // Only the cursors repaint, and the lookup is a bisection or a
+        // k-d tree search, so hover stays smooth on whole sessions
+        m_hoverCursor = m_plotArea.contains(event->position()) ? nearestSample(event->position()) : Cursor();
+        updateCursors();
     }
 }
 
@@ -721,6 +1402,32 @@ void PlotWidget::mouseReleaseEvent(QMouseEvent *event)
     if (event->button() == Qt::LeftButton) {
         m_isDragging = false;
     }
+    
+    // A click that did not pan places cursor A (left) or B (right)
+    if (m_cursorClick && hasCursors()
+        && (event->button() == Qt::LeftButton || event->button() == Qt::RightButton)) {
+        m_cursors[event->button() == Qt::LeftButton ? 0 : 1] = nearestSample(event->position());
+        updateCursors();
+    }
+    m_cursorClick = false;
+}
+
+void PlotWidget::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    // Qt sends this in place of the second press; its release must not
+    // place a cursor again
+    mousePressEvent(event);
+    m_cursorClick = false;
+    if (event->button() == Qt::LeftButton) {
+        clearCursors();
+    }
+}
+
+void PlotWidget::leaveEvent(QEvent *event)
+{
+    QWidget::leaveEvent(event);
+    m_hoverCursor = Cursor();
+    updateCursors();
 }
 
 void PlotWidget::wheelEvent(QWheelEvent *event)
@@ -730,6 +1437,7 @@ void PlotWidget::wheelEvent(QWheelEvent *event)
         scaleFactor = 1.0 / scaleFactor;
     }
     
+    refreshBounds();
     QPointF mousePos = event->position();
     QPointF dataPos = screenToData(mousePos);
     
@@ -746,7 +1454,7 @@ void PlotWidget::wheelEvent(QWheelEvent *event)
     m_maxY = dataPos.y() + newRangeY * (m_maxY - dataPos.y()) / rangeY;
     
     updateScales();
-    update();
+    replot();
 }
 
 void PlotWidget::drawTitle(QPainter& painter)
@@ -762,7 +1470,15 @@ void PlotWidget::drawTitle(QPainter& painter)
         case Position: title = "Position vs Time"; break;
         case Force: title = "Force vs Time"; break;
         case Encoder: title = "Encoder vs Time"; break;
+        case ChannelSeries: title = m_channel.title() + " vs Time"; break;
         case ForceVsPosition: title = "Force vs Position"; break;
+        case ForceVsVelocity: title = "Force vs Velocity (Damping Curve)"; break;
+        case EnergyVsTime: title = "Energy Dissipated per Cycle"; break;
+        case CumulativeEnergyVsTime: title = "Cumulative Energy Dissipated"; break;
+        case PowerSpectrum: title = "Power Spectral Density (Welch)"; break;
+        case Spectrogram: title = "Spectrogram"; break;
+        case Residual: title = "Position Residual (Reference - Comparison)"; break;
+        case DampingFamily: title = "Damping Curves by Session"; break;
         case Comparison:
             if (m_polarMode) {
                 title = "Polar Comparison - Encoder Angle vs Stroke Length (Force Colored)";
@@ -776,7 +1492,146 @@ void PlotWidget::drawTitle(QPainter& painter)
     painter.drawText(titleRect, Qt::AlignCenter, title);
 }
 
-QColor PlotWidget::getViridisColor(double value, double minValue, double maxValue) const
+void PlotWidget::drawCursors(QPainter& painter)
+{
+    if (!hasCursors()) {
+        return;
+    }
+    
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setFont(m_labelFont);
+    
+    for (int i = 0; i < 2; ++i) {
+        if (m_cursors[i].valid) {
+            drawCursorLines(painter, m_cursors[i], m_cursorColors[i], Qt::SolidLine);
+        }
+    }
+    if (m_hoverCursor.valid) {
+        drawCursorLines(painter, m_hoverCursor, m_axisColor, Qt::DashLine);
+        drawReadout(painter, cursorToScreen(m_hoverCursor), cursorReadout(m_hoverCursor), m_axisColor);
+    }
+    
+    // Placed cursors are read out in the top corners, with the delta beside
+    // B once both are down
+    if (m_cursors[0].valid) {
+        QStringList lines = cursorReadout(m_cursors[0]);
+        lines.prepend("A");
+        drawReadout(painter, m_plotArea.topLeft(), lines, m_cursorColors[0]);
+    }
+    if (m_cursors[1].valid) {
+        QStringList lines = cursorReadout(m_cursors[1]);
+        lines.prepend("B");
+        if (m_cursors[0].valid) {
+            lines << "B - A" << deltaReadout(m_cursors[0], m_cursors[1]);
+        }
+        drawReadout(painter, m_plotArea.topRight(), lines, m_cursorColors[1]);
+    }
+    
+    painter.restore();
+}
+
+void PlotWidget::drawCursorLines(QPainter& painter, const Cursor& cursor, const QColor& color, Qt::PenStyle style)
+{
+    const QPointF point = cursorToScreen(cursor);
+    painter.setPen(QPen(color, 1, style));
+    painter.setBrush(Qt::NoBrush);
+    
+    if (m_polarMode && m_plotType == Comparison) {
+        // Stroke circle and angle spoke through the sample
+        QPointF offset = point - m_polarCenter;
+        double radius = qSqrt(QPointF::dotProduct(offset, offset));
+        painter.drawEllipse(m_polarCenter, radius, radius);
+        if (radius > 0) {
+            painter.drawLine(m_polarCenter, m_polarCenter + offset * (m_polarRadius * 1.05 / radius));
+        }
+    } else {
+        painter.save();
+        painter.setClipRect(m_plotArea);
+        painter.drawLine(QPointF(point.x(), m_plotArea.top()), QPointF(point.x(), m_plotArea.bottom()));
+        painter.drawLine(QPointF(m_plotArea.left(), point.y()), QPointF(m_plotArea.right(), point.y()));
+        painter.restore();
+    }
+    
+    painter.setPen(QPen(color, 2));
+    painter.drawEllipse(point, 4, 4);
+}
+
+void PlotWidget::drawReadout(QPainter& painter, const QPointF& anchor, const QStringList& lines, const QColor& color)
+{
+    const QFontMetrics metrics(m_labelFont);
+    int textWidth = 0;
+    for (const QString& line : lines) {
+        textWidth = qMax(textWidth, metrics.horizontalAdvance(line));
+    }
+    
+    // Below and right of the anchor, flipped to its left where that would
+    // leave the plot area, and kept inside the widget
+    const double offset = 10;
+    QRectF box(0, 0, textWidth + 12, lines.size() * metrics.height() + 8);
+    box.moveTopLeft(anchor + QPointF(offset, offset));
+    if (box.right() > m_plotArea.right()) {
+        box.moveRight(anchor.x() - offset);
+    }
+    box.moveBottom(qMin(box.bottom(), double(height() - 1)));
+    box.moveLeft(qMax(box.left(), 0.0));
+    
+    QColor fill = m_backgroundColor;
+    fill.setAlpha(230);
+    painter.setPen(QPen(color, 1));
+    painter.setBrush(fill);
+    painter.drawRect(box);
+    
+    painter.setPen(m_axisColor);
+    for (int i = 0; i < lines.size(); ++i) {
+        QRectF lineRect(box.left() + 6, box.top() + 4 + i * metrics.height(), textWidth, metrics.height());
+        painter.drawText(lineRect, Qt::AlignLeft | Qt::AlignVCenter, lines[i]);
+    }
+}
+
+QStringList PlotWidget::cursorReadout(const Cursor& cursor) const
+{
+    QStringList lines;
+    if (cursor.series > 0 && cursor.series <= m_overlayLabels.size() && !m_overlayLabels[cursor.series - 1].isEmpty()) {
+        lines << m_overlayLabels[cursor.series - 1];
+    }
+    if (m_polarMode && m_plotType == Comparison) {
+        lines << QString("Angle: %1°").arg(cursor.value.x(), 0, 'f', 1)
+              << QString("Position: %1 mm").arg(cursor.value.y(), 0, 'g', 6)
+              << QString("Force: %1 kg").arg(cursor.force, 0, 'g', 6);
+    } else {
+        lines << QString("%1: %2").arg(xAxisTitle()).arg(cursor.value.x(), 0, 'g', 6)
+              << QString("%1: %2").arg(yAxisTitle()).arg(cursor.value.y(), 0, 'g', 6);
+    }
+    return lines;
+}
+
+QStringList PlotWidget::deltaReadout(const Cursor& a, const Cursor& b) const
+{
+    const double dx = b.value.x() - a.value.x();
+    const double dy = b.value.y() - a.value.y();
+    
+    QStringList lines;
+    if (m_polarMode && m_plotType == Comparison) {
+        lines << QString("ΔAngle: %1°").arg(dx, 0, 'f', 1)
+              << QString("ΔPosition: %1 mm").arg(dy, 0, 'g', 6)
+              << QString("ΔForce: %1 kg").arg(b.force - a.force, 0, 'g', 6);
+        return lines;
+    }
+    
+    lines << QString("Δ%1: %2").arg(xAxisTitle()).arg(dx, 0, 'g', 6)
+          << QString("Δ%1: %2").arg(yAxisTitle()).arg(dy, 0, 'g', 6);
+    if (dx != 0) {
+        // Stiffness on force-vs-position plots, a rate on time plots
+        lines << QString("Slope: %1").arg(dy / dx, 0, 'g', 6);
+        if (hasTimeAxis()) {
+            lines << QString("1/Δt: %1 Hz").arg(1.0 / qAbs(dx), 0, 'g', 6);
+        }
+    }
+    return lines;
+}
+
+QColor PlotWidget::getViridisColor(double value, double minValue, double maxValue)
 {
     if (maxValue <= minValue) return QColor(68, 1, 84);
     
@@ -17,9 +17,14 @@
 #include <QLinearGradient>
 #include <QRadialGradient>
 #include <QConicalGradient>
+#include <QImage>
+#include <QPixmap>
 #include <QtMath>
 
-#include "serialcommunicator.h"
+#include "sensordata.h"
+#include "dampinganalyzer.h"
+#include "channelschema.h"
+#include "pointindex.h"
 
 class PlotWidget : public QWidget
 {
@@ -31,7 +36,15 @@ public:
         Force,
         Encoder,
         ForceVsPosition,
-        Comparison
+        Comparison,
+        ForceVsVelocity,
+        EnergyVsTime,
+        CumulativeEnergyVsTime,
+        PowerSpectrum,
+        Spectrogram,
+        Residual,
+        DampingFamily,
+        ChannelSeries   // any schema channel against time, see setChannel()
     };
 
     explicit PlotWidget(PlotType type, QWidget *parent = nullptr);
@@ -46,24 +59,75 @@ public:
     void exportToPdf(const QString& filename);
     void exportToPng(const QString& filename);
     
+    // For channel series plots
+    void setChannel(const SensorChannel& channel);
+    const SensorChannel& channel() const { return m_channel; }
+    
+    // For force vs velocity plots
+    void setVelocityBinWidth(double binWidth);
+    
+    // For derived-result plots (energy, spectra, ...) drawn from a point curve
+    void setCurveData(const QVector<QPointF>& curve, const QString& label = "");
+    void addCurvePoint(const QPointF& point);
+    void setCurveLabel(const QString& label);
+    
+    // For spectrogram plots; frames are power spectra in dB, 0 .. maxFrequency
+    void setSpectrogram(const QVector<QVector<float>>& frames, double frameInterval, double maxFrequency);
+    void addSpectrogramFrame(const QVector<float>& frame, double frameInterval, double maxFrequency);
+    
+    // For damping curve families; one force-vs-velocity curve per session
+    void setCurveFamily(const QVector<QVector<QPointF>>& curves, const QStringList& labels,
+                        bool normalized = false);
+    
+    // Distinct colour per overlay series, stable as series are added
+    static QColor seriesColor(int index);
+    // Ordered colour ramp for curve families; index 0 .. count - 1
+    static QColor familyColor(int index, int count);
+    
     // For comparison plots
     void setOverlayMode(bool enable);
     void addOverlayData(const QVector<SensorData>& data, const QString& label);
     void clearOverlayData();
+    
+    // Measurement cursors: hovering shows the nearest sample, a left click
+    // places cursor A and a right click cursor B, double-click clears both
+    void clearCursors();
 
 protected:
     void paintEvent(QPaintEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
     void wheelEvent(QWheelEvent *event) override;
+    void leaveEvent(QEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
 
 private:
+    // A cursor snapped to a plotted sample, in axis units; polar plots hold
+    // the encoder angle in degrees and the position, with the force
+    struct Cursor {
+        bool valid;
+        QPointF value;
+        double force;
+        int series;     // 0 for the main series or curve, then the overlays
+        
+        Cursor() : valid(false), force(0), series(0) {}
+    };
+    
+    void drawPlot(QPainter& painter);
     void drawAxes(QPainter& painter);
     void drawGrid(QPainter& painter);
     void drawData(QPainter& painter);
     void drawDataSeries(QPainter& painter, const QVector<SensorData>& data, const QColor& color);
+    void drawCurve(QPainter& painter);
+    void drawCurveFamily(QPainter& painter);
+    void drawSpectrogram(QPainter& painter);
+    void resetSpectrogram(int columns, int bins);
+    void paintSpectrogramColumn(int column);
+    void repaintSpectrogramImage();
+    void drawDampingCurve(QPainter& painter);
+    void drawDampingSeries(QPainter& painter, const QVector<DampingBin>& curve, const QColor& color);
     void drawPolarData(QPainter& painter);
     void drawPolarDataSeries(QPainter& painter, const QVector<SensorData>& data, const QColor& baseColor, double opacity = 1.0);
     void drawPolarAxes(QPainter& painter);
@@ -72,22 +136,71 @@ private:
     void drawPolarLabels(QPainter& painter);
     void drawLegend(QPainter& painter);
     void drawTitle(QPainter& painter);
+    void drawCursors(QPainter& painter);
+    void drawCursorLines(QPainter& painter, const Cursor& cursor, const QColor& color, Qt::PenStyle style);
+    void drawReadout(QPainter& painter, const QPointF& anchor, const QStringList& lines, const QColor& color);
+    QStringList cursorReadout(const Cursor& cursor) const;
+    QStringList deltaReadout(const Cursor& a, const Cursor& b) const;
+    QString xAxisTitle() const;
+    QString yAxisTitle() const;
     void calculateBounds();
+    void calculateDataBounds();
+    // Catches up on bounds that addDataPoint() and friends left stale
+    void refreshBounds();
+    // Calls visitor(readX, readY) once with this plot type's sample readers;
+    // plots drawn from derived results do not call it
+    template <typename Visitor>
+    void visitSampleAxes(Visitor&& visitor) const;
+    bool isCurvePlot() const;
+    bool hasCursors() const;
+    bool hasTimeAxis() const;
     void updateScales();
-    QColor getViridisColor(double value, double minValue, double maxValue) const;
+    static QColor getViridisColor(double value, double minValue, double maxValue);
     QColor getCividisColor(double value, double minValue, double maxValue) const;
     
     QPointF dataToScreen(double x, double y) const;
     QPointF screenToData(const QPointF& screen) const;
     
+    // replot() redraws the plot itself; updateCursors() only redraws the
+    // cursors over the last rendered plot
+    void replot();
+    void updateCursors();
+    
+    // The cursor index holds one PointIndex per series, in plot coordinates
+    // for cartesian plots and in units of the polar radius for polar ones;
+    // it is rebuilt on the first lookup after the data changes
+    void buildCursorIndex();
+    QVector<QPointF> cursorPoints(const QVector<SensorData>& data) const;
+    Cursor nearestSample(const QPointF& screen);
+    QPointF cursorToScreen(const Cursor& cursor) const;
+    static QPointF polarPoint(const SensorData& data);
+    
     PlotType m_plotType;
+    SensorChannel m_channel;
     QVector<SensorData> m_data;
     QVector<QVector<SensorData>> m_overlaySeries;
     QStringList m_overlayLabels;
+    DampingAnalyzer m_dampingCurve;
+    QVector<QPointF> m_curve;
+    QString m_curveLabel;
+    QVector<QVector<QPointF>> m_family;
+    QStringList m_familyLabels;
+    bool m_familyNormalized;
+    
+    // Spectrogram ring of columns; the image mirrors m_spectrogramFrames
+    QVector<QVector<float>> m_spectrogramFrames;
+    QImage m_spectrogramImage;
+    int m_spectrogramHead;
+    int m_spectrogramCount;
+    double m_spectrogramInterval;
+    double m_spectrogramMaxFrequency;
+    double m_spectrogramEndTime;
+    double m_spectrogramTopDb;
     
     // Plot settings
     double m_timeWindow;
     bool m_autoScale;
+    bool m_boundsStale;         // autoscaled bounds wait for refreshBounds()
     bool m_gridVisible;
     bool m_overlayMode;
     bool m_polarMode;
@@ -100,17 +213,32 @@ private:
     double m_polarRadius;
     double m_minForce, m_maxForce;
     
+    // Latency instrumentation
+    qint64 m_lastPaintedReceivedAt;
+    
     // Interaction
     bool m_isDragging;
     QPointF m_lastMousePos;
+    QPointF m_pressPos;
+    bool m_cursorClick;     // press not yet moved past CLICK_DISTANCE
     double m_zoomFactor;
     
+    // Cursors
+    Cursor m_hoverCursor;
+    Cursor m_cursors[2];    // A and B
+    QVector<PointIndex> m_cursorIndex;
+    bool m_cursorIndexValid;
+    QPixmap m_plotCache;
+    bool m_plotCacheValid;
+    bool m_cursorRepaint;
+    
     // Appearance
     QColor m_backgroundColor;
     QColor m_gridColor;
     QColor m_axisColor;
     QColor m_dataColor;
-    QVector<QColor> m_overlayColors;
+    QColor m_reboundColor;
+    QColor m_cursorColors[2];
     QPen m_dataPen;
     QPen m_gridPen;
     QPen m_axisPen;
@@ -119,7 +247,10 @@ private:
     // Constants
     static const int MARGIN = 60;
     static const int LEGEND_HEIGHT = 30;
+    static const int CLICK_DISTANCE = 3;    // pixels a click may move and still place a cursor
     static constexpr double DEFAULT_TIME_WINDOW = 30.0; // seconds
+    static const int SPECTROGRAM_COLUMNS = 600;
+    static constexpr double SPECTROGRAM_RANGE_DB = 80.0;
 };
 
 #endif // PLOTWIDGET_H
\ No newline at end of file
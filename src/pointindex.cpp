@@ -0,0 +1,141 @@
+#include "pointindex.h"
+#include <QtMath>
+#include <algorithm>
+#include <limits>
+
+PointIndex::PointIndex()
+    : m_sorted(true)
+{
+}
+
+void PointIndex::build(const QVector<QPointF>& points)
+{
+    m_nodes.clear();
+    m_nodes.reserve(points.size());
+    m_sorted = true;
+    for (int i = 0; i < points.size(); ++i) {
+        const QPointF& point = points[i];
+        if (!qIsFinite(point.x()) || !qIsFinite(point.y())) {
+            continue;
+        }
+        if (!m_nodes.isEmpty() && point.x() < m_nodes.last().x) {
+            m_sorted = false;
+        }
+        m_nodes.append({ point.x(), point.y(), i });
+    }
+
+    if (!m_sorted) {
+        buildTree(0, m_nodes.size(), 0);
+    }
+}
+
+void PointIndex::clear()
+{
+    m_nodes.clear();
+    m_sorted = true;
+}
+
+void PointIndex::buildTree(int begin, int end, int depth)
+{
+    // The median of [begin, end) on this depth's axis sits at the middle,
+    // smaller coordinates before it and larger after
+    if (end - begin < 2) {
+        return;
+    }
+    const int mid = begin + (end - begin) / 2;
+    Node* nodes = m_nodes.data();
+    if (depth % 2 == 0) {
+        std::nth_element(nodes + begin, nodes + mid, nodes + end,
+                         [](const Node& a, const Node& b) { return a.x < b.x; });
+    } else {
+        std::nth_element(nodes + begin, nodes + mid, nodes + end,
+                         [](const Node& a, const Node& b) { return a.y < b.y; });
+    }
+    buildTree(begin, mid, depth + 1);
+    buildTree(mid + 1, end, depth + 1);
+}
+
+int PointIndex::nearest(const QPointF& target, double scaleX, double scaleY, double* distanceSquared) const
+{
+    if (m_nodes.isEmpty()) {
+        return -1;
+    }
+
+    const double weightX = scaleX * scaleX;
+    const double weightY = scaleY * scaleY;
+    int best = -1;
+    double bestDistance = std::numeric_limits<double>::infinity();
+    if (m_sorted) {
+        best = nearestSorted(target);
+        const double dx = m_nodes[best].x - target.x();
+        const double dy = m_nodes[best].y - target.y();
+        bestDistance = dx * dx * weightX + dy * dy * weightY;
+    } else {
+        searchTree(0, m_nodes.size(), 0, target, weightX, weightY, &best, &bestDistance);
+    }
+
+    if (distanceSquared) {
+        *distanceSquared = bestDistance;
+    }
+    return m_nodes[best].index;
+}
+
+int PointIndex::nearestSorted(const QPointF& target) const
+{
+    auto byX = [](const Node& node, double x) { return node.x < x; };
+    const Node* begin = m_nodes.constData();
+    const Node* end = begin + m_nodes.size();
+
+    // The nearer of the samples either side of the target in x
+    const Node* after = std::lower_bound(begin, end, target.x(), byX);
+    const Node* closest = after;
+    if (after == end || (after != begin && target.x() - (after - 1)->x < after->x - target.x())) {
+        closest = after - 1;
+    }
+
+    // Then the nearest in y among the samples at that x
+    const double x = closest->x;
+    const Node* runBegin = std::lower_bound(begin, closest, x, byX);
+    const Node* best = closest;
+    for (const Node* node = runBegin; node != end && node->x == x; ++node) {
+        if (qAbs(node->y - target.y()) < qAbs(best->y - target.y())) {
+            best = node;
+        }
+    }
+    return int(best - begin);
+}
+
+void PointIndex::searchTree(int begin, int end, int depth, const QPointF& target, double weightX, double weightY,
+                            int* best, double* bestDistance) const
+{
+    if (begin >= end) {
+        return;
+    }
+
+    const int mid = begin + (end - begin) / 2;
+    const Node& node = m_nodes[mid];
+    const double dx = target.x() - node.x;
+    const double dy = target.y() - node.y;
+    const double distance = dx * dx * weightX + dy * dy * weightY;
+    if (distance < *bestDistance) {
+        *bestDistance = distance;
+        *best = mid;
+    }
+
+    // The target's side of the split first; the far side only while the
+    // splitting line is nearer than the best point found so far
+    const bool xAxis = depth % 2 == 0;
+    const double split = xAxis ? dx : dy;
+    const double splitDistance = split * split * (xAxis ? weightX : weightY);
+    if (split < 0) {
+        searchTree(begin, mid, depth + 1, target, weightX, weightY, best, bestDistance);
+        if (splitDistance < *bestDistance) {
+            searchTree(mid + 1, end, depth + 1, target, weightX, weightY, best, bestDistance);
+        }
+    } else {
+        searchTree(mid + 1, end, depth + 1, target, weightX, weightY, best, bestDistance);
+        if (splitDistance < *bestDistance) {
+            searchTree(begin, mid, depth + 1, target, weightX, weightY, best, bestDistance);
+        }
+    }
+}
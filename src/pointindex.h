@@ -0,0 +1,54 @@
+#ifndef POINTINDEX_H
+#define POINTINDEX_H
+
+#include <QVector>
+#include <QPointF>
+
+// Nearest-point lookup over one plotted series, for cursors that snap to
+// samples as the mouse moves.
+//
+// Points already sorted by x, as time series are, are searched by bisection
+// on x: the nearest sample in x wins, and the nearest in y among samples
+// sharing that x. Anything else (force against position, polar traces) is
+// built into an implicit k-d tree, the points reordered in place around
+// median splits so the tree needs no node storage of its own.
+//
+// Distances are taken after scaling each axis by the caller's pixels per
+// unit, so "nearest" means nearest on screen at the current zoom; the index
+// does not depend on the scales and survives pans, zooms and resizes.
+// Non-finite points are skipped; lookups return indices into the vector
+// passed to build().
+class PointIndex
+{
+public:
+    PointIndex();
+
+    void build(const QVector<QPointF>& points);
+    void clear();
+
+    bool isEmpty() const { return m_nodes.isEmpty(); }
+    int size() const { return m_nodes.size(); }
+    bool isSorted() const { return m_sorted; }
+
+    // Returns the index of the nearest point, or -1 if there are none.
+    // distanceSquared, if given, receives the scaled squared distance to it.
+    int nearest(const QPointF& target, double scaleX = 1.0, double scaleY = 1.0,
+                double* distanceSquared = nullptr) const;
+
+private:
+    struct Node {
+        double x;
+        double y;
+        int index;      // into the built vector
+    };
+
+    void buildTree(int begin, int end, int depth);
+    int nearestSorted(const QPointF& target) const;
+    void searchTree(int begin, int end, int depth, const QPointF& target, double weightX, double weightY,
+                    int* best, double* bestDistance) const;
+
+    QVector<Node> m_nodes;
+    bool m_sorted;
+};
+
+#endif // POINTINDEX_H
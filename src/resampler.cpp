@@ -0,0 +1,499 @@
+#include "resampler.h"
+#include <QtConcurrent>
+#include <QtMath>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Grid samples produced per worker for long recordings
+const int PARALLEL_CHUNK_SIZE = 65536;
+
+const int CHANNEL_COUNT = 4;
+
+// Structure-of-arrays copy of a recording, times relative to the first sample
+struct ChannelArrays {
+    std::vector<double> time;
+    std::vector<double> values[CHANNEL_COUNT];
+};
+
+ChannelArrays splitChannels(const QVector<SensorData>& data)
+{
+    ChannelArrays arrays;
+    const int n = data.size();
+    const qint64 origin = data.first().timestampUs;
+
+    arrays.time.resize(n);
+    for (std::vector<double>& channel : arrays.values) {
+        channel.resize(n);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        const SensorData& point = data[i];
+        arrays.time[i] = (point.timestampUs - origin) / 1e6;
+        arrays.values[0][i] = point.position;
+        arrays.values[1][i] = point.force;
+        arrays.values[2][i] = point.velocity;
+        arrays.values[3][i] = point.encoderPulses;
+    }
+
+    return arrays;
+}
+
+double lanczos(double x, int taps)
+{
+    if (x == 0.0) {
+        return 1.0;
+    }
+    if (qAbs(x) >= taps) {
+        return 0.0;
+    }
+    double px = M_PI * x;
+    return taps * std::sin(px) * std::sin(px / taps) / (px * px);
+}
+
+// Calls fn(first, last) over [0, count), split across the thread pool when
+// the range is long enough to be worth it
+template<typename Fn>
+void forEachChunk(qint64 count, Fn fn)
+{
+    if (count < 2 * PARALLEL_CHUNK_SIZE) {
+        fn(0, count);
+        return;
+    }
+
+    QVector<QPair<qint64, qint64>> ranges;
+    for (qint64 first = 0; first < count; first += PARALLEL_CHUNK_SIZE) {
+        ranges.append(qMakePair(first, qMin(first + PARALLEL_CHUNK_SIZE, count)));
+    }
+    QtConcurrent::blockingMap(ranges, [&fn](const QPair<qint64, qint64>& range) {
+        fn(range.first, range.second);
+    });
+}
+
+// Grid samples [first, last) by linear interpolation. The bracketing index
+// and fraction are found once per grid sample, then each channel is a
+// straight gather-and-blend loop the compiler can vectorise.
+void linearChunk(const ChannelArrays& input, double sampleRate, double* const* outputs,
+                 qint64 first, qint64 last)
+{
+    const std::vector<double>& time = input.time;
+    const int n = time.size();
+    const int count = last - first;
+
+    std::vector<int> index(count);
+    std::vector<double> fraction(count);
+
+    int j = std::upper_bound(time.begin(), time.end(), first / sampleRate) - time.begin() - 1;
+    j = qBound(0, j, n - 2);
+    for (int i = 0; i < count; ++i) {
+        double t = (first + i) / sampleRate;
+        while (j < n - 2 && time[j + 1] <= t) {
+            ++j;
+        }
+        double dt = time[j + 1] - time[j];
+        index[i] = j;
+        fraction[i] = dt > 0 ? qBound(0.0, (t - time[j]) / dt, 1.0) : 1.0;
+    }
+
+    for (int c = 0; c < CHANNEL_COUNT; ++c) {
+        const double* v = input.values[c].data();
+        double* out = outputs[c] + first;
+        for (int i = 0; i < count; ++i) {
+            double v0 = v[index[i]];
+            out[i] = v0 + fraction[i] * (v[index[i] + 1] - v0);
+        }
+    }
+}
+
+// Grid samples [first, last) from the uniform fine grid by a normalised
+// Lanczos-weighted sum. The weights of each grid sample are computed once
+// and shared by all channels; the per-channel work is a dot product.
+void sincChunk(const double* const* fine, qint64 fineCount, double fineRate,
+               double sampleRate, double kernelRate, int taps,
+               double* const* outputs, qint64 first, qint64 last)
+{
+    const double scale = kernelRate / fineRate;
+    const double halfWidth = taps / scale; // in fine samples
+
+    std::vector<double> weights;
+    for (qint64 i = first; i < last; ++i) {
+        double u = qMin(i * fineRate / sampleRate, double(fineCount - 1));
+        qint64 lo = qMax(qint64(0), qint64(std::ceil(u - halfWidth)));
+        qint64 hi = qMin(fineCount - 1, qint64(std::floor(u + halfWidth)));
+
+        weights.resize(hi - lo + 1);
+        double sum = 0;
+        for (qint64 k = lo; k <= hi; ++k) {
+            double w = lanczos((u - k) * scale, taps);
+            weights[k - lo] = w;
+            sum += w;
+        }
+
+        const int support = weights.size();
+        const double* w = weights.data();
+        for (int c = 0; c < CHANNEL_COUNT; ++c) {
+            const double* v = fine[c] + lo;
+            double acc = 0;
+            for (int k = 0; k < support; ++k) {
+                acc += w[k] * v[k];
+            }
+            outputs[c][i] = acc / sum;
+        }
+    }
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// UniformSeries
+
+void UniformSeries::resize(int size)
+{
+    position.resize(size);
+    force.resize(size);
+    velocity.resize(size);
+    encoder.resize(size);
+}
+
+void UniformSeries::clear()
+{
+    position.clear();
+    force.clear();
+    velocity.clear();
+    encoder.clear();
+}
+
+SensorData UniformSeries::at(int index) const
+{
+    SensorData data;
+    data.timestampUs = qRound64(timeAt(index) * 1e6);
+    data.timestamp = data.timestampUs / 1000;
+    data.position = position[index];
+    data.force = force[index];
+    data.velocity = velocity[index];
+    data.encoderPulses = qRound64(encoder[index]);
+    return data;
+}
+
+QVector<SensorData> UniformSeries::toSensorData() const
+{
+    QVector<SensorData> data(size());
+    for (int i = 0; i < size(); ++i) {
+        data[i] = at(i);
+    }
+    return data;
+}
+
+// ---------------------------------------------------------------------------
+// Resampler
+
+Resampler::Resampler(double sampleRate, Mode mode, int sincTaps)
+{
+    configure(sampleRate, mode, sincTaps);
+}
+
+void Resampler::configure(double sampleRate, Mode mode, int sincTaps)
+{
+    m_requestedRate = qMax(0.0, sampleRate);
+    m_mode = mode;
+    m_sincTaps = qMax(1, sincTaps);
+    reset();
+}
+
+void Resampler::reset()
+{
+    m_sampleRate = 0;
+    m_kernelRate = 0;
+    m_fineRate = 0;
+    m_warmup.clear();
+    m_last = InputSample();
+    m_fineTime = 0;
+    m_gridTime = 0;
+    m_fine.clear();
+    m_newBlock = true;
+    m_pending.clear();
+    m_pendingCount = 0;
+}
+
+double Resampler::latency() const
+{
+    if (m_mode == WindowedSinc && m_kernelRate > 0) {
+        return m_sincTaps / m_kernelRate;
+    }
+    return 0.0;
+}
+
+int Resampler::addSample(const SensorData& data)
+{
+    if (!isReady()) {
+        m_warmup.append(data);
+        if (m_warmup.size() < RATE_ESTIMATE_SAMPLES) {
+            return 0;
+        }
+
+        double inputRate = estimateSampleRate(m_warmup);
+        if (inputRate <= 0) {
+            m_warmup.clear();
+            return 0;
+        }
+        m_sampleRate = m_requestedRate > 0 ? m_requestedRate : inputRate;
+        m_kernelRate = qMin(m_sampleRate, inputRate);
+        m_fineRate = m_mode == Linear ? m_sampleRate : fineRate(m_sampleRate, inputRate);
+
+        // Start the grid on the first sample and replay the rest
+        QVector<SensorData> warmup;
+        warmup.swap(m_warmup);
+        start(toInput(warmup.first()));
+        for (int i = 1; i < warmup.size(); ++i) {
+            push(toInput(warmup[i]));
+        }
+    } else {
+        push(toInput(data));
+    }
+
+    return m_pendingCount;
+}
+
+UniformSeries Resampler::takeSamples()
+{
+    if (m_pending.isEmpty()) {
+        return UniformSeries();
+    }
+    UniformSeries block = m_pending.takeFirst();
+    m_pendingCount -= block.size();
+    return block;
+}
+
+double Resampler::fineRate(double sampleRate, double inputRate)
+{
+    return FINE_OVERSAMPLING * qMax(sampleRate, inputRate);
+}
+
+Resampler::InputSample Resampler::toInput(const SensorData& data)
+{
+    return { data.timestampUs / 1e6,
+             { data.position, data.force, data.velocity, double(data.encoderPulses) } };
+}
+
+void Resampler::start(const InputSample& sample)
+{
+    m_last = sample;
+    m_fineTime = sample.time;
+    m_gridTime = sample.time;
+    m_fine.clear();
+    m_newBlock = true;
+
+    pushFine(sample);
+}
+
+void Resampler::push(const InputSample& sample)
+{
+    if (sample.time <= m_last.time) {
+        // Duplicate timestamps keep the newest reading, older ones are dropped
+        if (sample.time == m_last.time) {
+            m_last = sample;
+        }
+        return;
+    }
+
+    if (sample.time - m_last.time > MAX_GAP) {
+        // Do not fabricate seconds of data across a dropout
+        if (m_mode == WindowedSinc && !m_fine.isEmpty()) {
+            emitSinc(m_fine.last().time);
+        }
+        start(sample);
+        return;
+    }
+
+    // Linear stage onto the fine grid
+    const double step = 1.0 / m_fineRate;
+    const double span = sample.time - m_last.time;
+
+    InputSample fine;
+    while (m_fineTime + step <= sample.time) {
+        m_fineTime += step;
+        double fraction = (m_fineTime - m_last.time) / span;
+        fine.time = m_fineTime;
+        for (int c = 0; c < 4; ++c) {
+            fine.values[c] = m_last.values[c] + fraction * (sample.values[c] - m_last.values[c]);
+        }
+        pushFine(fine);
+    }
+
+    m_last = sample;
+}
+
+void Resampler::pushFine(const InputSample& sample)
+{
+    if (m_mode == Linear) {
+        // The fine grid is the output grid
+        m_gridTime = sample.time;
+        appendGridSample(sample.values);
+        return;
+    }
+
+    m_fine.append(sample);
+    emitSinc(sample.time - latency());
+}
+
+void Resampler::emitSinc(double until)
+{
+    const double step = 1.0 / m_sampleRate;
+    const double halfWidth = latency();
+
+    double values[4];
+    while (m_gridTime <= until) {
+        double sum = 0;
+        double acc[4] = { 0, 0, 0, 0 };
+        for (const InputSample& sample : m_fine) {
+            double offset = m_gridTime - sample.time;
+            if (qAbs(offset) >= halfWidth) {
+                continue;
+            }
+            double w = lanczos(offset * m_kernelRate, m_sincTaps);
+            sum += w;
+            for (int c = 0; c < 4; ++c) {
+                acc[c] += w * sample.values[c];
+            }
+        }
+
+        for (int c = 0; c < 4; ++c) {
+            values[c] = acc[c] / sum;
+        }
+        appendGridSample(values);
+        m_gridTime += step;
+    }
+
+    // Drop fine samples the kernel can no longer reach
+    int stale = 0;
+    while (stale < m_fine.size() - 1 && m_fine[stale].time <= m_gridTime - halfWidth) {
+        ++stale;
+    }
+    m_fine.remove(0, stale);
+}
+
+void Resampler::appendGridSample(const double* values)
+{
+    if (m_newBlock || m_pending.isEmpty()) {
+        UniformSeries block;
+        block.startTime = m_gridTime;
+        block.sampleRate = m_sampleRate;
+        m_pending.append(block);
+        m_newBlock = false;
+    }
+
+    UniformSeries& block = m_pending.last();
+    block.position.append(values[0]);
+    block.force.append(values[1]);
+    block.velocity.append(values[2]);
+    block.encoder.append(values[3]);
+    ++m_pendingCount;
+}
+
+UniformSeries Resampler::resample(const QVector<SensorData>& data, double sampleRate,
+                                  Mode mode, int sincTaps)
+{
+    UniformSeries series;
+    if (data.size() < 2 || sampleRate <= 0) {
+        return series;
+    }
+
+    const double start = data.first().timestampUs / 1e6;
+    const double duration = data.last().timestampUs / 1e6 - start;
+    if (duration <= 0) {
+        return series;
+    }
+
+    // Broken timestamps would blow up the grid; refuse rather than return a
+    // series that silently stops short of the recording
+    const qint64 count = static_cast<qint64>(duration * sampleRate) + 1;
+    if (count > qint64(MAX_UPSAMPLING) * data.size()) {
+        qWarning() << "Resampling" << data.size() << "samples over" << duration << "s at"
+                   << sampleRate << "Hz needs" << count << "grid samples; refusing more than"
+                   << MAX_UPSAMPLING << "per input sample";
+        return series;
+    }
+
+    series.startTime = start;
+    series.sampleRate = sampleRate;
+    series.resize(count);
+
+    // Workers write disjoint ranges through raw pointers, so detach here
+    double* outputs[CHANNEL_COUNT] = { series.position.data(), series.force.data(),
+                                       series.velocity.data(), series.encoder.data() };
+
+    const ChannelArrays input = splitChannels(data);
+
+    if (mode == Linear) {
+        forEachChunk(count, [&input, &outputs, sampleRate](qint64 first, qint64 last) {
+            linearChunk(input, sampleRate, outputs, first, last);
+        });
+        return series;
+    }
+
+    // Windowed sinc on jittered timestamps is biased by the uneven sample
+    // spacing, so the samples are first put on a uniform fine grid
+    double inputRate = estimateSampleRate(data);
+    if (inputRate <= 0) {
+        inputRate = sampleRate;
+    }
+    const double kernelRate = qMin(sampleRate, inputRate);
+    const double fine = fineRate(sampleRate, inputRate);
+    const qint64 fineCount = static_cast<qint64>((count - 1) / sampleRate * fine) + 1;
+    sincTaps = qMax(1, sincTaps);
+
+    std::vector<double> fineValues[CHANNEL_COUNT];
+    double* fineOutputs[CHANNEL_COUNT];
+    for (int c = 0; c < CHANNEL_COUNT; ++c) {
+        fineValues[c].resize(fineCount);
+        fineOutputs[c] = fineValues[c].data();
+    }
+
+    forEachChunk(fineCount, [&input, &fineOutputs, fine](qint64 first, qint64 last) {
+        linearChunk(input, fine, fineOutputs, first, last);
+    });
+    forEachChunk(count, [&](qint64 first, qint64 last) {
+        sincChunk(fineOutputs, fineCount, fine, sampleRate, kernelRate, sincTaps, outputs, first, last);
+    });
+
+    return series;
+}
+
+double Resampler::estimateSampleRate(const QVector<SensorData>& data)
+{
+    const int maxIntervals = 10000;
+
+    std::vector<qint64> intervals;
+    intervals.reserve(qMin(int(data.size()), maxIntervals));
+    for (int i = 1; i < data.size() && int(intervals.size()) < maxIntervals; ++i) {
+        qint64 delta = data[i].timestampUs - data[i - 1].timestampUs;
+        if (delta > 0) {
+            intervals.push_back(delta);
+        }
+    }
+
+    if (intervals.empty()) {
+        return 0.0;
+    }
+
+    auto middle = intervals.begin() + intervals.size() / 2;
+    std::nth_element(intervals.begin(), middle, intervals.end());
+    return 1e6 / *middle;
+}
+
+QString Resampler::modeName(Mode mode)
+{
+    switch (mode) {
+        case Linear: return "Linear";
+        case WindowedSinc: return "Windowed Sinc";
+    }
+    return QString();
+}
+
+QStringList Resampler::modeNames()
+{
+    return { modeName(Linear), modeName(WindowedSinc) };
+}
@@ -0,0 +1,125 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+#include "sensordata.h"
+
+// Sensor channels on a fixed-rate time grid, one contiguous array per
+// channel so analysis kernels can run straight loops with a constant dt.
+struct UniformSeries {
+    double startTime;   // s, time of sample 0
+    double sampleRate;  // Hz
+    QVector<double> position;
+    QVector<double> force;
+    QVector<double> velocity;
+    QVector<double> encoder;
+
+    UniformSeries() : startTime(0), sampleRate(0) {}
+
+    int size() const { return position.size(); }
+    bool isEmpty() const { return position.isEmpty(); }
+    double timeAt(int index) const { return startTime + index / sampleRate; }
+
+    void resize(int size);
+    void clear();
+
+    SensorData at(int index) const;
+    QVector<SensorData> toSensorData() const;
+};
+
+// Converts irregularly timestamped SensorData to a fixed sample rate. Input
+// times are SensorData::timestampUs, so rates above 1 kHz resolve.
+//
+// Linear mode interpolates between neighbouring samples. WindowedSinc mode
+// first interpolates linearly onto a uniform grid at FINE_OVERSAMPLING times
+// the higher of the input and output rates, then takes a normalised Lanczos
+// sum over sincTaps periods around each output point. The kernel is
+// stretched to the lower of the two rates so it also acts as the
+// anti-aliasing filter when downsampling.
+//
+// resample() is the offline path. addSample()/takeSamples() is the
+// streaming path; it holds back output by latency() so the sinc kernel sees
+// samples on both sides, and restarts the grid after a dropout.
+class Resampler
+{
+public:
+    enum Mode {
+        Linear,
+        WindowedSinc
+    };
+
+    // A sample rate of 0 uses the median rate of the first samples seen
+    explicit Resampler(double sampleRate = 0, Mode mode = Linear, int sincTaps = DEFAULT_SINC_TAPS);
+
+    void configure(double sampleRate, Mode mode, int sincTaps = DEFAULT_SINC_TAPS);
+    void reset();
+
+    // Returns the number of grid samples waiting in takeSamples()
+    int addSample(const SensorData& data);
+
+    // Oldest contiguous block of grid samples; a block never spans a gap
+    UniformSeries takeSamples();
+
+    bool isReady() const { return m_sampleRate > 0; }
+    double sampleRate() const { return m_sampleRate; }
+    double latency() const;
+    Mode mode() const { return m_mode; }
+
+    // Empty when the grid would hold more than MAX_UPSAMPLING samples per
+    // input sample, which only broken timestamps produce
+    static UniformSeries resample(const QVector<SensorData>& data, double sampleRate,
+                                  Mode mode = Linear, int sincTaps = DEFAULT_SINC_TAPS);
+
+    // Median sample rate of a recording, robust against dropped samples
+    static double estimateSampleRate(const QVector<SensorData>& data);
+
+    static QString modeName(Mode mode);
+    static QStringList modeNames();
+
+    static const int DEFAULT_SINC_TAPS = 4;
+    static constexpr double MAX_GAP = 1.0; // s
+
+private:
+    struct InputSample {
+        double time;
+        double values[4];
+    };
+
+    static double fineRate(double sampleRate, double inputRate);
+    static InputSample toInput(const SensorData& data);
+    void start(const InputSample& sample);
+    void push(const InputSample& sample);
+    void pushFine(const InputSample& sample);
+    void emitSinc(double until);
+    void appendGridSample(const double* values);
+
+    double m_requestedRate;
+    Mode m_mode;
+    int m_sincTaps;
+
+    double m_sampleRate;
+    double m_kernelRate;
+    double m_fineRate;
+    QVector<SensorData> m_warmup;
+
+    // Linear stage: last input sample and the fine grid position
+    InputSample m_last;
+    double m_fineTime;
+
+    // Sinc stage: output grid position and the fine samples it depends on
+    double m_gridTime;
+    QVector<InputSample> m_fine;
+    bool m_newBlock;
+
+    QVector<UniformSeries> m_pending;
+    int m_pendingCount;
+
+    static const int RATE_ESTIMATE_SAMPLES = 32;
+    static const int MAX_UPSAMPLING = 16;
+    static const int FINE_OVERSAMPLING = 4;
+};
+
+#endif // RESAMPLER_H
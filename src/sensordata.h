@@ -0,0 +1,103 @@
+#ifndef SENSORDATA_H
+#define SENSORDATA_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QSharedData>
+
+#include <algorithm>
+#include <memory>
+
+// Rows of extra channel values for consecutive samples, allocated together
+// and freed with the last sample pointing into them
+struct SensorExtraBlock : public QSharedData {
+    SensorExtraBlock(int columns, int rows)
+        : values(new double[size_t(columns) * size_t(rows)]), columns(columns), rows(rows), used(0) {}
+
+    std::unique_ptr<double[]> values;
+    int columns;
+    int rows;
+    int used;           // rows handed out so far
+};
+
+// Channels beyond the built-in ones. The values live out of line, in a row
+// of a block shared with neighbouring samples, so a sample carries a
+// pointer and a row index whatever the schema and samples without extras
+// allocate nothing. A row is written once, by the SensorExtraStore handing
+// it out, before the sample is passed on; copies of a sample share it.
+class SensorExtras
+{
+public:
+    SensorExtras() : m_row(0) {}
+
+    int size() const { return m_block ? m_block->columns : 0; }
+    bool isEmpty() const { return !m_block; }
+    void clear() { m_block.reset(); m_row = 0; }
+
+    double operator[](int index) const { return constData()[index]; }
+    const double* constData() const
+    {
+        return m_block ? m_block->values.get() + qsizetype(m_row) * m_block->columns : nullptr;
+    }
+
+private:
+    friend class SensorExtraStore;
+
+    QExplicitlySharedDataPointer<SensorExtraBlock> m_block;
+    int m_row;
+};
+
+// Hands out SensorExtras rows from blocks of BLOCK_ROWS, so extras cost one
+// allocation per block rather than per sample. A store is used by one
+// thread at a time; the samples it fills may be read anywhere.
+class SensorExtraStore
+{
+public:
+    static const int BLOCK_ROWS = 1024;
+
+    // Points extras at a new row of columns values, left for the caller to
+    // fill, and returns it; no columns clears extras and returns nullptr
+    double* allocate(SensorExtras* extras, int columns)
+    {
+        if (columns <= 0) {
+            extras->clear();
+            return nullptr;
+        }
+        if (!m_block || m_block->columns != columns || m_block->used == m_block->rows) {
+            m_block.reset(new SensorExtraBlock(columns, BLOCK_ROWS));
+        }
+        extras->m_block = m_block;
+        extras->m_row = m_block->used++;
+        return m_block->values.get() + qsizetype(extras->m_row) * columns;
+    }
+
+    // Moves extras to a new row holding a copy of its values, to be changed
+    // without affecting the copies that share the old one
+    double* detach(SensorExtras* extras)
+    {
+        const SensorExtras old = *extras;
+        double* row = allocate(extras, old.size());
+        std::copy(old.constData(), old.constData() + old.size(), row);
+        return row;
+    }
+
+private:
+    QExplicitlySharedDataPointer<SensorExtraBlock> m_block;
+};
+
+struct SensorData {
+    qint64 timestamp;   // ms, monotonic (timestampUs / 1000 for live data)
+    double position;    // mm
+    double force;       // kg
+    long encoderPulses;
+    double velocity;    // mm/s (calculated)
+    qint64 timestampUs; // us, reconstructed by DeviceClock on the host timeline
+    qint64 receivedAt;  // ns, LatencyMonitor::now() when read from the port; 0 if not live
+    int source;         // acquisition device index; 0 is the primary board
+    SensorExtras extra; // channels beyond the built-in ones, in ChannelSchema extra order
+
+    SensorData() : timestamp(0), position(0), force(0), encoderPulses(0), velocity(0),
+                   timestampUs(0), receivedAt(0), source(0) {}
+};
+
+#endif // SENSORDATA_H
@@ -0,0 +1,174 @@
+#include "sensorstreamparser.h"
+#include "latencymonitor.h"
+#include "tracing.h"
+#include <QStringList>
+
+SensorStreamParser::SensorStreamParser(VelocityEstimator::Method method)
+    : m_sequenceField(true)
+    , m_defaultSchema(true)
+    , m_schemaGeneration(0)
+    , m_calibrationActive(false)
+    , m_velocityEstimator(VelocityEstimator::create(method))
+{
+}
+
+SensorStreamParser::~SensorStreamParser() = default;
+
+void SensorStreamParser::reset()
+{
+    m_buffer.clear();
+    m_velocityEstimator->reset();
+    m_linkHealth.reset();
+    m_deviceClock.reset();
+    if (!m_defaultSchema) {
+        m_schema = ChannelSchema();
+        m_defaultSchema = true;
+        m_calibrationActive = false;
+        ++m_schemaGeneration;
+    }
+}
+
+LinkHealth SensorStreamParser::health(qint64 hostTime) const
+{
+    LinkHealth health = m_linkHealth.health(hostTime);
+    health.deviceResets = m_deviceClock.resets();
+    health.clockRollovers = m_deviceClock.rollovers();
+    health.clockDrift = m_deviceClock.drift();
+    return health;
+}
+
+void SensorStreamParser::setVelocityMethod(VelocityEstimator::Method method)
+{
+    m_velocityEstimator = VelocityEstimator::create(method);
+}
+
+VelocityEstimator::Method SensorStreamParser::velocityMethod() const
+{
+    return m_velocityEstimator->method();
+}
+
+QVector<SensorData> SensorStreamParser::feed(const QByteArray& bytes, qint64 receivedAt)
+{
+    SHOCKEE_TRACE_SCOPE("parse", "SensorStreamParser::feed");
+
+    QVector<SensorData> samples;
+    m_buffer.append(bytes);
+    m_linkHealth.recordRead(bytes.size(), receivedAt);
+    m_linkHealth.recordPendingBytes(m_buffer.size());
+
+    // Walk complete lines and drop them from the buffer in one go. Samples
+    // are calibrated and given a velocity in batches, see finishSamples()
+    int finished = 0;
+    int start = 0;
+    for (int newline = m_buffer.indexOf('\n'); newline >= 0; newline = m_buffer.indexOf('\n', start)) {
+        QString line = QString::fromUtf8(m_buffer.constData() + start, newline - start).trimmed();
+        start = newline + 1;
+
+        if (line.isEmpty()) {
+            continue;
+        }
+        if (line.startsWith('#')) {
+            if (ChannelSchema::isHeader(line)) {
+                // Samples so far were parsed with the old columns
+                finishSamples(samples, finished);
+                finished = samples.size();
+                applyHeader(line);
+            }
+            continue;
+        }
+
+        qint64 sequence = -1;
+        SensorData data;
+        if (m_defaultSchema) {
+            data = parseDataLine(line, m_sequenceField ? &sequence : nullptr);
+        } else if (!m_schema.parseLine(line, &data, &m_extraStore, m_sequenceField ? &sequence : nullptr)) {
+            data.timestamp = 0;
+        }
+        if (data.timestamp <= 0) {
+            m_linkHealth.recordParseError();
+            continue;
+        }
+
+        m_linkHealth.recordSample(data.timestamp, sequence);
+        data.timestampUs = m_deviceClock.map(data.timestamp, receivedAt);
+        data.timestamp = data.timestampUs / 1000;
+        data.receivedAt = receivedAt;
+        samples.append(data);
+    }
+    m_buffer.remove(0, start);
+    finishSamples(samples, finished);
+
+    return samples;
+}
+
+void SensorStreamParser::finishSamples(QVector<SensorData>& samples, int from)
+{
+    if (from >= samples.size()) {
+        return;
+    }
+
+    // Raw device readings become engineering units before velocity is
+    // estimated from the calibrated position
+    if (m_calibrationActive) {
+        m_calibration.apply(samples.data() + from, samples.size() - from, m_schema, &m_extraStore);
+    }
+
+    LatencyMonitor& latency = LatencyMonitor::instance();
+    for (int i = from; i < samples.size(); ++i) {
+        SensorData& data = samples[i];
+        data.velocity = m_velocityEstimator->update(data.timestampUs, data.position);
+        latency.record(LatencyMonitor::Parsed, data.receivedAt);
+    }
+}
+
+void SensorStreamParser::setCalibration(const CalibrationSet& calibration)
+{
+    m_calibration = calibration;
+    m_calibrationActive = m_calibration.appliesTo(m_schema);
+}
+
+void SensorStreamParser::applyHeader(const QString& line)
+{
+    bool ok;
+    ChannelSchema schema = ChannelSchema::fromHeader(line, &ok);
+    if (ok && schema != m_schema) {
+        m_schema = schema;
+        m_defaultSchema = m_schema.isDefault();
+        m_calibrationActive = m_calibration.appliesTo(m_schema);
+        ++m_schemaGeneration;
+    }
+}
+
+SensorData SensorStreamParser::parseDataLine(const QString& line, qint64* sequence)
+{
+    SensorData data;
+    QStringList parts = line.split(',');
+
+    if (sequence) {
+        *sequence = -1;
+    }
+
+    if (parts.size() >= 4) {
+        bool ok;
+        data.timestamp = parts[0].toLongLong(&ok);
+        if (!ok) return SensorData();
+
+        data.position = parts[1].toDouble(&ok);
+        if (!ok) return SensorData();
+
+        data.force = parts[2].toDouble(&ok);
+        if (!ok) return SensorData();
+
+        data.encoderPulses = parts[3].toLong(&ok);
+        if (!ok) return SensorData();
+
+        if (sequence && parts.size() >= 5) {
+            qint64 value = parts[4].toLongLong(&ok);
+            if (ok) {
+                *sequence = value;
+            }
+        }
+    }
+
+    return data;
+}
@@ -0,0 +1,83 @@
+#ifndef SENSORSTREAMPARSER_H
+#define SENSORSTREAMPARSER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+#include "sensordata.h"
+#include "velocityestimator.h"
+#include "linkhealthmonitor.h"
+#include "deviceclock.h"
+#include "channelschema.h"
+#include "calibration.h"
+
+// Turns the Arduino's line protocol into SensorData. Bytes may arrive in
+// arbitrary chunks; complete "timestamp,position,force,encoder" lines are
+// parsed and given a streaming velocity estimate, comment lines (#) and
+// malformed lines are dropped and counted in linkHealth(). A "# Format:" or
+// "# Channels:" header line switches the columns to the ChannelSchema it
+// names. An optional field after the last column is a sample sequence
+// number used for exact loss accounting. Device millis() timestamps go
+// through a DeviceClock, so emitted timestamps are monotonic across
+// rollovers and board resets. Independent of the serial port so recorded
+// byte streams can be replayed and benchmarked.
+class SensorStreamParser
+{
+public:
+    explicit SensorStreamParser(VelocityEstimator::Method method = VelocityEstimator::SavitzkyGolay);
+    ~SensorStreamParser();
+
+    void reset();
+
+    void setVelocityMethod(VelocityEstimator::Method method);
+    VelocityEstimator::Method velocityMethod() const;
+
+    // Whether a fifth field is read as a sequence number (default on)
+    void setSequenceField(bool enabled) { m_sequenceField = enabled; }
+
+    // Appends raw bytes and returns the samples completed by them; receivedAt
+    // (LatencyMonitor::now() of the read) is stamped on each sample
+    QVector<SensorData> feed(const QByteArray& bytes, qint64 receivedAt = 0);
+
+    LinkHealthMonitor& linkHealth() { return m_linkHealth; }
+    const LinkHealthMonitor& linkHealth() const { return m_linkHealth; }
+    const DeviceClock& deviceClock() const { return m_deviceClock; }
+
+    // Columns of the data lines; the default until the device sends a header.
+    // schemaGeneration() changes whenever a header changes the schema.
+    const ChannelSchema& schema() const { return m_schema; }
+    int schemaGeneration() const { return m_schemaGeneration; }
+
+    // Host-side calibration of raw channels ("force_raw" -> force); applies
+    // whenever the schema carries a raw channel the set calibrates
+    void setCalibration(const CalibrationSet& calibration);
+    const CalibrationSet& calibration() const { return m_calibration; }
+
+    // Link accounting plus the clock's reset, rollover and drift figures
+    LinkHealth health(qint64 hostTime = 0) const;
+
+    // One data line; timestamp 0 if malformed. sequence is set to the
+    // optional fifth field, or -1 if there is none.
+    static SensorData parseDataLine(const QString& line, qint64* sequence = nullptr);
+
+private:
+    void applyHeader(const QString& line);
+    // Calibrates and estimates velocity for samples[from..]
+    void finishSamples(QVector<SensorData>& samples, int from);
+
+    QByteArray m_buffer;
+    bool m_sequenceField;
+    ChannelSchema m_schema;
+    SensorExtraStore m_extraStore;      // rows for the samples' extra channels
+    bool m_defaultSchema;       // original four columns: use parseDataLine()
+    int m_schemaGeneration;
+    CalibrationSet m_calibration;
+    bool m_calibrationActive;
+    std::unique_ptr<VelocityEstimator> m_velocityEstimator;
+    LinkHealthMonitor m_linkHealth;
+    DeviceClock m_deviceClock;
+};
+
+#endif // SENSORSTREAMPARSER_H
@@ -1,17 +1,31 @@
 #include "serialcommunicator.h"
+#include "latencymonitor.h"
+#include "tracing.h"
 #include <QDebug>
+#include <QThread>
+#include <QMetaObject>
 
 SerialCommunicator::SerialCommunicator(QObject *parent)
     : QObject(parent)
     , m_serialPort(new QSerialPort(this))
-    , m_lastPosition(0)
-    , m_lastTimestamp(0)
-    , m_hasLastPosition(false)
+    , m_parser(VelocityEstimator::SavitzkyGolay)
+    , m_schemaGeneration(0)
 {
     connect(m_serialPort, &QSerialPort::readyRead, this, &SerialCommunicator::readData);
     connect(m_serialPort, &QSerialPort::errorOccurred, this, &SerialCommunicator::handleError);
 }
 
+template <typename Function>
+bool SerialCommunicator::dispatchToPortThread(Function function, bool wait) const
+{
+    if (QThread::currentThread() == thread()) {
+        return false;
+    }
+    QMetaObject::invokeMethod(const_cast<SerialCommunicator*>(this), function,
+                              wait ? Qt::BlockingQueuedConnection : Qt::QueuedConnection);
+    return true;
+}
+
 SerialCommunicator::~SerialCommunicator()
 {
     if (m_serialPort->isOpen()) {
@@ -31,6 +45,11 @@ QStringList SerialCommunicator::getAvailablePorts()
 
 bool SerialCommunicator::connectToPort(const QString& portName, int baudRate)
 {
+    bool connected = false;
+    if (dispatchToPortThread([&] { connected = connectToPort(portName, baudRate); }, true)) {
+        return connected;
+    }
+    
     if (m_serialPort->isOpen()) {
         m_serialPort->close();
     }
@@ -43,9 +62,9 @@ bool SerialCommunicator::connectToPort(const QString& portName, int baudRate)
     m_serialPort->setFlowControl(QSerialPort::NoFlowControl);
     
     if (m_serialPort->open(QIODevice::ReadWrite)) {
-        m_dataBuffer.clear();
-        m_hasLastPosition = false;
-        m_velocityHistory.clear();
+        m_parser.reset();
+        m_parser.linkHealth().setBaudRate(baudRate);
+        m_limits.resetLatency();
         emit connectionStatusChanged(true);
         return true;
     }
@@ -56,6 +75,10 @@ bool SerialCommunicator::connectToPort(const QString& portName, int baudRate)
 
 void SerialCommunicator::disconnect()
 {
+    if (dispatchToPortThread([this] { disconnect(); }, true)) {
+        return;
+    }
+    
     if (m_serialPort->isOpen()) {
         m_serialPort->close();
         emit connectionStatusChanged(false);
@@ -64,11 +87,19 @@ void SerialCommunicator::disconnect()
 
 bool SerialCommunicator::isConnected() const
 {
+    bool open = false;
+    if (dispatchToPortThread([&] { open = isConnected(); }, true)) {
+        return open;
+    }
     return m_serialPort->isOpen();
 }
 
 void SerialCommunicator::sendCommand(const QString& command)
 {
+    if (dispatchToPortThread([this, command] { sendCommand(command); }, false)) {
+        return;
+    }
+    
     if (m_serialPort->isOpen()) {
         m_serialPort->write(command.toUtf8() + "\n");
     }
@@ -89,86 +120,149 @@ void SerialCommunicator::setLoadCellCalibration(double calibration)
     sendCommand(QString("CAL_LOAD:%1").arg(calibration));
 }
 
-void SerialCommunicator::readData()
+void SerialCommunicator::setVelocityMethod(int method)
 {
-    QByteArray data = m_serialPort->readAll();
-    m_dataBuffer.append(data);
-    
-    // Process complete lines
-    while (m_dataBuffer.contains('\n')) {
-        int newlineIndex = m_dataBuffer.indexOf('\n');
-        QByteArray line = m_dataBuffer.left(newlineIndex);
-        m_dataBuffer.remove(0, newlineIndex + 1);
-        
-        QString lineStr = QString::fromUtf8(line).trimmed();
-        if (!lineStr.isEmpty() && !lineStr.startsWith('#')) {
-            processDataLine(lineStr);
-        }
+    if (dispatchToPortThread([this, method] { setVelocityMethod(method); }, false)) {
+        return;
     }
+    m_parser.setVelocityMethod(static_cast<VelocityEstimator::Method>(method));
 }
 
-void SerialCommunicator::handleError(QSerialPort::SerialPortError error)
+int SerialCommunicator::velocityMethod() const
 {
-    if (error != QSerialPort::NoError) {
-        emit errorOccurred("Serial port error: " + m_serialPort->errorString());
-        emit connectionStatusChanged(false);
+    int method = 0;
+    if (dispatchToPortThread([&] { method = velocityMethod(); }, true)) {
+        return method;
     }
+    return m_parser.velocityMethod();
 }
 
-void SerialCommunicator::processDataLine(const QString& line)
+LinkHealth SerialCommunicator::linkHealth() const
 {
-    SensorData data = parseDataLine(line);
-    if (data.timestamp > 0) {
-        calculateVelocity(data);
-        emit dataReceived(data);
+    LinkHealth health;
+    if (dispatchToPortThread([&] { health = linkHealth(); }, true)) {
+        return health;
+    }
+    return m_parser.health(LatencyMonitor::now());
+}
+
+void SerialCommunicator::resetLinkHealth()
+{
+    if (dispatchToPortThread([this] { resetLinkHealth(); }, false)) {
+        return;
+    }
+    m_parser.linkHealth().reset();
+}
+
+ChannelSchema SerialCommunicator::channelSchema() const
+{
+    ChannelSchema schema;
+    if (dispatchToPortThread([&] { schema = channelSchema(); }, true)) {
+        return schema;
+    }
+    return m_parser.schema();
+}
+
+void SerialCommunicator::setCalibration(const CalibrationSet& calibration)
+{
+    if (dispatchToPortThread([this, calibration] { setCalibration(calibration); }, false)) {
+        return;
+    }
+    m_parser.setCalibration(calibration);
+    m_limits.setSchema(m_parser.schema(), calibration);
+}
+
+CalibrationSet SerialCommunicator::calibration() const
+{
+    CalibrationSet calibration;
+    if (dispatchToPortThread([&] { calibration = this->calibration(); }, true)) {
+        return calibration;
     }
+    return m_parser.calibration();
 }
 
-SensorData SerialCommunicator::parseDataLine(const QString& line)
+void SerialCommunicator::setLimits(const LimitMonitor::Options& options)
 {
-    SensorData data;
-    QStringList parts = line.split(',');
+    if (dispatchToPortThread([this, options] { setLimits(options); }, false)) {
+        return;
+    }
+    m_limits.setOptions(options);
+}
+
+void SerialCommunicator::resetLimits()
+{
+    if (dispatchToPortThread([this] { resetLimits(); }, false)) {
+        return;
+    }
+    m_limits.reset();
+}
+
+LatencyHistogram SerialCommunicator::limitLatency() const
+{
+    LatencyHistogram latency;
+    if (dispatchToPortThread([&] { latency = limitLatency(); }, true)) {
+        return latency;
+    }
+    return m_limits.detectionLatency();
+}
+
+QStringList SerialCommunicator::unresolvedLimits() const
+{
+    QStringList channels;
+    if (dispatchToPortThread([&] { channels = unresolvedLimits(); }, true)) {
+        return channels;
+    }
+    return m_limits.unresolvedChannels();
+}
+
+void SerialCommunicator::readData()
+{
+    SHOCKEE_TRACE_SCOPE("serial", "SerialCommunicator::readData");
     
-    if (parts.size() >= 4) {
-        bool ok;
-        data.timestamp = parts[0].toLongLong(&ok);
-        if (!ok) return SensorData();
-        
-        data.position = parts[1].toDouble(&ok);
-        if (!ok) return SensorData();
-        
-        data.force = parts[2].toDouble(&ok);
-        if (!ok) return SensorData();
-        
-        data.encoderPulses = parts[3].toLong(&ok);
-        if (!ok) return SensorData();
+    const qint64 readStart = LatencyMonitor::now();
+    const QByteArray bytes = m_serialPort->readAll();
+    const qint64 receivedAt = LatencyMonitor::now();
+    LatencyMonitor::instance().recordDuration(LatencyMonitor::Read, receivedAt - readStart);
+    
+    const QVector<SensorData> samples = m_parser.feed(bytes, receivedAt);
+    if (m_parser.schemaGeneration() != m_schemaGeneration) {
+        // Announced before the samples that use it
+        m_schemaGeneration = m_parser.schemaGeneration();
+        m_limits.setSchema(m_parser.schema(), m_parser.calibration());
+        emit channelSchemaChanged(m_parser.schema());
     }
     
-    return data;
+    // The whole read is checked before any of it is handed on, so a trip
+    // late in a large read does not wait for the queued emits before it
+    for (const SensorData& data : samples) {
+        if (m_limits.check(data)) {
+            stopOnLimit();
+            break;
+        }
+    }
+    for (const SensorData& data : samples) {
+        emit dataReceived(data);
+    }
 }
 
-void SerialCommunicator::calculateVelocity(SensorData& data)
+void SerialCommunicator::stopOnLimit()
 {
-    if (m_hasLastPosition && data.timestamp > m_lastTimestamp) {
-        double deltaTime = (data.timestamp - m_lastTimestamp) / 1000.0; // Convert to seconds
-        double deltaPosition = data.position - m_lastPosition;
-        double instantVelocity = deltaPosition / deltaTime;
-        
-        // Apply moving average filter
-        m_velocityHistory.append(instantVelocity);
-        if (m_velocityHistory.size() > VELOCITY_HISTORY_SIZE) {
-            m_velocityHistory.removeFirst();
-        }
-        
-        // Calculate average velocity
-        double sum = 0;
-        for (double v : m_velocityHistory) {
-            sum += v;
-        }
-        data.velocity = sum / m_velocityHistory.size();
+    LimitTrip trip = m_limits.trip();
+    const LimitMonitor::Options& options = m_limits.options();
+    if (options.stopOnTrip && !options.stopCommand.isEmpty() && m_serialPort->isOpen()) {
+        // Written and flushed here rather than queued through sendCommand(),
+        // which would wait for the event loop
+        m_serialPort->write(options.stopCommand.toUtf8() + "\n");
+        m_serialPort->flush();
+        trip.stopLatency = trip.receivedAt > 0 ? LatencyMonitor::now() - trip.receivedAt : 0;
     }
-    
-    m_lastPosition = data.position;
-    m_lastTimestamp = data.timestamp;
-    m_hasLastPosition = true;
-}
\ No newline at end of file
+    emit limitTripped(trip);
+}
+
+void SerialCommunicator::handleError(QSerialPort::SerialPortError error)
+{
+    if (error != QSerialPort::NoError) {
+        emit errorOccurred("Serial port error: " + m_serialPort->errorString());
+        emit connectionStatusChanged(false);
+    }
+}
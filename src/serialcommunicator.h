@@ -8,16 +8,13 @@
 #include <QByteArray>
 #include <QStringList>
 
-struct SensorData {
-    qint64 timestamp;
-    double position;    // mm
-    double force;       // kg
-    long encoderPulses;
-    double velocity;    // mm/s (calculated)
-    
-    SensorData() : timestamp(0), position(0), force(0), encoderPulses(0), velocity(0) {}
-};
+#include "sensordata.h"
+#include "sensorstreamparser.h"
+#include "limitmonitor.h"
 
+// May live on its own I/O thread (see AcquisitionManager). The public
+// methods can be called from any thread; they run on the port's thread,
+// blocking the caller when they return a value.
 class SerialCommunicator : public QObject
 {
     Q_OBJECT
@@ -35,32 +32,59 @@ public:
     void tareLoadCell();
     void resetEncoder();
     void setLoadCellCalibration(double calibration);
+    
+    // Velocity estimation
+    void setVelocityMethod(int method);
+    int velocityMethod() const;
+    
+    // Sample loss, parse errors and link load since connecting or the last reset
+    LinkHealth linkHealth() const;
+    void resetLinkHealth();
+    
+    // Columns announced by the device's header line
+    ChannelSchema channelSchema() const;
+    
+    // Host calibration for boards that stream raw ADC/HX711 counts
+    void setCalibration(const CalibrationSet& calibration);
+    CalibrationSet calibration() const;
+    
+    // Safe operating limits, checked on the port's thread as samples are
+    // parsed. A trip writes the stop command straight to the port, then
+    // emits limitTripped(); checking resumes after resetLimits().
+    void setLimits(const LimitMonitor::Options& options);
+    void resetLimits();
+    LatencyHistogram limitLatency() const;
+    // Channels of limit rules that neither the device nor its calibration
+    // provides, so those rules are not checked
+    QStringList unresolvedLimits() const;
 
 signals:
     void dataReceived(const SensorData& data);
     void connectionStatusChanged(bool connected);
     void errorOccurred(const QString& error);
+    void channelSchemaChanged(const ChannelSchema& schema);
+    void limitTripped(const LimitTrip& trip);
 
 private slots:
     void readData();
     void handleError(QSerialPort::SerialPortError error);
 
 private:
-    void processDataLine(const QString& line);
-    SensorData parseDataLine(const QString& line);
-    void calculateVelocity(SensorData& data);
+    // Re-posts function to the port's thread and returns true when called
+    // from another thread; returns false if already on it
+    template <typename Function>
+    bool dispatchToPortThread(Function function, bool wait) const;
+    
+    // Sends the stop command for the trip just detected and reports it
+    void stopOnLimit();
     
     QSerialPort* m_serialPort;
-    QByteArray m_dataBuffer;
     
-    // For velocity calculation
-    double m_lastPosition;
-    qint64 m_lastTimestamp;
-    bool m_hasLastPosition;
+    // Line framing, parsing and velocity estimation
+    SensorStreamParser m_parser;
+    int m_schemaGeneration;
     
-    // Moving average filter for velocity
-    QList<double> m_velocityHistory;
-    static const int VELOCITY_HISTORY_SIZE = 5;
+    LimitMonitor m_limits;
 };
 
 #endif // SERIALCOMMUNICATOR_H
\ No newline at end of file
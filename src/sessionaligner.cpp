@@ -0,0 +1,330 @@
+#include "sessionaligner.h"
+#include "fft.h"
+#include "resampler.h"
+#include "hysteresisanalyzer.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+std::vector<double> demeaned(const QVector<double>& samples)
+{
+    double mean = 0;
+    for (double value : samples) {
+        mean += value;
+    }
+    mean /= qMax(1, int(samples.size()));
+
+    std::vector<double> out(samples.size());
+    for (int i = 0; i < samples.size(); ++i) {
+        out[i] = samples[i] - mean;
+    }
+    return out;
+}
+
+// Block means; a crude but cheap anti-alias filter for the coarse search
+std::vector<double> decimate(const std::vector<double>& samples, int factor)
+{
+    if (factor <= 1) {
+        return samples;
+    }
+
+    std::vector<double> out(samples.size() / factor);
+    for (size_t i = 0; i < out.size(); ++i) {
+        double sum = 0;
+        for (int k = 0; k < factor; ++k) {
+            sum += samples[i * factor + k];
+        }
+        out[i] = sum / factor;
+    }
+    return out;
+}
+
+// Pairs x[n + lag] with y[n]
+int overlapLength(int nx, int ny, int lag)
+{
+    return qMin(ny, nx - lag) - qMax(0, -lag);
+}
+
+int minimumOverlap(int nx, int ny)
+{
+    // Reject lags where only the tails of the runs touch
+    return qMax(16, qMin(nx, ny) / 4);
+}
+
+double dotAtLag(const std::vector<double>& x, const std::vector<double>& y, int lag)
+{
+    const int first = qMax(0, -lag);
+    const int last = qMin(int(y.size()), int(x.size()) - lag);
+    const double* a = x.data() + lag;
+    const double* b = y.data();
+
+    double sum = 0;
+    for (int n = first; n < last; ++n) {
+        sum += a[n] * b[n];
+    }
+    return sum;
+}
+
+double pearsonAtLag(const std::vector<double>& x, const std::vector<double>& y, int lag)
+{
+    const int first = qMax(0, -lag);
+    const int last = qMin(int(y.size()), int(x.size()) - lag);
+    const int count = last - first;
+    if (count < 2) {
+        return 0.0;
+    }
+
+    double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+    for (int n = first; n < last; ++n) {
+        double a = x[n + lag];
+        double b = y[n];
+        sx += a;
+        sy += b;
+        sxx += a * a;
+        syy += b * b;
+        sxy += a * b;
+    }
+
+    double cov = sxy - sx * sy / count;
+    double vx = sxx - sx * sx / count;
+    double vy = syy - sy * sy / count;
+    return (vx > 0 && vy > 0) ? cov / std::sqrt(vx * vy) : 0.0;
+}
+
+// Lag of the cross-correlation peak via one real-pair FFT and one inverse
+bool fftPeakLag(const std::vector<double>& x, const std::vector<double>& y, int* lag)
+{
+    const int nx = x.size();
+    const int ny = y.size();
+    const int n = Fft::nextPowerOfTwo(nx + ny - 1);
+    const int bins = n / 2 + 1;
+
+    std::vector<double> a(n, 0.0), b(n, 0.0);
+    std::copy(x.begin(), x.end(), a.begin());
+    std::copy(y.begin(), y.end(), b.begin());
+
+    const Fft fft(n);
+    std::vector<Fft::Complex> spectrumA(bins), spectrumB(bins);
+    fft.forwardRealPair(a.data(), b.data(), spectrumA.data(), spectrumB.data());
+
+    // X * conj(Y), extended to the full spectrum by conjugate symmetry
+    std::vector<Fft::Complex> cross(n);
+    for (int k = 0; k < bins; ++k) {
+        cross[k] = spectrumA[k] * std::conj(spectrumB[k]);
+        if (k > 0 && k < n - k) {
+            cross[n - k] = std::conj(cross[k]);
+        }
+    }
+    fft.inverse(cross.data());
+
+    const int minOverlap = minimumOverlap(nx, ny);
+    bool found = false;
+    double best = 0;
+    for (int candidate = -(ny - 1); candidate < nx; ++candidate) {
+        if (overlapLength(nx, ny, candidate) < minOverlap) {
+            continue;
+        }
+        double value = cross[(candidate + n) % n].real();
+        if (!found || value > best) {
+            best = value;
+            *lag = candidate;
+            found = true;
+        }
+    }
+    return found;
+}
+
+} // namespace
+
+AlignmentResult SessionAligner::align(const QVector<SensorData>& reference, const QVector<SensorData>& other,
+                                      bool cycleFallback)
+{
+    AlignmentResult correlated = crossCorrelate(reference, other);
+    if (!cycleFallback || (correlated.valid && correlated.score >= MIN_CORRELATION)) {
+        return correlated;
+    }
+
+    AlignmentResult cycles = alignCycles(reference, other);
+    return cycles.valid ? cycles : correlated;
+}
+
+AlignmentResult SessionAligner::crossCorrelate(const QVector<SensorData>& reference,
+                                               const QVector<SensorData>& other)
+{
+    AlignmentResult result;
+    result.method = AlignmentResult::CrossCorrelation;
+
+    double referenceRate = Resampler::estimateSampleRate(reference);
+    double otherRate = Resampler::estimateSampleRate(other);
+    if (referenceRate <= 0 || otherRate <= 0) {
+        return result;
+    }
+
+    const double rate = qMin(qMin(referenceRate, otherRate), MAX_CORRELATION_RATE);
+    UniformSeries a = Resampler::resample(reference, rate);
+    UniformSeries b = Resampler::resample(other, rate);
+    const std::vector<double> x = demeaned(a.position);
+    const std::vector<double> y = demeaned(b.position);
+    const int nx = x.size();
+    const int ny = y.size();
+    if (qMin(nx, ny) < 32) {
+        return result;
+    }
+
+    // Coarse search on a decimated copy keeps the transform bounded
+    const int factor = qMax(1, int(std::ceil(double(nx + ny) / MAX_FFT_SIZE)));
+    int coarseLag = 0;
+    if (!fftPeakLag(decimate(x, factor), decimate(y, factor), &coarseLag)) {
+        return result;
+    }
+
+    // Refine at the full rate around the coarse peak
+    const int minOverlap = minimumOverlap(nx, ny);
+    int lag = coarseLag * factor;
+    double best = -1;
+    for (int candidate = coarseLag * factor - factor; candidate <= coarseLag * factor + factor; ++candidate) {
+        if (overlapLength(nx, ny, candidate) < minOverlap) {
+            continue;
+        }
+        double value = dotAtLag(x, y, candidate);
+        if (best < 0 || value > best) {
+            best = value;
+            lag = candidate;
+        }
+    }
+
+    // Sub-sample peak by fitting a parabola through the neighbours
+    double fraction = 0;
+    if (overlapLength(nx, ny, lag - 1) >= minOverlap && overlapLength(nx, ny, lag + 1) >= minOverlap) {
+        double left = dotAtLag(x, y, lag - 1);
+        double centre = dotAtLag(x, y, lag);
+        double right = dotAtLag(x, y, lag + 1);
+        double curvature = left - 2 * centre + right;
+        if (curvature < 0) {
+            fraction = qBound(-0.5, 0.5 * (left - right) / curvature, 0.5);
+        }
+    }
+
+    result.valid = true;
+    result.offset = a.startTime + (lag + fraction) / rate - b.startTime;
+    result.score = pearsonAtLag(x, y, lag);
+    return result;
+}
+
+AlignmentResult SessionAligner::alignCycles(const QVector<SensorData>& reference,
+                                            const QVector<SensorData>& other)
+{
+    AlignmentResult result;
+    result.method = AlignmentResult::CycleMatching;
+
+    const QVector<HysteresisCycle> a = HysteresisAnalyzer::analyze(reference);
+    const QVector<HysteresisCycle> b = HysteresisAnalyzer::analyze(other);
+    if (a.size() < MIN_MATCHED_CYCLES || b.size() < MIN_MATCHED_CYCLES) {
+        return result;
+    }
+
+    auto mismatch = [](double p, double q) {
+        double scale = qAbs(p) + qAbs(q);
+        return scale > 0 ? qAbs(p - q) / scale : 0.0;
+    };
+
+    // Slide the cycle sequences past each other; b[i] pairs with a[i + shift]
+    int bestShift = 0;
+    double bestCost = -1;
+    for (int shift = -(b.size() - MIN_MATCHED_CYCLES); shift <= a.size() - MIN_MATCHED_CYCLES; ++shift) {
+        int first = qMax(0, -shift);
+        int last = qMin(int(b.size()), int(a.size()) - shift);
+
+        double cost = 0;
+        for (int i = first; i < last; ++i) {
+            const HysteresisCycle& p = a[i + shift];
+            const HysteresisCycle& q = b[i];
+            cost += mismatch(p.stroke, q.stroke)
+                  + mismatch(p.endTime - p.startTime, q.endTime - q.startTime);
+        }
+        cost /= 2 * (last - first);
+
+        if (bestCost < 0 || cost < bestCost) {
+            bestCost = cost;
+            bestShift = shift;
+        }
+    }
+
+    // Median start-time difference is robust to a few badly segmented cycles
+    std::vector<double> offsets;
+    for (int i = qMax(0, -bestShift); i < qMin(int(b.size()), int(a.size()) - bestShift); ++i) {
+        offsets.push_back(a[i + bestShift].startTime - b[i].startTime);
+    }
+    auto middle = offsets.begin() + offsets.size() / 2;
+    std::nth_element(offsets.begin(), middle, offsets.end());
+
+    result.valid = true;
+    result.offset = *middle;
+    result.score = 1.0 - bestCost;
+    result.matchedCycles = offsets.size();
+    return result;
+}
+
+QVector<SensorData> SessionAligner::shifted(const QVector<SensorData>& data, qint64 offsetMs)
+{
+    QVector<SensorData> out = data;
+    for (SensorData& point : out) {
+        point.timestamp += offsetMs;
+        point.timestampUs += offsetMs * 1000;
+    }
+    return out;
+}
+
+QVector<QPointF> SessionAligner::residual(const QVector<SensorData>& reference,
+                                          const QVector<SensorData>& alignedOther)
+{
+    QVector<QPointF> curve;
+    if (reference.size() < 2 || alignedOther.size() < 2) {
+        return curve;
+    }
+
+    const double start = qMax(reference.first().timestampUs, alignedOther.first().timestampUs) / 1e6;
+    const double end = qMin(reference.last().timestampUs, alignedOther.last().timestampUs) / 1e6;
+    if (end <= start) {
+        return curve;
+    }
+
+    // Evaluate both on one grid, no denser than the plot can show
+    double rate = Resampler::estimateSampleRate(reference);
+    rate = qMin(rate, MAX_RESIDUAL_POINTS / (end - start));
+    if (rate <= 0) {
+        return curve;
+    }
+
+    UniformSeries a = Resampler::resample(reference, rate);
+    UniformSeries b = Resampler::resample(alignedOther, rate);
+
+    curve.reserve(qMin(a.size(), MAX_RESIDUAL_POINTS + 1));
+    for (int i = 0; i < a.size(); ++i) {
+        double t = a.timeAt(i);
+        if (t < start || t > end) {
+            continue;
+        }
+
+        // b is on the same rate but its own phase; interpolate between grid points
+        double u = (t - b.startTime) * rate;
+        int j = qBound(0, int(std::floor(u)), b.size() - 2);
+        double fraction = qBound(0.0, u - j, 1.0);
+        double position = b.position[j] + fraction * (b.position[j + 1] - b.position[j]);
+        curve.append(QPointF(t, a.position[i] - position));
+    }
+
+    return curve;
+}
+
+QString SessionAligner::methodName(AlignmentResult::Method method)
+{
+    switch (method) {
+        case AlignmentResult::CrossCorrelation: return "Cross-correlation";
+        case AlignmentResult::CycleMatching: return "Cycle matching";
+    }
+    return QString();
+}
@@ -0,0 +1,58 @@
+#ifndef SESSIONALIGNER_H
+#define SESSIONALIGNER_H
+
+#include <QVector>
+#include <QPointF>
+#include <QString>
+
+#include "sensordata.h"
+
+struct AlignmentResult {
+    enum Method {
+        CrossCorrelation,
+        CycleMatching
+    };
+
+    bool valid;
+    Method method;
+    double offset;      // s, add to the other session's times to line it up
+    double score;       // peak correlation coefficient, or cycle match quality (0..1)
+    int matchedCycles;  // CycleMatching only
+
+    AlignmentResult() : valid(false), method(CrossCorrelation), offset(0), score(0), matchedCycles(0) {}
+    qint64 offsetMs() const { return qRound64(offset * 1000.0); }
+};
+
+// Finds the time offset between two recordings of the same kind of test.
+//
+// crossCorrelate() resamples position onto a common grid and takes the peak
+// of the FFT cross-correlation; very long runs are searched on a decimated
+// copy first and the peak refined at the full rate. alignCycles() matches
+// the sequences of detected stroke cycles instead, which still works when
+// the runs differ too much in shape for a clean correlation peak.
+class SessionAligner
+{
+public:
+    static AlignmentResult align(const QVector<SensorData>& reference, const QVector<SensorData>& other,
+                                 bool cycleFallback = true);
+    static AlignmentResult crossCorrelate(const QVector<SensorData>& reference, const QVector<SensorData>& other);
+    static AlignmentResult alignCycles(const QVector<SensorData>& reference, const QVector<SensorData>& other);
+
+    static QVector<SensorData> shifted(const QVector<SensorData>& data, qint64 offsetMs);
+
+    // Reference minus other position (mm) over the overlap, vs time in seconds
+    static QVector<QPointF> residual(const QVector<SensorData>& reference, const QVector<SensorData>& alignedOther);
+
+    static QString methodName(AlignmentResult::Method method);
+
+    // Below this correlation align() tries cycle matching
+    static constexpr double MIN_CORRELATION = 0.5;
+
+private:
+    static const int MAX_FFT_SIZE = 1 << 18;
+    static constexpr double MAX_CORRELATION_RATE = 1000.0; // Hz
+    static const int MIN_MATCHED_CYCLES = 3;
+    static const int MAX_RESIDUAL_POINTS = 20000;
+};
+
+#endif // SESSIONALIGNER_H
@@ -0,0 +1,977 @@
+#include "sessionjson.h"
+#include "tracing.h"
+#include "mappedfile.h"
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <QtConcurrent>
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const int MAX_DEPTH = 256;              // nesting accepted in metadata values
+const int MAX_SAMPLE_LENGTH = 512;      // built-in fields of one encoded sample
+const int MAX_NUMBER_LENGTH = 32;
+
+// Key or string token as it appears in the document; escaped tokens
+// contain backslash sequences and must be decoded before use
+struct Token {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    bool escaped = false;
+
+    bool is(const char* literal) const
+    {
+        const size_t length = strlen(literal);
+        return !escaped && size_t(end - begin) == length && memcmp(begin, literal, length) == 0;
+    }
+};
+
+bool isNumberChar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+// Pull parser over a JSON document held in memory
+class JsonCursor
+{
+public:
+    JsonCursor(const char* begin, const char* end) : m_begin(begin), m_p(begin), m_end(end) {}
+
+    const char* begin() const { return m_begin; }
+    const char* end() const { return m_end; }
+    const char* position() const { return m_p; }
+    void seek(const char* p) { m_p = p; }
+    QString errorString() const { return m_error; }
+
+    // Next significant byte, 0 at the end of the document
+    char peek()
+    {
+        while (m_p < m_end && (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t')) {
+            ++m_p;
+        }
+        return m_p < m_end ? *m_p : 0;
+    }
+
+    bool consume(char c)
+    {
+        if (peek() != c) {
+            return false;
+        }
+        ++m_p;
+        return true;
+    }
+
+    bool expect(char c)
+    {
+        return consume(c) || fail(QString("Expected '%1'").arg(QChar(c)));
+    }
+
+    bool setError(const QString& error)
+    {
+        m_error = error;
+        return false;
+    }
+
+    bool fail(const QString& what)
+    {
+        if (m_error.isEmpty()) {
+            m_error = QString("%1 at offset %2").arg(what).arg(m_p - m_begin);
+        }
+        return false;
+    }
+
+    bool string(Token* token)
+    {
+        if (!expect('"')) {
+            return false;
+        }
+        token->begin = m_p;
+        token->escaped = false;
+        while (m_p < m_end && *m_p != '"') {
+            if (*m_p == '\\') {
+                token->escaped = true;
+                ++m_p;
+            }
+            ++m_p;
+        }
+        if (m_p >= m_end) {
+            return fail("Unterminated string");
+        }
+        token->end = m_p++;
+        return true;
+    }
+
+    // String value; anything else reads as an empty string, as
+    // QJsonValue::toString() does
+    bool text(QString* value)
+    {
+        if (peek() != '"') {
+            value->clear();
+            return skip();
+        }
+        Token token;
+        if (!string(&token)) {
+            return false;
+        }
+        *value = decode(token);
+        return true;
+    }
+
+    // Number value; null and non-numbers read as fallback, as
+    // QJsonValue::toDouble(fallback) does
+    bool number(double* value, double fallback)
+    {
+        const char c = peek();
+        if (c != '-' && (c < '0' || c > '9')) {
+            *value = fallback;
+            return skip();
+        }
+        const char* begin = m_p;
+        while (m_p < m_end && isNumberChar(*m_p)) {
+            ++m_p;
+        }
+        const std::from_chars_result result = std::from_chars(begin, m_p, *value);
+        return (result.ec == std::errc() && result.ptr == m_p) || fail("Invalid number");
+    }
+
+    // Integer value; a fraction or exponent is rounded
+    bool integer(qint64* value)
+    {
+        const char c = peek();
+        if (c != '-' && (c < '0' || c > '9')) {
+            *value = 0;
+            return skip();
+        }
+        const char* begin = m_p;
+        while (m_p < m_end && isNumberChar(*m_p)) {
+            ++m_p;
+        }
+        std::from_chars_result result = std::from_chars(begin, m_p, *value);
+        if (result.ec == std::errc() && result.ptr == m_p) {
+            return true;
+        }
+        double real;
+        result = std::from_chars(begin, m_p, real);
+        if (result.ec != std::errc() || result.ptr != m_p) {
+            return fail("Invalid number");
+        }
+        *value = qRound64(real);
+        return true;
+    }
+
+    // Any value as a QJsonValue, for the small metadata objects
+    bool value(QJsonValue* out, int depth = 0)
+    {
+        if (depth > MAX_DEPTH) {
+            return fail("Nesting too deep");
+        }
+        switch (peek()) {
+            case '{': {
+                ++m_p;
+                QJsonObject object;
+                if (!consume('}')) {
+                    do {
+                        Token key;
+                        QJsonValue member;
+                        if (!string(&key) || !expect(':') || !value(&member, depth + 1)) {
+                            return false;
+                        }
+                        object.insert(decode(key), member);
+                    } while (consume(','));
+                    if (!expect('}')) {
+                        return false;
+                    }
+                }
+                *out = object;
+                return true;
+            }
+            case '[': {
+                ++m_p;
+                QJsonArray array;
+                if (!consume(']')) {
+                    do {
+                        QJsonValue element;
+                        if (!value(&element, depth + 1)) {
+                            return false;
+                        }
+                        array.append(element);
+                    } while (consume(','));
+                    if (!expect(']')) {
+                        return false;
+                    }
+                }
+                *out = array;
+                return true;
+            }
+            case '"': {
+                Token token;
+                if (!string(&token)) {
+                    return false;
+                }
+                *out = decode(token);
+                return true;
+            }
+            case 't':
+                *out = true;
+                return literal("true");
+            case 'f':
+                *out = false;
+                return literal("false");
+            case 'n':
+                *out = QJsonValue();
+                return literal("null");
+            default: {
+                const char* begin = m_p;
+                while (m_p < m_end && isNumberChar(*m_p)) {
+                    ++m_p;
+                }
+                qint64 integral;
+                std::from_chars_result result = std::from_chars(begin, m_p, integral);
+                if (begin < m_p && result.ec == std::errc() && result.ptr == m_p) {
+                    *out = integral;
+                    return true;
+                }
+                double real;
+                result = std::from_chars(begin, m_p, real);
+                if (begin == m_p || result.ec != std::errc() || result.ptr != m_p) {
+                    return fail(begin == m_p ? "Unexpected character" : "Invalid number");
+                }
+                *out = real;
+                return true;
+            }
+        }
+    }
+
+    // Passes over a value without building it; containers are only
+    // bracket-matched, not validated
+    bool skip()
+    {
+        const char c = peek();
+        if (c == '"') {
+            Token token;
+            return string(&token);
+        }
+        if (c != '{' && c != '[') {
+            QJsonValue scalar;
+            return value(&scalar);
+        }
+        int level = 0;
+        while (m_p < m_end) {
+            switch (*m_p) {
+                case '"': {
+                    Token token;
+                    if (!string(&token)) {
+                        return false;
+                    }
+                    continue;
+                }
+                case '{':
+                case '[':
+                    ++level;
+                    break;
+                case '}':
+                case ']':
+                    if (--level == 0) {
+                        ++m_p;
+                        return true;
+                    }
+                    break;
+            }
+            ++m_p;
+        }
+        return fail("Unterminated value");
+    }
+
+    static QString decode(const Token& token)
+    {
+        if (!token.escaped) {
+            return QString::fromUtf8(token.begin, int(token.end - token.begin));
+        }
+        // \u escapes are UTF-16 code units, so surrogate pairs join up in
+        // the QString by themselves
+        QString text;
+        const char* run = token.begin;
+        const char* p = token.begin;
+        while (p < token.end) {
+            if (*p != '\\') {
+                ++p;
+                continue;
+            }
+            text += QString::fromUtf8(run, int(p - run));
+            const char escape = *++p;
+            ++p;
+            switch (escape) {
+                case 'b': text += QChar('\b'); break;
+                case 'f': text += QChar('\f'); break;
+                case 'n': text += QChar('\n'); break;
+                case 'r': text += QChar('\r'); break;
+                case 't': text += QChar('\t'); break;
+                case 'u': {
+                    ushort unit = 0xfffd;
+                    if (token.end - p >= 4) {
+                        std::from_chars(p, p + 4, unit, 16);
+                        p += 4;
+                    }
+                    text += QChar(unit);
+                    break;
+                }
+                default: text += QChar(escape); break;
+            }
+            run = p;
+        }
+        return text + QString::fromUtf8(run, int(token.end - run));
+    }
+
+private:
+    bool literal(const char* word)
+    {
+        const size_t length = strlen(word);
+        if (size_t(m_end - m_p) < length || memcmp(m_p, word, length) != 0) {
+            return fail("Invalid literal");
+        }
+        m_p += length;
+        return true;
+    }
+
+    const char* m_begin;
+    const char* m_p;
+    const char* m_end;
+    QString m_error;
+};
+
+// Extra channel as keyed in a sample's "extra" object
+struct ExtraKey {
+    QByteArray name;
+    int index;
+};
+
+QVector<ExtraKey> extraKeys(const ChannelSchema& schema)
+{
+    QVector<ExtraKey> keys;
+    for (const SensorChannel& channel : schema.extraChannels()) {
+        keys << ExtraKey{ channel.name.toUtf8(), channel.extraIndex };
+    }
+    return keys;
+}
+
+bool readExtras(JsonCursor& cursor, const QVector<ExtraKey>& extras, double* values)
+{
+    if (cursor.peek() != '{') {
+        return cursor.skip();
+    }
+    cursor.expect('{');
+    if (cursor.consume('}')) {
+        return true;
+    }
+    do {
+        Token key;
+        if (!cursor.string(&key) || !cursor.expect(':')) {
+            return false;
+        }
+        const QByteArray decoded = key.escaped ? JsonCursor::decode(key).toUtf8() : QByteArray();
+        const char* name = key.escaped ? decoded.constData() : key.begin;
+        const int length = key.escaped ? decoded.size() : int(key.end - key.begin);
+        const ExtraKey* match = nullptr;
+        for (const ExtraKey& extra : extras) {
+            if (extra.name.size() == length && memcmp(extra.name.constData(), name, length) == 0) {
+                match = &extra;
+                break;
+            }
+        }
+        if (!(match ? cursor.number(&values[match->index], qQNaN()) : cursor.skip())) {
+            return false;
+        }
+    } while (cursor.consume(','));
+    return cursor.expect('}');
+}
+
+// One element of "data", with the defaults of DataLogger::sensorDataFromJson()
+bool readSample(JsonCursor& cursor, const QVector<ExtraKey>& extras, SensorExtraStore* store,
+                SensorData* data)
+{
+    if (!cursor.expect('{')) {
+        return false;
+    }
+    double* values = store->allocate(&data->extra, extras.size());
+    std::fill(values, values + extras.size(), qQNaN());
+    bool hasTimestampUs = false;
+    if (!cursor.consume('}')) {
+        do {
+            Token key;
+            if (!cursor.string(&key) || !cursor.expect(':')) {
+                return false;
+            }
+            bool ok;
+            qint64 integral;
+            if (key.is("timestamp")) {
+                ok = cursor.integer(&data->timestamp);
+            } else if (key.is("timestamp_us")) {
+                ok = cursor.integer(&data->timestampUs);
+                hasTimestampUs = true;
+            } else if (key.is("position")) {
+                ok = cursor.number(&data->position, 0);
+            } else if (key.is("force")) {
+                ok = cursor.number(&data->force, 0);
+            } else if (key.is("velocity")) {
+                ok = cursor.number(&data->velocity, 0);
+            } else if (key.is("encoder_pulses")) {
+                ok = cursor.integer(&integral);
+                data->encoderPulses = long(integral);
+            } else if (key.is("source")) {
+                ok = cursor.integer(&integral);
+                data->source = int(integral);
+            } else if (key.is("extra") && !extras.isEmpty()) {
+                ok = readExtras(cursor, extras, values);
+            } else {
+                ok = cursor.skip();
+            }
+            if (!ok) {
+                return false;
+            }
+        } while (cursor.consume(','));
+        if (!cursor.expect('}')) {
+            return false;
+        }
+    }
+    if (!hasTimestampUs) {
+        data->timestampUs = data->timestamp * 1000;
+    }
+    return true;
+}
+
+// Run of "data" elements parsed by one task. end is where the next run
+// starts, right after a separating comma; the last run has none and stops
+// before the closing bracket.
+struct SampleRun {
+    const char* begin;
+    const char* end;
+};
+
+struct RunResult {
+    QVector<SensorData> data;
+    QVector<SensorData> auxiliary;
+    const char* stop;
+    QString error;
+};
+
+RunResult readRun(const char* document, const char* documentEnd, const SampleRun& run,
+                  const QVector<ExtraKey>& extras)
+{
+    RunResult result;
+    result.stop = nullptr;
+    JsonCursor cursor(document, documentEnd);
+    cursor.seek(run.begin);
+    const qint64 length = (run.end ? run.end : documentEnd) - run.begin;
+    SensorExtraStore store;     // runs are read in parallel
+    for (;;) {
+        const char* start = cursor.position();
+        SensorData data;
+        if (!readSample(cursor, extras, &store, &data)) {
+            result.error = cursor.errorString();
+            return result;
+        }
+        // Samples are written alike, so the first one's length sizes the
+        // vector for the rest of the run instead of growing it by copies
+        if (result.data.isEmpty() && result.auxiliary.isEmpty()) {
+            const qint64 estimate = length / qMax<qint64>(cursor.position() - start, 1) + 1;
+            result.data.reserve(int(qMin<qint64>(estimate, std::numeric_limits<int>::max() / 2)));
+        }
+        if (data.source == 0) {
+            result.data.append(std::move(data));
+        } else {
+            result.auxiliary.append(std::move(data));
+        }
+
+        if (!cursor.consume(',')) {
+            result.stop = cursor.position();
+            if (run.end) {
+                result.error = "Sample run ended early";
+            }
+            return result;
+        }
+        if (run.end && cursor.peek() != 0 && cursor.position() >= run.end) {
+            result.stop = cursor.position();
+            if (result.stop != run.end) {
+                result.error = "Sample run overlaps the next";
+            }
+            return result;
+        }
+    }
+}
+
+// Candidate run starts: an element opening a line. Raw newlines only occur
+// between tokens, and both sessionToJson() and SessionJson::write() put
+// each sample on a new line. A candidate that is really inside a sample
+// makes the run before it fail, and the array is then read in one piece.
+QVector<SampleRun> splitRuns(const char* begin, const char* end)
+{
+    QVector<SampleRun> runs;
+    SampleRun run = { begin, nullptr };
+    const char* p = begin + SessionJson::RUN_SIZE;
+    while (p < end) {
+        const char* line = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!line) {
+            break;
+        }
+        p = line + 1;
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+            ++p;
+        }
+        if (p < end && *p == '{') {
+            run.end = p;
+            runs << run;
+            run = { p, nullptr };
+            p += SessionJson::RUN_SIZE;
+        }
+    }
+    runs << run;
+    return runs;
+}
+
+// The "data" array; auxiliary-device samples are split off by source
+bool readSamples(JsonCursor& cursor, const QVector<ExtraKey>& extras, Session* session)
+{
+    session->data.clear();
+    session->auxiliary.clear();
+    if (cursor.peek() != '[') {
+        return cursor.skip();
+    }
+    cursor.expect('[');
+    if (cursor.consume(']')) {
+        return true;
+    }
+
+    const char* document = cursor.begin();
+    const char* documentEnd = cursor.end();
+    const char* begin = cursor.position();
+    const QVector<SampleRun> runs = splitRuns(begin, documentEnd);
+    QVector<RunResult> results = QtConcurrent::blockingMapped<QVector<RunResult>>(runs,
+        [document, documentEnd, &extras](const SampleRun& run) {
+            return readRun(document, documentEnd, run, extras);
+        });
+    const bool failed = std::any_of(results.begin(), results.end(),
+                                    [](const RunResult& result) { return !result.error.isEmpty(); });
+    if (failed && runs.size() > 1) {
+        results = { readRun(document, documentEnd, SampleRun{ begin, nullptr }, extras) };
+    }
+    if (!results.last().error.isEmpty()) {
+        return cursor.setError(results.last().error);
+    }
+
+    const char* stop = results.last().stop;
+    qint64 primary = 0;
+    qint64 auxiliary = 0;
+    for (const RunResult& result : results) {
+        primary += result.data.size();
+        auxiliary += result.auxiliary.size();
+    }
+    if (results.size() == 1) {
+        session->data = std::move(results.first().data);
+        session->auxiliary = std::move(results.first().auxiliary);
+    } else {
+        // Moved over run by run, so the samples are held about once
+        session->data.reserve(primary);
+        session->auxiliary.reserve(auxiliary);
+        for (RunResult& result : results) {
+            session->data.append(std::move(result.data));
+            session->auxiliary.append(std::move(result.auxiliary));
+            result = RunResult();
+        }
+    }
+
+    cursor.seek(stop);
+    return cursor.expect(']');
+}
+
+// The "data" array read in order, handed to sink every chunkSize samples;
+// only the chunk being filled is held
+bool streamSamples(JsonCursor& cursor, const QVector<ExtraKey>& extras, int chunkSize,
+                   const SessionJson::SampleSink& sink, qint64* count)
+{
+    if (cursor.peek() != '[') {
+        return cursor.skip();
+    }
+    cursor.expect('[');
+    if (cursor.consume(']')) {
+        return true;
+    }
+
+    QVector<SensorData> data;
+    QVector<SensorData> auxiliary;
+    data.reserve(chunkSize);
+    auto handOver = [&]() {
+        *count += data.size() + auxiliary.size();
+        if (!sink(data, auxiliary)) {
+            return cursor.setError("Stopped while reading samples");
+        }
+        data.clear();
+        auxiliary.clear();
+        return true;
+    };
+
+    SensorExtraStore store;
+    do {
+        SensorData sample;
+        if (!readSample(cursor, extras, &store, &sample)) {
+            return false;
+        }
+        (sample.source == 0 ? data : auxiliary).append(std::move(sample));
+        if (data.size() + auxiliary.size() >= chunkSize && !handOver()) {
+            return false;
+        }
+    } while (cursor.consume(','));
+
+    if (!cursor.expect(']')) {
+        return false;
+    }
+    return (data.isEmpty() && auxiliary.isEmpty()) || handOver();
+}
+
+void appendString(QByteArray& out, const QString& text)
+{
+    out.append('"');
+    const QByteArray utf8 = text.toUtf8();
+    for (char c : utf8) {
+        switch (c) {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (uchar(c) < 0x20) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", unsigned(uchar(c)));
+                    out.append(escape);
+                } else {
+                    out.append(c);
+                }
+                break;
+        }
+    }
+    out.append('"');
+}
+
+// JSON has no NaN or infinity; like QJsonDocument they are written as null
+char* putNumber(char* out, double value)
+{
+    if (!qIsFinite(value)) {
+        memcpy(out, "null", 4);
+        return out + 4;
+    }
+    return std::to_chars(out, out + MAX_NUMBER_LENGTH, value).ptr;
+}
+
+char* putNumber(char* out, qint64 value)
+{
+    return std::to_chars(out, out + MAX_NUMBER_LENGTH, value).ptr;
+}
+
+template <size_t N>
+char* putLiteral(char* out, const char (&text)[N])
+{
+    memcpy(out, text, N - 1);
+    return out + N - 1;
+}
+
+void appendMember(QByteArray& out, const char* key, const QByteArray& json)
+{
+    out.append(",\n    \"").append(key).append("\": ").append(json);
+}
+
+void appendMember(QByteArray& out, const char* key, double value)
+{
+    char number[MAX_NUMBER_LENGTH];
+    out.append(",\n    \"").append(key).append("\": ").append(number, int(putNumber(number, value) - number));
+}
+
+void appendMember(QByteArray& out, const char* key, const QString& value)
+{
+    out.append(",\n    \"").append(key).append("\": ");
+    appendString(out, value);
+}
+
+} // namespace
+
+SessionJson::SessionJson()
+    : m_samples(0)
+    , m_device(nullptr)
+    , m_written(0)
+{
+}
+
+bool SessionJson::read(const QString& filename, Session* session)
+{
+    return readFile(filename, session, true);
+}
+
+bool SessionJson::readHeader(const QString& filename, Session* session)
+{
+    return readFile(filename, session, false);
+}
+
+bool SessionJson::readChunks(const QString& filename, Session* session, int chunkSize, const SampleSink& sink)
+{
+    return readFile(filename, session, false, qMax(chunkSize, 1), &sink);
+}
+
+bool SessionJson::read(const char* data, qint64 size, Session* session)
+{
+    return parse(data, size, session, true);
+}
+
+bool SessionJson::readFile(const QString& filename, Session* session, bool samples,
+                           int chunkSize, const SampleSink* sink)
+{
+    SHOCKEE_TRACE_SCOPE("storage", "SessionJson::read");
+
+    MappedFile file;
+    if (!file.open(filename)) {
+        m_error = file.errorString();
+        return false;
+    }
+    return parse(file.data(), file.size(), session, samples, chunkSize, sink);
+}
+
+bool SessionJson::parse(const char* data, qint64 size, Session* session, bool samples,
+                        int chunkSize, const SampleSink* sink)
+{
+    m_error.clear();
+    m_samples = 0;
+
+    JsonCursor cursor(MappedFile::skipByteOrderMark(data, data + size), data + size);
+
+    Session result;
+    QVector<ExtraKey> extras;
+    const char* samplesAt = nullptr;
+    bool reparse = false;
+
+    bool ok = cursor.expect('{');
+    if (ok && !cursor.consume('}')) {
+        do {
+            Token key;
+            if (!cursor.string(&key) || !cursor.expect(':')) {
+                ok = false;
+                break;
+            }
+            QJsonValue value;
+            QString text;
+            if (key.is("name")) {
+                ok = cursor.text(&result.name);
+            } else if (key.is("description")) {
+                ok = cursor.text(&result.description);
+            } else if (key.is("timestamp")) {
+                ok = cursor.text(&text);
+                result.timestamp = QDateTime::fromString(text, Qt::ISODate);
+            } else if (key.is("strut_info")) {
+                ok = cursor.text(&result.strut_info);
+            } else if (key.is("spring_rate")) {
+                ok = cursor.number(&result.spring_rate, 0);
+            } else if (key.is("damping_setting")) {
+                ok = cursor.number(&result.damping_setting, 0);
+            } else if (key.is("test_conditions")) {
+                ok = cursor.text(&result.test_conditions);
+            } else if (key.is("link_health")) {
+                ok = cursor.value(&value);
+                result.link_health = LinkHealth::fromJson(value.toObject());
+            } else if (key.is("limit_trips")) {
+                ok = cursor.value(&value);
+                result.limit_trips.clear();
+                for (const QJsonValue& trip : value.toArray()) {
+                    result.limit_trips << LimitTrip::fromJson(trip.toObject());
+                }
+            } else if (key.is("devices")) {
+                ok = cursor.value(&value);
+                result.devices.clear();
+                for (const QJsonValue& device : value.toArray()) {
+                    result.devices << device.toString();
+                }
+            } else if (key.is("channels")) {
+                ok = cursor.value(&value);
+                result.schema = ChannelSchema::fromJson(value.toArray());
+                extras = extraKeys(result.schema);
+                // Files written by sessionToJson() sort "channels" first;
+                // samples already read without the extras are read again
+                reparse = samplesAt && samples && !extras.isEmpty();
+            } else if (key.is("calibration")) {
+                ok = cursor.value(&value);
+                result.calibration = CalibrationSet::fromJson(value.toObject());
+            } else if (key.is("data")) {
+                samplesAt = cursor.position();
+                ok = samples ? readSamples(cursor, extras, &result) : cursor.skip();
+            } else {
+                ok = cursor.skip();
+            }
+        } while (ok && cursor.consume(','));
+        ok = ok && cursor.expect('}');
+    }
+    if (ok && cursor.peek() != 0) {
+        ok = cursor.fail("Unexpected data after the session");
+    }
+    if (ok && reparse) {
+        const char* end = cursor.position();
+        cursor.seek(samplesAt);
+        ok = readSamples(cursor, extras, &result);
+        cursor.seek(end);
+    }
+    // Streamed once the whole header is known, wherever "channels" sits
+    qint64 streamed = 0;
+    if (ok && sink && samplesAt) {
+        cursor.seek(samplesAt);
+        ok = streamSamples(cursor, extras, chunkSize, *sink, &streamed);
+    }
+    if (!ok) {
+        m_error = cursor.errorString();
+        return false;
+    }
+
+    m_samples = streamed + result.data.size() + result.auxiliary.size();
+    *session = std::move(result);
+    return true;
+}
+
+bool SessionJson::write(const Session& session, QIODevice* device)
+{
+    SHOCKEE_TRACE_SCOPE("storage", "SessionJson::write");
+
+    return begin(session, device) && writeSamples(session.data, session.auxiliary) && finish();
+}
+
+bool SessionJson::begin(const Session& session, QIODevice* device)
+{
+    m_error.clear();
+    m_device = device;
+    m_written = 0;
+    m_out.clear();
+    m_out.reserve(WRITE_BUFFER_SIZE + MAX_SAMPLE_LENGTH);
+
+    // Metadata first, so a reader knows the extra channels before the samples
+    QByteArray& out = m_out;
+    out.append("{\n    \"name\": ");
+    appendString(out, session.name);
+    appendMember(out, "description", session.description);
+    appendMember(out, "timestamp", session.timestamp.toString(Qt::ISODate));
+    appendMember(out, "strut_info", session.strut_info);
+    appendMember(out, "spring_rate", session.spring_rate);
+    appendMember(out, "damping_setting", session.damping_setting);
+    appendMember(out, "test_conditions", session.test_conditions);
+    if (session.link_health.linesReceived > 0) {
+        appendMember(out, "link_health",
+                     QJsonDocument(session.link_health.toJson()).toJson(QJsonDocument::Compact));
+    }
+    if (!session.limit_trips.isEmpty()) {
+        QJsonArray trips;
+        for (const LimitTrip& trip : session.limit_trips) {
+            trips.append(trip.toJson());
+        }
+        appendMember(out, "limit_trips", QJsonDocument(trips).toJson(QJsonDocument::Compact));
+    }
+    if (!session.devices.isEmpty()) {
+        appendMember(out, "devices",
+                     QJsonDocument(QJsonArray::fromStringList(session.devices)).toJson(QJsonDocument::Compact));
+    }
+    if (!session.schema.isDefault()) {
+        appendMember(out, "channels", QJsonDocument(session.schema.toJson()).toJson(QJsonDocument::Compact));
+    }
+    if (!session.calibration.isEmpty()) {
+        appendMember(out, "calibration",
+                     QJsonDocument(session.calibration.toJson()).toJson(QJsonDocument::Compact));
+    }
+    out.append(",\n    \"data\": [");
+
+    m_extraNames.clear();
+    m_extraIndexes.clear();
+    for (const SensorChannel& channel : session.schema.extraChannels()) {
+        QByteArray key;
+        appendString(key, channel.name);
+        m_extraNames << key.append(": ");
+        m_extraIndexes << channel.extraIndex;
+    }
+    return true;
+}
+
+bool SessionJson::writeSamples(const QVector<SensorData>& primary, const QVector<SensorData>& auxiliary)
+{
+    // Auxiliary samples are merged in by time as StreamMerger::merge()
+    // orders them, without building the merged copy
+    QByteArray& out = m_out;
+    int p = 0;
+    int a = 0;
+    char line[MAX_SAMPLE_LENGTH];
+    char number[MAX_NUMBER_LENGTH];
+    while (p < primary.size() || a < auxiliary.size()) {
+        const bool fromAuxiliary = a < auxiliary.size()
+            && (p >= primary.size() || auxiliary[a].timestampUs < primary[p].timestampUs);
+        const SensorData& data = fromAuxiliary ? auxiliary[a++] : primary[p++];
+
+        char* o = line;
+        o = putLiteral(o, "\n        {\"timestamp\": ");
+        o = putNumber(o, data.timestamp);
+        if (data.timestampUs != 0) {
+            o = putLiteral(o, ", \"timestamp_us\": ");
+            o = putNumber(o, data.timestampUs);
+        }
+        o = putLiteral(o, ", \"position\": ");
+        o = putNumber(o, data.position);
+        o = putLiteral(o, ", \"force\": ");
+        o = putNumber(o, data.force);
+        o = putLiteral(o, ", \"encoder_pulses\": ");
+        o = putNumber(o, qint64(data.encoderPulses));
+        o = putLiteral(o, ", \"velocity\": ");
+        o = putNumber(o, data.velocity);
+        if (data.source != 0) {
+            o = putLiteral(o, ", \"source\": ");
+            o = putNumber(o, qint64(data.source));
+        }
+        if (m_written++ > 0) {
+            out.append(',');
+        }
+        out.append(line, int(o - line));
+
+        if (!m_extraNames.isEmpty() && !data.extra.isEmpty()) {
+            out.append(", \"extra\": {");
+            for (int i = 0; i < m_extraNames.size(); ++i) {
+                if (i > 0) {
+                    out.append(", ");
+                }
+                out.append(m_extraNames[i]);
+                out.append(number, int(putNumber(number, SensorExtraReader{ m_extraIndexes[i] }(data)) - number));
+            }
+            out.append('}');
+        }
+        out.append('}');
+
+        if (out.size() >= WRITE_BUFFER_SIZE && !flush()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SessionJson::finish()
+{
+    m_out.append(m_written == 0 ? "]\n}\n" : "\n    ]\n}\n");
+    const bool ok = flush();
+    m_device = nullptr;
+    m_out = QByteArray();
+    return ok;
+}
+
+bool SessionJson::flush()
+{
+    if (m_device->write(m_out) != m_out.size()) {
+        m_error = m_device->errorString();
+        return false;
+    }
+    m_out.clear();
+    return true;
+}
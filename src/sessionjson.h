@@ -0,0 +1,73 @@
+#ifndef SESSIONJSON_H
+#define SESSIONJSON_H
+
+#include <QString>
+#include <QIODevice>
+#include <functional>
+
+#include "datalogger.h"
+
+// Streaming reader and writer for the JSON session format.
+//
+// Produces and accepts the same document as DataLogger::sessionToJson()
+// without building a QJsonDocument: the writer encodes samples with
+// std::to_chars into a WRITE_BUFFER_SIZE buffer that is flushed as it
+// fills, the reader pulls tokens from the memory-mapped file and stores
+// sample fields straight into SensorData. The "data" array is cut at
+// sample lines into RUN_SIZE pieces that are parsed in parallel. Only the
+// small metadata objects (channels, calibration, link health, devices) go
+// through QJsonValue, so memory use is the samples themselves.
+//
+// readChunks() and begin()/writeSamples()/finish() are the bounded-memory
+// forms, for rewriting a session that should not be held whole: samples
+// pass through a chunk at a time, in file order.
+class SessionJson
+{
+public:
+    // Primary and auxiliary-device samples of one chunk; false stops the read
+    typedef std::function<bool(QVector<SensorData>& data, QVector<SensorData>& auxiliary)> SampleSink;
+
+    SessionJson();
+
+    bool read(const QString& filename, Session* session);
+    bool read(const char* data, qint64 size, Session* session);
+    // Everything but the samples; the "data" array is skipped unparsed
+    bool readHeader(const QString& filename, Session* session);
+
+    // Everything but the samples goes to session; the samples are handed to
+    // sink about chunkSize at a time, read sequentially
+    bool readChunks(const QString& filename, Session* session, int chunkSize, const SampleSink& sink);
+
+    bool write(const Session& session, QIODevice* device);
+
+    // write() in pieces: the metadata of session (its samples are ignored),
+    // then any number of sample chunks, then the closing brackets
+    bool begin(const Session& session, QIODevice* device);
+    bool writeSamples(const QVector<SensorData>& data, const QVector<SensorData>& auxiliary);
+    bool finish();
+
+    QString errorString() const { return m_error; }
+    qint64 samplesRead() const { return m_samples; }
+
+    static const int WRITE_BUFFER_SIZE = 1 << 20;
+    static const qint64 RUN_SIZE = 4 << 20;     // bytes of samples per parse task
+
+private:
+    bool readFile(const QString& filename, Session* session, bool samples,
+                  int chunkSize = 0, const SampleSink* sink = nullptr);
+    bool parse(const char* data, qint64 size, Session* session, bool samples,
+               int chunkSize = 0, const SampleSink* sink = nullptr);
+    bool flush();
+
+    QString m_error;
+    qint64 m_samples;
+
+    // Writer state between begin() and finish()
+    QIODevice* m_device;
+    QByteArray m_out;
+    QVector<QByteArray> m_extraNames;
+    QVector<int> m_extraIndexes;
+    qint64 m_written;
+};
+
+#endif // SESSIONJSON_H
@@ -0,0 +1,337 @@
+#include "spectralanalyzer.h"
+#include <QtConcurrent>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Segments handed to each worker when averaging long recordings
+const int SEGMENTS_PER_TASK = 64;
+
+QVector<double> hannWindow(int size)
+{
+    // Periodic Hann, the usual choice for overlapped Welch segments
+    QVector<double> window(size);
+    for (int i = 0; i < size; ++i) {
+        window[i] = 0.5 - 0.5 * qCos(2.0 * M_PI * i / size);
+    }
+    return window;
+}
+
+double windowPower(const QVector<double>& window)
+{
+    double sum = 0;
+    for (double w : window) {
+        sum += w * w;
+    }
+    return sum;
+}
+
+// Mean-removed, windowed copy of one segment
+void prepareSegment(const double* samples, const QVector<double>& window, double* out)
+{
+    const int size = window.size();
+
+    double mean = 0;
+    for (int i = 0; i < size; ++i) {
+        mean += samples[i];
+    }
+    mean /= size;
+
+    for (int i = 0; i < size; ++i) {
+        out[i] = (samples[i] - mean) * window[i];
+    }
+}
+
+// Sum of |X|^2 over the given segments, two real segments per complex FFT
+QVector<double> accumulateSegments(const Fft& fft, const QVector<double>& window,
+                                   const double* samples, const QVector<int>& starts)
+{
+    const int size = fft.size();
+    const int bins = size / 2 + 1;
+
+    std::vector<double> a(size), b(size);
+    std::vector<Fft::Complex> spectrumA(bins), spectrumB(bins);
+    QVector<double> power(bins, 0.0);
+
+    for (int s = 0; s < starts.size(); s += 2) {
+        bool pair = s + 1 < starts.size();
+
+        prepareSegment(samples + starts[s], window, a.data());
+        if (pair) {
+            prepareSegment(samples + starts[s + 1], window, b.data());
+        }
+
+        fft.forwardRealPair(a.data(), pair ? b.data() : nullptr,
+                            spectrumA.data(), pair ? spectrumB.data() : nullptr);
+
+        for (int k = 0; k < bins; ++k) {
+            power[k] += std::norm(spectrumA[k]);
+            if (pair) {
+                power[k] += std::norm(spectrumB[k]);
+            }
+        }
+    }
+
+    return power;
+}
+
+// One spectrogram column in dB (PSD scaling)
+QVector<float> framePower(const Fft& fft, const QVector<double>& window, double scale,
+                          const double* samples)
+{
+    const int size = fft.size();
+    const int bins = size / 2 + 1;
+
+    std::vector<double> segment(size);
+    std::vector<Fft::Complex> spectrum(bins);
+    prepareSegment(samples, window, segment.data());
+    fft.forwardRealPair(segment.data(), nullptr, spectrum.data(), nullptr);
+
+    QVector<float> frame(bins);
+    for (int k = 0; k < bins; ++k) {
+        double power = std::norm(spectrum[k]) * scale;
+        if (k > 0 && k < size / 2) {
+            power *= 2.0;
+        }
+        frame[k] = static_cast<float>(10.0 * std::log10(power + 1e-20));
+    }
+    return frame;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// SpectralAnalyzer
+
+double SpectralAnalyzer::channelValue(const SensorData& data, Channel channel)
+{
+    switch (channel) {
+        case Position: return data.position;
+        case Force: return data.force;
+        case Velocity: return data.velocity;
+    }
+    return 0.0;
+}
+
+QString SpectralAnalyzer::channelName(Channel channel)
+{
+    switch (channel) {
+        case Position: return "Position";
+        case Force: return "Force";
+        case Velocity: return "Velocity";
+    }
+    return QString();
+}
+
+QString SpectralAnalyzer::channelUnit(Channel channel)
+{
+    switch (channel) {
+        case Position: return "mm";
+        case Force: return "kg";
+        case Velocity: return "mm/s";
+    }
+    return QString();
+}
+
+const QVector<double>& SpectralAnalyzer::channelSamples(const UniformSeries& series, Channel channel)
+{
+    switch (channel) {
+        case Position: return series.position;
+        case Force: return series.force;
+        case Velocity: return series.velocity;
+    }
+    return series.position;
+}
+
+QVector<double> SpectralAnalyzer::resampleUniform(const QVector<SensorData>& data, Channel channel,
+                                                  double sampleRate)
+{
+    return channelSamples(Resampler::resample(data, sampleRate), channel);
+}
+
+PowerSpectrum SpectralAnalyzer::welch(const QVector<SensorData>& data, Channel channel,
+                                      int segmentSize, double overlap)
+{
+    double sampleRate = Resampler::estimateSampleRate(data);
+    return welch(resampleUniform(data, channel, sampleRate), sampleRate, segmentSize, overlap);
+}
+
+PowerSpectrum SpectralAnalyzer::welch(const QVector<double>& samples, double sampleRate,
+                                      int segmentSize, double overlap)
+{
+    PowerSpectrum spectrum;
+    if (sampleRate <= 0) {
+        return spectrum;
+    }
+
+    // Short recordings fall back to a single, smaller segment
+    int size = Fft::nextPowerOfTwo(qMax(segmentSize, 16));
+    while (size > samples.size() && size > 16) {
+        size >>= 1;
+    }
+    if (size > samples.size()) {
+        return spectrum;
+    }
+
+    const int step = qMax(1, static_cast<int>(size * (1.0 - qBound(0.0, overlap, 0.95))));
+    QVector<int> starts;
+    for (int start = 0; start + size <= samples.size(); start += step) {
+        starts.append(start);
+    }
+
+    const Fft fft(size);
+    const QVector<double> window = hannWindow(size);
+    const double* data = samples.constData();
+
+    QVector<double> power;
+    if (starts.size() <= SEGMENTS_PER_TASK) {
+        power = accumulateSegments(fft, window, data, starts);
+    } else {
+        QVector<QVector<int>> tasks;
+        for (int i = 0; i < starts.size(); i += SEGMENTS_PER_TASK) {
+            tasks.append(starts.mid(i, SEGMENTS_PER_TASK));
+        }
+
+        power = QtConcurrent::blockingMappedReduced<QVector<double>>(tasks,
+            [&fft, &window, data](const QVector<int>& taskStarts) {
+                return accumulateSegments(fft, window, data, taskStarts);
+            },
+            [](QVector<double>& total, const QVector<double>& partial) {
+                if (total.isEmpty()) {
+                    total = partial;
+                    return;
+                }
+                for (int k = 0; k < total.size(); ++k) {
+                    total[k] += partial[k];
+                }
+            },
+            QtConcurrent::OrderedReduce);
+    }
+
+    // One-sided PSD normalisation
+    const int bins = size / 2 + 1;
+    const double scale = 1.0 / (starts.size() * sampleRate * windowPower(window));
+
+    spectrum.sampleRate = sampleRate;
+    spectrum.segmentCount = starts.size();
+    spectrum.frequency.resize(bins);
+    spectrum.power.resize(bins);
+    for (int k = 0; k < bins; ++k) {
+        spectrum.frequency[k] = k * sampleRate / size;
+        spectrum.power[k] = power[k] * scale * ((k > 0 && k < size / 2) ? 2.0 : 1.0);
+    }
+
+    return spectrum;
+}
+
+QVector<QVector<float>> SpectralAnalyzer::spectrogram(const QVector<double>& samples, double sampleRate,
+                                                      int segmentSize, int hop)
+{
+    QVector<QVector<float>> frames;
+
+    const int size = Fft::nextPowerOfTwo(qMax(segmentSize, 16));
+    hop = qMax(1, hop);
+    if (samples.size() < size || sampleRate <= 0) {
+        return frames;
+    }
+
+    QVector<int> starts;
+    for (int start = 0; start + size <= samples.size(); start += hop) {
+        starts.append(start);
+    }
+
+    const Fft fft(size);
+    const QVector<double> window = hannWindow(size);
+    const double scale = 1.0 / (sampleRate * windowPower(window));
+    const double* data = samples.constData();
+
+    return QtConcurrent::blockingMapped<QVector<QVector<float>>>(starts,
+        [&fft, &window, scale, data](int start) {
+            return framePower(fft, window, scale, data + start);
+        });
+}
+
+QVector<QPointF> SpectralAnalyzer::toDecibelCurve(const PowerSpectrum& spectrum)
+{
+    QVector<QPointF> curve;
+    curve.reserve(spectrum.power.size());
+    for (int k = 0; k < spectrum.power.size(); ++k) {
+        curve.append(QPointF(spectrum.frequency[k], 10.0 * std::log10(spectrum.power[k] + 1e-20)));
+    }
+    return curve;
+}
+
+// ---------------------------------------------------------------------------
+// SpectrogramStream
+
+SpectrogramStream::SpectrogramStream(SpectralAnalyzer::Channel channel, int segmentSize, int hop)
+{
+    configure(channel, segmentSize, hop);
+}
+
+void SpectrogramStream::configure(SpectralAnalyzer::Channel channel, int segmentSize, int hop)
+{
+    m_channel = channel;
+    m_segmentSize = Fft::nextPowerOfTwo(qMax(segmentSize, 16));
+    m_hop = qBound(1, hop, m_segmentSize);
+    m_fft.reset(new Fft(m_segmentSize));
+    m_window = hannWindow(m_segmentSize);
+    reset();
+}
+
+void SpectrogramStream::reset()
+{
+    m_resampler.configure(0, Resampler::Linear);
+    m_ring.fill(0.0, m_segmentSize);
+    m_ringHead = 0;
+    m_ringFilled = 0;
+    m_sinceFrame = 0;
+    m_pendingFrames.clear();
+}
+
+int SpectrogramStream::addSample(const SensorData& data)
+{
+    if (m_resampler.addSample(data) > 0) {
+        for (;;) {
+            UniformSeries block = m_resampler.takeSamples();
+            if (block.isEmpty()) {
+                break;
+            }
+            for (double value : SpectralAnalyzer::channelSamples(block, m_channel)) {
+                pushGridSample(value);
+            }
+        }
+    }
+
+    return m_pendingFrames.size();
+}
+
+QVector<float> SpectrogramStream::takeFrame()
+{
+    return m_pendingFrames.isEmpty() ? QVector<float>() : m_pendingFrames.takeFirst();
+}
+
+void SpectrogramStream::pushGridSample(double value)
+{
+    m_ring[m_ringHead] = value;
+    m_ringHead = (m_ringHead + 1) % m_segmentSize;
+    m_ringFilled = qMin(m_ringFilled + 1, m_segmentSize);
+    ++m_sinceFrame;
+
+    if (m_ringFilled < m_segmentSize || m_sinceFrame < m_hop) {
+        return;
+    }
+    m_sinceFrame = 0;
+
+    // Unroll the ring, oldest sample first
+    QVector<double> segment(m_segmentSize);
+    for (int i = 0; i < m_segmentSize; ++i) {
+        segment[i] = m_ring[(m_ringHead + i) % m_segmentSize];
+    }
+
+    const double scale = 1.0 / (sampleRate() * windowPower(m_window));
+    m_pendingFrames.append(framePower(*m_fft, m_window, scale, segment.constData()));
+}
@@ -0,0 +1,101 @@
+#ifndef SPECTRALANALYZER_H
+#define SPECTRALANALYZER_H
+
+#include <QVector>
+#include <QPointF>
+#include <QString>
+#include <memory>
+
+#include "sensordata.h"
+#include "fft.h"
+#include "resampler.h"
+
+struct PowerSpectrum {
+    double sampleRate;          // Hz of the uniform grid the PSD was taken on
+    QVector<double> frequency;  // Hz, bins 0 .. sampleRate/2
+    QVector<double> power;      // one-sided PSD, unit^2/Hz
+    int segmentCount;
+
+    PowerSpectrum() : sampleRate(0), segmentCount(0) {}
+    bool isEmpty() const { return power.isEmpty(); }
+};
+
+// Frequency-domain analysis of a session channel. Samples are first put on a
+// uniform time grid by the Resampler (the device timestamps jitter by a
+// millisecond or more), then split into Hann-windowed, overlapping segments.
+class SpectralAnalyzer
+{
+public:
+    enum Channel {
+        Position,
+        Force,
+        Velocity
+    };
+
+    static double channelValue(const SensorData& data, Channel channel);
+    static const QVector<double>& channelSamples(const UniformSeries& series, Channel channel);
+    static QString channelName(Channel channel);
+    static QString channelUnit(Channel channel);
+
+    static QVector<double> resampleUniform(const QVector<SensorData>& data, Channel channel,
+                                          double sampleRate);
+
+    // Welch averaged periodogram
+    static PowerSpectrum welch(const QVector<SensorData>& data, Channel channel,
+                               int segmentSize = DEFAULT_SEGMENT_SIZE, double overlap = DEFAULT_OVERLAP);
+    static PowerSpectrum welch(const QVector<double>& samples, double sampleRate,
+                               int segmentSize = DEFAULT_SEGMENT_SIZE, double overlap = DEFAULT_OVERLAP);
+
+    // Short-time power spectra in dB (PSD scaling), one frame per hop
+    static QVector<QVector<float>> spectrogram(const QVector<double>& samples, double sampleRate,
+                                               int segmentSize, int hop);
+
+    static QVector<QPointF> toDecibelCurve(const PowerSpectrum& spectrum);
+
+    static const int DEFAULT_SEGMENT_SIZE = 512;
+    static constexpr double DEFAULT_OVERLAP = 0.5;
+};
+
+// Incremental spectrogram for live capture. Incoming samples are put on a
+// uniform grid by a streaming Resampler at the rate of the first samples; a
+// new frame is produced every hop grid samples.
+class SpectrogramStream
+{
+public:
+    SpectrogramStream(SpectralAnalyzer::Channel channel = SpectralAnalyzer::Position,
+                      int segmentSize = SpectralAnalyzer::DEFAULT_SEGMENT_SIZE,
+                      int hop = SpectralAnalyzer::DEFAULT_SEGMENT_SIZE / 4);
+
+    void reset();
+    void configure(SpectralAnalyzer::Channel channel, int segmentSize, int hop);
+
+    // Returns the number of frames waiting in takeFrame()
+    int addSample(const SensorData& data);
+    QVector<float> takeFrame();
+
+    bool isReady() const { return m_resampler.isReady(); }
+    double sampleRate() const { return m_resampler.sampleRate(); }
+    double frameInterval() const { return isReady() ? m_hop / sampleRate() : 0; }
+    double maxFrequency() const { return sampleRate() / 2; }
+
+private:
+    void pushGridSample(double value);
+
+    SpectralAnalyzer::Channel m_channel;
+    int m_segmentSize;
+    int m_hop;
+    std::unique_ptr<Fft> m_fft;
+    QVector<double> m_window;
+
+    Resampler m_resampler;
+
+    // Grid ring buffer
+    QVector<double> m_ring;
+    int m_ringHead;
+    int m_ringFilled;
+    int m_sinceFrame;
+
+    QVector<QVector<float>> m_pendingFrames;
+};
+
+#endif // SPECTRALANALYZER_H
@@ -0,0 +1,178 @@
+#include "streammerger.h"
+#include <queue>
+
+StreamMerger::StreamMerger(int sourceCount)
+    : m_maxLatency(DEFAULT_MAX_LATENCY)
+    , m_capacity(DEFAULT_CAPACITY)
+{
+    setSourceCount(sourceCount);
+    reset();
+}
+
+void StreamMerger::setSourceCount(int count)
+{
+    m_sources.resize(qMax(0, count));
+}
+
+void StreamMerger::reset()
+{
+    for (Source& source : m_sources) {
+        source = Source();
+    }
+    m_newest = 0;
+    m_released = 0;
+    m_hasReleased = false;
+}
+
+bool StreamMerger::push(int source, SensorData data)
+{
+    if (source < 0 || source >= m_sources.size()) {
+        return false;
+    }
+
+    Source& state = m_sources[source];
+    ++state.stats.pushed;
+
+    // Older than what has gone out: releasing it would break the order
+    if (m_hasReleased && data.timestampUs < m_released) {
+        ++state.stats.dropped;
+        return false;
+    }
+
+    data.source = source;
+    state.queue.push_back(data);
+    state.lastSeen = qMax(state.lastSeen, data.timestampUs);
+    state.seen = true;
+    state.stats.maxQueued = qMax(state.stats.maxQueued, int(state.queue.size()));
+    m_newest = qMax(m_newest, data.timestampUs);
+    return true;
+}
+
+QVector<SensorData> StreamMerger::take(qint64 now)
+{
+    QVector<SensorData> out;
+    const qint64 horizon = qMax(m_newest, now);
+
+    for (;;) {
+        int oldest = oldestHead();
+        if (oldest < 0) {
+            break;
+        }
+
+        bool full = false;
+        for (const Source& source : m_sources) {
+            full = full || int(source.queue.size()) >= m_capacity;
+        }
+
+        const qint64 timestamp = m_sources[oldest].queue.front().timestampUs;
+        if (canRelease(oldest, timestamp, horizon)) {
+            release(oldest, out);
+        } else if (full) {
+            ++m_sources[oldest].stats.forced;
+            release(oldest, out);
+        } else {
+            break;
+        }
+    }
+    return out;
+}
+
+QVector<SensorData> StreamMerger::flush()
+{
+    QVector<SensorData> out;
+    for (int oldest = oldestHead(); oldest >= 0; oldest = oldestHead()) {
+        release(oldest, out);
+    }
+    return out;
+}
+
+StreamMerger::SourceStats StreamMerger::stats(int source) const
+{
+    if (source < 0 || source >= m_sources.size()) {
+        return SourceStats();
+    }
+    SourceStats stats = m_sources[source].stats;
+    stats.queued = int(m_sources[source].queue.size());
+    return stats;
+}
+
+QVector<SensorData> StreamMerger::merge(const QVector<QVector<SensorData>>& streams)
+{
+    // Min-heap of (timestamp, stream, index) over the stream heads
+    struct Head {
+        qint64 timestamp;
+        int stream;
+        int index;
+        bool operator>(const Head& other) const
+        {
+            return timestamp != other.timestamp ? timestamp > other.timestamp : stream > other.stream;
+        }
+    };
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+
+    int total = 0;
+    for (int s = 0; s < streams.size(); ++s) {
+        total += streams[s].size();
+        if (!streams[s].isEmpty()) {
+            heads.push({ streams[s].first().timestampUs, s, 0 });
+        }
+    }
+
+    QVector<SensorData> out;
+    out.reserve(total);
+    while (!heads.empty()) {
+        Head head = heads.top();
+        heads.pop();
+
+        out.append(streams[head.stream][head.index]);
+
+        if (++head.index < streams[head.stream].size()) {
+            head.timestamp = streams[head.stream][head.index].timestampUs;
+            heads.push(head);
+        }
+    }
+    return out;
+}
+
+int StreamMerger::oldestHead() const
+{
+    // k is the number of devices, so a scan beats keeping a heap in sync
+    int oldest = -1;
+    for (int i = 0; i < m_sources.size(); ++i) {
+        const std::deque<SensorData>& queue = m_sources[i].queue;
+        if (!queue.empty()
+            && (oldest < 0 || queue.front().timestampUs < m_sources[oldest].queue.front().timestampUs)) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+bool StreamMerger::canRelease(int source, qint64 timestamp, qint64 horizon) const
+{
+    // Waited long enough for everyone
+    if (timestamp <= horizon - m_maxLatency) {
+        return true;
+    }
+
+    // Otherwise every other source must already be past this time; queued
+    // heads are, being no older than the oldest head
+    for (int i = 0; i < m_sources.size(); ++i) {
+        const Source& other = m_sources[i];
+        if (i != source && other.queue.empty() && (!other.seen || other.lastSeen < timestamp)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void StreamMerger::release(int source, QVector<SensorData>& out)
+{
+    Source& state = m_sources[source];
+    out.append(state.queue.front());
+    state.queue.pop_front();
+    ++state.stats.released;
+
+    m_released = out.last().timestampUs;
+    m_hasReleased = true;
+}
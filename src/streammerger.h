@@ -0,0 +1,85 @@
+#ifndef STREAMMERGER_H
+#define STREAMMERGER_H
+
+#include <QVector>
+#include <deque>
+
+#include "sensordata.h"
+
+// Bounded k-way merge of per-device sample streams into one time-ordered
+// stream, keyed on the reconstructed timestampUs.
+//
+// Each source must be monotonic on its own (DeviceClock guarantees this).
+// A queued sample is released once every other source has been seen at or
+// past its time, so nothing older can still arrive. A source that falls
+// more than maxLatency behind the newest data is not waited for; if it
+// catches up later its samples are older than what has been released and
+// are dropped to keep the output ordered. A queue that reaches capacity
+// releases its head regardless, so memory stays bounded when one source
+// floods while another is silent.
+class StreamMerger
+{
+public:
+    struct SourceStats {
+        qint64 pushed;
+        qint64 released;
+        qint64 dropped;     // arrived after newer samples were released
+        qint64 forced;      // released early because the queue was full
+        int queued;
+        int maxQueued;
+
+        SourceStats() : pushed(0), released(0), dropped(0), forced(0), queued(0), maxQueued(0) {}
+    };
+
+    explicit StreamMerger(int sourceCount = 0);
+
+    void setSourceCount(int count);
+    int sourceCount() const { return m_sources.size(); }
+    void reset();
+
+    // us of data time to wait for a lagging source
+    void setMaxLatency(qint64 latency) { m_maxLatency = latency; }
+    qint64 maxLatency() const { return m_maxLatency; }
+    void setCapacity(int capacity) { m_capacity = qMax(1, capacity); }
+
+    // Sets data.source; returns false if the sample was too late and dropped
+    bool push(int source, SensorData data);
+
+    // Samples that can be released in order. now (us, same clock as the
+    // timestamps) lets silent sources time out when no new data arrives.
+    QVector<SensorData> take(qint64 now = 0);
+    // Everything still queued, in order
+    QVector<SensorData> flush();
+
+    SourceStats stats(int source) const;
+
+    // Offline merge of already ordered streams; each sample keeps its source
+    static QVector<SensorData> merge(const QVector<QVector<SensorData>>& streams);
+
+    static const qint64 DEFAULT_MAX_LATENCY = 200000; // us
+    static const int DEFAULT_CAPACITY = 10000;
+
+private:
+    struct Source {
+        std::deque<SensorData> queue;
+        qint64 lastSeen;    // us, newest timestamp pushed
+        bool seen;
+        SourceStats stats;
+
+        Source() : lastSeen(0), seen(false) {}
+    };
+
+    // Index of the queue holding the oldest head, -1 if all are empty
+    int oldestHead() const;
+    bool canRelease(int source, qint64 timestamp, qint64 horizon) const;
+    void release(int source, QVector<SensorData>& out);
+
+    QVector<Source> m_sources;
+    qint64 m_maxLatency;
+    int m_capacity;
+    qint64 m_newest;        // us, newest timestamp from any source
+    qint64 m_released;      // us, timestamp of the last released sample
+    bool m_hasReleased;
+};
+
+#endif // STREAMMERGER_H
@@ -0,0 +1,300 @@
+#include "tracing.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QDebug>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct TraceEvent
+{
+    const char* category;
+    const char* name;
+    qint64 start;
+    qint64 end;
+};
+
+// Single producer (the owning thread), read by toChromeTrace(). The writer
+// publishes each event by bumping head with release ordering.
+struct TraceBuffer
+{
+    TraceBuffer(int threadId, const QString& threadName)
+        : events(Tracer::BUFFER_CAPACITY)
+        , head(0)
+        , tid(threadId)
+        , name(threadName)
+    {
+    }
+
+    std::vector<TraceEvent> events;
+    std::atomic<quint64> head;
+    int tid;
+    QString name;
+};
+
+// Events of a thread that has exited, kept until the next export or clear()
+struct RetiredThread
+{
+    int tid;
+    QString name;
+    std::deque<TraceEvent> events;
+};
+
+struct TraceRegistry
+{
+    QMutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;  // rings of running threads
+    std::vector<std::unique_ptr<TraceBuffer>> spare;    // rings of exited threads, for reuse
+    std::deque<RetiredThread> retired;
+    qint64 retiredEvents = 0;
+    qint64 retiredDropped = 0;
+    int nextTid = 1;
+};
+
+TraceRegistry& registry()
+{
+    static TraceRegistry instance;
+    return instance;
+}
+
+// Events that started before this are hidden by clear(); rewinding the
+// rings from another thread would race with their writers
+std::atomic<qint64> clearedAt(0);
+
+// At most one ring's worth of events outlives the threads that recorded
+// them; the oldest go first
+const qint64 MAX_RETIRED_EVENTS = Tracer::BUFFER_CAPACITY;
+
+TraceBuffer* createThreadBuffer()
+{
+    TraceRegistry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+
+    // Thread ids are never reused, so a recycled ring shows as a new thread
+    const int tid = reg.nextTid++;
+    QThread* thread = QThread::currentThread();
+    QString name = thread->objectName();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        name = "Main";
+    } else if (name.isEmpty()) {
+        name = QString("Thread %1").arg(tid);
+    }
+
+    if (reg.spare.empty()) {
+        reg.buffers.push_back(std::make_unique<TraceBuffer>(tid, name));
+    } else {
+        std::unique_ptr<TraceBuffer> buffer = std::move(reg.spare.back());
+        reg.spare.pop_back();
+        buffer->head.store(0, std::memory_order_relaxed);
+        buffer->tid = tid;
+        buffer->name = name;
+        reg.buffers.push_back(std::move(buffer));
+    }
+    return reg.buffers.back().get();
+}
+
+// Called on the owning thread as it exits, so nothing writes the ring
+// while its events are moved out
+void releaseThreadBuffer(TraceBuffer* buffer)
+{
+    TraceRegistry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+
+    const quint64 head = buffer->head.load(std::memory_order_relaxed);
+    const quint64 first = head > quint64(Tracer::BUFFER_CAPACITY) ? head - Tracer::BUFFER_CAPACITY : 0;
+    reg.retiredDropped += qint64(first);
+    if (head > first) {
+        RetiredThread retired{ buffer->tid, buffer->name, {} };
+        for (quint64 i = first; i < head; ++i) {
+            retired.events.push_back(buffer->events[i % Tracer::BUFFER_CAPACITY]);
+        }
+        reg.retiredEvents += qint64(head - first);
+        reg.retired.push_back(std::move(retired));
+    }
+    while (reg.retiredEvents > MAX_RETIRED_EVENTS) {
+        RetiredThread& oldest = reg.retired.front();
+        oldest.events.pop_front();
+        --reg.retiredEvents;
+        ++reg.retiredDropped;
+        if (oldest.events.empty()) {
+            reg.retired.pop_front();
+        }
+    }
+
+    auto it = std::find_if(reg.buffers.begin(), reg.buffers.end(),
+                           [buffer](const std::unique_ptr<TraceBuffer>& owned) { return owned.get() == buffer; });
+    if (it != reg.buffers.end()) {
+        reg.spare.push_back(std::move(*it));
+        reg.buffers.erase(it);
+    }
+}
+
+// Hands the thread's ring back when the thread exits; pool threads come and
+// go, and each would otherwise keep its ring for the life of the process
+struct ThreadBufferOwner
+{
+    TraceBuffer* buffer = nullptr;
+
+    ~ThreadBufferOwner()
+    {
+        if (buffer) {
+            releaseThreadBuffer(buffer);
+        }
+    }
+};
+
+thread_local ThreadBufferOwner threadBuffer;
+
+QJsonObject threadNameEvent(qint64 pid, int tid, const QString& name)
+{
+    QJsonObject args;
+    args["name"] = name;
+
+    QJsonObject json;
+    json["name"] = "thread_name";
+    json["ph"] = "M";
+    json["pid"] = pid;
+    json["tid"] = tid;
+    json["args"] = args;
+    return json;
+}
+
+// Chrome trace timestamps are microseconds
+QJsonObject completeEvent(qint64 pid, int tid, const TraceEvent& event)
+{
+    QJsonObject json;
+    json["name"] = event.name;
+    json["cat"] = event.category;
+    json["ph"] = "X";
+    json["ts"] = event.start / 1000.0;
+    json["dur"] = (event.end - event.start) / 1000.0;
+    json["pid"] = pid;
+    json["tid"] = tid;
+    return json;
+}
+
+} // namespace
+
+std::atomic<bool> Tracer::s_enabled(false);
+
+void Tracer::setEnabled(bool enabled)
+{
+    // Start the clock before the first scope reads it
+    now();
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 Tracer::now()
+{
+    static const QElapsedTimer clock = [] {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return clock.nsecsElapsed();
+}
+
+void Tracer::complete(const char* category, const char* name, qint64 start, qint64 end)
+{
+    TraceBuffer*& buffer = threadBuffer.buffer;
+    if (!buffer) {
+        buffer = createThreadBuffer();
+    }
+
+    const quint64 head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head % BUFFER_CAPACITY] = { category, name, start, end };
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::clear()
+{
+    clearedAt.store(now(), std::memory_order_relaxed);
+
+    // Exited threads' events can simply go
+    TraceRegistry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    reg.retired.clear();
+    reg.retiredEvents = 0;
+    reg.retiredDropped = 0;
+}
+
+QByteArray Tracer::toChromeTrace()
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    const qint64 since = clearedAt.load(std::memory_order_relaxed);
+
+    QJsonArray events;
+    qint64 dropped = 0;
+
+    TraceRegistry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+
+    for (const RetiredThread& thread : reg.retired) {
+        events.append(threadNameEvent(pid, thread.tid, thread.name));
+        for (const TraceEvent& event : thread.events) {
+            if (event.start >= since) {
+                events.append(completeEvent(pid, thread.tid, event));
+            }
+        }
+    }
+    dropped += reg.retiredDropped;
+
+    for (const std::unique_ptr<TraceBuffer>& buffer : reg.buffers) {
+        events.append(threadNameEvent(pid, buffer->tid, buffer->name));
+
+        // Copy what is there, then discard anything the writer lapped meanwhile
+        const quint64 head = buffer->head.load(std::memory_order_acquire);
+        const quint64 first = head > quint64(BUFFER_CAPACITY) ? head - BUFFER_CAPACITY : 0;
+        std::vector<TraceEvent> snapshot;
+        snapshot.reserve(head - first);
+        for (quint64 i = first; i < head; ++i) {
+            snapshot.push_back(buffer->events[i % BUFFER_CAPACITY]);
+        }
+
+        // The writer may already be filling slot newHead, which holds event
+        // newHead - BUFFER_CAPACITY, so that one is suspect as well
+        const quint64 newHead = buffer->head.load(std::memory_order_acquire);
+        const quint64 valid = newHead >= quint64(BUFFER_CAPACITY) ? newHead - BUFFER_CAPACITY + 1 : 0;
+        dropped += qint64(qMax(first, valid));
+
+        for (quint64 i = qMax(first, valid); i < head; ++i) {
+            const TraceEvent& event = snapshot[i - first];
+            if (event.start >= since) {
+                events.append(completeEvent(pid, buffer->tid, event));
+            }
+        }
+    }
+
+    QJsonObject otherData;
+    otherData["application"] = QCoreApplication::applicationName();
+    otherData["dropped_events"] = dropped;
+
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+    trace["otherData"] = otherData;
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+bool Tracer::writeChromeTrace(const QString& filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open trace file for writing:" << filename;
+        return false;
+    }
+
+    file.write(toChromeTrace());
+    file.close();
+    return true;
+}
@@ -0,0 +1,231 @@
+#include "triggercapture.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSettings>
+
+QJsonObject TriggerCapture::Options::toJson() const
+{
+    QJsonArray list;
+    for (const TriggerCondition& condition : conditions) {
+        list.append(condition.toJson());
+    }
+    QJsonObject json;
+    json["conditions"] = list;
+    json["require_all"] = requireAll;
+    json["pre_trigger"] = preTrigger;
+    json["post_trigger"] = postTrigger;
+    json["auto_rearm"] = autoRearm;
+    json["source"] = source;
+    return json;
+}
+
+TriggerCapture::Options TriggerCapture::Options::fromJson(const QJsonObject& json)
+{
+    Options options;
+    for (const QJsonValue& condition : json["conditions"].toArray()) {
+        options.conditions << TriggerCondition::fromJson(condition.toObject());
+    }
+    options.requireAll = json["require_all"].toBool(options.requireAll);
+    options.preTrigger = qMax(0.0, json["pre_trigger"].toDouble(options.preTrigger));
+    options.postTrigger = qMax(0.0, json["post_trigger"].toDouble(options.postTrigger));
+    options.autoRearm = json["auto_rearm"].toBool(options.autoRearm);
+    options.source = json["source"].toInt(options.source);
+    return options;
+}
+
+TriggerCapture::Options TriggerCapture::Options::fromSettings()
+{
+    QSettings settings;
+    const QByteArray options = settings.value("Trigger/options").toByteArray();
+    if (options.isEmpty()) {
+        // A force spike of either sign, as in a bump or a bottoming event
+        Options defaults;
+        defaults.conditions << TriggerCondition("force", TriggerCondition::Magnitude, 50.0);
+        return defaults;
+    }
+    return fromJson(QJsonDocument::fromJson(options).object());
+}
+
+void TriggerCapture::Options::saveToSettings() const
+{
+    QSettings settings;
+    settings.setValue("Trigger/options", QJsonDocument(toJson()).toJson(QJsonDocument::Compact));
+}
+
+double TriggerCapture::Capture::duration() const
+{
+    return data.size() < 2 ? 0.0 : (data.last().timestampUs - data.first().timestampUs) / 1e6;
+}
+
+TriggerCapture::TriggerCapture(const Options& options)
+    : m_options(options)
+{
+    reset();
+}
+
+void TriggerCapture::setOptions(const Options& options)
+{
+    m_options = options;
+    resolveConditions();
+}
+
+void TriggerCapture::setSchema(const ChannelSchema& schema, const CalibrationSet& calibration)
+{
+    m_conditions.setChannels(calibration.plotChannels(schema));
+    // Nothing fires until the conditions have been seen inactive
+    m_wasActive = true;
+}
+
+void TriggerCapture::resolveConditions()
+{
+    m_conditions.setConditions(m_options.conditions);
+    // Nothing fires until the conditions have been seen inactive
+    m_wasActive = true;
+}
+
+QStringList TriggerCapture::unresolvedChannels() const
+{
+    return m_conditions.unresolvedChannels();
+}
+
+QVector<ChannelCondition::Type> TriggerCapture::conditionTypes()
+{
+    return { ChannelCondition::Magnitude, ChannelCondition::Above, ChannelCondition::Below,
+             ChannelCondition::Crossing, ChannelCondition::Rate };
+}
+
+void TriggerCapture::arm()
+{
+    if (m_state == Idle) {
+        m_state = Armed;
+    }
+}
+
+void TriggerCapture::disarm()
+{
+    if (m_state == Capturing) {
+        finishCapture(false);
+    }
+    m_state = Idle;
+}
+
+void TriggerCapture::reset()
+{
+    m_state = Idle;
+    m_ring.clear();
+    m_ringHead = 0;
+    m_ringCount = 0;
+    m_capture = Capture();
+    m_completed.clear();
+    m_captureCount = 0;
+    resolveConditions();
+}
+
+int TriggerCapture::addSample(const SensorData& data)
+{
+    // Conditions are tracked while idle too, so arming during a sustained
+    // event waits for the next one
+    bool fired = false;
+    int condition = -1;
+    if (data.source == m_options.source) {
+        const bool active = evaluate(data, &condition);
+        fired = active && !m_wasActive;
+        m_wasActive = active;
+    }
+
+    if (m_state == Capturing) {
+        if (data.timestampUs - m_capture.triggerTimeUs <= qint64(m_options.postTrigger * 1e6)) {
+            m_capture.data.append(data);
+        } else {
+            finishCapture(true);
+        }
+    }
+
+    pushRing(data);
+
+    // The sample completing one capture may start the next, whose
+    // pre-trigger data then overlaps the previous capture's tail
+    if (m_state == Armed && fired) {
+        startCapture(data, condition);
+    }
+    return m_completed.size();
+}
+
+TriggerCapture::Capture TriggerCapture::takeCapture()
+{
+    return m_completed.isEmpty() ? Capture() : m_completed.dequeue();
+}
+
+bool TriggerCapture::evaluate(const SensorData& data, int* firstActive)
+{
+    *firstActive = -1;
+    bool any = false;
+    bool all = m_conditions.size() > 0;
+    for (int i = 0; i < m_conditions.size(); ++i) {
+        const bool active = m_conditions.test(i, data);
+        if (active && *firstActive < 0) {
+            *firstActive = i;
+        }
+        any = any || active;
+        all = all && active;
+    }
+    return m_options.requireAll ? all : any;
+}
+
+void TriggerCapture::pushRing(const SensorData& data)
+{
+    if (m_ringCount == m_ring.size()) {
+        if (m_ringCount == MAX_RING_SAMPLES) {
+            m_ringHead = (m_ringHead + 1) % m_ring.size();
+            --m_ringCount;
+        } else {
+            // Unrolled into a larger ring, oldest first
+            QVector<SensorData> grown(qMin(qMax(64, m_ring.size() * 2), int(MAX_RING_SAMPLES)));
+            for (int i = 0; i < m_ringCount; ++i) {
+                grown[i] = std::move(m_ring[(m_ringHead + i) % m_ring.size()]);
+            }
+            m_ring.swap(grown);
+            m_ringHead = 0;
+        }
+    }
+    m_ring[(m_ringHead + m_ringCount) % m_ring.size()] = data;
+    ++m_ringCount;
+
+    const qint64 oldest = data.timestampUs - qint64(m_options.preTrigger * 1e6);
+    while (m_ringCount > 1 && m_ring[m_ringHead].timestampUs < oldest) {
+        m_ringHead = (m_ringHead + 1) % m_ring.size();
+        --m_ringCount;
+    }
+}
+
+void TriggerCapture::startCapture(const SensorData& data, int condition)
+{
+    m_capture = Capture();
+    m_capture.triggerTimeUs = data.timestampUs;
+    m_capture.condition = condition;
+
+    // Sized from the ring's sample rate so appends during the capture do
+    // not reallocate on the acquisition path
+    const SensorData& oldest = m_ring[m_ringHead];
+    const double span = (data.timestampUs - oldest.timestampUs) / 1e6;
+    const int expected = span > 0 ? int(qMin(m_ringCount / span * m_options.postTrigger, double(MAX_RING_SAMPLES))) : 0;
+    m_capture.data.reserve(m_ringCount + expected + 1);
+    for (int i = 0; i < m_ringCount; ++i) {
+        m_capture.data.append(m_ring[(m_ringHead + i) % m_ring.size()]);
+    }
+    m_capture.triggerIndex = m_capture.data.size() - 1;     // the sample that fired is the newest
+    m_state = Capturing;
+
+    if (m_options.postTrigger <= 0) {
+        finishCapture(true);
+    }
+}
+
+void TriggerCapture::finishCapture(bool complete)
+{
+    m_capture.complete = complete;
+    m_completed.enqueue(m_capture);
+    m_capture = Capture();
+    ++m_captureCount;
+    m_state = complete && m_options.autoRearm ? Armed : Idle;
+}
@@ -0,0 +1,119 @@
+#ifndef TRIGGERCAPTURE_H
+#define TRIGGERCAPTURE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QQueue>
+#include <QJsonObject>
+
+#include "sensordata.h"
+#include "channelschema.h"
+#include "channelcondition.h"
+#include "calibration.h"
+
+// A test on one channel, made on every sample. Each condition is either
+// met or not on a sample; the capture fires when the combination turns
+// active, so a level that stays exceeded fires once, not on every sample.
+typedef ChannelCondition TriggerCondition;
+
+// Event-triggered capture from the live sample stream.
+//
+// Every sample goes through a ring buffer holding the last preTrigger
+// seconds, whether or not the capture is armed. When armed, the conditions
+// are evaluated per sample; on the sample that fires, the ring's contents
+// start the capture and samples are appended until postTrigger seconds
+// after the trigger. With autoRearm the next trigger is looked for from the
+// sample that completes a capture, and since the ring keeps running during
+// a capture, back-to-back events are captured without gaps between them.
+class TriggerCapture
+{
+public:
+    enum State {
+        Idle,
+        Armed,
+        Capturing
+    };
+
+    struct Options {
+        QVector<TriggerCondition> conditions;
+        bool requireAll;        // fire when all conditions are active, else any
+        double preTrigger;      // s of data kept from before the trigger
+        double postTrigger;     // s captured after the trigger
+        bool autoRearm;         // look for the next trigger after each capture
+        int source;             // device whose samples the conditions test; all are captured
+
+        Options() : requireAll(false), preTrigger(1.0), postTrigger(2.0), autoRearm(true), source(0) {}
+
+        QJsonObject toJson() const;
+        static Options fromJson(const QJsonObject& json);
+        static Options fromSettings();
+        void saveToSettings() const;
+    };
+
+    struct Capture {
+        QVector<SensorData> data;       // time-ordered, every source
+        int triggerIndex;               // of the sample that fired
+        qint64 triggerTimeUs;
+        int condition;                  // first condition active on that sample
+        bool complete;                  // false if cut short by disarm()
+
+        Capture() : triggerIndex(-1), triggerTimeUs(0), condition(-1), complete(false) {}
+        double duration() const;        // s
+    };
+
+    explicit TriggerCapture(const Options& options = Options());
+
+    void setOptions(const Options& options);
+    const Options& options() const { return m_options; }
+
+    // Resolves the conditions' channel names against the schema's channels
+    // and the quantities the calibration computes from them; conditions on
+    // channels neither provides are never active (see unresolvedChannels())
+    void setSchema(const ChannelSchema& schema, const CalibrationSet& calibration = CalibrationSet());
+    QStringList unresolvedChannels() const;
+
+    void arm();
+    // A capture in progress is ended early and queued as incomplete
+    void disarm();
+    // Clears the ring, any capture in progress and the queue
+    void reset();
+
+    State state() const { return m_state; }
+    bool isArmed() const { return m_state != Idle; }
+
+    // Returns the number of captures waiting in takeCapture()
+    int addSample(const SensorData& data);
+    Capture takeCapture();
+    int pendingCaptures() const { return m_completed.size(); }
+    int captureCount() const { return m_captureCount; }    // since reset()
+
+    // The condition types a trigger can be, in the order offered to the user
+    static QVector<ChannelCondition::Type> conditionTypes();
+
+    static const int MAX_RING_SAMPLES = 1 << 20;    // bounds the ring if time stalls
+
+private:
+    void resolveConditions();
+    bool evaluate(const SensorData& data, int* firstActive);
+    void pushRing(const SensorData& data);
+    void startCapture(const SensorData& data, int condition);
+    void finishCapture(bool complete);
+
+    Options m_options;
+    ChannelConditionSet m_conditions;
+    State m_state;
+    bool m_wasActive;
+
+    // Ring of the last preTrigger seconds; grows to the sample rate's need
+    // once and is then reused
+    QVector<SensorData> m_ring;
+    int m_ringHead;
+    int m_ringCount;
+
+    Capture m_capture;
+    QQueue<Capture> m_completed;
+    int m_captureCount;
+};
+
+#endif // TRIGGERCAPTURE_H
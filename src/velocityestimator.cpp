@@ -0,0 +1,435 @@
+#include "velocityestimator.h"
+#include <QtConcurrent>
+#include <QPair>
+#include <QtMath>
+
+namespace {
+
+// Samples per task when recomputing a long series on the thread pool
+const int PARALLEL_CHUNK_SIZE = 65536;
+
+// Full recompute interval for the running moments, bounds rounding drift
+const int MOMENT_REBUILD_INTERVAL = 4096;
+
+// Steps a central difference widens past duplicate timestamps
+const int MAX_WIDEN = 4;
+
+inline double toSeconds(qint64 timestampUs)
+{
+    return timestampUs / 1e6;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// VelocityEstimator
+
+void VelocityEstimator::processRange(QVector<SensorData>& data, int first, int last)
+{
+    SensorData* samples = data.data();
+
+    reset();
+    for (int i = first; i < last; ++i) {
+        samples[i].velocity = update(samples[i].timestampUs, samples[i].position);
+    }
+}
+
+std::unique_ptr<VelocityEstimator> VelocityEstimator::create(Method method)
+{
+    switch (method) {
+        case MovingAverage: return std::make_unique<MovingAverageEstimator>();
+        case SavitzkyGolay: return std::make_unique<SavitzkyGolayEstimator>();
+        case AlphaBeta: return std::make_unique<AlphaBetaEstimator>();
+        case CentralDifference: return std::make_unique<CentralDifferenceEstimator>();
+    }
+    return std::make_unique<SavitzkyGolayEstimator>();
+}
+
+QString VelocityEstimator::methodName(Method method)
+{
+    switch (method) {
+        case MovingAverage: return "Moving Average";
+        case SavitzkyGolay: return "Savitzky-Golay";
+        case AlphaBeta: return "Alpha-Beta Tracker";
+        case CentralDifference: return "Central Difference";
+    }
+    return QString();
+}
+
+QStringList VelocityEstimator::methodNames()
+{
+    return QStringList() << methodName(MovingAverage) << methodName(SavitzkyGolay)
+                         << methodName(AlphaBeta) << methodName(CentralDifference);
+}
+
+void VelocityEstimator::recompute(QVector<SensorData>& data, Method method, bool parallel)
+{
+    std::unique_ptr<VelocityEstimator> estimator = create(method);
+
+    if (!parallel || !estimator->isLocal() || data.size() < 2 * PARALLEL_CHUNK_SIZE) {
+        estimator->process(data);
+        return;
+    }
+
+    // Local estimators only read their neighbours' timestamp and position,
+    // so disjoint ranges can write their velocities concurrently
+    data.detach();
+
+    QVector<QPair<int, int>> ranges;
+    for (int first = 0; first < data.size(); first += PARALLEL_CHUNK_SIZE) {
+        ranges.append(qMakePair(first, qMin(first + PARALLEL_CHUNK_SIZE, int(data.size()))));
+    }
+
+    QtConcurrent::blockingMap(ranges, [&data, method](const QPair<int, int>& range) {
+        std::unique_ptr<VelocityEstimator> chunkEstimator = create(method);
+        chunkEstimator->processRange(data, range.first, range.second);
+    });
+}
+
+// ---------------------------------------------------------------------------
+// MovingAverageEstimator
+
+MovingAverageEstimator::MovingAverageEstimator()
+{
+    reset();
+}
+
+void MovingAverageEstimator::reset()
+{
+    m_head = 0;
+    m_count = 0;
+    m_sum = 0;
+    m_lastPosition = 0;
+    m_lastTimestamp = 0;
+    m_hasLast = false;
+    m_velocity = 0;
+}
+
+double MovingAverageEstimator::update(qint64 timestampUs, double position)
+{
+    if (m_hasLast && timestampUs > m_lastTimestamp) {
+        double deltaTime = toSeconds(timestampUs - m_lastTimestamp);
+        double instantVelocity = (position - m_lastPosition) / deltaTime;
+
+        if (m_count == HISTORY_SIZE) {
+            m_sum -= m_history[m_head];
+        } else {
+            ++m_count;
+        }
+        m_history[m_head] = instantVelocity;
+        m_sum += instantVelocity;
+        m_head = (m_head + 1) % HISTORY_SIZE;
+
+        m_velocity = m_sum / m_count;
+    }
+
+    m_lastPosition = position;
+    m_lastTimestamp = timestampUs;
+    m_hasLast = true;
+
+    return m_velocity;
+}
+
+// ---------------------------------------------------------------------------
+// SavitzkyGolayEstimator
+
+void SavitzkyGolayEstimator::Moments::clear()
+{
+    for (double& v : t) v = 0;
+    for (double& v : p) v = 0;
+}
+
+void SavitzkyGolayEstimator::Moments::add(double dt, double position, double sign)
+{
+    double dt2 = dt * dt;
+    t[0] += sign;
+    t[1] += sign * dt;
+    t[2] += sign * dt2;
+    t[3] += sign * dt2 * dt;
+    t[4] += sign * dt2 * dt2;
+    p[0] += sign * position;
+    p[1] += sign * position * dt;
+    p[2] += sign * position * dt2;
+}
+
+void SavitzkyGolayEstimator::Moments::shift(double offset)
+{
+    // Binomial expansion of sum((dt - offset)^k) in terms of the old sums
+    double d = offset;
+    double d2 = d * d;
+    double d3 = d2 * d;
+    double d4 = d2 * d2;
+
+    double t0 = t[0], t1 = t[1], t2 = t[2], t3 = t[3], t4 = t[4];
+    t[1] = t1 - d * t0;
+    t[2] = t2 - 2 * d * t1 + d2 * t0;
+    t[3] = t3 - 3 * d * t2 + 3 * d2 * t1 - d3 * t0;
+    t[4] = t4 - 4 * d * t3 + 6 * d2 * t2 - 4 * d3 * t1 + d4 * t0;
+
+    double p0 = p[0], p1 = p[1], p2 = p[2];
+    p[1] = p1 - d * p0;
+    p[2] = p2 - 2 * d * p1 + d2 * p0;
+}
+
+bool SavitzkyGolayEstimator::Moments::slope(double& velocity) const
+{
+    // Normal equations of p = a + b*dt + c*dt^2; b is the derivative at dt = 0
+    double det = t[0] * (t[2] * t[4] - t[3] * t[3])
+               - t[1] * (t[1] * t[4] - t[3] * t[2])
+               + t[2] * (t[1] * t[3] - t[2] * t[2]);
+
+    if (qAbs(det) > 1e-9 * t[0] * t[2] * t[4]) {
+        double detB = t[0] * (p[1] * t[4] - t[3] * p[2])
+                    - p[0] * (t[1] * t[4] - t[3] * t[2])
+                    + t[2] * (t[1] * p[2] - p[1] * t[2]);
+        velocity = detB / det;
+        return true;
+    }
+
+    // Fewer than three distinct timestamps: fall back to a straight line
+    double den = t[0] * t[2] - t[1] * t[1];
+    if (den > 1e-12 * t[0] * t[2]) {
+        velocity = (t[0] * p[1] - t[1] * p[0]) / den;
+        return true;
+    }
+
+    return false;
+}
+
+SavitzkyGolayEstimator::SavitzkyGolayEstimator(int windowSize)
+    : m_windowSize(qMax(3, windowSize | 1))
+{
+    m_times.resize(m_windowSize);
+    m_positions.resize(m_windowSize);
+    reset();
+}
+
+void SavitzkyGolayEstimator::reset()
+{
+    m_head = 0;
+    m_count = 0;
+    m_moments.clear();
+    m_reference = 0;
+    m_updatesSinceRebuild = 0;
+    m_velocity = 0;
+}
+
+double SavitzkyGolayEstimator::update(qint64 timestampUs, double position)
+{
+    double t = toSeconds(timestampUs);
+
+    if (m_count == 0) {
+        m_reference = t;
+    }
+
+    // Drop the oldest sample once the window is full
+    int slot;
+    if (m_count == m_windowSize) {
+        slot = m_head;
+        m_moments.add(m_times[slot] - m_reference, m_positions[slot], -1.0);
+        m_head = (m_head + 1) % m_windowSize;
+    } else {
+        slot = (m_head + m_count) % m_windowSize;
+        ++m_count;
+    }
+
+    // Re-centre on the new sample so the fit is evaluated at dt = 0
+    m_moments.shift(t - m_reference);
+    m_reference = t;
+    m_moments.add(0.0, position);
+
+    m_times[slot] = t;
+    m_positions[slot] = position;
+
+    if (++m_updatesSinceRebuild >= MOMENT_REBUILD_INTERVAL) {
+        rebuildMoments();
+    }
+
+    double velocity;
+    if (m_count >= 2 && m_moments.slope(velocity)) {
+        m_velocity = velocity;
+    }
+
+    return m_velocity;
+}
+
+void SavitzkyGolayEstimator::rebuildMoments()
+{
+    m_moments.clear();
+    for (int i = 0; i < m_count; ++i) {
+        int slot = (m_head + i) % m_windowSize;
+        m_moments.add(m_times[slot] - m_reference, m_positions[slot]);
+    }
+    m_updatesSinceRebuild = 0;
+}
+
+void SavitzkyGolayEstimator::processRange(QVector<SensorData>& data, int first, int last)
+{
+    SensorData* samples = data.data();
+    const int size = data.size();
+    const int halfWindow = m_windowSize / 2;
+
+    // Centred window, truncated at the ends of the recording
+    for (int i = first; i < last; ++i) {
+        int lo = qMax(0, i - halfWindow);
+        int hi = qMin(size - 1, i + halfWindow);
+        double reference = toSeconds(samples[i].timestampUs);
+
+        Moments moments;
+        moments.clear();
+        for (int j = lo; j <= hi; ++j) {
+            moments.add(toSeconds(samples[j].timestampUs) - reference, samples[j].position);
+        }
+
+        double velocity;
+        samples[i].velocity = moments.slope(velocity) ? velocity : 0.0;
+    }
+}
+
+int SavitzkyGolayEstimator::lookAhead() const
+{
+    return m_windowSize / 2;
+}
+
+// ---------------------------------------------------------------------------
+// AlphaBetaEstimator
+
+AlphaBetaEstimator::AlphaBetaEstimator(double alpha, double beta)
+    : m_alpha(alpha)
+    , m_beta(beta)
+{
+    reset();
+}
+
+void AlphaBetaEstimator::reset()
+{
+    m_position = 0;
+    m_velocity = 0;
+    m_lastTimestamp = 0;
+    m_initialised = false;
+}
+
+double AlphaBetaEstimator::step(double dt, double position)
+{
+    double predicted = m_position + m_velocity * dt;
+    double residual = position - predicted;
+
+    m_position = predicted + m_alpha * residual;
+    m_velocity += (m_beta / dt) * residual;
+
+    return m_velocity;
+}
+
+double AlphaBetaEstimator::update(qint64 timestampUs, double position)
+{
+    if (!m_initialised) {
+        m_position = position;
+        m_velocity = 0;
+        m_lastTimestamp = timestampUs;
+        m_initialised = true;
+        return m_velocity;
+    }
+
+    if (timestampUs > m_lastTimestamp) {
+        step(toSeconds(timestampUs - m_lastTimestamp), position);
+        m_lastTimestamp = timestampUs;
+    }
+
+    return m_velocity;
+}
+
+void AlphaBetaEstimator::processRange(QVector<SensorData>& data, int first, int last)
+{
+    if (last - first < 2) {
+        VelocityEstimator::processRange(data, first, last);
+        return;
+    }
+
+    SensorData* samples = data.data();
+
+    // Forward pass
+    reset();
+    for (int i = first; i < last; ++i) {
+        samples[i].velocity = update(samples[i].timestampUs, samples[i].position);
+    }
+
+    // Backward pass in reversed time; its velocity has the opposite sign.
+    // Averaging the two cancels the tracker lag.
+    m_position = samples[last - 1].position;
+    m_velocity = 0;
+    double backward = 0;
+    for (int i = last - 2; i >= first; --i) {
+        qint64 deltaUs = samples[i + 1].timestampUs - samples[i].timestampUs;
+        if (deltaUs > 0) {
+            backward = -step(toSeconds(deltaUs), samples[i].position);
+        }
+        samples[i].velocity = 0.5 * (samples[i].velocity + backward);
+    }
+    reset();
+}
+
+// ---------------------------------------------------------------------------
+// CentralDifferenceEstimator
+
+CentralDifferenceEstimator::CentralDifferenceEstimator()
+{
+    reset();
+}
+
+void CentralDifferenceEstimator::reset()
+{
+    m_timestamps[0] = m_timestamps[1] = 0;
+    m_positions[0] = m_positions[1] = 0;
+    m_count = 0;
+    m_velocity = 0;
+}
+
+double CentralDifferenceEstimator::update(qint64 timestampUs, double position)
+{
+    if (m_count > 0 && timestampUs <= m_timestamps[1]) {
+        // Duplicate or out-of-order timestamp carries no slope information
+        return m_velocity;
+    }
+
+    // Span two intervals when available, otherwise fall back to one
+    int oldest = m_count >= 2 ? 0 : 1;
+    if (m_count > 0 && timestampUs > m_timestamps[oldest]) {
+        m_velocity = (position - m_positions[oldest]) / toSeconds(timestampUs - m_timestamps[oldest]);
+    }
+
+    m_timestamps[0] = m_timestamps[1];
+    m_positions[0] = m_positions[1];
+    m_timestamps[1] = timestampUs;
+    m_positions[1] = position;
+    m_count = qMin(m_count + 1, 2);
+
+    return m_velocity;
+}
+
+int CentralDifferenceEstimator::lookAhead() const
+{
+    // One neighbour, widened past up to MAX_WIDEN duplicate timestamps
+    return 1 + MAX_WIDEN;
+}
+
+void CentralDifferenceEstimator::processRange(QVector<SensorData>& data, int first, int last)
+{
+    SensorData* samples = data.data();
+    const int size = data.size();
+
+    for (int i = first; i < last; ++i) {
+        int lo = qMax(0, i - 1);
+        int hi = qMin(size - 1, i + 1);
+
+        // Widen past a few duplicate timestamps
+        for (int step = 0; step < MAX_WIDEN && samples[hi].timestampUs <= samples[lo].timestampUs; ++step) {
+            if (lo > 0) --lo;
+            if (hi < size - 1) ++hi;
+        }
+
+        qint64 deltaUs = samples[hi].timestampUs - samples[lo].timestampUs;
+        samples[i].velocity = deltaUs > 0
+            ? (samples[hi].position - samples[lo].position) / toSeconds(deltaUs)
+            : 0.0;
+    }
+}
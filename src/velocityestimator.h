@@ -0,0 +1,170 @@
+#ifndef VELOCITYESTIMATOR_H
+#define VELOCITYESTIMATOR_H
+
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+#include "sensordata.h"
+
+// Derives shaft velocity from timestamped position samples.
+//
+// update() is the streaming path used during acquisition and costs O(1) per
+// sample. processRange() is the offline path used on recorded sessions; it
+// may look ahead of the current sample to remove phase lag.
+class VelocityEstimator
+{
+public:
+    enum Method {
+        MovingAverage,
+        SavitzkyGolay,
+        AlphaBeta,
+        CentralDifference
+    };
+
+    virtual ~VelocityEstimator() = default;
+
+    virtual Method method() const = 0;
+    virtual void reset() = 0;
+
+    // Streaming estimate (mm/s) for a new sample; timestamp in microseconds
+    // on the host timeline (SensorData::timestampUs)
+    virtual double update(qint64 timestampUs, double position) = 0;
+
+    // Offline estimate for data[first, last). Estimators that only look at a
+    // bounded neighbourhood (isLocal) may be run on independent ranges in
+    // parallel; the others must be given the whole series.
+    virtual void processRange(QVector<SensorData>& data, int first, int last);
+    virtual bool isLocal() const { return false; }
+    // Samples past data[i] that processRange() reads to estimate it (local
+    // estimators read as far back): 0 when it is update() run forwards, -1
+    // when it needs the whole series
+    virtual int lookAhead() const { return 0; }
+
+    void process(QVector<SensorData>& data) { processRange(data, 0, data.size()); }
+
+    static std::unique_ptr<VelocityEstimator> create(Method method);
+    static QString methodName(Method method);
+    static QStringList methodNames();
+
+    // Recomputes the velocity channel of a recorded series, splitting local
+    // estimators across the thread pool when parallel is set
+    static void recompute(QVector<SensorData>& data, Method method, bool parallel = true);
+};
+
+// Legacy behaviour: first difference smoothed by a 5-tap moving average,
+// kept as a fixed ring buffer with a running sum.
+class MovingAverageEstimator : public VelocityEstimator
+{
+public:
+    MovingAverageEstimator();
+
+    Method method() const override { return MovingAverage; }
+    void reset() override;
+    double update(qint64 timestampUs, double position) override;
+
+private:
+    static const int HISTORY_SIZE = 5;
+
+    double m_history[HISTORY_SIZE];
+    int m_head;
+    int m_count;
+    double m_sum;
+    double m_lastPosition;
+    qint64 m_lastTimestamp;     // us
+    bool m_hasLast;
+    double m_velocity;
+};
+
+// Least-squares quadratic fit over a sliding window of real (non-uniform)
+// timestamps. Streaming evaluates the derivative at the newest sample, so
+// there is no group delay; offline evaluates it at the window centre.
+class SavitzkyGolayEstimator : public VelocityEstimator
+{
+public:
+    explicit SavitzkyGolayEstimator(int windowSize = DEFAULT_WINDOW);
+
+    Method method() const override { return SavitzkyGolay; }
+    void reset() override;
+    double update(qint64 timestampUs, double position) override;
+    void processRange(QVector<SensorData>& data, int first, int last) override;
+    bool isLocal() const override { return true; }
+    int lookAhead() const override;
+
+    static const int DEFAULT_WINDOW = 9;
+
+private:
+    // Power sums of (t - tRef) and position, re-centred on every update
+    struct Moments {
+        double t[5];  // sum of dt^0 .. dt^4
+        double p[3];  // sum of p*dt^0 .. p*dt^2
+
+        void clear();
+        void add(double dt, double position, double sign = 1.0);
+        void shift(double offset);
+        bool slope(double& velocity) const;
+    };
+
+    void rebuildMoments();
+
+    int m_windowSize;
+    QVector<double> m_times;      // ring buffer, seconds
+    QVector<double> m_positions;  // ring buffer, mm
+    int m_head;
+    int m_count;
+    Moments m_moments;
+    double m_reference;           // time of newest sample, seconds
+    int m_updatesSinceRebuild;
+    double m_velocity;
+};
+
+// Fixed-gain alpha-beta tracker. Offline runs forward and backward passes
+// and averages them, which cancels the tracker's lag.
+class AlphaBetaEstimator : public VelocityEstimator
+{
+public:
+    explicit AlphaBetaEstimator(double alpha = DEFAULT_ALPHA, double beta = DEFAULT_BETA);
+
+    Method method() const override { return AlphaBeta; }
+    void reset() override;
+    double update(qint64 timestampUs, double position) override;
+    void processRange(QVector<SensorData>& data, int first, int last) override;
+    int lookAhead() const override { return -1; }
+
+    static constexpr double DEFAULT_ALPHA = 0.4;
+    static constexpr double DEFAULT_BETA = 0.08;
+
+private:
+    double step(double dt, double position);
+
+    double m_alpha;
+    double m_beta;
+    double m_position;
+    double m_velocity;
+    qint64 m_lastTimestamp;     // us
+    bool m_initialised;
+};
+
+// Two-sided difference. Streaming can only centre on the previous sample, so
+// it lags by one sample; offline it is exactly centred.
+class CentralDifferenceEstimator : public VelocityEstimator
+{
+public:
+    CentralDifferenceEstimator();
+
+    Method method() const override { return CentralDifference; }
+    void reset() override;
+    double update(qint64 timestampUs, double position) override;
+    void processRange(QVector<SensorData>& data, int first, int last) override;
+    bool isLocal() const override { return true; }
+    int lookAhead() const override;
+
+private:
+    qint64 m_timestamps[2];     // us
+    double m_positions[2];
+    int m_count;
+    double m_velocity;
+};
+
+#endif // VELOCITYESTIMATOR_H
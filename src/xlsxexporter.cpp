@@ -0,0 +1,316 @@
+#include "xlsxexporter.h"
+#include "csvexporter.h"
+#include "batchcomparison.h"
+#include "zipwriter.h"
+#include "tracing.h"
+#include <QSaveFile>
+#include <QDebug>
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+const char* const XML_DECLARATION = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n";
+const char* const MAIN_NAMESPACE = "http://schemas.openxmlformats.org/spreadsheetml/2006/main";
+const char* const RELATIONSHIP_NAMESPACE = "http://schemas.openxmlformats.org/officeDocument/2006/relationships";
+const char* const PACKAGE_RELATIONSHIP_NAMESPACE = "http://schemas.openxmlformats.org/package/2006/relationships";
+
+const int HEADER_STYLE = 1;     // bold, see stylesXml()
+
+// Bytes a data cell adds around its formatted value: <c><v></v></c>
+const int CELL_OVERHEAD = 14;
+const int ROW_OVERHEAD = 12;
+
+QByteArray escaped(const QString& text)
+{
+    return text.toHtmlEscaped().toUtf8();
+}
+
+void appendText(QByteArray& xml, const QString& text, int style = 0)
+{
+    xml += "<c t=\"inlineStr\"";
+    if (style > 0) {
+        xml += " s=\"" + QByteArray::number(style) + "\"";
+    }
+    xml += "><is><t>" + escaped(text) + "</t></is></c>";
+}
+
+void appendNumber(QByteArray& xml, double value)
+{
+    if (!qIsFinite(value)) {
+        xml += "<c/>";
+        return;
+    }
+    char buffer[CsvExporter::MAX_FIELD_LENGTH];
+    const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    xml += "<c><v>";
+    xml.append(buffer, int(result.ptr - buffer));
+    xml += "</v></c>";
+}
+
+void appendRow(QByteArray& xml, const QString& label, double value)
+{
+    xml += "<row>";
+    appendText(xml, label);
+    appendNumber(xml, value);
+    xml += "</row>\n";
+}
+
+void appendRow(QByteArray& xml, const QString& label, const QString& value)
+{
+    xml += "<row>";
+    appendText(xml, label);
+    appendText(xml, value);
+    xml += "</row>\n";
+}
+
+QByteArray worksheetStart()
+{
+    // Header row frozen above the data
+    return QByteArray(XML_DECLARATION) + "<worksheet xmlns=\"" + MAIN_NAMESPACE + "\">"
+        "<sheetViews><sheetView workbookViewId=\"0\">"
+        "<pane ySplit=\"1\" topLeftCell=\"A2\" activePane=\"bottomLeft\" state=\"frozen\"/>"
+        "</sheetView></sheetViews><sheetData>\n";
+}
+
+const char* const WORKSHEET_END = "</sheetData></worksheet>\n";
+
+QByteArray stylesXml()
+{
+    return QByteArray(XML_DECLARATION) + "<styleSheet xmlns=\"" + MAIN_NAMESPACE + "\">"
+        "<fonts count=\"2\">"
+        "<font><sz val=\"11\"/><name val=\"Calibri\"/></font>"
+        "<font><b/><sz val=\"11\"/><name val=\"Calibri\"/></font>"
+        "</fonts>"
+        "<fills count=\"2\"><fill><patternFill patternType=\"none\"/></fill>"
+        "<fill><patternFill patternType=\"gray125\"/></fill></fills>"
+        "<borders count=\"1\"><border><left/><right/><top/><bottom/><diagonal/></border></borders>"
+        "<cellStyleXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\"/></cellStyleXfs>"
+        "<cellXfs count=\"2\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\" xfId=\"0\"/>"
+        "<xf numFmtId=\"0\" fontId=\"1\" fillId=\"0\" borderId=\"0\" xfId=\"0\" applyFont=\"1\"/></cellXfs>"
+        "<cellStyles count=\"1\"><cellStyle name=\"Normal\" xfId=\"0\" builtinId=\"0\"/></cellStyles>"
+        "</styleSheet>\n";
+}
+
+} // namespace
+
+XlsxExporter::XlsxExporter(const Options& options)
+    : m_options(options)
+    , m_rows(0)
+    , m_dataSheets(0)
+{
+}
+
+QString XlsxExporter::sheetName(int dataSheet) const
+{
+    return m_dataSheets == 1 ? QString("Data") : QString("Data %1").arg(dataSheet + 1);
+}
+
+bool XlsxExporter::exportSession(const Session& session, const QString& filename)
+{
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_error = file.errorString();
+        qWarning() << "Failed to open Excel file for writing:" << filename;
+        return false;
+    }
+    if (!exportSession(session, &file)) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        m_error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool XlsxExporter::exportSession(const Session& session, QIODevice* device)
+{
+    SHOCKEE_TRACE_SCOPE("storage", "XlsxExporter::exportSession");
+
+    m_error.clear();
+    m_rows = 0;
+    if (!CsvExporter::selectColumns(session, m_options.columns, &m_columns, &m_error)) {
+        return false;
+    }
+
+    const SensorData* begin;
+    const SensorData* end;
+    CsvExporter::selectRange(session.data, m_options.startTime, m_options.endTime, &begin, &end);
+    const qint64 total = end - begin;
+    const int sheetRows = MAX_SHEET_ROWS - 1;
+    m_dataSheets = qMax(1, int((total + sheetRows - 1) / sheetRows));
+
+    // Package structure: summary first, then the data sheets
+    const int sheetCount = m_dataSheets + 1;
+    QByteArray contentTypes = QByteArray(XML_DECLARATION)
+        + "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+          "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+          "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+          "<Override PartName=\"/xl/workbook.xml\" "
+          "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+          "<Override PartName=\"/xl/styles.xml\" "
+          "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.styles+xml\"/>";
+    QByteArray workbook = QByteArray(XML_DECLARATION) + "<workbook xmlns=\"" + MAIN_NAMESPACE
+        + "\" xmlns:r=\"" + RELATIONSHIP_NAMESPACE + "\"><sheets>";
+    QByteArray workbookRels = QByteArray(XML_DECLARATION) + "<Relationships xmlns=\""
+        + PACKAGE_RELATIONSHIP_NAMESPACE + "\">";
+    for (int sheet = 1; sheet <= sheetCount; ++sheet) {
+        const QByteArray number = QByteArray::number(sheet);
+        const QString name = sheet == 1 ? QString("Summary") : sheetName(sheet - 2);
+        contentTypes += "<Override PartName=\"/xl/worksheets/sheet" + number + ".xml\" "
+                        "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>";
+        workbook += "<sheet name=\"" + escaped(name) + "\" sheetId=\"" + number + "\" r:id=\"rId" + number + "\"/>";
+        workbookRels += "<Relationship Id=\"rId" + number + "\" Type=\"" + RELATIONSHIP_NAMESPACE
+                        + "/worksheet\" Target=\"worksheets/sheet" + number + ".xml\"/>";
+    }
+    contentTypes += "</Types>\n";
+    workbook += "</sheets></workbook>\n";
+    workbookRels += "<Relationship Id=\"rId" + QByteArray::number(sheetCount + 1) + "\" Type=\""
+                    + RELATIONSHIP_NAMESPACE + "/styles\" Target=\"styles.xml\"/></Relationships>\n";
+    const QByteArray rootRels = QByteArray(XML_DECLARATION) + "<Relationships xmlns=\""
+        + PACKAGE_RELATIONSHIP_NAMESPACE + "\"><Relationship Id=\"rId1\" Type=\"" + RELATIONSHIP_NAMESPACE
+        + "/officeDocument\" Target=\"xl/workbook.xml\"/></Relationships>\n";
+
+    ZipWriter zip(device);
+    bool ok = writePart(zip, "[Content_Types].xml", contentTypes)
+           && writePart(zip, "_rels/.rels", rootRels)
+           && writePart(zip, "xl/workbook.xml", workbook)
+           && writePart(zip, "xl/_rels/workbook.xml.rels", workbookRels)
+           && writePart(zip, "xl/styles.xml", stylesXml())
+           && writeSummarySheet(zip, session, begin, end);
+
+    for (int sheet = 0; ok && sheet < m_dataSheets; ++sheet) {
+        const qint64 first = qint64(sheet) * sheetRows;
+        ok = writeDataSheet(zip, sheet, begin + first, int(qMin<qint64>(sheetRows, total - first)));
+    }
+
+    if (!ok || !zip.finish()) {
+        if (m_error.isEmpty()) {
+            m_error = zip.errorString();
+        }
+        return false;
+    }
+    m_rows = total;
+    return true;
+}
+
+bool XlsxExporter::writePart(ZipWriter& zip, const QString& name, const QByteArray& xml)
+{
+    return zip.beginEntry(name) && zip.write(xml) && zip.endEntry();
+}
+
+bool XlsxExporter::writeSummarySheet(ZipWriter& zip, const Session& session,
+                                     const SensorData* begin, const SensorData* end)
+{
+    const SessionSummary summary = BatchComparison::summarize(session, m_options.binWidth);
+
+    QByteArray xml = worksheetStart();
+    xml += "<row>";
+    appendText(xml, "Session", HEADER_STYLE);
+    appendText(xml, session.name, HEADER_STYLE);
+    xml += "</row>\n";
+    appendRow(xml, "Recorded", session.timestamp.toString(Qt::ISODate));
+    appendRow(xml, "Description", session.description);
+    appendRow(xml, "Strut", session.strut_info);
+    appendRow(xml, "Spring rate", session.spring_rate);
+    appendRow(xml, "Damping setting", session.damping_setting);
+    appendRow(xml, "Test conditions", session.test_conditions);
+    xml += "<row/>\n";
+
+    appendRow(xml, "Samples", summary.sampleCount);
+    appendRow(xml, "Duration (s)", summary.duration);
+    appendRow(xml, "Sample rate (Hz)", summary.sampleRate);
+    appendRow(xml, "Peak compression force (kg)", summary.peakCompressionForce);
+    appendRow(xml, "Peak rebound force (kg)", summary.peakReboundForce);
+    appendRow(xml, "Max velocity (mm/s)", summary.maxVelocity);
+    appendRow(xml, "Compression damping (kg*s/mm)", summary.compressionDamping);
+    appendRow(xml, "Rebound damping (kg*s/mm)", summary.reboundDamping);
+    appendRow(xml, "Cycles", summary.cycleCount);
+    appendRow(xml, "Energy (J)", summary.energy);
+    xml += "<row/>\n";
+
+    // Where each part of the exported range went
+    xml += "<row>";
+    for (const char* heading : { "Sheet", "Rows", "From (s)", "To (s)" }) {
+        appendText(xml, heading, HEADER_STYLE);
+    }
+    xml += "</row>\n";
+    const qint64 origin = session.data.isEmpty() ? 0 : session.data.first().timestamp;
+    const qint64 sheetRows = MAX_SHEET_ROWS - 1;
+    for (int sheet = 0; sheet < m_dataSheets; ++sheet) {
+        const SensorData* first = begin + sheet * sheetRows;
+        const qint64 count = qMin<qint64>(sheetRows, end - first);
+        xml += "<row>";
+        appendText(xml, sheetName(sheet));
+        appendNumber(xml, double(count));
+        if (count > 0) {
+            appendNumber(xml, (first->timestamp - origin) / 1000.0);
+            appendNumber(xml, (first[count - 1].timestamp - origin) / 1000.0);
+        }
+        xml += "</row>\n";
+    }
+    xml += WORKSHEET_END;
+
+    return writePart(zip, "xl/worksheets/sheet1.xml", xml);
+}
+
+bool XlsxExporter::writeDataSheet(ZipWriter& zip, int index, const SensorData* rows, int count)
+{
+    SHOCKEE_TRACE_SCOPE("storage", "XlsxExporter::writeDataSheet");
+
+    QVector<CsvExporter::FieldWriter> writers;
+    QVector<int> extraIndices;
+    QByteArray xml = worksheetStart() + "<row>";
+    for (const SensorChannel& channel : m_columns) {
+        CsvExporter::FieldWriter writer = CsvExporter::fieldWriter(channel);
+        if (!writer) {
+            continue;
+        }
+        writers << writer;
+        extraIndices << channel.extraIndex;
+        appendText(xml, channel.role == SensorChannel::Timestamp ? channel.title() : channel.label(), HEADER_STYLE);
+    }
+    xml += "</row>\n";
+
+    if (!zip.beginEntry(QString("xl/worksheets/sheet%1.xml").arg(index + 2)) || !zip.write(xml)) {
+        return false;
+    }
+
+    // One buffer, sized for the longest possible chunk and reused
+    const int columnCount = writers.size();
+    const int rowCapacity = ROW_OVERHEAD + columnCount * (CELL_OVERHEAD + CsvExporter::MAX_FIELD_LENGTH);
+    QByteArray chunk(qsizetype(ROWS_PER_CHUNK) * rowCapacity, Qt::Uninitialized);
+    const int precision = m_options.precision;
+
+    for (int start = 0; start < count; start += ROWS_PER_CHUNK) {
+        const int n = qMin(ROWS_PER_CHUNK, count - start);
+        char* out = chunk.data();
+        for (int i = 0; i < n; ++i) {
+            const SensorData& data = rows[start + i];
+            memcpy(out, "<row>", 5);
+            out += 5;
+            for (int c = 0; c < columnCount; ++c) {
+                memcpy(out, "<c><v>", 6);
+                char* value = out + 6;
+                char* valueEnd = writers[c](value, data, extraIndices[c], precision);
+                if (valueEnd == value) {
+                    // Missing value: an empty cell keeps the columns aligned
+                    memcpy(out, "<c/>", 4);
+                    out += 4;
+                } else {
+                    memcpy(valueEnd, "</v></c>", 8);
+                    out = valueEnd + 8;
+                }
+            }
+            memcpy(out, "</row>\n", 7);
+            out += 7;
+        }
+        if (!zip.write(chunk.constData(), out - chunk.constData())) {
+            return false;
+        }
+    }
+
+    return zip.write(QByteArray(WORKSHEET_END)) && zip.endEntry();
+}
@@ -0,0 +1,64 @@
+#ifndef XLSXEXPORTER_H
+#define XLSXEXPORTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <QIODevice>
+
+#include "datalogger.h"
+
+class ZipWriter;
+
+// Office Open XML workbook export of a session.
+//
+// The workbook has a Summary sheet (session metadata, the batch summary
+// figures and an index of the data sheets) followed by the samples. Sheet
+// XML is encoded ROWS_PER_CHUNK rows at a time and deflated straight into
+// the zip container, so memory use does not grow with the session. Data
+// beyond Excel's MAX_SHEET_ROWS continues on further sheets, each with its
+// own header row. Text cells are inline strings, so no shared string table
+// has to be collected.
+class XlsxExporter
+{
+public:
+    struct Options {
+        QStringList columns;    // channel names in output order; empty exports all
+        double startTime;       // s from the first sample
+        double endTime;         // s from the first sample, inclusive; < 0 runs to the end
+        int precision;          // significant digits; 0 is shortest round-trip
+        double binWidth;        // mm/s, for the summary's damping figures
+
+        Options()
+            : startTime(0), endTime(-1), precision(0), binWidth(DampingAnalyzer::DEFAULT_BIN_WIDTH) {}
+    };
+
+    explicit XlsxExporter(const Options& options = Options());
+
+    bool exportSession(const Session& session, const QString& filename);
+    bool exportSession(const Session& session, QIODevice* device);
+
+    QString errorString() const { return m_error; }
+    qint64 rowsWritten() const { return m_rows; }
+    int dataSheetCount() const { return m_dataSheets; }
+
+    static const int MAX_SHEET_ROWS = 1048576;  // Excel's limit, header row included
+    static const int ROWS_PER_CHUNK = 4096;
+
+private:
+    bool writeSummarySheet(ZipWriter& zip, const Session& session,
+                           const SensorData* begin, const SensorData* end);
+    bool writeDataSheet(ZipWriter& zip, int index, const SensorData* rows, int count);
+    bool writePart(ZipWriter& zip, const QString& name, const QByteArray& xml);
+
+    QString sheetName(int dataSheet) const;
+
+    Options m_options;
+    QVector<SensorChannel> m_columns;
+    QString m_error;
+    qint64 m_rows;
+    int m_dataSheets;
+};
+
+#endif // XLSXEXPORTER_H
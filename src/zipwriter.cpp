@@ -0,0 +1,304 @@
+#include "zipwriter.h"
+#include <QDateTime>
+#include <QDebug>
+#include <array>
+
+#ifdef SHOCKEE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const quint32 LOCAL_HEADER_SIGNATURE = 0x04034b50;
+const quint32 DATA_DESCRIPTOR_SIGNATURE = 0x08074b50;
+const quint32 CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+const quint32 END_OF_DIRECTORY_SIGNATURE = 0x06054b50;
+
+const quint16 VERSION_NEEDED = 20;          // 2.0: deflate and data descriptors
+const quint16 FLAG_DATA_DESCRIPTOR = 0x0008;
+const quint16 FLAG_UTF8_NAME = 0x0800;
+const quint16 METHOD_STORED = 0;
+const quint16 METHOD_DEFLATED = 8;
+
+const int DEFLATE_BUFFER_SIZE = 1 << 16;
+
+// Little-endian field appenders for the header records
+void put16(QByteArray& out, quint16 value)
+{
+    out.append(char(value & 0xff));
+    out.append(char(value >> 8));
+}
+
+void put32(QByteArray& out, quint32 value)
+{
+    put16(out, quint16(value & 0xffff));
+    put16(out, quint16(value >> 16));
+}
+
+#ifndef SHOCKEE_HAVE_ZLIB
+const std::array<quint32, 256>& crcTable()
+{
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> t;
+        for (quint32 n = 0; n < 256; ++n) {
+            quint32 c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+#endif
+
+} // namespace
+
+// Raw deflate stream of the current entry
+struct ZipWriter::Deflater
+{
+#ifdef SHOCKEE_HAVE_ZLIB
+    z_stream stream;
+    QByteArray buffer;
+
+    Deflater() : buffer(DEFLATE_BUFFER_SIZE, Qt::Uninitialized)
+    {
+        stream = z_stream();
+        // Negative window bits: no zlib header or checksum, as ZIP expects
+        deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    }
+    ~Deflater() { deflateEnd(&stream); }
+#endif
+};
+
+ZipWriter::ZipWriter(QIODevice* device)
+    : m_device(device)
+    , m_inEntry(false)
+    , m_offset(0)
+{
+    // One modification time for every entry, in MS-DOS format
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDate date = now.date();
+    const QTime time = now.time();
+    m_dosTime = quint16((time.hour() << 11) | (time.minute() << 5) | (time.second() / 2));
+    m_dosDate = quint16(((qMax(date.year(), 1980) - 1980) << 9) | (date.month() << 5) | date.day());
+}
+
+ZipWriter::~ZipWriter() = default;
+
+bool ZipWriter::deflateAvailable()
+{
+#ifdef SHOCKEE_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+quint32 ZipWriter::crc32(quint32 crc, const char* data, qint64 size)
+{
+#ifdef SHOCKEE_HAVE_ZLIB
+    // zlib's is table-sliced and much faster; feed it in uInt-sized pieces
+    while (size > 0) {
+        const uInt piece = uInt(qMin<qint64>(size, 1 << 30));
+        crc = quint32(::crc32(crc, reinterpret_cast<const Bytef*>(data), piece));
+        data += piece;
+        size -= piece;
+    }
+    return crc;
+#else
+    const std::array<quint32, 256>& table = crcTable();
+    crc = ~crc;
+    for (qint64 i = 0; i < size; ++i) {
+        crc = table[(crc ^ quint8(data[i])) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+#endif
+}
+
+bool ZipWriter::fail(const QString& error)
+{
+    m_error = error;
+    qWarning() << "ZIP write failed:" << error;
+    return false;
+}
+
+bool ZipWriter::writeRaw(const char* data, qint64 size)
+{
+    if (m_offset + size > MAX_OFFSET) {
+        return fail("Archive exceeds 4 GiB");
+    }
+    if (m_device->write(data, size) != size) {
+        return fail(m_device->errorString());
+    }
+    m_offset += size;
+    return true;
+}
+
+bool ZipWriter::beginEntry(const QString& name, Method method)
+{
+    if (m_inEntry && !endEntry()) {
+        return false;
+    }
+
+    Entry entry;
+    entry.name = name.toUtf8();
+    entry.method = method == Deflated && deflateAvailable() ? METHOD_DEFLATED : METHOD_STORED;
+    entry.crc = 0;
+    entry.compressedSize = 0;
+    entry.size = 0;
+    entry.headerOffset = m_offset;
+
+    // CRC and sizes follow the data in a descriptor
+    QByteArray header;
+    put32(header, LOCAL_HEADER_SIGNATURE);
+    put16(header, VERSION_NEEDED);
+    put16(header, FLAG_DATA_DESCRIPTOR | FLAG_UTF8_NAME);
+    put16(header, entry.method);
+    put16(header, m_dosTime);
+    put16(header, m_dosDate);
+    put32(header, 0);
+    put32(header, 0);
+    put32(header, 0);
+    put16(header, quint16(entry.name.size()));
+    put16(header, 0);
+    header.append(entry.name);
+    if (!writeRaw(header.constData(), header.size())) {
+        return false;
+    }
+
+    if (entry.method == METHOD_DEFLATED) {
+        m_deflater.reset(new Deflater);
+    }
+    m_entries << entry;
+    m_inEntry = true;
+    return true;
+}
+
+bool ZipWriter::write(const char* data, qint64 size)
+{
+    if (!m_inEntry) {
+        return fail("No open entry");
+    }
+
+    Entry& entry = m_entries.last();
+    entry.crc = crc32(entry.crc, data, size);
+    entry.size += size;
+
+    if (entry.method == METHOD_STORED) {
+        entry.compressedSize += size;
+        return writeRaw(data, size);
+    }
+
+#ifdef SHOCKEE_HAVE_ZLIB
+    z_stream& stream = m_deflater->stream;
+    while (size > 0) {
+        const uInt piece = uInt(qMin<qint64>(size, 1 << 30));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = piece;
+        do {
+            stream.next_out = reinterpret_cast<Bytef*>(m_deflater->buffer.data());
+            stream.avail_out = uInt(m_deflater->buffer.size());
+            deflate(&stream, Z_NO_FLUSH);
+            const qint64 produced = m_deflater->buffer.size() - stream.avail_out;
+            entry.compressedSize += produced;
+            if (produced > 0 && !writeRaw(m_deflater->buffer.constData(), produced)) {
+                return false;
+            }
+        } while (stream.avail_out == 0);
+        data += piece;
+        size -= piece;
+    }
+#endif
+    return true;
+}
+
+bool ZipWriter::endEntry()
+{
+    if (!m_inEntry) {
+        return true;
+    }
+    m_inEntry = false;
+    Entry& entry = m_entries.last();
+
+#ifdef SHOCKEE_HAVE_ZLIB
+    if (entry.method == METHOD_DEFLATED) {
+        z_stream& stream = m_deflater->stream;
+        stream.next_in = nullptr;
+        stream.avail_in = 0;
+        int status;
+        do {
+            stream.next_out = reinterpret_cast<Bytef*>(m_deflater->buffer.data());
+            stream.avail_out = uInt(m_deflater->buffer.size());
+            status = deflate(&stream, Z_FINISH);
+            const qint64 produced = m_deflater->buffer.size() - stream.avail_out;
+            entry.compressedSize += produced;
+            if (produced > 0 && !writeRaw(m_deflater->buffer.constData(), produced)) {
+                return false;
+            }
+        } while (status == Z_OK);
+        m_deflater.reset();
+        if (status != Z_STREAM_END) {
+            return fail("Deflate failed");
+        }
+    }
+#endif
+
+    if (entry.size > MAX_OFFSET || entry.compressedSize > MAX_OFFSET) {
+        return fail("Entry exceeds 4 GiB: " + QString::fromUtf8(entry.name));
+    }
+
+    QByteArray descriptor;
+    put32(descriptor, DATA_DESCRIPTOR_SIGNATURE);
+    put32(descriptor, entry.crc);
+    put32(descriptor, quint32(entry.compressedSize));
+    put32(descriptor, quint32(entry.size));
+    return writeRaw(descriptor.constData(), descriptor.size());
+}
+
+bool ZipWriter::finish()
+{
+    if (m_inEntry && !endEntry()) {
+        return false;
+    }
+    if (m_entries.size() > 0xffff) {
+        return fail("Too many entries");
+    }
+
+    const qint64 directoryOffset = m_offset;
+    QByteArray directory;
+    for (const Entry& entry : m_entries) {
+        put32(directory, CENTRAL_HEADER_SIGNATURE);
+        put16(directory, VERSION_NEEDED);     // made by
+        put16(directory, VERSION_NEEDED);
+        put16(directory, FLAG_DATA_DESCRIPTOR | FLAG_UTF8_NAME);
+        put16(directory, entry.method);
+        put16(directory, m_dosTime);
+        put16(directory, m_dosDate);
+        put32(directory, entry.crc);
+        put32(directory, quint32(entry.compressedSize));
+        put32(directory, quint32(entry.size));
+        put16(directory, quint16(entry.name.size()));
+        put16(directory, 0);                  // extra field
+        put16(directory, 0);                  // comment
+        put16(directory, 0);                  // disk
+        put16(directory, 0);                  // internal attributes
+        put32(directory, 0);                  // external attributes
+        put32(directory, quint32(entry.headerOffset));
+        directory.append(entry.name);
+    }
+
+    QByteArray end;
+    put32(end, END_OF_DIRECTORY_SIGNATURE);
+    put16(end, 0);
+    put16(end, 0);
+    put16(end, quint16(m_entries.size()));
+    put16(end, quint16(m_entries.size()));
+    put32(end, quint32(directory.size()));
+    put32(end, quint32(directoryOffset));
+    put16(end, 0);
+
+    return writeRaw(directory.constData(), directory.size())
+        && writeRaw(end.constData(), end.size());
+}
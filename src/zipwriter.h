@@ -0,0 +1,69 @@
+#ifndef ZIPWRITER_H
+#define ZIPWRITER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QIODevice>
+#include <memory>
+
+// Minimal streaming ZIP archive writer, enough for Office Open XML files.
+//
+// Entries are written one after another straight to the device: each gets
+// a local header with the sizes deferred to a data descriptor, so nothing
+// has to be held back or seeked over. Deflate needs zlib (SHOCKEE_HAVE_ZLIB);
+// without it Deflated entries are stored. Archives are limited to 4 GiB as
+// there is no ZIP64 support.
+class ZipWriter
+{
+public:
+    enum Method {
+        Stored,
+        Deflated
+    };
+
+    explicit ZipWriter(QIODevice* device);
+    ~ZipWriter();
+
+    bool beginEntry(const QString& name, Method method = Deflated);
+    bool write(const char* data, qint64 size);
+    bool write(const QByteArray& data) { return write(data.constData(), data.size()); }
+    bool endEntry();
+
+    // Writes the central directory; the device is left open
+    bool finish();
+
+    QString errorString() const { return m_error; }
+    qint64 bytesWritten() const { return m_offset; }
+
+    static bool deflateAvailable();
+    static quint32 crc32(quint32 crc, const char* data, qint64 size);
+
+private:
+    struct Entry {
+        QByteArray name;
+        quint16 method;
+        quint32 crc;
+        qint64 compressedSize;
+        qint64 size;
+        qint64 headerOffset;
+    };
+
+    struct Deflater;
+
+    bool writeRaw(const char* data, qint64 size);
+    bool fail(const QString& error);
+
+    QIODevice* m_device;
+    QVector<Entry> m_entries;
+    bool m_inEntry;
+    qint64 m_offset;
+    quint16 m_dosTime;
+    quint16 m_dosDate;
+    std::unique_ptr<Deflater> m_deflater;
+    QString m_error;
+
+    static const qint64 MAX_OFFSET = 0xFFFFFFFFLL;
+};
+
+#endif // ZIPWRITER_H
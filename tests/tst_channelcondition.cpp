@@ -0,0 +1,168 @@
+#include <QtTest>
+
+#include "channelcondition.h"
+#include "limitmonitor.h"
+#include "triggercapture.h"
+
+class TestChannelCondition : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void limitTripLatches();
+    void rateLimit();
+    void unresolvedChannel();
+    void triggerFiresOncePerEvent();
+    void crossingBothWays();
+    void legacyJsonKeys();
+
+private:
+    static SensorData sample(qint64 timestampUs, double position, double force);
+};
+
+SensorData TestChannelCondition::sample(qint64 timestampUs, double position, double force)
+{
+    SensorData data;
+    data.timestampUs = timestampUs;
+    data.timestamp = timestampUs / 1000;
+    data.position = position;
+    data.force = force;
+    return data;
+}
+
+// The first sample over the limit trips; later ones are not checked until
+// reset()
+void TestChannelCondition::limitTripLatches()
+{
+    LimitMonitor::Options options;
+    options.rules << LimitRule("force", LimitRule::Above, 100.0);
+    LimitMonitor monitor(options);
+
+    QVERIFY(!monitor.check(sample(0, 0, 90)));
+    QVERIFY(!monitor.check(sample(1000, 0, 100)));
+    QVERIFY(monitor.check(sample(2000, 0, 110)));
+    QVERIFY(monitor.isTripped());
+    QCOMPARE(monitor.trip().timestampUs, qint64(2000));
+    QCOMPARE(monitor.trip().value, 110.0);
+    QVERIFY(!monitor.check(sample(3000, 0, 150)));
+    QCOMPARE(monitor.trip().timestampUs, qint64(2000));
+
+    monitor.reset();
+    QVERIFY(!monitor.isTripped());
+    QVERIFY(monitor.check(sample(4000, 0, 120)));
+}
+
+// Rates come from the microsecond spacing, here a quarter millisecond, and
+// restart after reset() rather than spanning the gap
+void TestChannelCondition::rateLimit()
+{
+    LimitMonitor::Options options;
+    options.rules << LimitRule("position", LimitRule::Rate, 100.0);
+    LimitMonitor monitor(options);
+
+    double position = 0;
+    qint64 timeUs = 0;
+    for (int i = 0; i < 8; ++i) {
+        QVERIFY(!monitor.check(sample(timeUs, position, 0)));     // 80 mm/s
+        position += 0.02;
+        timeUs += 250;
+    }
+    QVERIFY(!monitor.check(sample(timeUs, position, 0)));
+    position -= 0.05;
+    timeUs += 250;
+    QVERIFY(monitor.check(sample(timeUs, position, 0)));         // -200 mm/s
+    QVERIFY(qAbs(monitor.trip().value + 200.0) < 1e-6);
+
+    monitor.reset();
+    QVERIFY(!monitor.check(sample(timeUs + 250, position + 1.0, 0)));
+    QVERIFY(!monitor.check(sample(timeUs + 500, position + 1.0, 0)));
+}
+
+void TestChannelCondition::unresolvedChannel()
+{
+    LimitMonitor::Options options;
+    options.rules << LimitRule("pressure", LimitRule::Magnitude, 1.0)
+                  << LimitRule("force", LimitRule::Below, -10.0);
+    LimitMonitor monitor(options);
+    QCOMPARE(monitor.unresolvedChannels(), QStringList() << "pressure");
+
+    const ChannelSchema schema = ChannelSchema::fromHeader(
+        "# Channels: timestamp[ms]:int,position[mm],force[kg],pressure[bar]");
+    monitor.setSchema(schema);
+    QVERIFY(monitor.unresolvedChannels().isEmpty());
+
+    monitor.setSchema(ChannelSchema::defaultSchema());
+    QVERIFY(!monitor.check(sample(0, 0, 0)));
+    QVERIFY(monitor.check(sample(1000, 0, -20)));
+    QCOMPARE(monitor.trip().rule.channel, QString("force"));
+}
+
+// A level that stays exceeded fires once; the capture fires again only
+// after the condition has been seen inactive
+void TestChannelCondition::triggerFiresOncePerEvent()
+{
+    TriggerCapture::Options options;
+    options.conditions << TriggerCondition("force", TriggerCondition::Magnitude, 50.0);
+    options.preTrigger = 0.002;
+    options.postTrigger = 0;
+    TriggerCapture capture(options);
+    capture.arm();
+
+    const double forces[] = { 0, 60, 70, 80, 10, -60, -70, 0 };
+    int timeMs = 0;
+    for (double force : forces) {
+        capture.addSample(sample(timeMs++ * 1000, 0, force));
+    }
+    QCOMPARE(capture.captureCount(), 2);
+    QCOMPARE(capture.pendingCaptures(), 2);
+    QCOMPARE(capture.takeCapture().triggerTimeUs, qint64(1000));
+    QCOMPARE(capture.takeCapture().triggerTimeUs, qint64(5000));
+}
+
+void TestChannelCondition::crossingBothWays()
+{
+    ChannelConditionSet conditions;
+    conditions.setConditions({ ChannelCondition("force", ChannelCondition::Crossing, 5.0) });
+
+    const double forces[] = { 0, 4, 6, 7, 3, 3, 8 };
+    const bool crossed[] = { false, false, true, false, true, false, true };
+    for (int i = 0; i < 7; ++i) {
+        QCOMPARE(conditions.test(0, sample(i * 1000, 0, forces[i])), crossed[i]);
+    }
+
+    // The first sample after a restart has nothing to cross from
+    conditions.restart();
+    QVERIFY(!conditions.test(0, sample(8000, 0, 0)));
+}
+
+// Limit rules and trigger conditions stored before they shared a type
+// still load, and save under the shared names
+void TestChannelCondition::legacyJsonKeys()
+{
+    const struct {
+        const char* key;
+        ChannelCondition::Type type;
+    } legacy[] = {
+        { "maximum", ChannelCondition::Above }, { "minimum", ChannelCondition::Below },
+        { "threshold", ChannelCondition::Magnitude }, { "slope", ChannelCondition::Rate },
+        { "rising", ChannelCondition::Above }, { "falling", ChannelCondition::Below },
+        { "crossing", ChannelCondition::Crossing }
+    };
+    for (const auto& entry : legacy) {
+        QJsonObject json;
+        json["channel"] = "velocity";
+        json["type"] = entry.key;
+        json["level"] = 2.5;
+        const ChannelCondition condition = ChannelCondition::fromJson(json);
+        QCOMPARE(condition.type, entry.type);
+        QCOMPARE(condition.channel, QString("velocity"));
+        QCOMPARE(condition.level, 2.5);
+
+        const ChannelCondition reloaded = ChannelCondition::fromJson(condition.toJson());
+        QCOMPARE(reloaded.type, condition.type);
+        QCOMPARE(reloaded.level, condition.level);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestChannelCondition)
+#include "tst_channelcondition.moc"
@@ -0,0 +1,109 @@
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "csvimporter.h"
+
+class TestCsvImporter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void subMillisecondSpacing();
+    void quotedFields();
+    void unsortedRows();
+
+private:
+    QString writeFile(const QByteArray& contents);
+
+    QTemporaryDir m_dir;
+    int m_files = 0;
+};
+
+QString TestCsvImporter::writeFile(const QByteArray& contents)
+{
+    const QString path = m_dir.filePath(QString("import%1.csv").arg(m_files++));
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size()) {
+        return QString();
+    }
+    return path;
+}
+
+// 4 kHz rows in seconds: every millisecond holds four samples, which must
+// keep distinct microsecond timestamps and a velocity from the real spacing
+void TestCsvImporter::subMillisecondSpacing()
+{
+    const int rows = 400;
+    const double speed = 50.0;     // mm/s
+
+    QByteArray contents = "Time (s),Position (mm),Force (kg)\n";
+    for (int i = 0; i < rows; ++i) {
+        const double t = i * 0.00025;
+        contents += QByteArray::number(t, 'f', 5) + ',' + QByteArray::number(10.0 + speed * t, 'f', 6)
+                  + ",1.0\n";
+    }
+    const QString path = writeFile(contents);
+    QVERIFY(!path.isEmpty());
+
+    CsvImporter importer;
+    Session session;
+    QVERIFY2(importer.importSession(path, &session), qPrintable(importer.errorString()));
+    QCOMPARE(session.data.size(), rows);
+
+    for (int i = 0; i < rows; ++i) {
+        const SensorData& data = session.data[i];
+        QCOMPARE(data.timestampUs, qint64(i) * 250);
+        QCOMPARE(data.timestamp, data.timestampUs / 1000);
+        QVERIFY2(qAbs(data.velocity - speed) < 1e-3,
+                 qPrintable(QString("row %1: %2 mm/s").arg(i).arg(data.velocity)));
+    }
+}
+
+void TestCsvImporter::quotedFields()
+{
+    const QString path = writeFile("timestamp,\"Temp, oil (degC)\",position_mm,force_kg\n"
+                                   "1,\"41.5\",10,2\n"
+                                   "2,\"1,5\",11,2\n"
+                                   "3,,12,2\n");
+    QVERIFY(!path.isEmpty());
+
+    CsvImporter importer;
+    Session session;
+    QVERIFY2(importer.importSession(path, &session), qPrintable(importer.errorString()));
+    QCOMPARE(session.data.size(), 3);
+
+    const int column = session.schema.indexOf("temp_oil");
+    QVERIFY(column >= 0);
+    const SensorChannel& channel = session.schema.channel(column);
+    QCOMPARE(channel.role, SensorChannel::Extra);
+    QCOMPARE(channel.unit, QString("degC"));
+
+    // The quoted separator does not shift the columns after it
+    const SensorExtraReader temperature{ channel.extraIndex };
+    QCOMPARE(temperature(session.data[0]), 41.5);
+    QVERIFY(qIsNaN(temperature(session.data[1])));
+    QVERIFY(qIsNaN(temperature(session.data[2])));
+    QCOMPARE(session.data[1].position, 11.0);
+    QCOMPARE(session.data[2].position, 12.0);
+}
+
+void TestCsvImporter::unsortedRows()
+{
+    const QString path = writeFile("timestamp,position_mm,force_kg,encoder_pulses,velocity_mm_s\n"
+                                   "3,12,0,0,0\n"
+                                   "1,10,0,0,0\n"
+                                   "2,11,0,0,0\n");
+    QVERIFY(!path.isEmpty());
+
+    CsvImporter importer;
+    Session session;
+    QVERIFY(importer.importSession(path, &session));
+    QCOMPARE(session.data.size(), 3);
+    for (int i = 0; i < session.data.size(); ++i) {
+        QCOMPARE(session.data[i].timestampUs, qint64(i + 1) * 1000);
+        QCOMPARE(session.data[i].position, 10.0 + i);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestCsvImporter)
+#include "tst_csvimporter.moc"
@@ -0,0 +1,102 @@
+#include <QtTest>
+#include <QRegularExpression>
+#include <QtMath>
+
+#include "resampler.h"
+
+class TestResampler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sampleRateEstimate();
+    void linearSubMillisecond();
+    void windowedSincSine();
+    void oversizedGrid();
+
+private:
+    // 4 kHz with +-50 us of jitter, position and force linear in time
+    static QVector<SensorData> jittered(int count);
+};
+
+QVector<SensorData> TestResampler::jittered(int count)
+{
+    QVector<SensorData> data;
+    for (int i = 0; i < count; ++i) {
+        SensorData sample;
+        sample.timestampUs = 2000000 + qint64(i) * 250 + (i % 3 - 1) * 50;
+        sample.timestamp = sample.timestampUs / 1000;
+        const double t = sample.timestampUs / 1e6;
+        sample.position = 1000.0 * t;
+        sample.force = 3.0 - 20.0 * t;
+        data << sample;
+    }
+    return data;
+}
+
+// Four samples per millisecond; a single dropout does not move the median
+void TestResampler::sampleRateEstimate()
+{
+    QVector<SensorData> data;
+    for (int i = 0; i < 100; ++i) {
+        SensorData sample;
+        sample.timestampUs = qint64(i) * 250 + (i >= 50 ? 5000 : 0);
+        sample.timestamp = sample.timestampUs / 1000;
+        data << sample;
+    }
+    QCOMPARE(Resampler::estimateSampleRate(data), 4000.0);
+}
+
+void TestResampler::linearSubMillisecond()
+{
+    const QVector<SensorData> data = jittered(400);
+    const double rate = 10000.0;
+    const UniformSeries series = Resampler::resample(data, rate, Resampler::Linear);
+
+    const double start = data.first().timestampUs / 1e6;
+    const double duration = data.last().timestampUs / 1e6 - start;
+    QCOMPARE(series.startTime, start);
+    QCOMPARE(series.sampleRate, rate);
+    QCOMPARE(series.size(), int(duration * rate) + 1);
+    for (int i = 0; i < series.size(); ++i) {
+        const double t = series.timeAt(i);
+        QVERIFY2(qAbs(series.position[i] - 1000.0 * t) < 1e-6, qPrintable(QString::number(i)));
+        QVERIFY2(qAbs(series.force[i] - (3.0 - 20.0 * t)) < 1e-6, qPrintable(QString::number(i)));
+    }
+}
+
+// A 10 Hz sine at 4 kHz brought down to 1 kHz; away from the ends, where
+// the kernel runs out of samples, the output follows the sine
+void TestResampler::windowedSincSine()
+{
+    QVector<SensorData> data;
+    for (int i = 0; i < 4000; ++i) {
+        SensorData sample;
+        sample.timestampUs = qint64(i) * 250;
+        sample.timestamp = sample.timestampUs / 1000;
+        sample.position = qSin(2.0 * M_PI * 10.0 * sample.timestampUs / 1e6);
+        data << sample;
+    }
+
+    const UniformSeries series = Resampler::resample(data, 1000.0, Resampler::WindowedSinc);
+    QCOMPARE(series.size(), 1000);
+    for (int i = 20; i < series.size() - 20; ++i) {
+        const double expected = qSin(2.0 * M_PI * 10.0 * series.timeAt(i));
+        QVERIFY2(qAbs(series.position[i] - expected) < 1e-2, qPrintable(QString::number(i)));
+    }
+}
+
+// A timestamp glitch that would need more than MAX_UPSAMPLING grid samples
+// per input sample gives no series rather than a truncated one
+void TestResampler::oversizedGrid()
+{
+    QVector<SensorData> data = jittered(10);
+    data.last().timestampUs += 3600LL * 1000000;
+
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("refusing more than"));
+    const UniformSeries series = Resampler::resample(data, 1000.0);
+    QVERIFY(series.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestResampler)
+#include "tst_resampler.moc"
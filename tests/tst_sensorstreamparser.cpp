@@ -0,0 +1,115 @@
+#include <QtTest>
+
+#include "sensorstreamparser.h"
+#include "deviceclock.h"
+
+class TestSensorStreamParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void offlineTimeline();
+    void rollover();
+    void deviceReset();
+    void driftCorrection();
+    void chunkedLines();
+
+private:
+    static QByteArray line(quint32 deviceMillis, double position);
+};
+
+QByteArray TestSensorStreamParser::line(quint32 deviceMillis, double position)
+{
+    return QString("%1,%2,1.5,0\n").arg(deviceMillis).arg(position).toUtf8();
+}
+
+// Without host times the timeline is the device's, in microseconds, and the
+// millisecond timestamp is derived from it
+void TestSensorStreamParser::offlineTimeline()
+{
+    SensorStreamParser parser;
+    QByteArray bytes;
+    for (int i = 0; i < 50; ++i) {
+        bytes += line(5000 + i * 2, 0.1 * i);
+    }
+    const QVector<SensorData> samples = parser.feed(bytes);
+    QCOMPARE(samples.size(), 50);
+    for (int i = 0; i < samples.size(); ++i) {
+        QCOMPARE(samples[i].timestampUs, qint64(5000 + i * 2) * 1000);
+        QCOMPARE(samples[i].timestamp, samples[i].timestampUs / 1000);
+    }
+}
+
+void TestSensorStreamParser::rollover()
+{
+    DeviceClock clock;
+    const quint32 start = 0xFFFFFFFFu - 4;
+    qint64 previous = clock.map(start);
+    for (quint32 step = 1; step <= 10; ++step) {
+        const qint64 mapped = clock.map(quint32(start + step));
+        QCOMPARE(mapped - previous, qint64(1000));
+        previous = mapped;
+    }
+    QCOMPARE(clock.rollovers(), 1);
+    QCOMPARE(clock.resets(), 0);
+}
+
+// A board reset sends millis() back to zero; the timeline carries on from
+// the last output by the last step instead of going backwards
+void TestSensorStreamParser::deviceReset()
+{
+    DeviceClock clock;
+    qint64 last = 0;
+    for (qint64 millis = 100000; millis <= 100010; millis += 2) {
+        last = clock.map(millis);
+    }
+    const qint64 afterReset = clock.map(3);
+    QCOMPARE(clock.resets(), 1);
+    QCOMPARE(afterReset, last + 2000);
+    QCOMPARE(clock.map(5), afterReset + 2000);
+}
+
+// A device running 200 ppm slow is mapped onto the host clock once the fit
+// spans MIN_FIT_SPAN
+void TestSensorStreamParser::driftCorrection()
+{
+    DeviceClock clock;
+    const double hostNsPerMs = 1e6 * (1.0 + 200e-6);
+    const qint64 hostStart = 10000000000LL;
+    qint64 mapped = 0;
+    qint64 host = 0;
+    for (qint64 millis = 0; millis <= 3 * DeviceClock::MIN_FIT_SPAN; ++millis) {
+        host = hostStart + qRound64(millis * hostNsPerMs);
+        mapped = clock.map(millis, host);
+    }
+    QVERIFY(qAbs(clock.drift() - 200.0) < 1.0);
+    QVERIFY(qAbs(mapped - host / 1000) < 5);
+}
+
+// Lines split across reads, a schema header with an extra channel and a
+// sequence field; every sample keeps its device time in microseconds
+void TestSensorStreamParser::chunkedLines()
+{
+    QByteArray stream = "# Channels: timestamp[ms]:int,position[mm],force[kg],temperature[degC]\n";
+    for (int i = 0; i < 20; ++i) {
+        stream += QString("%1,%2,2.0,%3,%4\n").arg(1000 + i).arg(i * 0.5).arg(25.0 + i).arg(i).toUtf8();
+    }
+
+    SensorStreamParser parser;
+    QVector<SensorData> samples;
+    for (int offset = 0; offset < stream.size(); offset += 7) {
+        samples += parser.feed(stream.mid(offset, 7));
+    }
+    QCOMPARE(samples.size(), 20);
+    const int temperature = parser.schema().channel(parser.schema().indexOf("temperature")).extraIndex;
+    QVERIFY(temperature >= 0);
+    for (int i = 0; i < samples.size(); ++i) {
+        QCOMPARE(samples[i].timestampUs, qint64(1000 + i) * 1000);
+        QCOMPARE(samples[i].position, i * 0.5);
+        QCOMPARE(SensorExtraReader{ temperature }(samples[i]), 25.0 + i);
+    }
+    QCOMPARE(parser.health().parseErrors, qint64(0));
+}
+
+QTEST_GUILESS_MAIN(TestSensorStreamParser)
+#include "tst_sensorstreamparser.moc"
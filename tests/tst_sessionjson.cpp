@@ -0,0 +1,179 @@
+#include <QtTest>
+#include <QBuffer>
+#include <QTemporaryDir>
+
+#include "sessionjson.h"
+
+class TestSessionJson : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void roundTrip();
+    void byteOrderMark();
+    void chunkedRead();
+    void millisecondOnlyTimestamps();
+
+private:
+    QByteArray encode(const Session& session);
+    QString writeFile(const QString& name, const QByteArray& contents);
+
+    Session m_session;
+    int m_temperature = -1;
+    QTemporaryDir m_dir;
+};
+
+void TestSessionJson::initTestCase()
+{
+    bool ok;
+    m_session.name = "roundtrip";
+    m_session.schema = ChannelSchema::fromHeader(
+        "# Channels: timestamp[ms]:int,position[mm],force[kg],temperature[degC]", &ok);
+    QVERIFY(ok);
+    m_temperature = m_session.schema.channel(m_session.schema.indexOf("temperature")).extraIndex;
+    QVERIFY(m_temperature >= 0);
+
+    // 4 kHz primary samples with a 1 kHz auxiliary board in between
+    SensorExtraStore extras;
+    for (int i = 0; i < 200; ++i) {
+        SensorData data;
+        data.timestampUs = 1000000 + qint64(i) * 250;
+        data.timestamp = data.timestampUs / 1000;
+        data.position = 20.0 + 0.125 * i;
+        data.force = -3.5 + 0.01 * i;
+        data.velocity = 500.0;
+        data.encoderPulses = i * 3;
+        const int extraCount = m_session.schema.extraCount();
+        double* values = extras.allocate(&data.extra, extraCount);
+        std::fill(values, values + extraCount, qQNaN());
+        if (i % 7 != 0) {
+            values[m_temperature] = 30.0 + 0.5 * i;
+        }
+        m_session.data.append(data);
+
+        if (i % 4 == 2) {
+            SensorData auxiliary;
+            auxiliary.timestampUs = data.timestampUs + 10;
+            auxiliary.timestamp = auxiliary.timestampUs / 1000;
+            auxiliary.position = -i;
+            auxiliary.source = 1;
+            m_session.auxiliary.append(auxiliary);
+        }
+    }
+}
+
+QByteArray TestSessionJson::encode(const Session& session)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    SessionJson writer;
+    if (!writer.write(session, &buffer)) {
+        return QByteArray();
+    }
+    return buffer.data();
+}
+
+QString TestSessionJson::writeFile(const QString& name, const QByteArray& contents)
+{
+    const QString path = m_dir.filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size()) {
+        return QString();
+    }
+    return path;
+}
+
+static void compareSamples(const QVector<SensorData>& actual, const QVector<SensorData>& expected,
+                           int extraIndex)
+{
+    QCOMPARE(actual.size(), expected.size());
+    const SensorExtraReader extra{ extraIndex };
+    for (int i = 0; i < expected.size(); ++i) {
+        QCOMPARE(actual[i].timestampUs, expected[i].timestampUs);
+        QCOMPARE(actual[i].timestamp, expected[i].timestamp);
+        QCOMPARE(actual[i].position, expected[i].position);
+        QCOMPARE(actual[i].force, expected[i].force);
+        QCOMPARE(actual[i].velocity, expected[i].velocity);
+        QCOMPARE(actual[i].encoderPulses, expected[i].encoderPulses);
+        QCOMPARE(actual[i].source, expected[i].source);
+        if (qIsNaN(extra(expected[i]))) {
+            QVERIFY(qIsNaN(extra(actual[i])));
+        } else {
+            QCOMPARE(extra(actual[i]), extra(expected[i]));
+        }
+    }
+}
+
+void TestSessionJson::roundTrip()
+{
+    const QByteArray json = encode(m_session);
+    QVERIFY(!json.isEmpty());
+
+    SessionJson reader;
+    Session session;
+    QVERIFY2(reader.read(json.constData(), json.size(), &session), qPrintable(reader.errorString()));
+    QCOMPARE(session.name, m_session.name);
+    QVERIFY(session.schema == m_session.schema);
+    compareSamples(session.data, m_session.data, m_temperature);
+    compareSamples(session.auxiliary, m_session.auxiliary, m_temperature);
+}
+
+void TestSessionJson::byteOrderMark()
+{
+    const QByteArray json = "\xEF\xBB\xBF" + encode(m_session);
+    const QString path = writeFile("bom.json", json);
+    QVERIFY(!path.isEmpty());
+
+    SessionJson reader;
+    Session session;
+    QVERIFY2(reader.read(path, &session), qPrintable(reader.errorString()));
+    compareSamples(session.data, m_session.data, m_temperature);
+
+    Session fromMemory;
+    QVERIFY(reader.read(json.constData(), json.size(), &fromMemory));
+    QCOMPARE(fromMemory.data.size(), m_session.data.size());
+}
+
+void TestSessionJson::chunkedRead()
+{
+    const QString path = writeFile("chunked.json", encode(m_session));
+    QVERIFY(!path.isEmpty());
+
+    SessionJson reader;
+    Session session;
+    QVector<SensorData> data;
+    QVector<SensorData> auxiliary;
+    int chunks = 0;
+    QVERIFY(reader.readChunks(path, &session, 7,
+        [&](QVector<SensorData>& chunk, QVector<SensorData>& chunkAuxiliary) {
+            ++chunks;
+            data += chunk;
+            auxiliary += chunkAuxiliary;
+            return true;
+        }));
+    QVERIFY(chunks > 1);
+    QVERIFY(session.data.isEmpty());
+    QVERIFY(session.schema == m_session.schema);
+    compareSamples(data, m_session.data, m_temperature);
+    compareSamples(auxiliary, m_session.auxiliary, m_temperature);
+}
+
+// Files written before timestamp_us existed read back on a ms timeline
+void TestSessionJson::millisecondOnlyTimestamps()
+{
+    const QByteArray json = "{\"name\": \"old\", \"data\": [\n"
+                            "{\"timestamp\": 5, \"position\": 1, \"force\": 2, \"encoder_pulses\": 3},\n"
+                            "{\"timestamp\": 6, \"position\": 1.5, \"force\": 2, \"encoder_pulses\": 4}\n"
+                            "]}";
+    SessionJson reader;
+    Session session;
+    QVERIFY2(reader.read(json.constData(), json.size(), &session), qPrintable(reader.errorString()));
+    QCOMPARE(session.data.size(), 2);
+    QCOMPARE(session.data[0].timestampUs, qint64(5000));
+    QCOMPARE(session.data[1].timestampUs, qint64(6000));
+    QCOMPARE(session.data[1].position, 1.5);
+}
+
+QTEST_GUILESS_MAIN(TestSessionJson)
+#include "tst_sessionjson.moc"
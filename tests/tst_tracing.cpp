@@ -0,0 +1,134 @@
+#include <QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <atomic>
+#include <thread>
+
+#include "tracing.h"
+
+// Events are recorded on std::threads, whose thread_local destructors have
+// run once join() returns, so a thread's ring is retired by then. The test
+// thread itself never records anything.
+class TestTracing : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void retiredWraparound();
+    void liveSnapshot();
+    void concurrentWriter();
+
+private:
+    // "X" events of the category in the current export
+    static QVector<QJsonObject> exported(const char* category, qint64* dropped = nullptr);
+};
+
+QVector<QJsonObject> TestTracing::exported(const char* category, qint64* dropped)
+{
+    const QJsonObject trace = QJsonDocument::fromJson(Tracer::toChromeTrace()).object();
+    QVector<QJsonObject> events;
+    for (const QJsonValue& value : trace["traceEvents"].toArray()) {
+        const QJsonObject event = value.toObject();
+        if (event["ph"].toString() == "X" && event["cat"].toString() == QLatin1String(category)) {
+            events << event;
+        }
+    }
+    if (dropped) {
+        *dropped = trace["otherData"].toObject()["dropped_events"].toInteger();
+    }
+    return events;
+}
+
+void TestTracing::init()
+{
+    Tracer::clear();
+}
+
+// A thread that overruns its ring keeps the newest BUFFER_CAPACITY events,
+// in order, and the overwritten ones are counted
+void TestTracing::retiredWraparound()
+{
+    const int extra = 100;
+    const qint64 base = Tracer::now();
+    std::thread writer([base]() {
+        for (int i = 0; i < Tracer::BUFFER_CAPACITY + extra; ++i) {
+            Tracer::complete("wrap", "event", base + i * 1000, base + i * 1000 + 500);
+        }
+    });
+    writer.join();
+
+    qint64 dropped = 0;
+    const QVector<QJsonObject> events = exported("wrap", &dropped);
+    QCOMPARE(events.size(), int(Tracer::BUFFER_CAPACITY));
+    QCOMPARE(dropped, qint64(extra));
+    for (int i = 0; i < events.size(); ++i) {
+        QCOMPARE(events[i]["ts"].toDouble(), (base + qint64(i + extra) * 1000) / 1000.0);
+    }
+}
+
+// A running thread's events are exported while it keeps its ring
+void TestTracing::liveSnapshot()
+{
+    const int count = 1000;
+    const qint64 base = Tracer::now();
+    std::atomic<bool> written(false);
+    std::atomic<bool> exportDone(false);
+    std::thread writer([&]() {
+        for (int i = 0; i < count; ++i) {
+            Tracer::complete("live", "event", base + i, base + i + 1);
+        }
+        written.store(true);
+        while (!exportDone.load()) {
+            std::this_thread::yield();
+        }
+    });
+    while (!written.load()) {
+        std::this_thread::yield();
+    }
+
+    qint64 dropped = -1;
+    const QVector<QJsonObject> events = exported("live", &dropped);
+    exportDone.store(true);
+    writer.join();
+
+    QCOMPARE(events.size(), count);
+    QCOMPARE(dropped, qint64(0));
+}
+
+// Exports taken while the writer laps its ring never contain an event
+// assembled from two writes; every event is written with a 7 ns duration
+void TestTracing::concurrentWriter()
+{
+    const qint64 base = Tracer::now();
+    std::atomic<bool> stop(false);
+    std::atomic<qint64> recorded(0);
+    std::thread writer([&]() {
+        qint64 i = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            Tracer::complete("torn", "event", base + i * 10, base + i * 10 + 7);
+            recorded.store(++i, std::memory_order_relaxed);
+        }
+    });
+
+    // Counted rather than compared in the loop, so the writer is always joined
+    int checked = 0;
+    int torn = 0;
+    while (checked < 20 || recorded.load() < 4 * Tracer::BUFFER_CAPACITY) {
+        for (const QJsonObject& event : exported("torn")) {
+            const qint64 start = qRound64(event["ts"].toDouble() * 1000.0);
+            const qint64 duration = qRound64(event["dur"].toDouble() * 1000.0);
+            if (duration != 7 || (start - base) % 10 != 0) {
+                ++torn;
+            }
+        }
+        ++checked;
+    }
+    stop.store(true);
+    writer.join();
+    QCOMPARE(torn, 0);
+}
+
+QTEST_GUILESS_MAIN(TestTracing)
+#include "tst_tracing.moc"